@@ -0,0 +1,114 @@
+/**
+ * @file bench.c
+ * @brief Timing and reporting of the benchmark workloads
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <string.h>
+#include "bench.h"
+#include "../../main_device/src/workq.h"
+
+#if defined(CONFIG_NATIVE_LIBC)
+#include <time.h>
+#include <sys/resource.h>
+#endif
+
+static uint32_t failures;
+
+uint64_t bench_now_ns(void)
+{
+#if defined(CONFIG_NATIVE_LIBC)
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#elif defined(CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER)
+    return k_cyc_to_ns_floor64(k_cycle_get_64());
+#else
+    return k_cyc_to_ns_floor64(k_cycle_get_32());
+#endif
+}
+
+void bench_begin(struct bench_result *res, const char *name)
+{
+    memset(res, 0, sizeof(*res));
+    res->name = name;
+    res->start_ns = bench_now_ns();
+}
+
+void bench_add(struct bench_result *res, uint64_t ns)
+{
+    res->ops++;
+    rentscan_latency_record(&res->hist, ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns);
+}
+
+void bench_record(struct bench_result *res, uint64_t start_ns)
+{
+    bench_add(res, bench_now_ns() - start_ns);
+}
+
+/* Print nanoseconds as microseconds with three decimals */
+#define US_FMT "%u.%03u"
+#define US_ARG(ns) (unsigned int)((ns) / 1000), (unsigned int)((ns) % 1000)
+
+void bench_end(struct bench_result *res)
+{
+    res->elapsed_ns = bench_now_ns() - res->start_ns;
+
+    uint64_t ops_per_s = res->elapsed_ns ?
+                         (uint64_t)res->ops * NSEC_PER_SEC / res->elapsed_ns : 0;
+    uint32_t p50 = rentscan_latency_percentile(&res->hist, 50);
+    uint32_t p99 = rentscan_latency_percentile(&res->hist, 99);
+
+    printk("bench %s: ops=%u ms=%u ops_per_s=%u mean_us=" US_FMT " p50_us=" US_FMT
+           " p99_us=" US_FMT " max_us=" US_FMT "\n",
+           res->name, res->ops, (unsigned int)(res->elapsed_ns / NSEC_PER_MSEC),
+           (unsigned int)ops_per_s, US_ARG(rentscan_latency_mean(&res->hist)),
+           US_ARG(p50), US_ARG(p99), US_ARG(res->hist.max_us));
+}
+
+bool bench_check(bool ok, const char *what)
+{
+    if (!ok) {
+        failures++;
+        printk("bench check failed: %s\n", what);
+    }
+    return ok;
+}
+
+uint32_t bench_failures(void)
+{
+    return failures;
+}
+
+#if !defined(CONFIG_NATIVE_LIBC)
+static void report_stack(const char *name, struct k_thread *thread)
+{
+    size_t size;
+    size_t used;
+
+    if (rentscan_thread_stack_usage(thread, &size, &used) == 0) {
+        printk("bench stack %s: used=%u size=%u\n", name,
+               (unsigned int)used, (unsigned int)size);
+    }
+}
+#endif
+
+void bench_report_memory(void)
+{
+#if defined(CONFIG_NATIVE_LIBC)
+    /* Threads run on host stacks here, so only the process peak means anything */
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage) == 0) {
+        printk("bench memory: peak_rss_kb=%ld\n", usage.ru_maxrss);
+    }
+#else
+    report_stack("main", k_current_get());
+    report_stack("tag_wq", &workq_tag.queue.thread);
+    report_stack("rental_wq", &workq_rental.queue.thread);
+    report_stack("persist_wq", &workq_persist.queue.thread);
+    report_stack("housekeeping_wq", &workq_housekeeping.queue.thread);
+#endif
+}
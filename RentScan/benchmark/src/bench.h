@@ -0,0 +1,93 @@
+/**
+ * @file bench.h
+ * @brief Timing and reporting of the benchmark workloads
+ *
+ * Samples are kept in the same log2 histograms as the tap latency
+ * statistics, only in nanoseconds, and every workload ends with one
+ * "bench <name>: ..." line that scripts can compare against a baseline.
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include "../../common/include/rentscan_latency.h"
+
+/**
+ * @brief Results of one workload
+ */
+struct bench_result {
+    const char *name;                    /**< Name in the report */
+    uint32_t ops;                        /**< Operations timed */
+    uint64_t start_ns;                   /**< When the workload started */
+    uint64_t elapsed_ns;                 /**< Total time of the workload */
+    struct rentscan_latency_hist hist;   /**< Time per operation, in ns */
+};
+
+/**
+ * @brief Get the time for benchmarking
+ *
+ * Uses the host clock on native_sim, where code runs in zero simulated
+ * time, and the timing functions of the SoC otherwise.
+ *
+ * @return uint64_t Monotonic time in nanoseconds
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * @brief Start timing a workload
+ *
+ * @param res Results to reset
+ * @param name Name in the report
+ */
+void bench_begin(struct bench_result *res, const char *name);
+
+/**
+ * @brief Add one timed operation
+ *
+ * @param res Results of the workload
+ * @param start_ns Time the operation started, from bench_now_ns()
+ */
+void bench_record(struct bench_result *res, uint64_t start_ns);
+
+/**
+ * @brief Add one operation timed by the caller
+ *
+ * @param res Results of the workload
+ * @param ns Time the operation took
+ */
+void bench_add(struct bench_result *res, uint64_t ns);
+
+/**
+ * @brief Stop timing a workload and print its report line
+ *
+ * @param res Results of the workload
+ */
+void bench_end(struct bench_result *res);
+
+/**
+ * @brief Check a condition of the run and count it if it fails
+ *
+ * @param ok Condition
+ * @param what Description printed if it fails
+ * @return bool @p ok
+ */
+bool bench_check(bool ok, const char *what);
+
+/**
+ * @brief Get the number of failed checks
+ *
+ * @return uint32_t Checks failed so far
+ */
+uint32_t bench_failures(void);
+
+/**
+ * @brief Print the memory figures of the run
+ *
+ * Peak resident set size of the process on native_sim, the stack high
+ * water marks of the work queues on hardware.
+ */
+void bench_report_memory(void);
+
+#endif /* BENCH_H */
\ No newline at end of file
@@ -0,0 +1,266 @@
+/**
+ * @file loopback.c
+ * @brief Main device and gateway wired back to back over stubbed BLE
+ *
+ * The gateway side mirrors ingress_message_handler() of the gateway
+ * application and the main device side process_scan() of the main device
+ * application, minus logging, so the benchmark runs the same module calls
+ * a tap causes on the real devices.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <stdio.h>
+#include <string.h>
+#include "loopback.h"
+#include "bench.h"
+#include "../../main_device/src/ble_service.h"
+#include "../../main_device/src/rental_manager.h"
+#include "../../main_device/src/latency_stats.h"
+#include "../../main_device/src/metrics.h"
+#include "../../gateway_device/src/ble_central.h"
+#include "../../gateway_device/src/gateway_service.h"
+#include "../../gateway_device/src/rental_sync.h"
+#include "../../common/include/rentscan_sync.h"
+#include "../../common/include/rentscan_time.h"
+
+LOG_MODULE_REGISTER(loopback, LOG_LEVEL_INF);
+
+/* Rental the gateway starts for an available item, as in the gateway app */
+#define TAP_RENTAL_USER "auto_user"
+#define TAP_RENTAL_DURATION_S 300
+
+/* One encoded message from the gateway to the main device */
+struct loopback_frame {
+    uint8_t link;
+    uint8_t len;
+    uint8_t data[RENTSCAN_WIRE_MSG_MAX_LEN];
+};
+
+BUILD_ASSERT(RENTSCAN_WIRE_MSG_MAX_LEN <= UINT8_MAX, "Frame length must fit in a byte");
+
+K_MSGQ_DEFINE(to_main_msgq, sizeof(struct loopback_frame),
+              CONFIG_RENTSCAN_BENCH_LINK_DEPTH, 1);
+
+static uint8_t link_count;
+
+/* Link the main device is answering on */
+static uint8_t main_link;
+
+static uint64_t sync_done_ns[BLE_CENTRAL_MAX_LINKS];
+static struct loopback_stats stats;
+
+void loopback_init(uint8_t links)
+{
+    link_count = MIN(links, BLE_CENTRAL_MAX_LINKS);
+    main_link = 0;
+    k_msgq_purge(&to_main_msgq);
+    memset(sync_done_ns, 0, sizeof(sync_done_ns));
+    memset(&stats, 0, sizeof(stats));
+
+    /* Both ends run on one clock, so the main device needs no time exchange */
+    rentscan_time_set_offset(0);
+}
+
+/* Gateway side, see ingress_message_handler() in gateway_device/src/main.c */
+static void gateway_handle(uint8_t link, const rentscan_msg_t *msg)
+{
+    if (msg->cmd == CMD_SYNC_DELTA) {
+        rental_sync_process(link, msg);
+        if (msg->status & RENTSCAN_SYNC_LAST) {
+            sync_done_ns[link] = bench_now_ns();
+            stats.syncs++;
+        }
+        return;
+    }
+
+    if (msg->cmd == CMD_STATUS_RESP && msg->status == STATUS_EXPIRED) {
+        stats.expired++;
+    }
+
+    if (msg->cmd == CMD_STATUS_REQ && msg->tag_id_len > 0) {
+        char item_id[MAX_TAG_ID_LEN + 1];
+        rentscan_status_t status;
+
+        snprintf(item_id, sizeof(item_id), "%.*s", msg->tag_id_len, msg->tag_id);
+
+        if (gateway_service_get_rental_status(item_id, &status) == 0) {
+            rentscan_msg_t reply = {
+                .tag_id_len = msg->tag_id_len,
+                .timestamp = rentscan_time_now(),
+            };
+            memcpy(reply.tag_id, msg->tag_id, msg->tag_id_len);
+
+            int err;
+
+            if (status == STATUS_RENTED || status == STATUS_EXPIRED) {
+                err = gateway_service_end_rental(item_id);
+                reply.cmd = CMD_RENTAL_END;
+                reply.status = STATUS_AVAILABLE;
+            } else {
+                err = gateway_service_start_rental(item_id, TAP_RENTAL_USER,
+                                                   TAP_RENTAL_DURATION_S);
+                reply.cmd = CMD_RENTAL_START;
+                reply.status = STATUS_RENTED;
+                reply.duration = TAP_RENTAL_DURATION_S;
+            }
+
+            if (!err) {
+                ble_central_send_message(link, &reply);
+            }
+        }
+    }
+
+    gateway_service_process_message(msg);
+}
+
+/* Main device side: the notification is decoded again by the gateway */
+int ble_service_send_message(const rentscan_msg_t *msg)
+{
+    uint8_t buf[RENTSCAN_WIRE_MSG_MAX_LEN];
+    rentscan_msg_t rx;
+
+    if (!msg) {
+        return -EINVAL;
+    }
+
+    int len = rentscan_msg_encode(msg, buf, sizeof(buf));
+    if (len < 0) {
+        return len;
+    }
+
+    int err = rentscan_msg_decode(&rx, buf, len);
+    if (err < 0) {
+        return err;
+    }
+
+    stats.to_gateway++;
+    stats.bytes += len;
+    gateway_handle(main_link, &rx);
+    return 0;
+}
+
+/* Nothing waits for a TX queue here */
+int ble_service_send_message_wait(const rentscan_msg_t *msg)
+{
+    return ble_service_send_message(msg);
+}
+
+bool ble_service_is_connected(void)
+{
+    return link_count > 0;
+}
+
+int loopback_rental_status(const rentscan_msg_t *msg)
+{
+    /* As rental_status_changed_handler() in main_device/src/main.c */
+    int err = ble_service_send_message_wait(msg);
+    if (err) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_NOTIFY_FAILED);
+    }
+    return err;
+}
+
+/* Main device side, see process_scan() in main_device/src/main.c */
+void loopback_process_scan(const struct scan_event *evt)
+{
+    uint32_t work_cycles = k_cycle_get_32();
+    rentscan_msg_t msg = {
+        .cmd = CMD_STATUS_REQ,
+        .tag_id_len = evt->tag_id_len,
+        .timestamp = rentscan_time_from_uptime(evt->timestamp_ms),
+        .corr_id = latency_stats_next_corr_id(),
+    };
+
+    latency_stats_record(RENTSCAN_LATENCY_TAP_TO_WORK, evt->cycles, work_cycles);
+    memcpy(msg.tag_id, evt->tag_id, evt->tag_id_len);
+
+    if (ble_service_is_connected()) {
+        uint32_t send_cycles = k_cycle_get_32();
+
+        msg.latency_us = latency_stats_us(evt->cycles, send_cycles);
+        latency_stats_record(RENTSCAN_LATENCY_TAP_TO_SEND, evt->cycles, send_cycles);
+        if (ble_service_send_message_wait(&msg)) {
+            metrics_inc(RENTSCAN_MAIN_METRIC_SEND_FAILED);
+        }
+    } else {
+        metrics_inc(RENTSCAN_MAIN_METRIC_SEND_FAILED);
+    }
+
+    int err = rental_manager_process_tag(evt->tag_id, evt->tag_id_len,
+                                         evt->tag_data, evt->tag_data_len);
+    if (err) {
+        LOG_ERR("Failed to process tag (err %d)", err);
+    }
+}
+
+/* Gateway side: queued like a write without response waiting for a buffer */
+int ble_central_send_message(uint8_t link, const rentscan_msg_t *msg)
+{
+    struct loopback_frame frame;
+
+    if (!msg || link >= link_count) {
+        return -EINVAL;
+    }
+
+    int len = rentscan_msg_encode(msg, frame.data, sizeof(frame.data));
+    if (len < 0) {
+        return len;
+    }
+
+    frame.link = link;
+    frame.len = len;
+    if (k_msgq_put(&to_main_msgq, &frame, K_NO_WAIT)) {
+        stats.dropped++;
+        return -ENOMEM;
+    }
+
+    stats.bytes += len;
+    return 0;
+}
+
+int ble_central_get_link_info(uint8_t link, struct ble_central_link_info *info)
+{
+    if (!info || link >= link_count) {
+        return -ENOTCONN;
+    }
+
+    /* A static random address per link */
+    memset(info, 0, sizeof(*info));
+    info->addr.type = BT_ADDR_LE_RANDOM;
+    info->addr.a.val[0] = link;
+    info->addr.a.val[5] = 0xC0;
+    info->subscribed = true;
+    return 0;
+}
+
+int ble_central_set_backpressure(bool enable)
+{
+    ARG_UNUSED(enable);
+    return 0;
+}
+
+size_t loopback_pump(void)
+{
+    struct loopback_frame frame;
+    size_t delivered = 0;
+
+    while (k_msgq_get(&to_main_msgq, &frame, K_NO_WAIT) == 0) {
+        main_link = frame.link;
+        stats.to_main++;
+        delivered++;
+        rental_manager_process_command(frame.data, frame.len);
+    }
+
+    return delivered;
+}
+
+uint64_t loopback_sync_done_ns(uint8_t link)
+{
+    return link < BLE_CENTRAL_MAX_LINKS ? sync_done_ns[link] : 0;
+}
+
+void loopback_get_stats(struct loopback_stats *out)
+{
+    *out = stats;
+}
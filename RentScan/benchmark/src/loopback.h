@@ -0,0 +1,84 @@
+/**
+ * @file loopback.h
+ * @brief Main device and gateway wired back to back over stubbed BLE
+ *
+ * Stands in for ble_service on the main device and ble_central on the
+ * gateway. Messages from the main device are encoded, decoded and handled
+ * by the gateway right away. Messages from the gateway are queued per
+ * link and delivered by loopback_pump(), so the main device never sees a
+ * command while it is still answering the previous one.
+ *
+ * Every link is served by the same rental manager under its own address,
+ * so several links look like several main devices with the same table.
+ */
+
+#ifndef LOOPBACK_H
+#define LOOPBACK_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "../../main_device/src/scan_ring.h"
+#include "../../common/include/rentscan_protocol.h"
+
+/**
+ * @brief Message counts of the loopback
+ */
+struct loopback_stats {
+    uint32_t to_gateway;    /**< Messages from the main device */
+    uint32_t to_main;       /**< Messages from the gateway */
+    uint32_t bytes;         /**< Encoded bytes in both directions */
+    uint32_t dropped;       /**< Gateway messages refused because the queue was full */
+    uint32_t expired;       /**< Expiry notifications seen by the gateway */
+    uint32_t syncs;         /**< Sync listings completed */
+};
+
+/**
+ * @brief Connect the given number of links
+ *
+ * @param links Number of links, at most BLE_CENTRAL_MAX_LINKS
+ */
+void loopback_init(uint8_t links);
+
+/**
+ * @brief Handle one NFC scan the way the main device application does
+ *
+ * Sends the status request to the gateway and tracks the tag locally.
+ *
+ * @param evt Scan to process
+ */
+void loopback_process_scan(const struct scan_event *evt);
+
+/**
+ * @brief Status callback to register with rental_manager_init()
+ *
+ * @param msg Message for the gateway
+ * @return int 0 on success, negative error code otherwise
+ */
+int loopback_rental_status(const rentscan_msg_t *msg);
+
+/**
+ * @brief Deliver the queued gateway messages to the main device
+ *
+ * Also delivers what the main device sends while handling them.
+ *
+ * @return size_t Number of messages delivered
+ */
+size_t loopback_pump(void);
+
+/**
+ * @brief Get the time the last sync listing on a link completed
+ *
+ * @param link Link to check
+ * @return uint64_t Time from bench_now_ns(), 0 if none completed yet
+ */
+uint64_t loopback_sync_done_ns(uint8_t link);
+
+/**
+ * @brief Get the message counts
+ *
+ * @param stats Pointer to store the counts
+ */
+void loopback_get_stats(struct loopback_stats *stats);
+
+#endif /* LOOPBACK_H */
\ No newline at end of file
@@ -0,0 +1,334 @@
+/**
+ * @file main.c
+ * @brief Throughput and latency benchmark of the rental logic of both devices
+ *
+ * Runs the real rental manager, gateway service, rental store, delta sync
+ * and protocol codec against stubbed BLE (see loopback.h) through these
+ * workloads:
+ *
+ * - codec: encode and decode of a status request
+ * - populate: first tap of every tag, each one starts a rental
+ * - burst: bursts of taps through the scan ring, larger than the ring
+ * - reconnect: every link asks for a delta sync at once, repeatedly; the
+ *   rate includes the taps made between rounds
+ * - expiry: every rental passes its deadline at about the same time
+ *
+ * Each workload prints one "bench <name>: ..." line and the run ends with
+ * "bench: PASS" or "bench: FAIL", so a CI job can gate on the result and
+ * compare the figures against a baseline.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/random/rand32.h>
+#include <zephyr/sys/printk.h>
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+#include "loopback.h"
+#include "../../main_device/src/rental_manager.h"
+#include "../../main_device/src/latency_stats.h"
+#include "../../main_device/src/workq.h"
+#include "../../gateway_device/src/ble_central.h"
+#include "../../gateway_device/src/gateway_service.h"
+#include "../../gateway_device/src/rental_sync.h"
+
+#if defined(CONFIG_ARCH_POSIX)
+#include "posix_board_if.h"
+#endif
+
+LOG_MODULE_REGISTER(bench, LOG_LEVEL_INF);
+
+#define TAGS CONFIG_RENTSCAN_BENCH_TAGS
+#define LINKS CONFIG_RENTSCAN_BENCH_LINKS
+
+/* Rentals started by a tap last this long, see loopback.c */
+#define TAP_RENTAL_DURATION_S 300
+
+/* Longest wait for a sync listing, in 1 ms steps of simulated time */
+#define SYNC_WAIT_MS 1000
+
+BUILD_ASSERT(TAGS <= CONFIG_RENTSCAN_MAX_RENTALS, "Main device can't track every tag");
+BUILD_ASSERT(TAGS <= CONFIG_RENTSCAN_GATEWAY_MAX_RENTALS, "Gateway can't rent every tag");
+BUILD_ASSERT(LINKS <= BLE_CENTRAL_MAX_LINKS, "More links than the gateway serves");
+
+static size_t tag_name(uint32_t tag, uint8_t *buf)
+{
+    char id[MAX_TAG_ID_LEN + 1];
+    int len = snprintf(id, sizeof(id), "TAG%05u", tag);
+
+    memcpy(buf, id, len);
+    return len;
+}
+
+static uint32_t random_tag(void)
+{
+    return sys_rand32_get() % TAGS;
+}
+
+static struct scan_event scan_of(const uint8_t *tag_id, size_t tag_id_len)
+{
+    struct scan_event evt = {
+        .tag_id = tag_id,
+        .tag_id_len = tag_id_len,
+        .timestamp_ms = k_uptime_get_32(),
+        .cycles = k_cycle_get_32(),
+    };
+
+    return evt;
+}
+
+/* One tap and everything it causes on both devices */
+static void tap(uint32_t tag)
+{
+    uint8_t tag_id[MAX_TAG_ID_LEN];
+    struct scan_event evt = scan_of(tag_id, tag_name(tag, tag_id));
+
+    loopback_process_scan(&evt);
+    loopback_pump();
+}
+
+static rentscan_status_t main_status(uint32_t tag)
+{
+    uint8_t tag_id[MAX_TAG_ID_LEN];
+    rentscan_status_t status = STATUS_ERROR;
+
+    rental_manager_get_status(tag_id, tag_name(tag, tag_id), &status);
+    return status;
+}
+
+static void bench_codec(void)
+{
+    struct bench_result res;
+    rentscan_msg_t msg = {
+        .cmd = CMD_STATUS_REQ,
+        .timestamp = 1700000000,
+        .corr_id = 0x12345678,
+        .latency_us = 850,
+    };
+    uint8_t buf[RENTSCAN_WIRE_MSG_MAX_LEN];
+    rentscan_msg_t rx;
+    bool ok = true;
+
+    msg.tag_id_len = tag_name(TAGS - 1, msg.tag_id);
+
+    bench_begin(&res, "codec");
+    for (uint32_t i = 0; i < CONFIG_RENTSCAN_BENCH_CODEC_OPS; i++) {
+        uint64_t start = bench_now_ns();
+
+        msg.corr_id++;
+        int len = rentscan_msg_encode(&msg, buf, sizeof(buf));
+
+        ok &= len > 0 && rentscan_msg_decode(&rx, buf, len) == len;
+        bench_record(&res, start);
+    }
+    bench_end(&res);
+
+    bench_check(ok && rx.corr_id == msg.corr_id, "codec round trip");
+}
+
+static void bench_populate(void)
+{
+    struct bench_result res;
+    struct rental_manager_stats rentals;
+    gateway_service_status_t gw;
+
+    bench_begin(&res, "populate");
+    for (uint32_t i = 0; i < TAGS; i++) {
+        uint64_t start = bench_now_ns();
+
+        tap(i);
+        bench_record(&res, start);
+    }
+    bench_end(&res);
+
+    rental_manager_get_stats(&rentals);
+    gateway_service_get_status(&gw);
+    bench_check(rentals.rentals == TAGS, "populate: main device tracks every tag");
+    bench_check(gw.rental_count == TAGS, "populate: gateway rents every tag");
+    bench_check(main_status(0) == STATUS_RENTED && main_status(TAGS - 1) == STATUS_RENTED,
+                "populate: main device sees the rentals");
+
+    if (CONFIG_RENTSCAN_BENCH_TAP_P99_BUDGET_US) {
+        bench_check(rentscan_latency_percentile(&res.hist, 99) <=
+                    CONFIG_RENTSCAN_BENCH_TAP_P99_BUDGET_US * NSEC_PER_USEC,
+                    "populate: tap p99 within budget");
+    }
+}
+
+static void bench_burst(void)
+{
+    static uint8_t ids[CONFIG_RENTSCAN_BENCH_BURST_SIZE][MAX_TAG_ID_LEN];
+    static uint64_t queued_ns[CONFIG_RENTSCAN_BENCH_BURST_SIZE];
+    struct scan_event batch[CONFIG_RENTSCAN_SCAN_BATCH_SIZE];
+    struct bench_result res;
+    uint32_t dropped = scan_ring_overflow_count();
+    uint32_t injected = 0;
+
+    bench_begin(&res, "burst");
+    for (int b = 0; b < CONFIG_RENTSCAN_BENCH_BURSTS; b++) {
+        size_t queued = 0;
+        size_t taken = 0;
+        size_t count;
+
+        /* The whole burst arrives before the tag work item gets to run */
+        for (int i = 0; i < CONFIG_RENTSCAN_BENCH_BURST_SIZE; i++) {
+            struct scan_event evt = scan_of(ids[i], tag_name(random_tag(), ids[i]));
+
+            injected++;
+            if (scan_ring_put(&evt)) {
+                queued_ns[queued++] = bench_now_ns();
+            }
+        }
+
+        while ((count = scan_ring_get_batch(batch, ARRAY_SIZE(batch))) > 0) {
+            for (size_t i = 0; i < count; i++) {
+                loopback_process_scan(&batch[i]);
+            }
+            loopback_pump();
+
+            /* Time from queueing until the gateway's answer was applied */
+            for (size_t i = 0; i < count; i++) {
+                bench_record(&res, queued_ns[taken++]);
+            }
+        }
+    }
+    bench_end(&res);
+
+    dropped = scan_ring_overflow_count() - dropped;
+    printk("bench burst: injected=%u dropped=%u ring_depth=%u\n",
+           injected, dropped, CONFIG_RENTSCAN_SCAN_RING_DEPTH);
+    bench_check(res.ops + dropped == injected, "burst: every scan processed or counted");
+}
+
+static void bench_reconnect(void)
+{
+    struct rental_sync_stats before;
+    struct rental_sync_stats after;
+    struct loopback_stats link;
+    struct bench_result res;
+    uint32_t expected = 0;
+
+    rental_sync_get_stats(&before);
+
+    bench_begin(&res, "reconnect");
+    for (int round = 0; round < CONFIG_RENTSCAN_BENCH_RECONNECT_ROUNDS; round++) {
+        /* Something to list in the deltas */
+        for (int i = 0; i < CONFIG_RENTSCAN_BENCH_RECONNECT_CHANGES; i++) {
+            tap(random_tag());
+        }
+
+        loopback_get_stats(&link);
+        expected = link.syncs + LINKS;
+
+        uint64_t start = bench_now_ns();
+
+        /* Every link comes back at once, the requests go out from the rental queue */
+        for (uint8_t l = 0; l < LINKS; l++) {
+            rental_sync_request(l, false);
+        }
+
+        for (int waited = 0; link.syncs < expected && waited < SYNC_WAIT_MS; ) {
+            if (!loopback_pump()) {
+                k_sleep(K_MSEC(1));
+                waited++;
+            }
+            loopback_get_stats(&link);
+        }
+
+        if (!bench_check(link.syncs == expected, "reconnect: every link synced")) {
+            break;
+        }
+
+        for (uint8_t l = 0; l < LINKS; l++) {
+            bench_add(&res, loopback_sync_done_ns(l) - start);
+        }
+    }
+    bench_end(&res);
+
+    rental_sync_get_stats(&after);
+    printk("bench reconnect: syncs=%u full=%u entries=%u corrections=%u\n",
+           after.syncs - before.syncs, after.full_syncs - before.full_syncs,
+           after.entries - before.entries, after.corrections - before.corrections);
+    bench_check(after.full_syncs - before.full_syncs == LINKS,
+                "reconnect: only the first sync of a link is full");
+    bench_check(after.corrections == before.corrections,
+                "reconnect: the devices agree on every rental");
+    bench_check(after.gaps == before.gaps, "reconnect: no sync message went missing");
+}
+
+static void bench_expiry(void)
+{
+    struct rental_manager_stats before;
+    struct rental_manager_stats after;
+    struct loopback_stats link;
+    struct bench_result res;
+    uint32_t rented = 0;
+    uint32_t expired;
+
+    /* Rent out whatever the bursts returned, returned tags are untracked */
+    for (uint32_t i = 0; i < TAGS; i++) {
+        if (main_status(i) != STATUS_RENTED) {
+            tap(i);
+        }
+        rented += main_status(i) == STATUS_RENTED;
+    }
+
+    rental_manager_get_stats(&before);
+    loopback_get_stats(&link);
+    expired = link.expired;
+
+    /* On native_sim the host time of this sleep is the cost of the sweeps,
+     * idle simulated time takes none.
+     */
+    bench_begin(&res, "expiry");
+    k_sleep(K_SECONDS(TAP_RENTAL_DURATION_S + 2));
+    loopback_get_stats(&link);
+    res.ops = link.expired - expired;
+    bench_end(&res);
+
+    rental_manager_get_stats(&after);
+    printk("bench expiry: rented=%u expired=%u sweeps=%u sweep_us_max=%u late_ms_max=%u\n",
+           rented, res.ops, after.expiry.sweeps - before.expiry.sweeps,
+           after.expiry.sweep_us_max, after.expiry.late_ms_max);
+    bench_check(rented == TAGS, "expiry: every tag rented");
+    bench_check(res.ops == rented, "expiry: every rental expired and was reported");
+}
+
+int main(void)
+{
+    printk("bench: %u tags, %u links\n", TAGS, LINKS);
+
+    workq_init();
+    latency_stats_init();
+    loopback_init(LINKS);
+
+    int err = rental_manager_init(loopback_rental_status);
+    if (!err) {
+        err = gateway_service_init();
+    }
+    if (err) {
+        printk("bench: FAIL (init err %d)\n", err);
+        return err;
+    }
+
+    bench_codec();
+    bench_populate();
+    bench_burst();
+    bench_reconnect();
+    bench_expiry();
+    bench_report_memory();
+
+    uint32_t failures = bench_failures();
+
+    if (failures) {
+        printk("bench: FAIL (%u checks)\n", failures);
+    } else {
+        printk("bench: PASS\n");
+    }
+
+#if defined(CONFIG_ARCH_POSIX)
+    posix_exit(failures ? 1 : 0);
+#endif
+    return 0;
+}
@@ -0,0 +1,79 @@
+/**
+ * @file stubs.c
+ * @brief Gateway backend path stubbed out for the benchmark
+ *
+ * The outbox only encodes what it is given, which is what the flash log
+ * does before writing, and the uplink is always up with nothing to send.
+ */
+
+#include <zephyr/kernel.h>
+#include <string.h>
+#include "../../gateway_device/src/outbox.h"
+#include "../../gateway_device/src/uplink.h"
+#include "../../gateway_device/src/ingress_queue.h"
+
+static struct outbox_stats outbox;
+
+int outbox_init(outbox_backpressure_cb_t backpressure_cb)
+{
+    ARG_UNUSED(backpressure_cb);
+    memset(&outbox, 0, sizeof(outbox));
+    return 0;
+}
+
+int outbox_append(const rentscan_msg_t *msg)
+{
+    uint8_t buf[RENTSCAN_WIRE_MSG_MAX_LEN];
+    int len = rentscan_msg_encode(msg, buf, sizeof(buf));
+
+    if (len < 0) {
+        return len;
+    }
+
+    /* Acknowledged at once, nothing is kept */
+    outbox.next_seq++;
+    outbox.sent_seq = outbox.next_seq;
+    outbox.acked_seq = outbox.next_seq;
+    return 0;
+}
+
+uint32_t outbox_unsent(void)
+{
+    return 0;
+}
+
+void outbox_get_stats(struct outbox_stats *stats)
+{
+    *stats = outbox;
+}
+
+int uplink_init(void)
+{
+    return 0;
+}
+
+void uplink_kick(void)
+{
+}
+
+void uplink_set_enabled(bool enable)
+{
+    ARG_UNUSED(enable);
+}
+
+bool uplink_is_up(void)
+{
+    return true;
+}
+
+void uplink_get_stats(struct uplink_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->transport = "bench";
+    stats->up = true;
+}
+
+void ingress_queue_get_stats(struct ingress_queue_stats *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+}
@@ -0,0 +1,40 @@
+# Memory footprint profiles shared by the main device and the gateway
+#
+# A profile only picks the defaults of the capacity options, so an option
+# set in a .conf file or on the command line still wins.
+
+choice RENTSCAN_PROFILE
+	prompt "Memory footprint profile"
+	default RENTSCAN_PROFILE_STANDARD
+	help
+	  Sizes the tables, queues and buffers of the application together.
+	  Check the result with "west build -t rentscan_footprint".
+
+config RENTSCAN_PROFILE_SMALL
+	bool "Small kiosk"
+	help
+	  Fits an nRF52832 (64 KB RAM) next to the Bluetooth stack: tens of
+	  items per main device, two main devices per gateway.
+
+config RENTSCAN_PROFILE_STANDARD
+	bool "Standard"
+	help
+	  Hundreds of items per main device and eight main devices per
+	  gateway, for the nRF52840 development kits.
+
+config RENTSCAN_PROFILE_LARGE
+	bool "Large hub"
+	help
+	  Thousands of rentals and sixteen main devices per gateway, for the
+	  application core of an nRF5340 (512 KB RAM). The gateway's
+	  rental tables take about 230 KB of it.
+
+endchoice
+
+config RENTSCAN_FOOTPRINT_REPORT
+	bool "Print a RAM and flash summary after each build"
+	default y
+	help
+	  Sums the static RAM and flash of every application module and of
+	  the largest libraries from the linker map. The same summary is
+	  printed by "west build -t rentscan_footprint".
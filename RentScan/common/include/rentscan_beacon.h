@@ -0,0 +1,92 @@
+/**
+ * @file rentscan_beacon.h
+ * @brief Connectionless rental status beacon shared by both devices
+ *
+ * A main device publishes the items that are not available as service
+ * data in a non-connectable extended advertisement:
+ *
+ *   [version][seq (le16)][page][page count][total (le16)][entry]...
+ *   entry: [tag hash (le32)][status]
+ *
+ * Tags are identified by the 32-bit FNV-1a hash of their ID. Items that
+ * are missing from a complete set of pages are available. When more items
+ * are out than fit in one advertisement, the device rotates through pages;
+ * seq changes whenever any rental state changes so observers know when to
+ * start collecting pages again.
+ */
+
+#ifndef RENTSCAN_BEACON_H
+#define RENTSCAN_BEACON_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include "rentscan_protocol.h"
+
+#define RENTSCAN_BEACON_VERSION 1
+
+/** Encoded header size */
+#define RENTSCAN_BEACON_HDR_LEN 7
+
+/** Encoded size of one entry */
+#define RENTSCAN_BEACON_ENTRY_LEN 5
+
+/** Entries carried by one advertisement */
+#define RENTSCAN_BEACON_MAX_ENTRIES 32
+
+/** Pages addressable by an observer's page bitmap */
+#define RENTSCAN_BEACON_MAX_PAGES 32
+
+/** Maximum encoded beacon size, excluding the service UUID */
+#define RENTSCAN_BEACON_MAX_LEN \
+    (RENTSCAN_BEACON_HDR_LEN + RENTSCAN_BEACON_MAX_ENTRIES * RENTSCAN_BEACON_ENTRY_LEN)
+
+/**
+ * @brief Status of one item in a beacon
+ */
+struct rentscan_beacon_entry {
+    uint32_t tag_hash;   /**< Hash of the tag ID, see rentscan_beacon_tag_hash() */
+    uint8_t status;      /**< rentscan_status_t of the item */
+};
+
+/**
+ * @brief Decoded beacon
+ */
+struct rentscan_beacon {
+    uint16_t seq;          /**< Rental state generation */
+    uint8_t page;          /**< Index of this page */
+    uint8_t page_count;    /**< Number of pages for this generation */
+    uint16_t total;        /**< Items not available across all pages */
+    uint8_t entry_count;   /**< Entries in this page */
+    struct rentscan_beacon_entry entries[RENTSCAN_BEACON_MAX_ENTRIES];
+};
+
+/**
+ * @brief Hash a tag ID the way beacons identify it
+ *
+ * @param tag_id Tag ID
+ * @param tag_id_len Length of the tag ID
+ * @return uint32_t 32-bit FNV-1a hash
+ */
+uint32_t rentscan_beacon_tag_hash(const uint8_t *tag_id, size_t tag_id_len);
+
+/**
+ * @brief Encode a beacon
+ *
+ * @param beacon Beacon to encode
+ * @param buf Output buffer
+ * @param buf_len Size of the output buffer
+ * @return int Number of bytes written on success, negative error code otherwise
+ */
+int rentscan_beacon_encode(const struct rentscan_beacon *beacon, uint8_t *buf, size_t buf_len);
+
+/**
+ * @brief Decode a beacon
+ *
+ * @param beacon Beacon to fill in
+ * @param buf Service data following the RentScan service UUID
+ * @param len Length of the service data
+ * @return int 0 on success, negative error code otherwise
+ */
+int rentscan_beacon_decode(struct rentscan_beacon *beacon, const uint8_t *buf, size_t len);
+
+#endif /* RENTSCAN_BEACON_H */
\ No newline at end of file
@@ -0,0 +1,84 @@
+/**
+ * @file rentscan_dedup.h
+ * @brief Time windowed cache of recently seen tag IDs shared by both devices
+ *
+ * A tag seen again within the window of its last sighting is a duplicate,
+ * and the sighting restarts the window, so a tag held at a reader counts
+ * once however long it stays. When the cache is full the entry seen least
+ * recently is replaced.
+ */
+
+#ifndef RENTSCAN_DEDUP_H
+#define RENTSCAN_DEDUP_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include "rentscan_protocol.h"
+
+/**
+ * @brief Remembered tag ID
+ */
+struct rentscan_dedup_entry {
+    uint8_t id[MAX_TAG_ID_LEN];
+    uint8_t id_len;         /**< 0 for an unused entry */
+    uint32_t seen_ms;       /**< Last sighting in ms of system uptime */
+};
+
+/**
+ * @brief De-duplication cache instance
+ */
+struct rentscan_dedup {
+    struct rentscan_dedup_entry *entries;
+    uint16_t capacity;
+    uint32_t window_ms;
+    struct k_spinlock lock;
+};
+
+/**
+ * @brief Statically define a de-duplication cache
+ *
+ * @param _name Name of the cache variable
+ * @param _capacity Number of tag IDs remembered
+ * @param _window_ms Window in which a tag is a duplicate, 0 lets every tag through
+ */
+#define RENTSCAN_DEDUP_DEFINE(_name, _capacity, _window_ms)               \
+    static struct rentscan_dedup_entry _name##_entries[_capacity];        \
+    static struct rentscan_dedup _name = {                                \
+        .entries = _name##_entries,                                       \
+        .capacity = (_capacity),                                          \
+        .window_ms = (_window_ms),                                        \
+    }
+
+/**
+ * @brief Look a tag up, restarting its window on a hit
+ *
+ * @param dd Cache
+ * @param id Tag ID
+ * @param id_len Length of @p id
+ * @return true if the tag was seen within the window
+ */
+bool rentscan_dedup_seen(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len);
+
+/**
+ * @brief Remember a tag, replacing the least recently seen one if full
+ *
+ * IDs longer than MAX_TAG_ID_LEN are not remembered.
+ *
+ * @param dd Cache
+ * @param id Tag ID
+ * @param id_len Length of @p id
+ */
+void rentscan_dedup_add(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len);
+
+/**
+ * @brief Look a tag up and remember it if it is new
+ *
+ * @param dd Cache
+ * @param id Tag ID
+ * @param id_len Length of @p id
+ * @return true if the tag is a duplicate
+ */
+bool rentscan_dedup_check(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len);
+
+#endif /* RENTSCAN_DEDUP_H */
\ No newline at end of file
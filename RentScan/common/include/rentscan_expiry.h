@@ -0,0 +1,155 @@
+/**
+ * @file rentscan_expiry.h
+ * @brief Deadline scheduler for rental expiry shared by both devices
+ *
+ * Scheduled entries are kept in a binary min-heap ordered by deadline and
+ * a single delayable work item is armed for the earliest one, so the
+ * scheduler only wakes up when something actually expires. Deadlines are
+ * in network time, see rentscan_time.h.
+ */
+
+#ifndef RENTSCAN_EXPIRY_H
+#define RENTSCAN_EXPIRY_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+
+/** Heap position of an entry that is not scheduled */
+#define RENTSCAN_EXPIRY_IDLE UINT16_MAX
+
+/**
+ * @brief Schedulable entry, embedded in the owner's rental record
+ */
+struct rentscan_expiry_entry {
+    uint32_t deadline;   /**< Expiry time in seconds of network time */
+    uint16_t heap_idx;   /**< Position in the heap, RENTSCAN_EXPIRY_IDLE if idle */
+};
+
+/**
+ * @brief Callback for an expired entry
+ *
+ * Called from the scheduler's work queue with the scheduler unlocked, so
+ * the callback may reschedule or cancel entries.
+ *
+ * @param entry Entry whose deadline has passed
+ */
+typedef void (*rentscan_expiry_cb_t)(struct rentscan_expiry_entry *entry);
+
+/**
+ * @brief Cost of the expiry work, for the metrics of both devices
+ */
+struct rentscan_expiry_stats {
+    uint32_t sweeps;        /**< Times the work ran */
+    uint32_t expired;       /**< Entries handed to the callback */
+    uint32_t sweep_us_max;  /**< Longest run, callbacks included */
+    uint32_t late_ms_max;   /**< Longest delay between deadline and run */
+};
+
+/**
+ * @brief Expiry scheduler instance
+ */
+struct rentscan_expiry {
+    struct rentscan_expiry_entry **heap;
+    uint16_t capacity;
+    uint16_t count;
+    rentscan_expiry_cb_t expired_cb;
+    struct k_work_q *work_q;
+    struct k_work_delayable work;
+    struct k_spinlock lock;
+    int64_t armed_ms;
+    struct rentscan_expiry_stats stats;
+};
+
+/**
+ * @brief Statically define an expiry scheduler
+ *
+ * @param _name Name of the scheduler variable
+ * @param _capacity Maximum number of entries scheduled at once
+ */
+#define RENTSCAN_EXPIRY_DEFINE(_name, _capacity)                          \
+    static struct rentscan_expiry_entry *_name##_heap[_capacity];         \
+    static struct rentscan_expiry _name = {                               \
+        .heap = _name##_heap,                                             \
+        .capacity = (_capacity),                                          \
+    }
+
+/**
+ * @brief Initialize an expiry scheduler
+ *
+ * @param exp Scheduler defined with RENTSCAN_EXPIRY_DEFINE
+ * @param work_q Work queue the callback runs on, NULL for the system work queue
+ * @param expired_cb Callback for entries whose deadline has passed
+ */
+void rentscan_expiry_init(struct rentscan_expiry *exp, struct k_work_q *work_q,
+                          rentscan_expiry_cb_t expired_cb);
+
+/**
+ * @brief Initialize an entry as not scheduled
+ *
+ * @param entry Entry to initialize
+ */
+static inline void rentscan_expiry_entry_init(struct rentscan_expiry_entry *entry)
+{
+    entry->deadline = 0;
+    entry->heap_idx = RENTSCAN_EXPIRY_IDLE;
+}
+
+/**
+ * @brief Check whether an entry is scheduled
+ *
+ * @param entry Entry to check
+ * @return true if the entry is waiting for its deadline
+ */
+static inline bool rentscan_expiry_is_scheduled(const struct rentscan_expiry_entry *entry)
+{
+    return entry->heap_idx != RENTSCAN_EXPIRY_IDLE;
+}
+
+/**
+ * @brief Schedule an entry, or move it if it is already scheduled
+ *
+ * @param exp Scheduler
+ * @param entry Entry to schedule
+ * @param deadline Expiry time in seconds of network time
+ * @return int 0 on success, -ENOMEM if the scheduler is full
+ */
+int rentscan_expiry_schedule(struct rentscan_expiry *exp,
+                             struct rentscan_expiry_entry *entry, uint32_t deadline);
+
+/**
+ * @brief Re-arm the scheduler after the network time offset changed
+ *
+ * Deadlines that passed with the new offset expire right away.
+ *
+ * @param exp Scheduler
+ */
+void rentscan_expiry_resync(struct rentscan_expiry *exp);
+
+/**
+ * @brief Remove an entry from the scheduler
+ *
+ * Cancelling an idle entry is a no-op.
+ *
+ * @param exp Scheduler
+ * @param entry Entry to cancel
+ */
+void rentscan_expiry_cancel(struct rentscan_expiry *exp, struct rentscan_expiry_entry *entry);
+
+/**
+ * @brief Get the number of scheduled entries
+ *
+ * @param exp Scheduler
+ * @return uint16_t Number of entries waiting for their deadline
+ */
+uint16_t rentscan_expiry_count(struct rentscan_expiry *exp);
+
+/**
+ * @brief Get the cost of the expiry work so far
+ *
+ * @param exp Scheduler
+ * @param stats Pointer to store the statistics
+ */
+void rentscan_expiry_get_stats(struct rentscan_expiry *exp, struct rentscan_expiry_stats *stats);
+
+#endif /* RENTSCAN_EXPIRY_H */
\ No newline at end of file
@@ -0,0 +1,115 @@
+/**
+ * @file rentscan_latency.h
+ * @brief Fixed-bucket latency histograms shared by both devices
+ *
+ * Bucket 0 counts latencies below 2 us, bucket n those from 2^n up to
+ * 2^(n+1) us, and the last bucket everything above. The main device
+ * answers CMD_STATS_REQ with one CMD_STATS_RESP per stage it measures,
+ * the stage in the status and the histogram in the payload:
+ *
+ *   [count (le32)][max (le32)][mean (le32)][bucket count][bucket (le32)]...
+ *
+ * Trailing empty buckets are not sent. The status of the last response
+ * carries RENTSCAN_LATENCY_LAST.
+ *
+ * A tap is followed across both devices by the correlation ID in its
+ * CMD_STATUS_REQ. The message also carries the time the main device spent
+ * on it, since the two devices don't share a clock.
+ */
+
+#ifndef RENTSCAN_LATENCY_H
+#define RENTSCAN_LATENCY_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include "rentscan_protocol.h"
+
+/** Number of histogram buckets, the last one is open ended */
+#define RENTSCAN_LATENCY_BUCKETS 24
+
+/** CMD_STATS_RESP status flag: last stage of the report */
+#define RENTSCAN_LATENCY_LAST 0x80
+
+/** Maximum encoded size of one histogram */
+#define RENTSCAN_LATENCY_ENCODED_MAX_LEN (13 + 4 * RENTSCAN_LATENCY_BUCKETS)
+
+/** Stages measured on the main device, in CMD_STATS_RESP order */
+enum rentscan_latency_main_stage {
+    RENTSCAN_LATENCY_TAP_TO_WORK,    /**< NFC read until the scan is processed */
+    RENTSCAN_LATENCY_WORK_TO_SEND,   /**< Processing until handed to BLE */
+    RENTSCAN_LATENCY_TAP_TO_SEND,    /**< NFC read until handed to BLE */
+    RENTSCAN_LATENCY_MAIN_STAGES,
+};
+
+/**
+ * @brief Latency histogram
+ */
+struct rentscan_latency_hist {
+    uint32_t count;                               /**< Samples recorded */
+    uint32_t max_us;                              /**< Largest sample */
+    uint64_t sum_us;                              /**< Sum of all samples */
+    uint32_t buckets[RENTSCAN_LATENCY_BUCKETS];   /**< Samples per bucket */
+};
+
+/**
+ * @brief Add a sample to a histogram
+ *
+ * @param hist Histogram
+ * @param us Latency in microseconds
+ */
+void rentscan_latency_record(struct rentscan_latency_hist *hist, uint32_t us);
+
+/**
+ * @brief Get the exclusive upper bound of a bucket
+ *
+ * @param bucket Bucket index
+ * @return uint32_t Upper bound in microseconds, UINT32_MAX for the last bucket
+ */
+uint32_t rentscan_latency_bucket_limit(unsigned int bucket);
+
+/**
+ * @brief Get the mean of a histogram
+ *
+ * @param hist Histogram
+ * @return uint32_t Mean latency in microseconds, 0 if empty
+ */
+uint32_t rentscan_latency_mean(const struct rentscan_latency_hist *hist);
+
+/**
+ * @brief Estimate a percentile of a histogram
+ *
+ * @param hist Histogram
+ * @param pct Percentile, 1 to 100
+ * @return uint32_t Upper bound of the bucket holding the percentile, capped
+ *                  at the largest sample
+ */
+uint32_t rentscan_latency_percentile(const struct rentscan_latency_hist *hist,
+                                     unsigned int pct);
+
+/**
+ * @brief Encode a histogram for CMD_STATS_RESP
+ *
+ * The sum is not sent, a decoded histogram has it rebuilt from the mean.
+ *
+ * @param hist Histogram to encode
+ * @param buf Output buffer
+ * @param buf_len Size of the output buffer
+ * @return int Number of bytes written on success, -ENOMEM if the buffer is
+ *             too small, negative error code otherwise
+ */
+int rentscan_latency_encode(const struct rentscan_latency_hist *hist,
+                            uint8_t *buf, size_t buf_len);
+
+/**
+ * @brief Decode a histogram from a CMD_STATS_RESP payload
+ *
+ * @param hist Histogram to fill
+ * @param buf Encoded histogram
+ * @param len Length of @p buf
+ * @return int 0 on success, -EBADMSG if the data is malformed,
+ *             negative error code otherwise
+ */
+int rentscan_latency_decode(struct rentscan_latency_hist *hist,
+                            const uint8_t *buf, size_t len);
+
+#endif /* RENTSCAN_LATENCY_H */
\ No newline at end of file
@@ -0,0 +1,198 @@
+/**
+ * @file rentscan_metrics.h
+ * @brief Runtime counters shared by both devices
+ *
+ * Each device lists its metrics once with an X-macro, which gives the
+ * metric IDs, their names and the atomic_t array holding them. Updates
+ * are single atomic operations, so they can sit on the hot path.
+ *
+ * The main device has no shell. The gateway asks for its metrics with a
+ * CMD_STATS_REQ whose status carries RENTSCAN_STATS_METRICS, and the main
+ * device answers with one or more CMD_STATS_RESP carrying the same flag:
+ *
+ *   [metric ID (varint)][value (varint)]...
+ *
+ * Metrics that are zero are not sent. The status of the last response
+ * also carries RENTSCAN_LATENCY_LAST.
+ */
+
+#ifndef RENTSCAN_METRICS_H
+#define RENTSCAN_METRICS_H
+
+#include <zephyr/types.h>
+#include <zephyr/sys/atomic.h>
+#include <stddef.h>
+
+/** CMD_STATS_REQ/CMD_STATS_RESP status flag: metrics instead of latency histograms */
+#define RENTSCAN_STATS_METRICS 0x40
+
+/** Kind of a metric, tells a reader how to interpret it */
+enum rentscan_metric_kind {
+    RENTSCAN_METRIC_COUNTER,  /**< Only goes up, reset at boot */
+    RENTSCAN_METRIC_GAUGE,    /**< Current level, sampled when read */
+    RENTSCAN_METRIC_PEAK,     /**< Largest value seen since boot */
+};
+
+/**
+ * @brief Metrics of the main device
+ *
+ * Shared so the gateway can name what the main device reports. New metrics
+ * go at the end, the position is the ID on the wire.
+ */
+#define RENTSCAN_MAIN_METRICS(X)                                              \
+    X(TAPS, taps, COUNTER)                       /* NFC reads */              \
+    X(TAPS_DROPPED, taps_dropped, COUNTER)       /* Scan ring full */         \
+    X(SCAN_HIGH_WATER, scan_high_water, PEAK)    /* Most scans queued */      \
+    X(WORK_LATE_US_MAX, work_late_us_max, PEAK)  /* NFC read to processing */ \
+    X(MSG_TX, msg_tx, COUNTER)                   /* Messages handed to BLE */ \
+    X(MSG_RX, msg_rx, COUNTER)                   /* Commands received */      \
+    X(MSG_MALFORMED, msg_malformed, COUNTER)     /* Undecodable commands */   \
+    X(SEND_FAILED, send_failed, COUNTER)         /* Tap not sent */           \
+    X(NOTIFY_FAILED, notify_failed, COUNTER)     /* Status change not sent */ \
+    X(BLE_BATCHES, ble_batches, COUNTER)         /* Notifications sent */     \
+    X(BLE_TX_FAILED, ble_tx_failed, COUNTER)     /* Notifications refused */  \
+    X(BLE_TX_LOST, ble_tx_lost, COUNTER)         /* Unsent at disconnect */   \
+    X(BLE_DISCONNECTS, ble_disconnects, COUNTER)                              \
+    X(BLE_DISC_TIMEOUT, ble_disc_timeout, COUNTER)  /* Supervision timeout */ \
+    X(BLE_DISC_REMOTE, ble_disc_remote, COUNTER)    /* Gateway closed it */   \
+    X(BLE_DISC_LOCAL, ble_disc_local, COUNTER)      /* We closed it */        \
+    X(BLE_DISC_OTHER, ble_disc_other, COUNTER)                                \
+    X(FLASH_WRITES, flash_writes, COUNTER)       /* Rental slots persisted */ \
+    X(FLASH_ERRORS, flash_errors, COUNTER)                                    \
+    X(RENTALS, rentals, GAUGE)                   /* Rentals tracked */        \
+    X(EXPIRY_SWEEPS, expiry_sweeps, COUNTER)                                  \
+    X(EXPIRY_SWEEP_US_MAX, expiry_sweep_us_max, PEAK)                         \
+    X(EXPIRY_LATE_MS_MAX, expiry_late_ms_max, PEAK)                           \
+    X(STACK_TAG_WQ, stack_tag_wq, PEAK)          /* Bytes of stack used */    \
+    X(STACK_RENTAL_WQ, stack_rental_wq, PEAK)                                 \
+    X(STACK_PERSIST_WQ, stack_persist_wq, PEAK)                               \
+    X(STACK_HOUSEKEEPING_WQ, stack_housekeeping_wq, PEAK)                     \
+    X(STACK_SYSTEM_WQ, stack_system_wq, PEAK)                                 \
+    X(BLE_TX_RETRIES, ble_tx_retries, COUNTER)   /* Stack out of buffers */   \
+    X(BLE_TX_QUEUE_FULL, ble_tx_queue_full, COUNTER) /* Messages refused */   \
+    X(BLE_TX_QUEUE_PEAK, ble_tx_queue_peak, PEAK) /* Most batches queued */   \
+    X(BLE_INDICATIONS, ble_indications, COUNTER) /* Confirmed by gateway */   \
+    X(NFC_FIELDS, nfc_fields, COUNTER)           /* Reader fields sensed */   \
+    X(ADV_FAST_S, adv_fast_s, GAUGE)             /* Seconds in each mode */   \
+    X(ADV_SLOW_S, adv_slow_s, GAUGE)                                          \
+    X(ADV_CONNECTED_S, adv_connected_s, GAUGE)                                \
+    X(ADV_FAST_WINDOWS, adv_fast_windows, COUNTER)                            \
+    X(ADV_CHARGE_UC, adv_charge_uc, GAUGE)       /* Energy model estimate */  \
+    X(ADV_AVG_NA, adv_avg_na, GAUGE)                                          \
+    X(ADV_ALWAYS_FAST_NA, adv_always_fast_na, GAUGE)                          \
+    X(READER_TAGS, reader_tags, COUNTER)         /* ST25R3911B reads */       \
+    X(READER_DUPLICATES, reader_duplicates, COUNTER)                          \
+    X(READER_ERRORS, reader_errors, COUNTER)                                  \
+    X(READER_SESSION_MS_MAX, reader_session_ms_max, PEAK)                     \
+    X(DEDUP_HITS, dedup_hits, COUNTER)           /* Repeated scans dropped */ \
+    X(DEDUP_MISSES, dedup_misses, COUNTER)                                    \
+    X(TIME_SYNCS, time_syncs, COUNTER)           /* Clock offsets applied */  \
+    X(TIME_SYNC_REJECTS, time_sync_rejects, COUNTER)                          \
+    X(TIME_RTT_MS_MAX, time_rtt_ms_max, PEAK)                                 \
+    X(TIME_STEP_MS_MAX, time_step_ms_max, PEAK)  /* Largest offset change */  \
+    X(BLE_TX_REFUSED, ble_tx_refused, COUNTER)   /* TX queue stayed full */   \
+    X(BLE_RX_DROPPED, ble_rx_dropped, COUNTER)   /* Command queue full */
+
+#define RENTSCAN_METRIC_ID(id, name, kind) RENTSCAN_MAIN_METRIC_##id,
+
+/** Metric IDs of the main device */
+enum rentscan_main_metric {
+    RENTSCAN_MAIN_METRICS(RENTSCAN_METRIC_ID)
+    RENTSCAN_MAIN_METRIC_COUNT,
+};
+
+#undef RENTSCAN_METRIC_ID
+
+/**
+ * @brief Name and kind of a metric
+ */
+struct rentscan_metric_desc {
+    const char *name;
+    enum rentscan_metric_kind kind;
+};
+
+/** Initializer for a descriptor table from an X-macro list */
+#define RENTSCAN_METRIC_DESC(id, name, kind) { #name, RENTSCAN_METRIC_##kind },
+
+/** Descriptors of the main device metrics, indexed by ID */
+extern const struct rentscan_metric_desc rentscan_main_metrics[RENTSCAN_MAIN_METRIC_COUNT];
+
+/**
+ * @brief Add one to a counter
+ *
+ * @param metric Metric to update
+ */
+static inline void rentscan_metric_inc(atomic_t *metric)
+{
+    (void)atomic_inc(metric);
+}
+
+/**
+ * @brief Add to a counter
+ *
+ * @param metric Metric to update
+ * @param val Amount to add
+ */
+static inline void rentscan_metric_add(atomic_t *metric, uint32_t val)
+{
+    (void)atomic_add(metric, val);
+}
+
+/**
+ * @brief Raise a peak to a new value if it is larger
+ *
+ * Only costs a load unless the value is a new peak.
+ *
+ * @param metric Metric to update
+ * @param val Value seen
+ */
+static inline void rentscan_metric_peak(atomic_t *metric, uint32_t val)
+{
+    atomic_val_t prev = atomic_get(metric);
+
+    while ((uint32_t)prev < val && !atomic_cas(metric, prev, val)) {
+        prev = atomic_get(metric);
+    }
+}
+
+/**
+ * @brief Get the name of a kind for display
+ *
+ * @param kind Kind of a metric
+ * @return const char* "counter", "gauge" or "peak"
+ */
+const char *rentscan_metric_kind_name(enum rentscan_metric_kind kind);
+
+/**
+ * @brief Encode metrics for CMD_STATS_RESP
+ *
+ * Encodes as many metrics as fit, starting at @p next, and moves @p next
+ * past them so a long list can be split across several messages.
+ *
+ * @param values Values indexed by metric ID
+ * @param count Number of metrics
+ * @param next First metric to encode, updated to the first one not encoded
+ * @param buf Output buffer
+ * @param buf_len Size of the output buffer
+ * @return int Number of bytes written on success, -ENOMEM if not even one
+ *             metric fits, negative error code otherwise
+ */
+int rentscan_metrics_encode(const uint32_t *values, size_t count, size_t *next,
+                            uint8_t *buf, size_t buf_len);
+
+/**
+ * @brief Decode metrics from a CMD_STATS_RESP payload
+ *
+ * Only the metrics present are written, IDs beyond @p count are skipped so
+ * an older gateway can read a newer main device.
+ *
+ * @param values Values indexed by metric ID
+ * @param count Number of metrics
+ * @param buf Encoded metrics
+ * @param len Length of @p buf
+ * @return int 0 on success, -EBADMSG if the data is malformed,
+ *             negative error code otherwise
+ */
+int rentscan_metrics_decode(uint32_t *values, size_t count, const uint8_t *buf, size_t len);
+
+#endif /* RENTSCAN_METRICS_H */
\ No newline at end of file
@@ -7,6 +7,7 @@
 #define RENTSCAN_PROTOCOL_H
 
 #include <zephyr/types.h>
+#include <stddef.h>
 #include <zephyr/bluetooth/uuid.h>
 
 /**
@@ -42,6 +43,12 @@ typedef enum {
     CMD_RENTAL_END = 2,    /**< End a rental */
     CMD_STATUS_REQ = 3,    /**< Request status */
     CMD_STATUS_RESP = 4,   /**< Status response */
+    CMD_SYNC_REQ = 5,      /**< Request rental table changes, see rentscan_sync.h */
+    CMD_SYNC_DELTA = 6,    /**< Rental table changes */
+    CMD_STATS_REQ = 7,     /**< Request latency statistics, see rentscan_latency.h */
+    CMD_STATS_RESP = 8,    /**< Latency histogram of one stage */
+    CMD_TIME_REQ = 9,      /**< Request the network time, see rentscan_time.h */
+    CMD_TIME_RESP = 10,    /**< Network time */
     CMD_ERROR = 0xFF       /**< Error message */
 } rentscan_cmd_type_t;
 
@@ -59,10 +66,90 @@ typedef struct {
     uint8_t status;                 /**< Status code */
     uint8_t tag_id[MAX_TAG_ID_LEN]; /**< NFC Tag ID */
     uint8_t tag_id_len;             /**< Length of NFC Tag ID */
-    uint32_t timestamp;             /**< Unix timestamp */
+    uint32_t timestamp;             /**< Network time in seconds, see rentscan_time.h */
     uint32_t duration;              /**< Rental duration in seconds */
+    uint32_t epoch;                 /**< Rental table epoch (sync only) */
+    uint32_t generation;            /**< Rental table generation (sync only) */
+    uint32_t corr_id;               /**< Correlation ID of the tap, 0 if none, or sync message number */
+    uint32_t latency_us;            /**< Time the main device spent before sending */
     uint8_t payload[MAX_MSG_PAYLOAD]; /**< Additional data */
     uint8_t payload_len;            /**< Length of payload */
 } rentscan_msg_t;
 
+/**
+ * @brief Wire encoding of rentscan_msg_t
+ *
+ * rentscan_msg_t is an in-memory representation only and is never sent
+ * as-is over the air. On the wire every message is encoded as:
+ *
+ *   [version][body length (varint)][cmd][status][field]...
+ *
+ * Each field starts with a key byte (field id << 1 | is_bytes). Integer
+ * fields are followed by an unsigned LEB128 varint, byte fields by a
+ * varint length and the raw bytes. Fields holding zero/empty values are
+ * omitted, and decoders skip field ids they don't know about.
+ *
+ * Because every message carries its own body length, several encoded
+ * messages can be concatenated back to back into one ATT payload.
+ */
+#define RENTSCAN_WIRE_VERSION 1
+
+/** Wire field identifiers */
+typedef enum {
+    RENTSCAN_FIELD_TAG_ID = 1,     /**< bytes: NFC Tag ID */
+    RENTSCAN_FIELD_TIMESTAMP = 2,  /**< varint: timestamp */
+    RENTSCAN_FIELD_DURATION = 3,   /**< varint: rental duration */
+    RENTSCAN_FIELD_PAYLOAD = 4,    /**< bytes: additional data */
+    RENTSCAN_FIELD_EPOCH = 5,      /**< varint: rental table epoch */
+    RENTSCAN_FIELD_GENERATION = 6, /**< varint: rental table generation */
+    RENTSCAN_FIELD_CORR_ID = 7,    /**< varint: tap correlation ID */
+    RENTSCAN_FIELD_LATENCY = 8,    /**< varint: time spent on the main device (us) */
+} rentscan_field_t;
+
+/** Minimum encoded size of a single message (header, cmd and status only) */
+#define RENTSCAN_WIRE_MSG_MIN_LEN 4
+
+/** Maximum encoded size of a single message */
+#define RENTSCAN_WIRE_MSG_MAX_LEN \
+    (1 + 2 + 2 +                        /* version, body length, cmd, status */ \
+     (1 + 1 + MAX_TAG_ID_LEN) +         /* tag ID */ \
+     6 * (1 + 5) +                      /* integer fields */ \
+     (1 + 2 + MAX_MSG_PAYLOAD))         /* payload */
+
+/**
+ * @brief Encode a message into its wire representation
+ *
+ * @param msg Message to encode
+ * @param buf Output buffer
+ * @param buf_len Size of the output buffer
+ * @return int Number of bytes written on success, negative error code otherwise
+ */
+int rentscan_msg_encode(const rentscan_msg_t *msg, uint8_t *buf, size_t buf_len);
+
+/**
+ * @brief Decode one message from its wire representation
+ *
+ * Only the first message in @p buf is decoded; the return value can be used
+ * to step to the next one when several messages share a buffer.
+ *
+ * @param msg Message to fill in
+ * @param buf Input buffer
+ * @param len Number of bytes available in the input buffer
+ * @return int Number of bytes consumed on success, negative error code otherwise
+ */
+int rentscan_msg_decode(rentscan_msg_t *msg, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Get the encoded length of the first message in a buffer
+ *
+ * Only the header is inspected, which lets encoded messages be split out
+ * of a batch and stored without decoding them.
+ *
+ * @param buf Input buffer
+ * @param len Number of bytes available in the input buffer
+ * @return int Length of the first message on success, negative error code
+ *             if the header is malformed or the message is truncated
+ */
+int rentscan_msg_frame_len(const uint8_t *buf, size_t len);
+
 #endif /* RENTSCAN_PROTOCOL_H */ 
\ No newline at end of file
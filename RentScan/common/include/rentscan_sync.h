@@ -0,0 +1,75 @@
+/**
+ * @file rentscan_sync.h
+ * @brief Rental table delta sync shared by both devices
+ *
+ * A main device counts every change to its rental table in a generation
+ * number. The gateway sends CMD_SYNC_REQ carrying the epoch and generation
+ * of the last sync it completed with that device. The main device answers
+ * with one or more CMD_SYNC_DELTA messages listing the items changed since
+ * then, packed into the payload as:
+ *
+ *   entry: [status][tag ID length][tag ID][start time (le32)][duration (le32)]
+ *
+ * The times are only present for items that are not available; returned
+ * items are listed as available. The status of the last message carries
+ * RENTSCAN_SYNC_LAST, and its epoch and generation are what the gateway
+ * asks from next time. The corr_id of the messages numbers them within the
+ * listing from 1, so the gateway notices one that went missing; a listing
+ * that starts over begins at 1 again.
+ *
+ * The epoch changes every time the main device boots. When it can't build
+ * a delta from the requested generation, it sends every item it tracks
+ * with RENTSCAN_SYNC_FULL set instead.
+ */
+
+#ifndef RENTSCAN_SYNC_H
+#define RENTSCAN_SYNC_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include "rentscan_protocol.h"
+
+/** CMD_SYNC_DELTA status flag: the listing is the whole table */
+#define RENTSCAN_SYNC_FULL 0x01
+
+/** CMD_SYNC_DELTA status flag: last message of the listing */
+#define RENTSCAN_SYNC_LAST 0x02
+
+/** Maximum encoded size of one entry */
+#define RENTSCAN_SYNC_ENTRY_MAX_LEN (2 + MAX_TAG_ID_LEN + 8)
+
+/**
+ * @brief State of one item in a delta
+ */
+struct rentscan_sync_entry {
+    uint8_t tag_id[MAX_TAG_ID_LEN];  /**< NFC Tag ID */
+    uint8_t tag_id_len;              /**< Length of the tag ID */
+    uint8_t status;                  /**< rentscan_status_t of the item */
+    uint32_t start_time;             /**< Rental start, 0 if available */
+    uint32_t duration;               /**< Rental duration, 0 if available */
+};
+
+/**
+ * @brief Encode one delta entry
+ *
+ * @param entry Entry to encode
+ * @param buf Output buffer
+ * @param buf_len Size of the output buffer
+ * @return int Number of bytes written on success, -ENOMEM if the entry
+ *             does not fit, negative error code otherwise
+ */
+int rentscan_sync_entry_encode(const struct rentscan_sync_entry *entry,
+                               uint8_t *buf, size_t buf_len);
+
+/**
+ * @brief Decode one delta entry
+ *
+ * @param entry Entry to fill in
+ * @param buf Input buffer
+ * @param len Number of bytes available in the input buffer
+ * @return int Number of bytes consumed on success, negative error code otherwise
+ */
+int rentscan_sync_entry_decode(struct rentscan_sync_entry *entry,
+                               const uint8_t *buf, size_t len);
+
+#endif /* RENTSCAN_SYNC_H */
\ No newline at end of file
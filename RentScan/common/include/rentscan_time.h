@@ -0,0 +1,118 @@
+/**
+ * @file rentscan_time.h
+ * @brief Network time shared by both devices
+ *
+ * Rental start times and expiry deadlines are kept in network time, the
+ * clock of the gateway, so a rental means the same on both sides and
+ * survives a reboot of the main device. Network time is the local uptime
+ * plus an offset: zero on the gateway, estimated by the main device with
+ * one round trip over the RentScan service:
+ *
+ *   CMD_TIME_REQ   payload [t1 (le32)]
+ *   CMD_TIME_RESP  payload [t1 (le32)][network time (le64)]
+ *
+ * t1 is the uptime of the main device in ms when it sent the request, the
+ * gateway echoes it next to its network time in ms when it answered. The
+ * answer is assumed to be taken halfway through the round trip, so the
+ * estimate is off by at most half of it.
+ */
+
+#ifndef RENTSCAN_TIME_H
+#define RENTSCAN_TIME_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include "rentscan_protocol.h"
+
+/** Encoded size of a CMD_TIME_REQ payload */
+#define RENTSCAN_TIME_REQ_LEN 4
+
+/** Encoded size of a CMD_TIME_RESP payload */
+#define RENTSCAN_TIME_RESP_LEN 12
+
+/**
+ * @brief Offset estimate from one exchange
+ */
+struct rentscan_time_sample {
+    int64_t offset_ms;   /**< Network time minus local uptime */
+    uint32_t rtt_ms;     /**< Round trip of the exchange */
+};
+
+/**
+ * @brief Get the network time
+ *
+ * @return int64_t Network time in ms
+ */
+int64_t rentscan_time_now_ms(void);
+
+/**
+ * @brief Get the network time in seconds, the unit of rental times
+ *
+ * @return uint32_t Network time in seconds
+ */
+uint32_t rentscan_time_now(void);
+
+/**
+ * @brief Convert a local uptime to network time
+ *
+ * @param uptime_ms Uptime in ms, e.g. when an event was recorded
+ * @return uint32_t Network time in seconds
+ */
+uint32_t rentscan_time_from_uptime(int64_t uptime_ms);
+
+/**
+ * @brief Set the offset of the local clock to network time
+ *
+ * The gateway sets 0, as its own clock is the reference. Rental deadlines
+ * scheduled before are not moved, see rentscan_expiry_resync().
+ *
+ * @param offset_ms Network time minus local uptime
+ */
+void rentscan_time_set_offset(int64_t offset_ms);
+
+/**
+ * @brief Get the offset of the local clock to network time
+ *
+ * @return int64_t Network time minus local uptime, 0 if never set
+ */
+int64_t rentscan_time_get_offset(void);
+
+/**
+ * @brief Check whether the local clock follows network time
+ *
+ * @return true once an offset was set
+ */
+bool rentscan_time_is_synced(void);
+
+/**
+ * @brief Fill in a time request
+ *
+ * @param msg Message to fill in
+ * @return uint32_t Uptime in ms the request carries, for rentscan_time_sample()
+ */
+uint32_t rentscan_time_request(rentscan_msg_t *msg);
+
+/**
+ * @brief Answer a time request with the local network time
+ *
+ * @param req Received CMD_TIME_REQ
+ * @param resp Response to fill in
+ * @return int 0 on success, -EBADMSG if the request is malformed
+ */
+int rentscan_time_respond(const rentscan_msg_t *req, rentscan_msg_t *resp);
+
+/**
+ * @brief Estimate the offset from a time response
+ *
+ * @param resp Received CMD_TIME_RESP
+ * @param t1_ms Uptime in ms the matching request was sent at
+ * @param t4_ms Uptime in ms the response arrived at
+ * @param sample Pointer to store the estimate
+ * @return int 0 on success, -EBADMSG if the response is malformed,
+ *             -ESTALE if it answers another request
+ */
+int rentscan_time_sample(const rentscan_msg_t *resp, uint32_t t1_ms, int64_t t4_ms,
+                         struct rentscan_time_sample *sample);
+
+#endif /* RENTSCAN_TIME_H */
\ No newline at end of file
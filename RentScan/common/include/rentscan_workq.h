@@ -0,0 +1,68 @@
+/**
+ * @file rentscan_workq.h
+ * @brief Dedicated work queues shared by both devices
+ *
+ * Work is split by how long it may wait: tag and BLE processing runs on
+ * its own high priority queue, rental logic below it, and flash writes
+ * and housekeeping last, so a slow settings write or health check never
+ * holds up a tap. Stack sizes come from Kconfig and their high water
+ * marks can be read back to size them.
+ */
+
+#ifndef RENTSCAN_WORKQ_H
+#define RENTSCAN_WORKQ_H
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+
+/**
+ * @brief Work queue with its thread's stack
+ */
+struct rentscan_workq {
+    struct k_work_q queue;
+    k_thread_stack_t *stack;
+    size_t stack_size;
+    int priority;
+    const char *name;
+};
+
+/**
+ * @brief Statically define a work queue
+ *
+ * @param _name Name of the work queue variable
+ * @param _label Thread name
+ * @param _stack_size Stack size in bytes
+ * @param _priority Thread priority
+ */
+#define RENTSCAN_WORKQ_DEFINE(_name, _label, _stack_size, _priority)    \
+    K_THREAD_STACK_DEFINE(_name##_stack, _stack_size);                  \
+    struct rentscan_workq _name = {                                     \
+        .stack = _name##_stack,                                         \
+        .stack_size = K_THREAD_STACK_SIZEOF(_name##_stack),             \
+        .priority = (_priority),                                        \
+        .name = (_label),                                               \
+    }
+
+/**
+ * @brief Start the thread of a work queue
+ *
+ * Must be called before any work is submitted to the queue.
+ *
+ * @param wq Work queue defined with RENTSCAN_WORKQ_DEFINE
+ */
+void rentscan_workq_start(struct rentscan_workq *wq);
+
+/**
+ * @brief Get the stack high water mark of a thread
+ *
+ * Needs CONFIG_INIT_STACKS and CONFIG_THREAD_STACK_INFO.
+ *
+ * @param thread Thread to check
+ * @param size Pointer to store the stack size
+ * @param used Pointer to store the most stack ever used
+ * @return int 0 on success, -ENOTSUP without stack information,
+ *             negative error code otherwise
+ */
+int rentscan_thread_stack_usage(struct k_thread *thread, size_t *size, size_t *used);
+
+#endif /* RENTSCAN_WORKQ_H */
\ No newline at end of file
@@ -0,0 +1,136 @@
+#!/usr/bin/env python3
+"""Decode the output of "rentscan rental dump" on the gateway.
+
+Reads a capture of the shell, checks the record count and CRC-32 in the
+trailer and prints one line per rental. The record layout is described in
+gateway_device/src/rental_dump.h.
+
+Usage: rentscan_dump.py [capture] [--csv]
+"""
+
+import argparse
+import base64
+import binascii
+import csv
+import re
+import sys
+import zlib
+
+DUMP_VERSION = 1
+
+STATUS_NAMES = {1: 'rented', 2: 'expired'}
+
+ANSI_RE = re.compile(r'\x1b\[[0-9;]*[A-Za-z]')
+HEADER_RE = re.compile(r'# rentscan rental dump v(\d+) now=(\d+)')
+TRAILER_RE = re.compile(r'# end records=(\d+) scanned=(\d+) bytes=(\d+) crc32=([0-9a-fA-F]{8})')
+CHUNK_RE = re.compile(r'^[A-Za-z0-9+/]+={0,2}$')
+
+
+def read_varint(data, pos):
+    val = 0
+    shift = 0
+    while True:
+        if pos >= len(data) or shift > 28:
+            raise ValueError('truncated varint')
+        byte = data[pos]
+        pos += 1
+        val |= (byte & 0x7F) << shift
+        shift += 7
+        if not byte & 0x80:
+            return val, pos
+
+
+def read_string(data, pos):
+    if pos >= len(data) or pos + 1 + data[pos] > len(data):
+        raise ValueError('truncated string')
+    end = pos + 1 + data[pos]
+    return data[pos + 1:end].decode('ascii', 'replace'), end
+
+
+def parse_chunk(chunk):
+    records = []
+    pos = 0
+    while pos < len(chunk):
+        status = chunk[pos]
+        item, pos = read_string(chunk, pos + 1)
+        user, pos = read_string(chunk, pos)
+        start, pos = read_varint(chunk, pos)
+        duration, pos = read_varint(chunk, pos)
+        records.append((item, user, STATUS_NAMES.get(status, str(status)), start, duration))
+    return records
+
+
+def parse_capture(lines):
+    """Returns the snapshot time and the records, raises ValueError if incomplete."""
+    now = None
+    data = b''
+    records = []
+    for line in lines:
+        line = ANSI_RE.sub('', line).strip()
+        header = HEADER_RE.search(line)
+        if header:
+            if int(header.group(1)) != DUMP_VERSION:
+                raise ValueError('unsupported dump version %s' % header.group(1))
+            now = int(header.group(2))
+            data = b''
+            records = []
+            continue
+        if now is None:
+            continue
+        trailer = TRAILER_RE.search(line)
+        if trailer:
+            count, _, size, crc = trailer.groups()
+            if len(records) != int(count) or len(data) != int(size):
+                raise ValueError('expected %s records in %s bytes, got %d in %d'
+                                 % (count, size, len(records), len(data)))
+            if zlib.crc32(data) != int(crc, 16):
+                raise ValueError('CRC mismatch')
+            return now, records
+        if not CHUNK_RE.match(line):
+            continue
+        try:
+            chunk = base64.b64decode(line, validate=True)
+        except binascii.Error:
+            continue
+        data += chunk
+        records += parse_chunk(chunk)
+    raise ValueError('no complete dump found')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('capture', nargs='?', help='shell capture, default stdin')
+    parser.add_argument('--csv', action='store_true', help='print CSV')
+    args = parser.parse_args()
+
+    if args.capture:
+        with open(args.capture, errors='replace') as f:
+            lines = f.readlines()
+    else:
+        lines = sys.stdin.readlines()
+
+    try:
+        now, records = parse_capture(lines)
+    except ValueError as e:
+        sys.exit('rentscan_dump: %s' % e)
+
+    rows = []
+    for item, user, status, start, duration in records:
+        remaining = max(start + duration - now, 0)
+        rows.append((item, user, status, start, duration, remaining))
+
+    header = ('item', 'user', 'status', 'start', 'duration', 'remaining')
+    if args.csv:
+        writer = csv.writer(sys.stdout)
+        writer.writerow(header)
+        writer.writerows(rows)
+        return
+
+    print('%-16s %-15s %-8s %10s %10s %10s' % header)
+    for row in rows:
+        print('%-16s %-15s %-8s %10u %10u %10u' % row)
+    print('%d rentals at network time %u s' % (len(rows), now))
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,177 @@
+#!/usr/bin/env python3
+"""Static RAM and flash of a RentScan build, from the linker map.
+
+Prints how full the memory regions are, what every application module
+takes and the largest libraries, so a profile can be checked against the
+part it has to fit.
+
+Usage: rentscan_footprint.py <zephyr.map> [--top N]
+"""
+
+import argparse
+import os
+import re
+import sys
+
+# Output sections that don't end up on the device
+IGNORED_SECTIONS = ('.debug', '.comment', '.ARM.attributes', '.note', '.stab', '.symtab',
+                    '.strtab', '.shstrtab')
+
+# Input sections that are zero filled at boot, everything else in RAM is
+# initialized data and also has its image in flash
+ZERO_SECTIONS = ('.bss', '.sbss', '.noinit', 'COMMON')
+
+# Output sections in RAM, for maps without memory regions
+RAM_SECTIONS = ('bss', 'sbss', 'tbss', 'data', 'sdata', 'tdata', 'noinit')
+
+APP_ARCHIVE = 'libapp.a'
+
+REGION_RE = re.compile(r'^(\S+)\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)')
+OUTPUT_RE = re.compile(r'^(\S+)(?:\s+0x[0-9a-fA-F]+\s+0x[0-9a-fA-F]+)?\s*$')
+INPUT_RE = re.compile(r'^ (\.\S+|COMMON)(?:\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*))?$')
+CONT_RE = re.compile(r'^\s+0x([0-9a-fA-F]+)\s+0x([0-9a-fA-F]+)\s+(\S.*)$')
+MEMBER_RE = re.compile(r'^(.*)\((.*)\)$')
+
+
+class Region:
+    def __init__(self, name, origin, length):
+        self.name = name
+        self.origin = origin
+        self.length = length
+        self.used = 0
+
+    def contains(self, addr):
+        return self.origin <= addr < self.origin + self.length
+
+    @property
+    def is_ram(self):
+        return 'RAM' in self.name.upper()
+
+    @property
+    def is_flash(self):
+        return 'FLASH' in self.name.upper()
+
+
+def owner(obj):
+    """Module of an application object, library of anything else."""
+    m = MEMBER_RE.match(obj)
+    if not m:
+        return 'objects', os.path.basename(obj).replace('.obj', '')
+
+    archive, member = os.path.basename(m.group(1)), m.group(2)
+    if archive == APP_ARCHIVE:
+        return 'app', member.replace('.obj', '')
+
+    if archive.startswith('lib'):
+        archive = archive[3:]
+    return 'lib', archive.rsplit('.', 1)[0]
+
+
+def parse(path):
+    with open(path, errors='replace') as f:
+        lines = f.read().splitlines()
+
+    regions = []
+    usage = {}
+    section = None
+    pending = None
+    in_regions = False
+    in_map = False
+
+    def account(name, addr, size, obj):
+        if size == 0 or section is None or section.startswith(IGNORED_SECTIONS):
+            return
+
+        # Sections outside RAM and flash, like IDT_LIST, are dropped by the final link
+        region = next((r for r in regions if r.contains(addr)), None)
+        if regions and (region is None or not (region.is_ram or region.is_flash)):
+            return
+
+        if region:
+            region.used += size
+            in_ram = region.is_ram
+        else:
+            # No memory regions in the map, tell by the section name
+            in_ram = section.lstrip('.').startswith(RAM_SECTIONS)
+
+        ram = size if in_ram else 0
+        flash = size if not in_ram or not name.startswith(ZERO_SECTIONS) else 0
+        entry = usage.setdefault(owner(obj), [0, 0])
+        entry[0] += ram
+        entry[1] += flash
+
+    for line in lines:
+        if line.startswith('Memory Configuration'):
+            in_regions = True
+            continue
+        if line.startswith('Linker script and memory map'):
+            in_regions = False
+            in_map = True
+            continue
+
+        if in_regions:
+            m = REGION_RE.match(line)
+            if m and m.group(1) != '*default*':
+                regions.append(Region(m.group(1), int(m.group(2), 16), int(m.group(3), 16)))
+            continue
+
+        if not in_map:
+            continue
+
+        if pending:
+            m = CONT_RE.match(line)
+            if m:
+                account(pending, int(m.group(1), 16), int(m.group(2), 16), m.group(3))
+            pending = None
+            continue
+
+        m = INPUT_RE.match(line)
+        if m:
+            if m.group(2) is None:
+                pending = m.group(1)
+            else:
+                account(m.group(1), int(m.group(2), 16), int(m.group(3), 16), m.group(4))
+            continue
+
+        m = OUTPUT_RE.match(line)
+        if m and not line.startswith((' ', 'LOAD', 'OUTPUT', 'START', 'END')):
+            section = m.group(1)
+
+    return regions, usage
+
+
+def print_table(title, rows):
+    print(f'{title:<32} {"RAM":>8} {"Flash":>8}')
+    for name, (ram, flash) in rows:
+        print(f'  {name:<30} {ram:>8} {flash:>8}')
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument('map', help='linker map of the build, e.g. build/zephyr/zephyr.map')
+    parser.add_argument('--top', type=int, default=10, help='libraries listed (default 10)')
+    args = parser.parse_args()
+
+    if not os.path.isfile(args.map):
+        sys.exit(f'{args.map} not found, build the application first')
+
+    regions, usage = parse(args.map)
+
+    print('RentScan footprint')
+    for r in regions:
+        if r.is_ram or r.is_flash:
+            pct = 100.0 * r.used / r.length if r.length else 0.0
+            print(f'  {r.name:<10} {r.used:>8} of {r.length:>8} bytes ({pct:.1f}%)')
+
+    app = sorted(((name, v) for (kind, name), v in usage.items() if kind == 'app'),
+                 key=lambda e: -e[1][0])
+    total = [sum(v[0] for _, v in app), sum(v[1] for _, v in app)]
+    print_table('Application', app + [('total', total)])
+
+    libs = sorted(((name, v) for (kind, name), v in usage.items() if kind != 'app'),
+                  key=lambda e: -(e[1][0] + e[1][1]))
+    print_table('Largest libraries', libs[:args.top])
+
+
+if __name__ == '__main__':
+    main()
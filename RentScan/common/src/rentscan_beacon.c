@@ -0,0 +1,100 @@
+/**
+ * @file rentscan_beacon.c
+ * @brief Encoding/decoding of rental status beacons shared by both devices
+ */
+
+#include <errno.h>
+#include <zephyr/sys/byteorder.h>
+#include "../include/rentscan_beacon.h"
+
+uint32_t rentscan_beacon_tag_hash(const uint8_t *tag_id, size_t tag_id_len)
+{
+    /* 32-bit FNV-1a */
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < tag_id_len; i++) {
+        hash ^= tag_id[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+int rentscan_beacon_encode(const struct rentscan_beacon *beacon, uint8_t *buf, size_t buf_len)
+{
+    if (!beacon || !buf) {
+        return -EINVAL;
+    }
+
+    if (beacon->entry_count > RENTSCAN_BEACON_MAX_ENTRIES ||
+        beacon->page_count > RENTSCAN_BEACON_MAX_PAGES ||
+        beacon->page >= beacon->page_count) {
+        return -EINVAL;
+    }
+
+    size_t len = RENTSCAN_BEACON_HDR_LEN +
+                 beacon->entry_count * RENTSCAN_BEACON_ENTRY_LEN;
+
+    if (buf_len < len) {
+        return -ENOMEM;
+    }
+
+    buf[0] = RENTSCAN_BEACON_VERSION;
+    sys_put_le16(beacon->seq, &buf[1]);
+    buf[3] = beacon->page;
+    buf[4] = beacon->page_count;
+    sys_put_le16(beacon->total, &buf[5]);
+
+    uint8_t *pos = &buf[RENTSCAN_BEACON_HDR_LEN];
+
+    for (int i = 0; i < beacon->entry_count; i++) {
+        sys_put_le32(beacon->entries[i].tag_hash, pos);
+        pos[4] = beacon->entries[i].status;
+        pos += RENTSCAN_BEACON_ENTRY_LEN;
+    }
+
+    return len;
+}
+
+int rentscan_beacon_decode(struct rentscan_beacon *beacon, const uint8_t *buf, size_t len)
+{
+    if (!beacon || !buf) {
+        return -EINVAL;
+    }
+
+    if (len < RENTSCAN_BEACON_HDR_LEN) {
+        return -EBADMSG;
+    }
+
+    if (buf[0] != RENTSCAN_BEACON_VERSION) {
+        return -ENOTSUP;
+    }
+
+    size_t count = (len - RENTSCAN_BEACON_HDR_LEN) / RENTSCAN_BEACON_ENTRY_LEN;
+
+    if ((len - RENTSCAN_BEACON_HDR_LEN) % RENTSCAN_BEACON_ENTRY_LEN ||
+        count > RENTSCAN_BEACON_MAX_ENTRIES) {
+        return -EBADMSG;
+    }
+
+    beacon->seq = sys_get_le16(&buf[1]);
+    beacon->page = buf[3];
+    beacon->page_count = buf[4];
+    beacon->total = sys_get_le16(&buf[5]);
+    beacon->entry_count = count;
+
+    if (beacon->page_count == 0 || beacon->page_count > RENTSCAN_BEACON_MAX_PAGES ||
+        beacon->page >= beacon->page_count) {
+        return -EBADMSG;
+    }
+
+    const uint8_t *pos = &buf[RENTSCAN_BEACON_HDR_LEN];
+
+    for (size_t i = 0; i < count; i++) {
+        beacon->entries[i].tag_hash = sys_get_le32(pos);
+        beacon->entries[i].status = pos[4];
+        pos += RENTSCAN_BEACON_ENTRY_LEN;
+    }
+
+    return 0;
+}
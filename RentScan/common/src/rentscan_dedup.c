@@ -0,0 +1,100 @@
+/**
+ * @file rentscan_dedup.c
+ * @brief Time windowed LRU cache of recently seen tag IDs
+ */
+
+#include <string.h>
+#include "../include/rentscan_dedup.h"
+
+/* The caches are a few dozen entries, a linear scan beats keeping an order */
+static struct rentscan_dedup_entry *find(struct rentscan_dedup *dd,
+                                         const uint8_t *id, size_t id_len)
+{
+    for (uint16_t i = 0; i < dd->capacity; i++) {
+        struct rentscan_dedup_entry *e = &dd->entries[i];
+
+        if (e->id_len == id_len && memcmp(e->id, id, id_len) == 0) {
+            return e;
+        }
+    }
+
+    return NULL;
+}
+
+static bool seen_locked(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len,
+                        uint32_t now)
+{
+    struct rentscan_dedup_entry *e = find(dd, id, id_len);
+
+    /* Unsigned difference, so sightings keep their age across wraparound */
+    if (!e || now - e->seen_ms >= dd->window_ms) {
+        return false;
+    }
+
+    e->seen_ms = now;
+    return true;
+}
+
+static void add_locked(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len,
+                       uint32_t now)
+{
+    struct rentscan_dedup_entry *e = find(dd, id, id_len);
+
+    if (!e) {
+        e = &dd->entries[0];
+        for (uint16_t i = 1; i < dd->capacity && e->id_len; i++) {
+            struct rentscan_dedup_entry *other = &dd->entries[i];
+
+            if (!other->id_len || now - other->seen_ms > now - e->seen_ms) {
+                e = other;
+            }
+        }
+        memcpy(e->id, id, id_len);
+        e->id_len = id_len;
+    }
+
+    e->seen_ms = now;
+}
+
+bool rentscan_dedup_seen(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len)
+{
+    if (id_len == 0 || id_len > MAX_TAG_ID_LEN) {
+        return false;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&dd->lock);
+    bool seen = seen_locked(dd, id, id_len, k_uptime_get_32());
+
+    k_spin_unlock(&dd->lock, key);
+    return seen;
+}
+
+void rentscan_dedup_add(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len)
+{
+    if (id_len == 0 || id_len > MAX_TAG_ID_LEN) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&dd->lock);
+
+    add_locked(dd, id, id_len, k_uptime_get_32());
+    k_spin_unlock(&dd->lock, key);
+}
+
+bool rentscan_dedup_check(struct rentscan_dedup *dd, const uint8_t *id, size_t id_len)
+{
+    if (id_len == 0 || id_len > MAX_TAG_ID_LEN) {
+        return false;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&dd->lock);
+    uint32_t now = k_uptime_get_32();
+    bool seen = seen_locked(dd, id, id_len, now);
+
+    if (!seen) {
+        add_locked(dd, id, id_len, now);
+    }
+    k_spin_unlock(&dd->lock, key);
+
+    return seen;
+}
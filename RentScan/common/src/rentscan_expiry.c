@@ -0,0 +1,216 @@
+/**
+ * @file rentscan_expiry.c
+ * @brief Min-heap deadline scheduler for rental expiry
+ */
+
+#include <errno.h>
+#include "../include/rentscan_expiry.h"
+#include "../include/rentscan_time.h"
+
+/* Serial number comparison so deadlines keep ordering across wraparound */
+static inline bool before(uint32_t a, uint32_t b)
+{
+    return (int32_t)(a - b) < 0;
+}
+
+static inline void heap_set(struct rentscan_expiry *exp, uint16_t idx,
+                            struct rentscan_expiry_entry *entry)
+{
+    exp->heap[idx] = entry;
+    entry->heap_idx = idx;
+}
+
+static void sift_up(struct rentscan_expiry *exp, uint16_t idx)
+{
+    struct rentscan_expiry_entry *entry = exp->heap[idx];
+
+    while (idx > 0) {
+        uint16_t parent = (idx - 1) / 2;
+
+        if (!before(entry->deadline, exp->heap[parent]->deadline)) {
+            break;
+        }
+        heap_set(exp, idx, exp->heap[parent]);
+        idx = parent;
+    }
+
+    heap_set(exp, idx, entry);
+}
+
+static void sift_down(struct rentscan_expiry *exp, uint16_t idx)
+{
+    struct rentscan_expiry_entry *entry = exp->heap[idx];
+
+    for (;;) {
+        uint32_t child = 2 * (uint32_t)idx + 1;
+
+        if (child >= exp->count) {
+            break;
+        }
+        if (child + 1 < exp->count &&
+            before(exp->heap[child + 1]->deadline, exp->heap[child]->deadline)) {
+            child++;
+        }
+        if (!before(exp->heap[child]->deadline, entry->deadline)) {
+            break;
+        }
+        heap_set(exp, idx, exp->heap[child]);
+        idx = child;
+    }
+
+    heap_set(exp, idx, entry);
+}
+
+static void heap_fix(struct rentscan_expiry *exp, uint16_t idx)
+{
+    if (idx > 0 && before(exp->heap[idx]->deadline, exp->heap[(idx - 1) / 2]->deadline)) {
+        sift_up(exp, idx);
+    } else {
+        sift_down(exp, idx);
+    }
+}
+
+static void heap_remove(struct rentscan_expiry *exp, uint16_t idx)
+{
+    struct rentscan_expiry_entry *entry = exp->heap[idx];
+
+    exp->count--;
+    if (idx != exp->count) {
+        heap_set(exp, idx, exp->heap[exp->count]);
+        heap_fix(exp, idx);
+    }
+
+    entry->heap_idx = RENTSCAN_EXPIRY_IDLE;
+}
+
+static void rearm_locked(struct rentscan_expiry *exp)
+{
+    if (exp->count == 0) {
+        k_work_cancel_delayable(&exp->work);
+        return;
+    }
+
+    int64_t now_ms = k_uptime_get();
+    int64_t delay_ms = (int64_t)exp->heap[0]->deadline * MSEC_PER_SEC - rentscan_time_now_ms();
+
+    /* What the work queue delays past this counts as lateness */
+    exp->armed_ms = delay_ms > 0 ? now_ms + delay_ms : now_ms;
+    k_work_reschedule_for_queue(exp->work_q, &exp->work,
+                                delay_ms > 0 ? K_MSEC(delay_ms) : K_NO_WAIT);
+}
+
+static void expiry_work_handler(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct rentscan_expiry *exp = CONTAINER_OF(dwork, struct rentscan_expiry, work);
+    uint32_t start = k_cycle_get_32();
+    uint32_t now = rentscan_time_now();
+    k_spinlock_key_t key = k_spin_lock(&exp->lock);
+    int64_t late_ms = k_uptime_get() - exp->armed_ms;
+
+    exp->stats.sweeps++;
+    if (late_ms > exp->stats.late_ms_max) {
+        exp->stats.late_ms_max = MIN(late_ms, UINT32_MAX);
+    }
+
+    while (exp->count > 0 && !before(now, exp->heap[0]->deadline)) {
+        struct rentscan_expiry_entry *entry = exp->heap[0];
+
+        heap_remove(exp, 0);
+        exp->stats.expired++;
+
+        k_spin_unlock(&exp->lock, key);
+        exp->expired_cb(entry);
+        key = k_spin_lock(&exp->lock);
+    }
+
+    rearm_locked(exp);
+
+    uint32_t sweep_us = k_cyc_to_us_floor32(k_cycle_get_32() - start);
+
+    if (sweep_us > exp->stats.sweep_us_max) {
+        exp->stats.sweep_us_max = sweep_us;
+    }
+    k_spin_unlock(&exp->lock, key);
+}
+
+void rentscan_expiry_init(struct rentscan_expiry *exp, struct k_work_q *work_q,
+                          rentscan_expiry_cb_t expired_cb)
+{
+    exp->work_q = work_q ? work_q : &k_sys_work_q;
+    exp->count = 0;
+    exp->armed_ms = 0;
+    exp->stats = (struct rentscan_expiry_stats) { 0 };
+    exp->expired_cb = expired_cb;
+    k_work_init_delayable(&exp->work, expiry_work_handler);
+}
+
+int rentscan_expiry_schedule(struct rentscan_expiry *exp,
+                             struct rentscan_expiry_entry *entry, uint32_t deadline)
+{
+    k_spinlock_key_t key = k_spin_lock(&exp->lock);
+    struct rentscan_expiry_entry *top = exp->count ? exp->heap[0] : NULL;
+
+    if (rentscan_expiry_is_scheduled(entry)) {
+        entry->deadline = deadline;
+        heap_fix(exp, entry->heap_idx);
+    } else {
+        if (exp->count >= exp->capacity) {
+            k_spin_unlock(&exp->lock, key);
+            return -ENOMEM;
+        }
+        entry->deadline = deadline;
+        exp->heap[exp->count] = entry;
+        entry->heap_idx = exp->count++;
+        sift_up(exp, entry->heap_idx);
+    }
+
+    /* Only the earliest deadline decides when the work runs */
+    if (exp->heap[0] != top || top == entry) {
+        rearm_locked(exp);
+    }
+
+    k_spin_unlock(&exp->lock, key);
+    return 0;
+}
+
+void rentscan_expiry_resync(struct rentscan_expiry *exp)
+{
+    k_spinlock_key_t key = k_spin_lock(&exp->lock);
+
+    rearm_locked(exp);
+    k_spin_unlock(&exp->lock, key);
+}
+
+void rentscan_expiry_cancel(struct rentscan_expiry *exp, struct rentscan_expiry_entry *entry)
+{
+    k_spinlock_key_t key = k_spin_lock(&exp->lock);
+
+    if (rentscan_expiry_is_scheduled(entry)) {
+        bool was_top = (entry->heap_idx == 0);
+
+        heap_remove(exp, entry->heap_idx);
+        if (was_top) {
+            rearm_locked(exp);
+        }
+    }
+
+    k_spin_unlock(&exp->lock, key);
+}
+
+uint16_t rentscan_expiry_count(struct rentscan_expiry *exp)
+{
+    k_spinlock_key_t key = k_spin_lock(&exp->lock);
+    uint16_t count = exp->count;
+
+    k_spin_unlock(&exp->lock, key);
+    return count;
+}
+
+void rentscan_expiry_get_stats(struct rentscan_expiry *exp, struct rentscan_expiry_stats *stats)
+{
+    k_spinlock_key_t key = k_spin_lock(&exp->lock);
+
+    *stats = exp->stats;
+    k_spin_unlock(&exp->lock, key);
+}
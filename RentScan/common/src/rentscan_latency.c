@@ -0,0 +1,123 @@
+/**
+ * @file rentscan_latency.c
+ * @brief Fixed-bucket latency histograms shared by both devices
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include "../include/rentscan_latency.h"
+
+static unsigned int bucket_of(uint32_t us)
+{
+    unsigned int bucket = 31 - __builtin_clz(us | 1);
+
+    return bucket < RENTSCAN_LATENCY_BUCKETS ? bucket : RENTSCAN_LATENCY_BUCKETS - 1;
+}
+
+void rentscan_latency_record(struct rentscan_latency_hist *hist, uint32_t us)
+{
+    if (!hist) {
+        return;
+    }
+
+    hist->count++;
+    hist->sum_us += us;
+    if (us > hist->max_us) {
+        hist->max_us = us;
+    }
+    hist->buckets[bucket_of(us)]++;
+}
+
+uint32_t rentscan_latency_bucket_limit(unsigned int bucket)
+{
+    if (bucket >= RENTSCAN_LATENCY_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return 2U << bucket;
+}
+
+uint32_t rentscan_latency_mean(const struct rentscan_latency_hist *hist)
+{
+    if (!hist || !hist->count) {
+        return 0;
+    }
+    return hist->sum_us / hist->count;
+}
+
+uint32_t rentscan_latency_percentile(const struct rentscan_latency_hist *hist,
+                                     unsigned int pct)
+{
+    if (!hist || !hist->count || pct == 0 || pct > 100) {
+        return 0;
+    }
+
+    /* Rank of the sample, rounded up */
+    uint64_t rank = ((uint64_t)hist->count * pct + 99) / 100;
+    uint64_t seen = 0;
+
+    for (unsigned int i = 0; i < RENTSCAN_LATENCY_BUCKETS; i++) {
+        seen += hist->buckets[i];
+        if (seen >= rank) {
+            uint32_t limit = rentscan_latency_bucket_limit(i);
+
+            return limit < hist->max_us ? limit : hist->max_us;
+        }
+    }
+
+    return hist->max_us;
+}
+
+int rentscan_latency_encode(const struct rentscan_latency_hist *hist,
+                            uint8_t *buf, size_t buf_len)
+{
+    uint8_t used = 0;
+
+    if (!hist || !buf) {
+        return -EINVAL;
+    }
+
+    for (unsigned int i = 0; i < RENTSCAN_LATENCY_BUCKETS; i++) {
+        if (hist->buckets[i]) {
+            used = i + 1;
+        }
+    }
+
+    size_t len = 13 + 4 * used;
+
+    if (buf_len < len) {
+        return -ENOMEM;
+    }
+
+    sys_put_le32(hist->count, &buf[0]);
+    sys_put_le32(hist->max_us, &buf[4]);
+    sys_put_le32(rentscan_latency_mean(hist), &buf[8]);
+    buf[12] = used;
+    for (unsigned int i = 0; i < used; i++) {
+        sys_put_le32(hist->buckets[i], &buf[13 + 4 * i]);
+    }
+
+    return len;
+}
+
+int rentscan_latency_decode(struct rentscan_latency_hist *hist,
+                            const uint8_t *buf, size_t len)
+{
+    if (!hist || !buf) {
+        return -EINVAL;
+    }
+
+    if (len < 13 || buf[12] > RENTSCAN_LATENCY_BUCKETS || len < 13 + 4 * (size_t)buf[12]) {
+        return -EBADMSG;
+    }
+
+    memset(hist, 0, sizeof(*hist));
+    hist->count = sys_get_le32(&buf[0]);
+    hist->max_us = sys_get_le32(&buf[4]);
+    hist->sum_us = (uint64_t)sys_get_le32(&buf[8]) * hist->count;
+    for (unsigned int i = 0; i < buf[12]; i++) {
+        hist->buckets[i] = sys_get_le32(&buf[13 + 4 * i]);
+    }
+
+    return 0;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file rentscan_metrics.c
+ * @brief Encoding of runtime counters shared by both devices
+ */
+
+#include <errno.h>
+#include "../include/rentscan_metrics.h"
+
+const struct rentscan_metric_desc rentscan_main_metrics[RENTSCAN_MAIN_METRIC_COUNT] = {
+    RENTSCAN_MAIN_METRICS(RENTSCAN_METRIC_DESC)
+};
+
+static size_t varint_len(uint32_t val)
+{
+    size_t len = 1;
+
+    while (val >= 0x80) {
+        val >>= 7;
+        len++;
+    }
+    return len;
+}
+
+static size_t put_varint(uint8_t *buf, uint32_t val)
+{
+    size_t pos = 0;
+
+    do {
+        uint8_t byte = val & 0x7F;
+
+        val >>= 7;
+        buf[pos++] = val ? (byte | 0x80) : byte;
+    } while (val);
+
+    return pos;
+}
+
+static int get_varint(const uint8_t *buf, size_t len, size_t *pos, uint32_t *val)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 35; shift += 7) {
+        if (*pos >= len) {
+            return -EBADMSG;
+        }
+
+        uint8_t byte = buf[(*pos)++];
+
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *val = result;
+            return 0;
+        }
+    }
+
+    return -EBADMSG;
+}
+
+const char *rentscan_metric_kind_name(enum rentscan_metric_kind kind)
+{
+    switch (kind) {
+    case RENTSCAN_METRIC_COUNTER:
+        return "counter";
+    case RENTSCAN_METRIC_GAUGE:
+        return "gauge";
+    case RENTSCAN_METRIC_PEAK:
+        return "peak";
+    default:
+        return "unknown";
+    }
+}
+
+int rentscan_metrics_encode(const uint32_t *values, size_t count, size_t *next,
+                            uint8_t *buf, size_t buf_len)
+{
+    size_t pos = 0;
+
+    if (!values || !next || !buf) {
+        return -EINVAL;
+    }
+
+    for (; *next < count; (*next)++) {
+        uint32_t val = values[*next];
+
+        if (!val) {
+            continue;
+        }
+        if (pos + varint_len(*next) + varint_len(val) > buf_len) {
+            /* Not even one metric fits, the caller would never finish */
+            return pos ? (int)pos : -ENOMEM;
+        }
+        pos += put_varint(&buf[pos], *next);
+        pos += put_varint(&buf[pos], val);
+    }
+
+    return pos;
+}
+
+int rentscan_metrics_decode(uint32_t *values, size_t count, const uint8_t *buf, size_t len)
+{
+    size_t pos = 0;
+
+    if (!values || !buf) {
+        return -EINVAL;
+    }
+
+    while (pos < len) {
+        uint32_t id;
+        uint32_t val;
+
+        if (get_varint(buf, len, &pos, &id) || get_varint(buf, len, &pos, &val)) {
+            return -EBADMSG;
+        }
+        if (id < count) {
+            values[id] = val;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,312 @@
+/**
+ * @file rentscan_protocol.c
+ * @brief Wire encoding/decoding of RentScan messages shared by both devices
+ */
+
+#include <errno.h>
+#include <string.h>
+#include "../include/rentscan_protocol.h"
+
+#define FIELD_KEY(id, is_bytes) ((uint8_t)(((id) << 1) | ((is_bytes) ? 1 : 0)))
+
+/* Largest body length we ever produce, fits in a two byte varint */
+#define BODY_LEN_MAX 0x3FFF
+
+struct wire_writer {
+    uint8_t *buf;
+    size_t len;
+    size_t pos;
+    bool overflow;
+};
+
+struct wire_reader {
+    const uint8_t *buf;
+    size_t len;
+    size_t pos;
+};
+
+static void put_u8(struct wire_writer *w, uint8_t val)
+{
+    if (w->pos >= w->len) {
+        w->overflow = true;
+        return;
+    }
+    w->buf[w->pos++] = val;
+}
+
+static void put_varint(struct wire_writer *w, uint32_t val)
+{
+    do {
+        uint8_t byte = val & 0x7F;
+
+        val >>= 7;
+        put_u8(w, val ? (byte | 0x80) : byte);
+    } while (val);
+}
+
+static void put_bytes(struct wire_writer *w, const uint8_t *data, size_t len)
+{
+    if (w->pos + len > w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(&w->buf[w->pos], data, len);
+    w->pos += len;
+}
+
+static void put_int_field(struct wire_writer *w, rentscan_field_t id, uint32_t val)
+{
+    if (val == 0) {
+        return;
+    }
+    put_u8(w, FIELD_KEY(id, false));
+    put_varint(w, val);
+}
+
+static void put_bytes_field(struct wire_writer *w, rentscan_field_t id,
+                            const uint8_t *data, size_t len)
+{
+    if (len == 0) {
+        return;
+    }
+    put_u8(w, FIELD_KEY(id, true));
+    put_varint(w, len);
+    put_bytes(w, data, len);
+}
+
+static int get_u8(struct wire_reader *r, uint8_t *val)
+{
+    if (r->pos >= r->len) {
+        return -EBADMSG;
+    }
+    *val = r->buf[r->pos++];
+    return 0;
+}
+
+static int get_varint(struct wire_reader *r, uint32_t *val)
+{
+    uint32_t result = 0;
+
+    for (int shift = 0; shift < 35; shift += 7) {
+        uint8_t byte;
+        int err = get_u8(r, &byte);
+
+        if (err) {
+            return err;
+        }
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if (!(byte & 0x80)) {
+            *val = result;
+            return 0;
+        }
+    }
+
+    return -EBADMSG;
+}
+
+int rentscan_msg_encode(const rentscan_msg_t *msg, uint8_t *buf, size_t buf_len)
+{
+    if (!msg || !buf) {
+        return -EINVAL;
+    }
+
+    if (msg->tag_id_len > MAX_TAG_ID_LEN || msg->payload_len > MAX_MSG_PAYLOAD) {
+        return -EINVAL;
+    }
+
+    /* The body length prefix is written once the body size is known. A two
+     * byte slot is reserved up front and compacted for short bodies.
+     */
+    struct wire_writer w = {
+        .buf = buf,
+        .len = buf_len,
+        .pos = 3,
+    };
+
+    if (buf_len < 3) {
+        return -ENOMEM;
+    }
+
+    put_u8(&w, msg->cmd);
+    put_u8(&w, msg->status);
+    put_bytes_field(&w, RENTSCAN_FIELD_TAG_ID, msg->tag_id, msg->tag_id_len);
+    put_int_field(&w, RENTSCAN_FIELD_TIMESTAMP, msg->timestamp);
+    put_int_field(&w, RENTSCAN_FIELD_DURATION, msg->duration);
+    put_int_field(&w, RENTSCAN_FIELD_EPOCH, msg->epoch);
+    put_int_field(&w, RENTSCAN_FIELD_GENERATION, msg->generation);
+    put_int_field(&w, RENTSCAN_FIELD_CORR_ID, msg->corr_id);
+    put_int_field(&w, RENTSCAN_FIELD_LATENCY, msg->latency_us);
+    put_bytes_field(&w, RENTSCAN_FIELD_PAYLOAD, msg->payload, msg->payload_len);
+
+    if (w.overflow) {
+        return -ENOMEM;
+    }
+
+    size_t body_len = w.pos - 3;
+
+    if (body_len > BODY_LEN_MAX) {
+        return -EINVAL;
+    }
+
+    buf[0] = RENTSCAN_WIRE_VERSION;
+    if (body_len < 0x80) {
+        buf[1] = body_len;
+        memmove(&buf[2], &buf[3], body_len);
+        return body_len + 2;
+    }
+
+    buf[1] = (body_len & 0x7F) | 0x80;
+    buf[2] = body_len >> 7;
+    return body_len + 3;
+}
+
+static int read_header(struct wire_reader *r, uint32_t *body_len)
+{
+    uint8_t version;
+    int err;
+
+    err = get_u8(r, &version);
+    if (err) {
+        return err;
+    }
+
+    if (version != RENTSCAN_WIRE_VERSION) {
+        return -ENOTSUP;
+    }
+
+    err = get_varint(r, body_len);
+    if (err) {
+        return err;
+    }
+
+    if (*body_len > r->len - r->pos) {
+        return -EBADMSG;
+    }
+
+    return 0;
+}
+
+int rentscan_msg_frame_len(const uint8_t *buf, size_t len)
+{
+    if (!buf) {
+        return -EINVAL;
+    }
+
+    struct wire_reader r = {
+        .buf = buf,
+        .len = len,
+        .pos = 0,
+    };
+    uint32_t body_len;
+    int err = read_header(&r, &body_len);
+
+    if (err) {
+        return err;
+    }
+
+    return r.pos + body_len;
+}
+
+int rentscan_msg_decode(rentscan_msg_t *msg, const uint8_t *buf, size_t len)
+{
+    if (!msg || !buf) {
+        return -EINVAL;
+    }
+
+    struct wire_reader r = {
+        .buf = buf,
+        .len = len,
+        .pos = 0,
+    };
+    uint32_t body_len;
+    int err;
+
+    err = read_header(&r, &body_len);
+    if (err) {
+        return err;
+    }
+
+    /* Restrict the reader to this message's body */
+    r.len = r.pos + body_len;
+
+    memset(msg, 0, sizeof(*msg));
+
+    err = get_u8(&r, &msg->cmd);
+    if (!err) {
+        err = get_u8(&r, &msg->status);
+    }
+    if (err) {
+        return err;
+    }
+
+    while (r.pos < r.len) {
+        uint8_t key;
+        uint32_t val;
+
+        err = get_u8(&r, &key);
+        if (!err) {
+            err = get_varint(&r, &val);
+        }
+        if (err) {
+            return err;
+        }
+
+        if (key & 1) {
+            /* Byte field, val is the length */
+            if (val > r.len - r.pos) {
+                return -EBADMSG;
+            }
+
+            const uint8_t *data = &r.buf[r.pos];
+
+            r.pos += val;
+
+            switch (key >> 1) {
+            case RENTSCAN_FIELD_TAG_ID:
+                if (val > MAX_TAG_ID_LEN) {
+                    return -EMSGSIZE;
+                }
+                memcpy(msg->tag_id, data, val);
+                msg->tag_id_len = val;
+                break;
+            case RENTSCAN_FIELD_PAYLOAD:
+                if (val > MAX_MSG_PAYLOAD) {
+                    return -EMSGSIZE;
+                }
+                memcpy(msg->payload, data, val);
+                msg->payload_len = val;
+                break;
+            default:
+                /* Unknown byte field, already skipped */
+                break;
+            }
+            continue;
+        }
+
+        switch (key >> 1) {
+        case RENTSCAN_FIELD_TIMESTAMP:
+            msg->timestamp = val;
+            break;
+        case RENTSCAN_FIELD_DURATION:
+            msg->duration = val;
+            break;
+        case RENTSCAN_FIELD_EPOCH:
+            msg->epoch = val;
+            break;
+        case RENTSCAN_FIELD_GENERATION:
+            msg->generation = val;
+            break;
+        case RENTSCAN_FIELD_CORR_ID:
+            msg->corr_id = val;
+            break;
+        case RENTSCAN_FIELD_LATENCY:
+            msg->latency_us = val;
+            break;
+        default:
+            /* Unknown integer field, ignore */
+            break;
+        }
+    }
+
+    return r.len;
+}
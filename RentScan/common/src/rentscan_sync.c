@@ -0,0 +1,80 @@
+/**
+ * @file rentscan_sync.c
+ * @brief Encoding/decoding of rental table delta entries shared by both devices
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include "../include/rentscan_sync.h"
+
+static size_t entry_len(uint8_t status, uint8_t tag_id_len)
+{
+    return 2 + tag_id_len + (status != STATUS_AVAILABLE ? 8 : 0);
+}
+
+int rentscan_sync_entry_encode(const struct rentscan_sync_entry *entry,
+                               uint8_t *buf, size_t buf_len)
+{
+    if (!entry || !buf) {
+        return -EINVAL;
+    }
+
+    if (entry->tag_id_len == 0 || entry->tag_id_len > MAX_TAG_ID_LEN) {
+        return -EINVAL;
+    }
+
+    size_t len = entry_len(entry->status, entry->tag_id_len);
+
+    if (buf_len < len) {
+        return -ENOMEM;
+    }
+
+    buf[0] = entry->status;
+    buf[1] = entry->tag_id_len;
+    memcpy(&buf[2], entry->tag_id, entry->tag_id_len);
+
+    if (entry->status != STATUS_AVAILABLE) {
+        sys_put_le32(entry->start_time, &buf[2 + entry->tag_id_len]);
+        sys_put_le32(entry->duration, &buf[6 + entry->tag_id_len]);
+    }
+
+    return len;
+}
+
+int rentscan_sync_entry_decode(struct rentscan_sync_entry *entry,
+                               const uint8_t *buf, size_t len)
+{
+    if (!entry || !buf) {
+        return -EINVAL;
+    }
+
+    if (len < 2) {
+        return -EBADMSG;
+    }
+
+    uint8_t status = buf[0];
+    uint8_t tag_id_len = buf[1];
+
+    if (tag_id_len == 0 || tag_id_len > MAX_TAG_ID_LEN) {
+        return -EBADMSG;
+    }
+
+    size_t consumed = entry_len(status, tag_id_len);
+
+    if (len < consumed) {
+        return -EBADMSG;
+    }
+
+    memset(entry, 0, sizeof(*entry));
+    entry->status = status;
+    entry->tag_id_len = tag_id_len;
+    memcpy(entry->tag_id, &buf[2], tag_id_len);
+
+    if (status != STATUS_AVAILABLE) {
+        entry->start_time = sys_get_le32(&buf[2 + tag_id_len]);
+        entry->duration = sys_get_le32(&buf[6 + tag_id_len]);
+    }
+
+    return consumed;
+}
@@ -0,0 +1,103 @@
+/**
+ * @file rentscan_time.c
+ * @brief Network time shared by both devices
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include "../include/rentscan_time.h"
+
+static struct k_spinlock lock;
+static int64_t offset;
+static bool synced;
+
+int64_t rentscan_time_now_ms(void)
+{
+    return k_uptime_get() + rentscan_time_get_offset();
+}
+
+uint32_t rentscan_time_now(void)
+{
+    return (uint32_t)(rentscan_time_now_ms() / MSEC_PER_SEC);
+}
+
+uint32_t rentscan_time_from_uptime(int64_t uptime_ms)
+{
+    return (uint32_t)((uptime_ms + rentscan_time_get_offset()) / MSEC_PER_SEC);
+}
+
+void rentscan_time_set_offset(int64_t offset_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    offset = offset_ms;
+    synced = true;
+    k_spin_unlock(&lock, key);
+}
+
+int64_t rentscan_time_get_offset(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    int64_t offset_ms = offset;
+
+    k_spin_unlock(&lock, key);
+    return offset_ms;
+}
+
+bool rentscan_time_is_synced(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    bool is_synced = synced;
+
+    k_spin_unlock(&lock, key);
+    return is_synced;
+}
+
+uint32_t rentscan_time_request(rentscan_msg_t *msg)
+{
+    uint32_t t1_ms = k_uptime_get_32();
+
+    memset(msg, 0, sizeof(*msg));
+    msg->cmd = CMD_TIME_REQ;
+    sys_put_le32(t1_ms, msg->payload);
+    msg->payload_len = RENTSCAN_TIME_REQ_LEN;
+    return t1_ms;
+}
+
+int rentscan_time_respond(const rentscan_msg_t *req, rentscan_msg_t *resp)
+{
+    if (req->cmd != CMD_TIME_REQ || req->payload_len < RENTSCAN_TIME_REQ_LEN) {
+        return -EBADMSG;
+    }
+
+    int64_t now_ms = rentscan_time_now_ms();
+
+    memset(resp, 0, sizeof(*resp));
+    resp->cmd = CMD_TIME_RESP;
+    resp->timestamp = (uint32_t)(now_ms / MSEC_PER_SEC);
+    memcpy(resp->payload, req->payload, RENTSCAN_TIME_REQ_LEN);
+    sys_put_le64(now_ms, &resp->payload[RENTSCAN_TIME_REQ_LEN]);
+    resp->payload_len = RENTSCAN_TIME_RESP_LEN;
+    return 0;
+}
+
+int rentscan_time_sample(const rentscan_msg_t *resp, uint32_t t1_ms, int64_t t4_ms,
+                         struct rentscan_time_sample *sample)
+{
+    if (resp->cmd != CMD_TIME_RESP || resp->payload_len < RENTSCAN_TIME_RESP_LEN) {
+        return -EBADMSG;
+    }
+
+    if (sys_get_le32(resp->payload) != t1_ms) {
+        return -ESTALE;
+    }
+
+    /* Unsigned difference, so a round trip across the 32 bit wrap still counts */
+    uint32_t rtt_ms = (uint32_t)t4_ms - t1_ms;
+    int64_t network_ms = (int64_t)sys_get_le64(&resp->payload[RENTSCAN_TIME_REQ_LEN]);
+
+    sample->rtt_ms = rtt_ms;
+    sample->offset_ms = network_ms + rtt_ms / 2 - t4_ms;
+    return 0;
+}
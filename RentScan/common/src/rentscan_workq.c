@@ -0,0 +1,38 @@
+/**
+ * @file rentscan_workq.c
+ * @brief Dedicated work queues shared by both devices
+ */
+
+#include <errno.h>
+#include "../include/rentscan_workq.h"
+
+void rentscan_workq_start(struct rentscan_workq *wq)
+{
+    const struct k_work_queue_config cfg = {
+        .name = wq->name,
+    };
+
+    k_work_queue_init(&wq->queue);
+    k_work_queue_start(&wq->queue, wq->stack, wq->stack_size, wq->priority, &cfg);
+}
+
+int rentscan_thread_stack_usage(struct k_thread *thread, size_t *size, size_t *used)
+{
+#if defined(CONFIG_INIT_STACKS) && defined(CONFIG_THREAD_STACK_INFO)
+    size_t unused;
+    int err = k_thread_stack_space_get(thread, &unused);
+
+    if (err) {
+        return err;
+    }
+
+    *size = thread->stack_info.size;
+    *used = *size - unused;
+    return 0;
+#else
+    ARG_UNUSED(thread);
+    ARG_UNUSED(size);
+    ARG_UNUSED(used);
+    return -ENOTSUP;
+#endif
+}
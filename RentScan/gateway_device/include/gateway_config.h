@@ -14,6 +14,16 @@
 #define BLE_CONN_RETRY_DELAY_MS 2000  /**< Delay between connection attempts (ms) - Increased */
 #define BLE_CONN_SUPERVISION_TIMEOUT 800 /**< Connection supervision timeout (8 seconds) - Increased */
 
+/** Connection policy, see conn_policy.c */
+#define BLE_CONN_BURST_INTERVAL_MIN 6    /**< Burst interval min (7.5 ms) */
+#define BLE_CONN_BURST_INTERVAL_MAX 12   /**< Burst interval max (15 ms) */
+#define BLE_CONN_IDLE_INTERVAL_MIN 320   /**< Idle interval min (400 ms) */
+#define BLE_CONN_IDLE_INTERVAL_MAX 400   /**< Idle interval max (500 ms) */
+#define BLE_CONN_IDLE_LATENCY 4          /**< Connection events an idle main device may skip */
+#define BLE_CONN_IDLE_SUPERVISION_TIMEOUT 600 /**< Idle supervision timeout (6 seconds) */
+#define BLE_CONN_IDLE_AFTER_MS 3000      /**< Quiet time before a link is relaxed (ms) */
+#define BLE_CONN_POLICY_PERIOD_MS 1000   /**< Period for re-evaluating link profiles (ms) */
+
 /** Gateway behavior configuration */
 #define GATEWAY_RECONNECT_DELAY_MS 3000 /**< Delay before reconnecting after disconnect (ms) */
 #define GATEWAY_HEALTH_CHECK_PERIOD_MS 30000 /**< Period for health checks (ms) */
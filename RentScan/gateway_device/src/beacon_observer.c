@@ -0,0 +1,230 @@
+/**
+ * @file beacon_observer.c
+ * @brief Passive tracking of main device status beacons
+ *
+ * Every main device in range keeps a slot with the pages of its current
+ * beacon generation. Pages are collected as they rotate past; a new
+ * sequence number discards what was collected for the previous one.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+#include "beacon_observer.h"
+#include "../../common/include/rentscan_beacon.h"
+
+LOG_MODULE_REGISTER(beacon_observer, LOG_LEVEL_INF);
+
+#define MAX_KIOSKS CONFIG_RENTSCAN_BEACON_MAX_DEVICES
+#define MAX_ITEMS CONFIG_RENTSCAN_BEACON_MAX_ITEMS
+#define MAX_STORED_PAGES DIV_ROUND_UP(MAX_ITEMS, RENTSCAN_BEACON_MAX_ENTRIES)
+
+struct kiosk {
+    bt_addr_le_t addr;
+    bool in_use;
+    int8_t rssi;
+    uint16_t seq;
+    uint16_t total;
+    uint8_t page_count;
+    uint32_t pages_seen;
+    int64_t last_seen;
+    uint8_t page_entries[MAX_STORED_PAGES];
+    struct rentscan_beacon_entry entries[MAX_STORED_PAGES * RENTSCAN_BEACON_MAX_ENTRIES];
+};
+
+static struct kiosk kiosks[MAX_KIOSKS];
+static struct k_spinlock kiosk_lock;
+
+struct svc_data_ctx {
+    const uint8_t *data;
+    size_t len;
+};
+
+static bool find_svc_data(struct bt_data *data, void *user_data)
+{
+    static const uint8_t uuid[] = { BT_UUID_RENTSCAN_VAL };
+    struct svc_data_ctx *ctx = user_data;
+
+    if (data->type != BT_DATA_SVC_DATA128 || data->data_len < sizeof(uuid) ||
+        memcmp(data->data, uuid, sizeof(uuid)) != 0) {
+        return true;
+    }
+
+    ctx->data = &data->data[sizeof(uuid)];
+    ctx->len = data->data_len - sizeof(uuid);
+    return false;
+}
+
+static struct kiosk *kiosk_get(const bt_addr_le_t *addr)
+{
+    struct kiosk *oldest = NULL;
+
+    for (int i = 0; i < MAX_KIOSKS; i++) {
+        if (kiosks[i].in_use && bt_addr_le_eq(&kiosks[i].addr, addr)) {
+            return &kiosks[i];
+        }
+    }
+
+    /* Free slot, or the device heard from least recently */
+    for (int i = 0; i < MAX_KIOSKS; i++) {
+        if (!kiosks[i].in_use) {
+            oldest = &kiosks[i];
+            break;
+        }
+        if (!oldest || kiosks[i].last_seen < oldest->last_seen) {
+            oldest = &kiosks[i];
+        }
+    }
+
+    memset(oldest, 0, sizeof(*oldest));
+    bt_addr_le_copy(&oldest->addr, addr);
+    oldest->in_use = true;
+    return oldest;
+}
+
+static bool kiosk_complete(const struct kiosk *k)
+{
+    return k->page_count && k->page_count <= MAX_STORED_PAGES &&
+           k->pages_seen == BIT_MASK(k->page_count);
+}
+
+static bool kiosk_fresh(const struct kiosk *k, int64_t now)
+{
+    return k->in_use && now - k->last_seen < CONFIG_RENTSCAN_BEACON_STALE_MS;
+}
+
+int beacon_observer_process(const bt_addr_le_t *addr, int8_t rssi,
+                            struct net_buf_simple *ad)
+{
+    struct svc_data_ctx ctx = { 0 };
+    struct net_buf_simple_state state;
+    struct rentscan_beacon beacon;
+    int err;
+
+    net_buf_simple_save(ad, &state);
+    bt_data_parse(ad, find_svc_data, &ctx);
+    net_buf_simple_restore(ad, &state);
+
+    if (!ctx.data) {
+        return -ENOENT;
+    }
+
+    err = rentscan_beacon_decode(&beacon, ctx.data, ctx.len);
+    if (err) {
+        LOG_DBG("Malformed status beacon (err %d)", err);
+        return err;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&kiosk_lock);
+    struct kiosk *k = kiosk_get(addr);
+
+    k->rssi = rssi;
+    k->last_seen = k_uptime_get();
+
+    if (k->seq != beacon.seq || k->page_count != beacon.page_count) {
+        k->seq = beacon.seq;
+        k->page_count = beacon.page_count;
+        k->pages_seen = 0;
+    }
+    k->total = beacon.total;
+
+    if (!(k->pages_seen & BIT(beacon.page))) {
+        k->pages_seen |= BIT(beacon.page);
+
+        /* Pages beyond what we can store leave the summary incomplete */
+        if (beacon.page < MAX_STORED_PAGES) {
+            memcpy(&k->entries[beacon.page * RENTSCAN_BEACON_MAX_ENTRIES], beacon.entries,
+                   beacon.entry_count * sizeof(beacon.entries[0]));
+            k->page_entries[beacon.page] = beacon.entry_count;
+        }
+    }
+
+    k_spin_unlock(&kiosk_lock, key);
+    return 0;
+}
+
+int beacon_observer_lookup(const char *item_id, rentscan_status_t *status,
+                           bt_addr_le_t *addr)
+{
+    if (!item_id || !status) {
+        return -EINVAL;
+    }
+
+    uint32_t hash = rentscan_beacon_tag_hash((const uint8_t *)item_id, strlen(item_id));
+    int64_t now = k_uptime_get();
+    bool complete = true;
+    bool any = false;
+    int err = -ENOENT;
+
+    k_spinlock_key_t key = k_spin_lock(&kiosk_lock);
+
+    for (int i = 0; i < MAX_KIOSKS && err; i++) {
+        const struct kiosk *k = &kiosks[i];
+
+        if (!kiosk_fresh(k, now)) {
+            continue;
+        }
+
+        any = true;
+        complete &= kiosk_complete(k);
+
+        for (int page = 0; page < MIN(k->page_count, MAX_STORED_PAGES) && err; page++) {
+            const struct rentscan_beacon_entry *entry =
+                &k->entries[page * RENTSCAN_BEACON_MAX_ENTRIES];
+
+            if (!(k->pages_seen & BIT(page))) {
+                continue;
+            }
+
+            for (int j = 0; j < k->page_entries[page]; j++) {
+                if (entry[j].tag_hash == hash) {
+                    *status = entry[j].status;
+                    if (addr) {
+                        bt_addr_le_copy(addr, &k->addr);
+                    }
+                    err = 0;
+                    break;
+                }
+            }
+        }
+    }
+
+    k_spin_unlock(&kiosk_lock, key);
+
+    if (err && (!any || !complete)) {
+        return -EAGAIN;
+    }
+    return err;
+}
+
+int beacon_observer_get(size_t idx, struct beacon_observer_info *info)
+{
+    if (idx >= MAX_KIOSKS || !info) {
+        return -EINVAL;
+    }
+
+    int err = -ENOENT;
+    k_spinlock_key_t key = k_spin_lock(&kiosk_lock);
+    const struct kiosk *k = &kiosks[idx];
+
+    if (k->in_use) {
+        bt_addr_le_copy(&info->addr, &k->addr);
+        info->rssi = k->rssi;
+        info->seq = k->seq;
+        info->total = k->total;
+        info->pages_seen = __builtin_popcount(k->pages_seen);
+        info->page_count = k->page_count;
+        info->age_ms = k_uptime_get() - k->last_seen;
+        err = 0;
+    }
+
+    k_spin_unlock(&kiosk_lock, key);
+    return err;
+}
+
+size_t beacon_observer_capacity(void)
+{
+    return MAX_KIOSKS;
+}
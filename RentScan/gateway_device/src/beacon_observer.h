@@ -0,0 +1,74 @@
+/**
+ * @file beacon_observer.h
+ * @brief Passive tracking of main device status beacons
+ */
+
+#ifndef BEACON_OBSERVER_H
+#define BEACON_OBSERVER_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/bluetooth/addr.h>
+#include <zephyr/net/buf.h>
+#include "../../common/include/rentscan_protocol.h"
+
+/**
+ * @brief State of one observed main device
+ */
+struct beacon_observer_info {
+    bt_addr_le_t addr;    /**< Address the beacon was sent from */
+    int8_t rssi;          /**< RSSI of the last beacon */
+    uint16_t seq;         /**< Rental state generation being collected */
+    uint16_t total;       /**< Items not available on the device */
+    uint8_t pages_seen;   /**< Pages of this generation received so far */
+    uint8_t page_count;   /**< Pages in this generation */
+    uint32_t age_ms;      /**< Time since the last beacon */
+};
+
+/**
+ * @brief Process an advertising report
+ * 
+ * Called from the scan callback for every report. The buffer is left as
+ * it was passed in.
+ * 
+ * @param addr Advertiser address
+ * @param rssi RSSI of the report
+ * @param ad Advertising data
+ * @return int 0 if the report carried a status beacon, -ENOENT if it
+ *             did not, negative error code if the beacon was malformed
+ */
+int beacon_observer_process(const bt_addr_le_t *addr, int8_t rssi,
+                            struct net_buf_simple *ad);
+
+/**
+ * @brief Look up the status of an item from the observed beacons
+ * 
+ * @param item_id Item ID as stored on the tag
+ * @param status Pointer to store the status
+ * @param addr Pointer to store the address of the reporting device, can be NULL
+ * @return int 0 if a device reports the item as not available,
+ *             -ENOENT if every device has been fully observed and none
+ *             reports it (the item is available),
+ *             -EAGAIN if some pages are still missing
+ */
+int beacon_observer_lookup(const char *item_id, rentscan_status_t *status,
+                           bt_addr_le_t *addr);
+
+/**
+ * @brief Get the state of an observed main device
+ * 
+ * @param idx Index into the observer table
+ * @param info Pointer to store the state
+ * @return int 0 on success, -ENOENT if the slot is unused
+ */
+int beacon_observer_get(size_t idx, struct beacon_observer_info *info);
+
+/**
+ * @brief Get the size of the observer table
+ * 
+ * @return size_t Number of slots, for use with beacon_observer_get()
+ */
+size_t beacon_observer_capacity(void);
+
+#endif /* BEACON_OBSERVER_H */
\ No newline at end of file
@@ -5,9 +5,15 @@
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
 #include <bluetooth/gatt_dm.h>
 #include <bluetooth/scan.h>
 #include "ble_central.h"
+#include "handle_cache.h"
+#include "conn_policy.h"
+#include "rental_sync.h"
+#include "beacon_observer.h"
+#include "metrics.h"
 #include <zephyr/sys/byteorder.h>
 #include <zephyr/bluetooth/hci_vs.h>
 #include "../include/gateway_config.h"
@@ -15,88 +21,164 @@
 
 LOG_MODULE_REGISTER(ble_central, LOG_LEVEL_INF);
 
-// Make these variables accessible to shell_commands.c
-struct bt_conn *current_conn;
-struct bt_gatt_discover_params discover_params;
-struct bt_gatt_subscribe_params subscribe_params;
-uint16_t nus_rx_handle;
-uint16_t nus_tx_handle;
+/* Per-connection state, one entry for every main device we serve */
+struct link {
+    struct bt_conn *conn;
+    struct bt_gatt_subscribe_params subscribe_params;
+    struct bt_gatt_read_params hash_params;
+    uint16_t rx_handle;
+    uint16_t tx_handle;
+    bool from_cache;          /* Handles were taken from the handle cache */
+    bool discovery_pending;   /* Waiting for the discovery manager */
+};
+
+static struct link links[BLE_CENTRAL_MAX_LINKS];
 
 static ble_msg_received_cb_t msg_callback;
+static ble_link_ready_cb_t link_ready_callback;
 static bool scanning = false;
+static bool connecting = false;
+static bool backpressure = false;
 static int consecutive_errors = 0;
+static uint8_t accept_list_count;
+
+/* The discovery manager serves one connection at a time */
+static struct link *dm_link;
 
 static void start_scan(void);
-static void error_recovery(void);
+static void error_recovery(struct link *link);
+
+static inline uint8_t link_id(const struct link *link)
+{
+    return link - links;
+}
+
+static struct link *link_find(const struct bt_conn *conn)
+{
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].conn && links[i].conn == conn) {
+            return &links[i];
+        }
+    }
+    return NULL;
+}
+
+static struct link *link_get(uint8_t id)
+{
+    if (id >= ARRAY_SIZE(links) || !links[id].conn) {
+        return NULL;
+    }
+    return &links[id];
+}
+
+static struct link *link_alloc(void)
+{
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (!links[i].conn) {
+            return &links[i];
+        }
+    }
+    return NULL;
+}
+
+static void link_free(struct link *link)
+{
+    if (link->conn) {
+        bt_conn_unref(link->conn);
+    }
+    memset(link, 0, sizeof(*link));
+}
+
+static bool link_table_full(void)
+{
+    return link_alloc() == NULL;
+}
 
 static uint8_t notify_handler(struct bt_conn *conn,
                           struct bt_gatt_subscribe_params *params,
                           const void *data, uint16_t length)
 {
+    struct link *link = CONTAINER_OF(params, struct link, subscribe_params);
+
     if (!data) {
-        LOG_INF("Unsubscribed from notifications");
+        LOG_INF("Link %u unsubscribed from notifications", link_id(link));
         params->value_handle = 0;
         return BT_GATT_ITER_STOP;
     }
 
-    if (msg_callback && length >= sizeof(rentscan_msg_t)) {
-        msg_callback((const rentscan_msg_t *)data);
+    if (!msg_callback) {
+        return BT_GATT_ITER_CONTINUE;
     }
 
+    conn_policy_activity(link_id(link));
+
+    /* Decoding is left to the receiver, keep the RX thread short */
+    msg_callback(link_id(link), data, length);
+
     return BT_GATT_ITER_CONTINUE;
 }
 
-static bool check_device(struct bt_data *data, void *user_data)
+static int subscribe(struct link *link, uint16_t ccc_handle)
 {
-    bool *found = (bool *)user_data;
-    
-    if (data->type == BT_DATA_NAME_COMPLETE) {
-        if (data->data_len == strlen(RENTSCAN_DEVICE_NAME) &&
-            memcmp(data->data, RENTSCAN_DEVICE_NAME, data->data_len) == 0) {
-            *found = true;
-        }
-    } else if (data->type == BT_DATA_UUID128_ALL) {
-        uint8_t uuid[] = {
-            BT_UUID_128_ENCODE(0x18ee2ef5, 0x263d, 0x4559, 0x953c, 0xd66077c89ae6)
-        };
-        if (data->data_len >= 16 && memcmp(data->data, uuid, 16) == 0) {
-            *found = true;
-        }
+    struct bt_gatt_subscribe_params *sub = &link->subscribe_params;
+    int err;
+
+    sub->notify = notify_handler;
+    /* Rental state changes come as indications, the stack confirms them */
+    sub->value = BT_GATT_CCC_NOTIFY | BT_GATT_CCC_INDICATE;
+    sub->value_handle = link->tx_handle;
+    sub->ccc_handle = ccc_handle;
+    /* Subscribed again on every connect. A bonded subscription would stay
+     * in the stack's list after the disconnect, while the link slot holding
+     * it is wiped and reused for the next peer.
+     */
+    atomic_set_bit(sub->flags, BT_GATT_SUBSCRIBE_FLAG_VOLATILE);
+    LOG_INF("Link %u: subscribing with value_handle=%u, ccc_handle=%u",
+            link_id(link), link->tx_handle, ccc_handle);
+
+    err = bt_gatt_subscribe(link->conn, sub);
+    if (err && err != -EALREADY) {
+        LOG_ERR("Link %u: subscribe failed (err %d)", link_id(link), err);
+        return err;
+    }
+
+    LOG_INF("Link %u: subscribed to notifications", link_id(link));
+
+    if (link_ready_callback) {
+        link_ready_callback(link_id(link));
     }
-    return true;
+    return 0;
 }
 
-static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
-                        struct net_buf_simple *ad)
+/* Called for advertisers that passed the UUID or name filter */
+static void try_connect(const bt_addr_le_t *addr, int8_t rssi)
 {
-    char addr_str[BT_ADDR_LE_STR_LEN];
-    bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
     int err;
 
-    // Only look for connectable advertising
-    if (type != BT_GAP_ADV_TYPE_ADV_IND &&
-        type != BT_GAP_ADV_TYPE_ADV_DIRECT_IND) {
+    // Only one connection can be initiated at a time
+    if (connecting || backpressure) {
         return;
     }
 
-    // Check if this is a RentScan device
-    bool found = false;
-    bt_data_parse(ad, check_device, &found);
-    
-    if (!found) {
+    // Skip devices we already have a link to
+    struct bt_conn *existing = bt_conn_lookup_addr_le(BT_ID_DEFAULT, addr);
+    if (existing) {
+        bt_conn_unref(existing);
         return;
     }
 
-    // Check if we're already connected or have a valid connection object
-    if (current_conn) {
-        LOG_DBG("Already connected to a device, ignoring %s", addr_str);
+    struct link *link = link_alloc();
+    if (!link) {
         return;
     }
 
+    char addr_str[BT_ADDR_LE_STR_LEN];
+    bt_addr_le_to_str(addr, addr_str, sizeof(addr_str));
     LOG_INF("Found RentScan device %s, RSSI %d", addr_str, rssi);
 
-    // Stop scanning
-    err = bt_le_scan_stop();
+    // The controller can't scan and initiate at the same time; scanning is
+    // resumed from connected() once the connection attempt completes.
+    err = bt_scan_stop();
     if (err) {
         LOG_ERR("Stop scan failed (err %d)", err);
         return;
@@ -110,204 +192,342 @@ static void device_found(const bt_addr_le_t *addr, int8_t rssi, uint8_t type,
         BT_GAP_SCAN_FAST_INTERVAL,
         BT_GAP_SCAN_FAST_WINDOW);
 
-    // Connection parameters
-    struct bt_le_conn_param conn_param = {
-        .interval_min = BT_GAP_INIT_CONN_INT_MIN,
-        .interval_max = BT_GAP_INIT_CONN_INT_MAX,
-        .latency = 0,
-        .timeout = BLE_CONN_SUPERVISION_TIMEOUT
-    };
-
-    // Connect to device
-    err = bt_conn_le_create(addr, &create_param, &conn_param, &current_conn);
+    // Start fast, the connection policy relaxes idle links later
+    err = bt_conn_le_create(addr, &create_param, conn_policy_initial_param(), &link->conn);
     if (err) {
         LOG_ERR("Create connection failed (err %d)", err);
-        scanning = false;
+        link->conn = NULL;
         start_scan();
         return;
     }
 
-    LOG_INF("Connection pending");
+    connecting = true;
+    LOG_INF("Connection pending on link %u", link_id(link));
+}
+
+static void scan_filter_match(struct bt_scan_device_info *device_info,
+                              struct bt_scan_filter_match *filter_match,
+                              bool connectable)
+{
+    // Only look for connectable advertising
+    if (!connectable) {
+        return;
+    }
+
+    try_connect(device_info->recv_info->addr, device_info->recv_info->rssi);
+}
+
+static void scan_filter_no_match(struct bt_scan_device_info *device_info,
+                                 bool connectable)
+{
+#if defined(CONFIG_RENTSCAN_BEACON_OBSERVER)
+    /* Status beacons carry service data only, so they never match the
+     * UUID or name filter.
+     */
+    if (device_info->recv_info->adv_type == BT_GAP_ADV_TYPE_EXT_ADV) {
+        beacon_observer_process(device_info->recv_info->addr,
+                                device_info->recv_info->rssi,
+                                device_info->adv_data);
+    }
+#endif
 }
 
-static uint8_t discover_func(struct bt_conn *conn,
-                         const struct bt_gatt_attr *attr,
-                         struct bt_gatt_discover_params *params)
+BT_SCAN_CB_INIT(scan_cb, scan_filter_match, scan_filter_no_match, NULL, NULL);
+
+static struct bt_le_scan_param scan_param = {
+    .type = BT_LE_SCAN_TYPE_ACTIVE,
+    .interval = BLE_SCAN_INTERVAL,
+    .window = BLE_SCAN_WINDOW,
+    .options = BT_LE_SCAN_OPT_FILTER_DUPLICATE,
+};
+
+/* The UUID and name filters are matched by the scan module as reports come
+ * in. The accept list is left to the controller, which then drops every
+ * other advertiser before the host sees it.
+ */
+static int scan_init(void)
 {
+    struct bt_scan_init_param scan_init_param = {
+        .scan_param = &scan_param,
+        .connect_if_match = false,
+    };
     int err;
 
-    if (!attr) {
-        LOG_INF("Discover complete - attr is NULL");
-        
-        // Workaround: If we've discovered the primary service but not the characteristics,
-        // try to manually set up the subscription
-        if (nus_tx_handle == 0) {
-            LOG_WRN("Incomplete discovery. Using manual subscription...");
-            
-            // We'll assume handle values based on the found service
-            uint16_t primary_handle = discover_params.start_handle - 1;
-            LOG_INF("Primary service was at handle %d", primary_handle);
-            
-            // Typical handle layout: Primary(n), RX(n+2, value n+3), TX(n+4, value n+5), CCC(n+6)
-            nus_rx_handle = primary_handle + 3;
-            nus_tx_handle = primary_handle + 5;
-            
-            LOG_INF("Using estimated handles: RX=%d, TX=%d, CCC=%d", 
-                    nus_rx_handle, nus_tx_handle, primary_handle + 6);
-            
-            // Set up subscription with estimated CCC handle
-            subscribe_params.notify = notify_handler;
-            subscribe_params.value = BT_GATT_CCC_NOTIFY;
-            subscribe_params.value_handle = nus_tx_handle;
-            subscribe_params.ccc_handle = primary_handle + 6;
-            
-            err = bt_gatt_subscribe(conn, &subscribe_params);
-            if (err && err != -EALREADY) {
-                LOG_ERR("Manual subscribe failed (err %d)", err);
-            } else {
-                LOG_INF("Manual subscription attempt successful");
-            }
-        }
-        
-        (void)memset(params, 0, sizeof(*params));
-        return BT_GATT_ITER_STOP;
+    bt_scan_init(&scan_init_param);
+    bt_scan_cb_register(&scan_cb);
+
+    err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_UUID, BT_UUID_RENTSCAN);
+    if (err) {
+        LOG_ERR("UUID scan filter failed (err %d)", err);
+        return err;
     }
 
-    LOG_INF("[ATTRIBUTE] handle %u, UUID: %s", attr->handle, bt_uuid_str(attr->uuid));
+    err = bt_scan_filter_add(BT_SCAN_FILTER_TYPE_NAME, RENTSCAN_DEVICE_NAME);
+    if (err) {
+        LOG_ERR("Name scan filter failed (err %d)", err);
+        return err;
+    }
 
-    if (!bt_uuid_cmp(discover_params.uuid, BT_UUID_RENTSCAN)) {
-        LOG_INF("RentScan service found at handle %u, discovering RX characteristic", attr->handle);
-        discover_params.uuid = BT_UUID_RENTSCAN_RX;
-        discover_params.start_handle = attr->handle + 1;
-        discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
-        discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
+    err = bt_scan_filter_enable(BT_SCAN_UUID_FILTER | BT_SCAN_NAME_FILTER, false);
+    if (err) {
+        LOG_ERR("Enabling scan filters failed (err %d)", err);
+    }
+    return err;
+}
 
-        err = bt_gatt_discover(conn, &discover_params);
-        if (err) {
-            LOG_ERR("Discover RX characteristic failed (err %d)", err);
-            
-            // Try the workaround directly
-            if (err == -ENOENT || err == -ENOMEM) {
-                LOG_WRN("Trying manual subscription due to discovery error");
-                uint16_t primary_handle = attr->handle;
-                nus_rx_handle = primary_handle + 3;
-                nus_tx_handle = primary_handle + 5;
-                
-                subscribe_params.notify = notify_handler;
-                subscribe_params.value = BT_GATT_CCC_NOTIFY;
-                subscribe_params.value_handle = nus_tx_handle;
-                subscribe_params.ccc_handle = primary_handle + 6;
-                
-                err = bt_gatt_subscribe(conn, &subscribe_params);
-                if (err && err != -EALREADY) {
-                    LOG_ERR("Manual subscribe failed (err %d)", err);
-                } else {
-                    LOG_INF("Manual subscription successful");
-                }
-            }
-        }
-        return BT_GATT_ITER_STOP;
-    } 
-    
-    if (!bt_uuid_cmp(discover_params.uuid, BT_UUID_RENTSCAN_RX)) {
-        LOG_INF("RX characteristic found at handle %u", attr->handle);
-        nus_rx_handle = bt_gatt_attr_value_handle(attr);
-        LOG_INF("RX value handle: %u", nus_rx_handle);
-        
-        discover_params.uuid = BT_UUID_RENTSCAN_TX;
-        discover_params.start_handle = attr->handle + 1;
-        discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
-        discover_params.type = BT_GATT_DISCOVER_CHARACTERISTIC;
-
-        err = bt_gatt_discover(conn, &discover_params);
-        if (err) {
-            LOG_ERR("Discover TX characteristic failed (err %d)", err);
-        }
-        return BT_GATT_ITER_STOP;
-    } 
-    
-    if (!bt_uuid_cmp(discover_params.uuid, BT_UUID_RENTSCAN_TX)) {
-        LOG_INF("TX characteristic found at handle %u", attr->handle);
-        nus_tx_handle = bt_gatt_attr_value_handle(attr);
-        LOG_INF("TX value handle: %u", nus_tx_handle);
-
-        /* Find the CCC descriptor */
-        discover_params.uuid = BT_UUID_GATT_CCC;
-        discover_params.start_handle = attr->handle + 1;
-        discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
-        discover_params.type = BT_GATT_DISCOVER_DESCRIPTOR;
-        
-        err = bt_gatt_discover(conn, &discover_params);
-        if (err) {
-            LOG_ERR("Discover CCC failed (err %d)", err);
-            
-            // Try with estimated CCC handle
-            LOG_WRN("Trying with estimated CCC handle");
-            subscribe_params.notify = notify_handler;
-            subscribe_params.value = BT_GATT_CCC_NOTIFY;
-            subscribe_params.value_handle = nus_tx_handle;
-            subscribe_params.ccc_handle = attr->handle + 2;
-            
-            err = bt_gatt_subscribe(conn, &subscribe_params);
-            if (err && err != -EALREADY) {
-                LOG_ERR("Subscribe with estimated handle failed (err %d)", err);
-            } else {
-                LOG_INF("Subscription with estimated handle successful");
-            }
+static void discover(struct link *link);
+
+/* Hand the discovery manager to the next link waiting for it */
+static void discovery_next(void)
+{
+    dm_link = NULL;
+
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].conn && links[i].discovery_pending) {
+            discover(&links[i]);
+            return;
         }
-        return BT_GATT_ITER_STOP;
     }
-    
-    if (!bt_uuid_cmp(discover_params.uuid, BT_UUID_GATT_CCC)) {
-        LOG_INF("CCC descriptor found at handle %u, subscribing to notifications", attr->handle);
-        
-        subscribe_params.notify = notify_handler;
-        subscribe_params.value = BT_GATT_CCC_NOTIFY;
-        subscribe_params.value_handle = nus_tx_handle;
-        subscribe_params.ccc_handle = attr->handle;
-        LOG_INF("Setting up subscription with value_handle=%u, ccc_handle=%u", 
-                nus_tx_handle, attr->handle);
-
-        err = bt_gatt_subscribe(conn, &subscribe_params);
-        if (err && err != -EALREADY) {
-            LOG_ERR("Subscribe failed (err %d)", err);
-        } else {
-            LOG_INF("Successfully subscribed to notifications");
-        }
-        
+}
+
+/* Remember the handles of a freshly discovered peer, keyed by its hash */
+static void cache_store(struct link *link, const uint8_t *db_hash)
+{
+    struct handle_cache_entry entry = {
+        .rx_handle = link->rx_handle,
+        .tx_handle = link->tx_handle,
+        .ccc_handle = link->subscribe_params.ccc_handle,
+        .has_hash = db_hash != NULL,
+    };
+
+    bt_addr_le_copy(&entry.addr, bt_conn_get_dst(link->conn));
+    if (db_hash) {
+        memcpy(entry.db_hash, db_hash, HANDLE_CACHE_HASH_LEN);
+    }
+
+    handle_cache_store(&entry);
+}
+
+/* Check cached handles against the peer's current database */
+static void cache_verify(struct link *link, const uint8_t *db_hash)
+{
+    const bt_addr_le_t *dst = bt_conn_get_dst(link->conn);
+    struct handle_cache_entry cached;
+    bool valid;
+
+    if (handle_cache_lookup(dst, &cached)) {
+        return;
+    }
+
+    if (db_hash) {
+        valid = cached.has_hash &&
+                memcmp(cached.db_hash, db_hash, HANDLE_CACHE_HASH_LEN) == 0;
+    } else {
+        /* Without a hash only a bond, which gets Service Changed
+         * indications, vouches for the cached layout.
+         */
+        valid = bt_addr_le_is_bonded(BT_ID_DEFAULT, dst);
+    }
+
+    if (valid) {
+        LOG_DBG("Link %u: cached handles verified", link_id(link));
+        return;
+    }
+
+    /* The subscription may point at the wrong attribute, start over with
+     * a full discovery on the next connection.
+     */
+    LOG_WRN("Link %u: peer database changed, dropping cached handles", link_id(link));
+    handle_cache_invalidate(dst);
+    bt_conn_disconnect(link->conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+}
+
+static uint8_t db_hash_read_func(struct bt_conn *conn, uint8_t err,
+                                 struct bt_gatt_read_params *params,
+                                 const void *data, uint16_t length)
+{
+    struct link *link = CONTAINER_OF(params, struct link, hash_params);
+    const uint8_t *db_hash = NULL;
+
+    if (!link->conn) {
         return BT_GATT_ITER_STOP;
     }
 
+    if (!err && data && length == HANDLE_CACHE_HASH_LEN) {
+        db_hash = data;
+    } else {
+        LOG_DBG("Link %u: no database hash (err 0x%02x)", link_id(link), err);
+    }
+
+    if (link->from_cache) {
+        cache_verify(link, db_hash);
+    } else {
+        cache_store(link, db_hash);
+    }
+
     return BT_GATT_ITER_STOP;
 }
 
+static int read_db_hash(struct link *link)
+{
+    struct bt_gatt_read_params *params = &link->hash_params;
+
+    params->func = db_hash_read_func;
+    params->handle_count = 0;
+    params->by_uuid.uuid = BT_UUID_GATT_DB_HASH;
+    params->by_uuid.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
+    params->by_uuid.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
+
+    int err = bt_gatt_read(link->conn, params);
+    if (err) {
+        LOG_WRN("Link %u: database hash read failed (err %d)", link_id(link), err);
+    }
+    return err;
+}
+
+static void discovery_completed(struct bt_gatt_dm *dm, void *context)
+{
+    struct link *link = context;
+    const struct bt_gatt_dm_attr *rx = bt_gatt_dm_char_by_uuid(dm, BT_UUID_RENTSCAN_RX);
+    const struct bt_gatt_dm_attr *tx = bt_gatt_dm_char_by_uuid(dm, BT_UUID_RENTSCAN_TX);
+    const struct bt_gatt_dm_attr *ccc = NULL;
+    uint16_t ccc_handle = 0;
+
+    if (tx) {
+        ccc = bt_gatt_dm_desc_by_uuid(dm, tx, BT_UUID_GATT_CCC);
+    }
+
+    if (rx && tx && ccc) {
+        link->rx_handle = bt_gatt_dm_attr_chrc_val(rx)->value_handle;
+        link->tx_handle = bt_gatt_dm_attr_chrc_val(tx)->value_handle;
+        ccc_handle = ccc->handle;
+    }
+
+    bt_gatt_dm_data_release(dm);
+    discovery_next();
+
+    if (!link->conn) {
+        /* Disconnected while discovering */
+        return;
+    }
+
+    if (!ccc_handle) {
+        LOG_ERR("Link %u: RentScan service is incomplete", link_id(link));
+        error_recovery(link);
+        return;
+    }
+
+    LOG_INF("Link %u: discovered RX %u, TX %u, CCC %u", link_id(link),
+            link->rx_handle, link->tx_handle, ccc_handle);
+
+    if (subscribe(link, ccc_handle) == 0 && read_db_hash(link) != 0) {
+        /* Cache without a hash, a bond still keeps it valid */
+        cache_store(link, NULL);
+    }
+}
+
+static void discovery_service_not_found(struct bt_conn *conn, void *context)
+{
+    struct link *link = context;
+
+    discovery_next();
+
+    if (link->conn) {
+        LOG_ERR("Link %u: RentScan service not found", link_id(link));
+        error_recovery(link);
+    }
+}
+
+static void discovery_error_found(struct bt_conn *conn, int err, void *context)
+{
+    struct link *link = context;
+
+    discovery_next();
+
+    if (link->conn) {
+        LOG_ERR("Link %u: service discovery failed (err %d)", link_id(link), err);
+        error_recovery(link);
+    }
+}
+
+static const struct bt_gatt_dm_cb discovery_cb = {
+    .completed = discovery_completed,
+    .service_not_found = discovery_service_not_found,
+    .error_found = discovery_error_found,
+};
+
+static void discover(struct link *link)
+{
+    if (dm_link) {
+        link->discovery_pending = true;
+        return;
+    }
+
+    link->discovery_pending = false;
+
+    int err = bt_gatt_dm_start(link->conn, BT_UUID_RENTSCAN, &discovery_cb, link);
+    if (err) {
+        LOG_ERR("Service discovery failed (err %d)", err);
+        error_recovery(link);
+        return;
+    }
+
+    dm_link = link;
+}
+
 static void connected(struct bt_conn *conn, uint8_t err)
 {
     char addr[BT_ADDR_LE_STR_LEN];
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
+    struct link *link = link_find(conn);
+    if (!link) {
+        /* Not a connection we initiated */
+        return;
+    }
+
+    connecting = false;
+
     if (err) {
         LOG_ERR("Failed to connect to %s (%u)", addr, err);
-        scanning = false;
+        metrics_inc(METRIC_BLE_CONNECT_FAILED);
+        link_free(link);
         start_scan();
         return;
     }
 
-    LOG_INF("Connected to device %s", addr);
-    current_conn = bt_conn_ref(conn);
+    LOG_INF("Connected to device %s on link %u", addr, link_id(link));
+    metrics_inc(METRIC_BLE_CONNECTS);
     consecutive_errors = 0;
 
-    discover_params.uuid = BT_UUID_RENTSCAN;
-    discover_params.func = discover_func;
-    discover_params.start_handle = BT_ATT_FIRST_ATTRIBUTE_HANDLE;
-    discover_params.end_handle = BT_ATT_LAST_ATTRIBUTE_HANDLE;
-    discover_params.type = BT_GATT_DISCOVER_PRIMARY;
+    /* PHY, data length and MTU are negotiated alongside discovery */
+    conn_policy_link_up(link_id(link), conn);
+
+    struct handle_cache_entry cached;
+
+    if (handle_cache_lookup(bt_conn_get_dst(conn), &cached) == 0) {
+        /* Known main device: subscribe straight away and check the
+         * database hash in parallel instead of walking the service.
+         */
+        LOG_INF("Link %u: using cached handles", link_id(link));
+        link->from_cache = true;
+        link->rx_handle = cached.rx_handle;
+        link->tx_handle = cached.tx_handle;
+        if (subscribe(link, cached.ccc_handle) == 0) {
+            read_db_hash(link);
+        }
+    } else {
+        discover(link);
+    }
 
-    err = bt_gatt_discover(conn, &discover_params);
+    /* Bond so the peer keeps our subscription and reports database changes */
+    err = bt_conn_set_security(conn, BT_SECURITY_L2);
     if (err) {
-        LOG_ERR("Service discovery failed (err %d)", err);
-        error_recovery();
+        LOG_WRN("Link %u: failed to request security (err %d)", link_id(link), err);
     }
+
+    /* Keep looking for more main devices while there is room */
+    start_scan();
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
@@ -315,21 +535,57 @@ static void disconnected(struct bt_conn *conn, uint8_t reason)
     char addr[BT_ADDR_LE_STR_LEN];
     bt_addr_le_to_str(bt_conn_get_dst(conn), addr, sizeof(addr));
 
-    LOG_INF("Disconnected from %s (reason 0x%02x)", addr, reason);
+    struct link *link = link_find(conn);
+    if (!link) {
+        return;
+    }
 
-    if (current_conn) {
-        bt_conn_unref(current_conn);
-        current_conn = NULL;
+    LOG_INF("Disconnected from %s on link %u (reason 0x%02x)", addr, link_id(link), reason);
+
+    metrics_inc(METRIC_BLE_DISCONNECTS);
+    switch (reason) {
+    case BT_HCI_ERR_CONN_TIMEOUT:
+        metrics_inc(METRIC_BLE_DISC_TIMEOUT);
+        break;
+    case BT_HCI_ERR_REMOTE_USER_TERM_CONN:
+        metrics_inc(METRIC_BLE_DISC_REMOTE);
+        break;
+    case BT_HCI_ERR_LOCALHOST_TERM_CONN:
+        metrics_inc(METRIC_BLE_DISC_LOCAL);
+        break;
+    default:
+        metrics_inc(METRIC_BLE_DISC_OTHER);
+        break;
     }
 
-    /* Return to scanning */
-    scanning = false;
+    conn_policy_link_down(link_id(link));
+    rental_sync_link_down(link_id(link));
+    link_free(link);
+
+    /* A slot is free again, make sure we are scanning */
     start_scan();
 }
 
+static void security_changed(struct bt_conn *conn, bt_security_t level,
+                             enum bt_security_err err)
+{
+    struct link *link = link_find(conn);
+
+    if (!link) {
+        return;
+    }
+
+    if (err) {
+        LOG_WRN("Link %u: security failed (err %d)", link_id(link), err);
+    } else {
+        LOG_INF("Link %u: security level %u", link_id(link), level);
+    }
+}
+
 BT_CONN_CB_DEFINE(conn_callbacks) = {
     .connected = connected,
     .disconnected = disconnected,
+    .security_changed = security_changed,
 };
 
 static void start_scan(void)
@@ -339,20 +595,40 @@ static void start_scan(void)
     const int max_retries = 3;
 
     if (scanning) {
-        LOG_INF("Scan already active");
+        LOG_DBG("Scan already active");
         return;
     }
 
+    if (connecting) {
+        /* Resumed once the pending connection completes */
+        return;
+    }
+
+    /* Beacons are observed even when no more links can be taken;
+     * try_connect() then skips the connectable devices.
+     */
+    if (!IS_ENABLED(CONFIG_RENTSCAN_BEACON_OBSERVER)) {
+        if (backpressure) {
+            /* Resumed once the backend has caught up */
+            LOG_DBG("Backpressure active, not scanning");
+            return;
+        }
+
+        if (link_table_full()) {
+            LOG_INF("All %d links in use, not scanning", BLE_CENTRAL_MAX_LINKS);
+            return;
+        }
+    }
+
+    if (accept_list_count) {
+        scan_param.options |= BT_LE_SCAN_OPT_FILTER_ACCEPT_LIST;
+    } else {
+        scan_param.options &= ~BT_LE_SCAN_OPT_FILTER_ACCEPT_LIST;
+    }
+    bt_scan_params_set(&scan_param);
+
     while (retry_count < max_retries) {
-        // Configure scan parameters for better discovery
-        struct bt_le_scan_param scan_param = {
-            .type = BT_LE_SCAN_TYPE_ACTIVE,
-            .interval = BLE_SCAN_INTERVAL,
-            .window = BLE_SCAN_WINDOW,
-            .options = BT_LE_SCAN_OPT_FILTER_DUPLICATE
-        };
-
-        err = bt_le_scan_start(&scan_param, device_found);
+        err = bt_scan_start(BT_SCAN_TYPE_SCAN_ACTIVE);
         if (err == 0) {
             scanning = true;
             LOG_INF("Scanning started successfully");
@@ -370,28 +646,28 @@ static void start_scan(void)
     LOG_ERR("Failed to start scan after %d retries", max_retries);
 }
 
-static void error_recovery(void)
+static void error_recovery(struct link *link)
 {
     consecutive_errors++;
-    
+
     if (consecutive_errors >= GATEWAY_ERROR_RESET_THRESHOLD) {
         LOG_WRN("Too many consecutive errors, resetting BLE");
         consecutive_errors = 0;
         ble_central_reset();
     } else {
-        if (current_conn) {
-            bt_conn_disconnect(current_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+        if (link->conn) {
+            bt_conn_disconnect(link->conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
         }
-        scanning = false;
         start_scan();
     }
 }
 
-int ble_central_init(ble_msg_received_cb_t msg_received_cb)
+int ble_central_init(ble_msg_received_cb_t msg_received_cb, ble_link_ready_cb_t link_ready_cb)
 {
     int err;
 
     msg_callback = msg_received_cb;
+    link_ready_callback = link_ready_cb;
 
     err = bt_enable(NULL);
     if (err) {
@@ -399,7 +675,17 @@ int ble_central_init(ble_msg_received_cb_t msg_received_cb)
         return err;
     }
 
-    LOG_INF("Bluetooth initialized");
+    /* Bonds were not available when the application settings were loaded */
+    if (IS_ENABLED(CONFIG_BT_SETTINGS)) {
+        settings_load_subtree("bt");
+    }
+
+    err = scan_init();
+    if (err) {
+        return err;
+    }
+
+    LOG_INF("Bluetooth initialized, up to %d links", BLE_CENTRAL_MAX_LINKS);
     return 0;
 }
 
@@ -414,7 +700,7 @@ int ble_central_start_scan(void)
 int ble_central_stop_scan(void)
 {
     if (scanning) {
-        int err = bt_le_scan_stop();
+        int err = bt_scan_stop();
         if (err) {
             LOG_ERR("Stopping scanning failed (err %d)", err);
             return err;
@@ -424,41 +710,101 @@ int ble_central_stop_scan(void)
     return 0;
 }
 
-int ble_central_send_message(const rentscan_msg_t *msg)
+int ble_central_set_backpressure(bool enable)
+{
+    if (enable == backpressure) {
+        return 0;
+    }
+
+    backpressure = enable;
+
+    if (enable) {
+        LOG_WRN("Backpressure on, not accepting new main devices");
+        /* Keep scanning for beacons, try_connect() skips new peers */
+        return IS_ENABLED(CONFIG_RENTSCAN_BEACON_OBSERVER) ? 0 : ble_central_stop_scan();
+    }
+
+    LOG_INF("Backpressure off, accepting new main devices");
+    start_scan();
+    return 0;
+}
+
+int ble_central_send_message(uint8_t id, const rentscan_msg_t *msg)
 {
-    if (!current_conn || !nus_rx_handle) {
+    struct link *link = link_get(id);
+
+    if (!link || !link->rx_handle) {
         return -ENOTCONN;
     }
 
-    return bt_gatt_write_without_response(current_conn, nus_rx_handle,
-                                        msg, sizeof(*msg), false);
+    uint8_t buf[RENTSCAN_WIRE_MSG_MAX_LEN];
+    int len = rentscan_msg_encode(msg, buf, sizeof(buf));
+    if (len < 0) {
+        LOG_ERR("Failed to encode message (err %d)", len);
+        return len;
+    }
+
+    int err = bt_gatt_write_without_response(link->conn, link->rx_handle,
+                                             buf, len, false);
+
+    /* Out of TX buffers means the interval is too long for the load */
+    conn_policy_set_backlog(id, err == -ENOMEM);
+    if (!err) {
+        metrics_inc(METRIC_BLE_TX);
+        conn_policy_activity(id);
+    } else {
+        metrics_inc(err == -ENOMEM ? METRIC_BLE_TX_NO_BUF : METRIC_BLE_TX_FAILED);
+    }
+    return err;
 }
 
-int ble_central_disconnect(void)
+int ble_central_disconnect(uint8_t id)
 {
-    if (current_conn) {
-        return bt_conn_disconnect(current_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+    if (id == BLE_CENTRAL_LINK_ALL) {
+        for (int i = 0; i < ARRAY_SIZE(links); i++) {
+            if (links[i].conn) {
+                bt_conn_disconnect(links[i].conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+            }
+        }
+        return 0;
     }
-    return 0;
+
+    struct link *link = link_get(id);
+    if (!link) {
+        return -ENOTCONN;
+    }
+
+    return bt_conn_disconnect(link->conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
 }
 
 int ble_central_reset(void)
 {
-    /* First, properly disconnect and clean up any existing connection */
-    if (current_conn) {
-        bt_conn_disconnect(current_conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
-        bt_conn_unref(current_conn);
-        current_conn = NULL;
+    /* First, properly disconnect every existing connection. The slots are
+     * freed in disconnected(), once the stack has dropped the subscription
+     * that lives in them.
+     */
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        if (links[i].conn) {
+            int err = bt_conn_disconnect(links[i].conn, BT_HCI_ERR_REMOTE_USER_TERM_CONN);
+
+            conn_policy_link_down(i);
+            rental_sync_link_down(i);
+            if (err) {
+                /* Already down, nothing of the link is left in the stack */
+                link_free(&links[i]);
+            }
+        }
     }
+    connecting = false;
 
     /* Stop any active scanning */
     if (scanning) {
-        bt_le_scan_stop();
+        bt_scan_stop();
         scanning = false;
     }
 
     LOG_INF("BLE central reset");
-    
+
     /* Restart scanning */
     start_scan();
     return 0;
@@ -466,78 +812,154 @@ int ble_central_reset(void)
 
 bool ble_central_is_connected(void)
 {
-    return current_conn != NULL;
+    return ble_central_link_count() > 0;
+}
+
+uint8_t ble_central_link_count(void)
+{
+    uint8_t count = 0;
+
+    for (int i = 0; i < ARRAY_SIZE(links); i++) {
+        /* A link only counts once the connection is established */
+        if (links[i].conn) {
+            struct bt_conn_info info;
+
+            if (bt_conn_get_info(links[i].conn, &info) == 0 &&
+                info.state == BT_CONN_STATE_CONNECTED) {
+                count++;
+            }
+        }
+    }
+    return count;
+}
+
+int ble_central_get_link_info(uint8_t id, struct ble_central_link_info *info)
+{
+    struct link *link = link_get(id);
+
+    if (!info) {
+        return -EINVAL;
+    }
+
+    if (!link) {
+        return -ENOTCONN;
+    }
+
+    bt_addr_le_copy(&info->addr, bt_conn_get_dst(link->conn));
+    info->rx_handle = link->rx_handle;
+    info->tx_handle = link->tx_handle;
+    info->ccc_handle = link->subscribe_params.ccc_handle;
+    info->subscribed = link->subscribe_params.value_handle != 0;
+    info->cached = link->from_cache;
+    return 0;
+}
+
+void ble_central_forget_handles(void)
+{
+    handle_cache_clear();
+}
+
+int ble_central_manual_subscribe(uint8_t id, uint16_t tx_handle, uint16_t ccc_handle)
+{
+    struct link *link = link_get(id);
+
+    if (!link) {
+        return -ENOTCONN;
+    }
+
+    link->tx_handle = tx_handle;
+
+    int err = subscribe(link, ccc_handle);
+    if (!err) {
+        /* Handles worked, reuse them on the next connection */
+        cache_store(link, NULL);
+    }
+    return err;
 }
 
 /* Function to read RSSI using HCI command */
-int ble_central_get_conn_stats(int8_t *rssi, int8_t *tx_power, uint16_t *conn_interval)
+int ble_central_get_conn_stats(uint8_t id, struct ble_central_conn_stats *stats)
 {
-    if (!current_conn) {
+    struct link *link = link_get(id);
+
+    if (!stats) {
+        return -EINVAL;
+    }
+
+    if (!link) {
         return -ENOTCONN;
     }
 
-    /* Get connection interval from connection info */
+    /* Get connection parameters from connection info */
     struct bt_conn_info info;
-    int err = bt_conn_get_info(current_conn, &info);
+    int err = bt_conn_get_info(link->conn, &info);
     if (err) {
         return err;
     }
 
-    if (conn_interval) {
-        *conn_interval = info.le.interval;
+    if (info.state != BT_CONN_STATE_CONNECTED) {
+        return -ENOTCONN;
     }
 
+    stats->interval = info.le.interval;
+    stats->latency = info.le.latency;
+    stats->timeout = info.le.timeout;
+    stats->tx_phy = info.le.phy->tx_phy;
+    stats->rx_phy = info.le.phy->rx_phy;
+    stats->tx_data_len = info.le.data_len->tx_max_len;
+    stats->rx_data_len = info.le.data_len->rx_max_len;
+    stats->mtu = bt_gatt_get_mtu(link->conn);
+    stats->burst = conn_policy_get_mode(id) == CONN_POLICY_BURST;
+
     /* Use HCI Read RSSI command to get actual RSSI value */
-    if (rssi) {
-        struct net_buf *buf, *rsp = NULL;
-        struct bt_hci_cp_read_rssi *cp;
-        struct bt_hci_rp_read_rssi *rp;
-        
-        /* Get connection handle - use index instead of non-existent bt_conn_get_id() */
-        uint16_t handle = bt_conn_index(current_conn);
-        
-        /* Create HCI command */
-        buf = bt_hci_cmd_create(BT_HCI_OP_READ_RSSI, sizeof(*cp));
-        if (!buf) {
-            return -ENOBUFS;
-        }
-        
-        /* Fill command parameters - use manual assignment instead of sys_cpu_to_le16 */
-        cp = net_buf_add(buf, sizeof(*cp));
-        cp->handle = handle; /* No endian conversion needed as this is a local variable */
-        
-        /* Send command and wait for response */
-        err = bt_hci_cmd_send_sync(BT_HCI_OP_READ_RSSI, buf, &rsp);
-        if (err) {
-            return err;
-        }
-        
-        /* Process response */
-        rp = (void *)rsp->data;
-        if (rp->status) {
-            /* Command failed */
-            err = -EIO;
-        } else {
-            /* The HCI returns RSSI as a signed 8-bit value in dBm */
-            *rssi = rp->rssi;
-            err = 0;
-        }
-        
-        /* Release response buffer */
-        net_buf_unref(rsp);
-        
-        if (err) {
-            return err;
-        }
+    struct net_buf *buf, *rsp = NULL;
+    struct bt_hci_cp_read_rssi *cp;
+    struct bt_hci_rp_read_rssi *rp;
+    uint16_t handle;
+
+    err = bt_hci_get_conn_handle(link->conn, &handle);
+    if (err) {
+        return err;
+    }
+
+    /* Create HCI command */
+    buf = bt_hci_cmd_create(BT_HCI_OP_READ_RSSI, sizeof(*cp));
+    if (!buf) {
+        return -ENOBUFS;
+    }
+
+    cp = net_buf_add(buf, sizeof(*cp));
+    cp->handle = sys_cpu_to_le16(handle);
+
+    /* Send command and wait for response */
+    err = bt_hci_cmd_send_sync(BT_HCI_OP_READ_RSSI, buf, &rsp);
+    if (err) {
+        return err;
+    }
+
+    /* Process response */
+    rp = (void *)rsp->data;
+    if (rp->status) {
+        /* Command failed */
+        err = -EIO;
+    } else {
+        /* The HCI returns RSSI as a signed 8-bit value in dBm */
+        stats->rssi = rp->rssi;
+        err = 0;
+    }
+
+    /* Release response buffer */
+    net_buf_unref(rsp);
+
+    if (err) {
+        return err;
     }
 
     /* Estimate TX power based on connection parameters */
-    if (tx_power) {
-        if (info.le.interval < 50) {
-            *tx_power = 0;  /* Higher power for fast connections */
-        } else {
-            *tx_power = -6; /* Lower power for slow connections */
-        }
+    if (info.le.interval < 50) {
+        stats->tx_power = 0;  /* Higher power for fast connections */
+    } else {
+        stats->tx_power = -6; /* Lower power for slow connections */
     }
 
     return 0;
@@ -545,17 +967,45 @@ int ble_central_get_conn_stats(int8_t *rssi, int8_t *tx_power, uint16_t *conn_in
 
 int ble_central_add_to_whitelist(const char *addr_str)
 {
-    // Replace whitelist with filter accept list
+    bool was_scanning = scanning;
     bt_addr_le_t addr;
     int err = bt_addr_le_from_str(addr_str, "random", &addr);
     if (err) {
         return err;
     }
-    return bt_le_filter_accept_list_add(&addr);
+
+    /* The controller rejects accept list changes while it scans with it */
+    err = ble_central_stop_scan();
+    if (err) {
+        return err;
+    }
+
+    err = bt_le_filter_accept_list_add(&addr);
+    if (!err) {
+        accept_list_count++;
+    }
+
+    if (was_scanning) {
+        start_scan();
+    }
+    return err;
 }
 
 int ble_central_clear_whitelist(void)
 {
-    // Replace whitelist with filter accept list
-    return bt_le_filter_accept_list_clear();
+    bool was_scanning = scanning;
+    int err = ble_central_stop_scan();
+    if (err) {
+        return err;
+    }
+
+    err = bt_le_filter_accept_list_clear();
+    if (!err) {
+        accept_list_count = 0;
+    }
+
+    if (was_scanning) {
+        start_scan();
+    }
+    return err;
 }
\ No newline at end of file
@@ -9,26 +9,81 @@
 #include <zephyr/types.h>
 #include <stdbool.h>
 #include <stddef.h>
+#include <zephyr/bluetooth/addr.h>
 #include "../../common/include/rentscan_protocol.h"
 
+/** Maximum number of main devices served concurrently */
+#define BLE_CENTRAL_MAX_LINKS CONFIG_BT_MAX_CONN
+
+/** Link identifier addressing every connected main device */
+#define BLE_CENTRAL_LINK_ALL 0xFF
+
+/**
+ * @brief Information about one link in the connection table
+ */
+struct ble_central_link_info {
+    bt_addr_le_t addr;     /**< Peer address */
+    uint16_t rx_handle;    /**< RX characteristic value handle */
+    uint16_t tx_handle;    /**< TX characteristic value handle */
+    uint16_t ccc_handle;   /**< TX CCC descriptor handle */
+    bool subscribed;       /**< Whether TX notifications are enabled */
+    bool cached;           /**< Whether the handles came from the handle cache */
+};
+
 /**
- * @brief Callback for received BLE messages
+ * @brief Connection quality and parameters of one link
+ */
+struct ble_central_conn_stats {
+    int8_t rssi;           /**< RSSI in dBm */
+    int8_t tx_power;       /**< Estimated TX power in dBm */
+    uint16_t interval;     /**< Connection interval in 1.25 ms units */
+    uint16_t latency;      /**< Peripheral latency in connection events */
+    uint16_t timeout;      /**< Supervision timeout in 10 ms units */
+    uint8_t tx_phy;        /**< TX PHY (BT_GAP_LE_PHY_*) */
+    uint8_t rx_phy;        /**< RX PHY (BT_GAP_LE_PHY_*) */
+    uint16_t tx_data_len;  /**< Maximum TX payload per link layer packet */
+    uint16_t rx_data_len;  /**< Maximum RX payload per link layer packet */
+    uint16_t mtu;          /**< ATT MTU */
+    bool burst;            /**< Whether the connection policy runs the link in burst mode */
+};
+
+/**
+ * @brief Callback for received BLE data
  * 
- * @param msg Pointer to RentScan message
+ * Called from the Bluetooth RX thread with the raw notification, which
+ * holds one or more encoded RentScan messages back to back.
+ * 
+ * @param link Link the data arrived on
+ * @param data Encoded message data
+ * @param len Length of the data
  */
-typedef void (*ble_msg_received_cb_t)(const rentscan_msg_t *msg);
+typedef void (*ble_msg_received_cb_t)(uint8_t link, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Callback for a link that is ready to exchange messages
+ * 
+ * Called from the Bluetooth RX thread once the gateway has subscribed to
+ * the main device's TX notifications.
+ * 
+ * @param link Link that became ready
+ */
+typedef void (*ble_link_ready_cb_t)(uint8_t link);
 
 /**
  * @brief Initialize the BLE central
  * 
  * @param msg_received_cb Callback function to be called when a message is received
+ * @param link_ready_cb Callback function to be called when a link is ready, can be NULL
  * @return int 0 on success, negative error code otherwise
  */
-int ble_central_init(ble_msg_received_cb_t msg_received_cb);
+int ble_central_init(ble_msg_received_cb_t msg_received_cb, ble_link_ready_cb_t link_ready_cb);
 
 /**
  * @brief Start scanning for RentScan devices
  * 
+ * Scanning continues while links are up until every slot in the
+ * connection table is in use.
+ * 
  * @return int 0 on success, negative error code otherwise
  */
 int ble_central_start_scan(void);
@@ -40,20 +95,33 @@ int ble_central_start_scan(void);
  */
 int ble_central_stop_scan(void);
 
+/**
+ * @brief Stop or resume accepting new main devices
+ * 
+ * While backpressure is on the gateway stops scanning and ignores new
+ * peers; existing links are kept.
+ * 
+ * @param enable true to apply backpressure, false to release it
+ * @return int 0 on success, negative error code otherwise
+ */
+int ble_central_set_backpressure(bool enable);
+
 /**
  * @brief Send a message to a connected RentScan device
  * 
+ * @param link Link to send the message on
  * @param msg Pointer to RentScan message
  * @return int 0 on success, negative error code otherwise
  */
-int ble_central_send_message(const rentscan_msg_t *msg);
+int ble_central_send_message(uint8_t link, const rentscan_msg_t *msg);
 
 /**
- * @brief Disconnect from the current device
+ * @brief Disconnect from a device
  * 
+ * @param link Link to disconnect, or BLE_CENTRAL_LINK_ALL
  * @return int 0 on success, negative error code otherwise
  */
-int ble_central_disconnect(void);
+int ble_central_disconnect(uint8_t link);
 
 /**
  * @brief Reset the BLE stack (in case of irrecoverable errors)
@@ -63,26 +131,64 @@ int ble_central_disconnect(void);
 int ble_central_reset(void);
 
 /**
- * @brief Check if connected to a RentScan device
+ * @brief Check if connected to at least one RentScan device
  * 
  * @return true if connected
  * @return false if not connected
  */
 bool ble_central_is_connected(void);
 
+/**
+ * @brief Get the number of connected RentScan devices
+ * 
+ * @return uint8_t Number of links in use
+ */
+uint8_t ble_central_link_count(void);
+
+/**
+ * @brief Get information about a link
+ * 
+ * @param link Link identifier
+ * @param info Pointer to store link information
+ * @return int 0 on success, -ENOTCONN if the link is not in use
+ */
+int ble_central_get_link_info(uint8_t link, struct ble_central_link_info *info);
+
+/**
+ * @brief Subscribe to TX notifications using known handles
+ * 
+ * Fallback for peers where GATT discovery does not complete. Handles that
+ * work are cached for the next connection to the same device.
+ * 
+ * @param link Link identifier
+ * @param tx_handle TX characteristic value handle
+ * @param ccc_handle TX CCC descriptor handle
+ * @return int 0 on success, negative error code otherwise
+ */
+int ble_central_manual_subscribe(uint8_t link, uint16_t tx_handle, uint16_t ccc_handle);
+
+/**
+ * @brief Forget the cached GATT handles of every main device
+ * 
+ * The next connection to each device runs a full service discovery.
+ */
+void ble_central_forget_handles(void);
+
 /**
  * @brief Get connection quality statistics
  * 
- * @param rssi Pointer to store RSSI value
- * @param tx_power Pointer to store TX power
- * @param conn_interval Pointer to store connection interval
+ * @param link Link identifier
+ * @param stats Pointer to store the statistics
  * @return int 0 on success, negative error code otherwise
  */
-int ble_central_get_conn_stats(int8_t *rssi, int8_t *tx_power, uint16_t *conn_interval);
+int ble_central_get_conn_stats(uint8_t link, struct ble_central_conn_stats *stats);
 
 /**
  * @brief Add a device address to the whitelist
  * 
+ * While the whitelist holds any address the controller filters scanning
+ * on it, so other main devices and their status beacons are not seen.
+ * 
  * @param addr_str String representation of the BLE address
  * @return int 0 on success, negative error code otherwise
  */
@@ -95,4 +201,4 @@ int ble_central_add_to_whitelist(const char *addr_str);
  */
 int ble_central_clear_whitelist(void);
 
-#endif /* BLE_CENTRAL_H */ 
\ No newline at end of file
+#endif /* BLE_CENTRAL_H */
\ No newline at end of file
@@ -0,0 +1,299 @@
+/**
+ * @file conn_policy.c
+ * @brief Connection parameter, PHY and data length policy for main device links
+ *
+ * Links with traffic run on a short interval without latency. Once a link
+ * has been quiet for a while it is moved to a long interval with
+ * peripheral latency so the main device can sleep through most connection
+ * events. The first message after a quiet period switches it back.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/bluetooth/gatt.h>
+#include <zephyr/sys/atomic.h>
+#include "conn_policy.h"
+#include "workq.h"
+#include "ble_central.h"
+#include "../include/gateway_config.h"
+
+LOG_MODULE_REGISTER(conn_policy, LOG_LEVEL_INF);
+
+struct policy_link {
+    struct bt_conn *conn;
+    enum conn_policy_mode mode;
+    atomic_t last_activity;
+    struct bt_gatt_exchange_params mtu_params;
+};
+
+static const struct bt_le_conn_param mode_params[] = {
+    [CONN_POLICY_BURST] = {
+        .interval_min = BLE_CONN_BURST_INTERVAL_MIN,
+        .interval_max = BLE_CONN_BURST_INTERVAL_MAX,
+        .latency = 0,
+        .timeout = BLE_CONN_SUPERVISION_TIMEOUT,
+    },
+    [CONN_POLICY_IDLE] = {
+        .interval_min = BLE_CONN_IDLE_INTERVAL_MIN,
+        .interval_max = BLE_CONN_IDLE_INTERVAL_MAX,
+        .latency = BLE_CONN_IDLE_LATENCY,
+        .timeout = BLE_CONN_IDLE_SUPERVISION_TIMEOUT,
+    },
+};
+
+static struct policy_link policy_links[BLE_CENTRAL_MAX_LINKS];
+static ATOMIC_DEFINE(backlog_links, BLE_CENTRAL_MAX_LINKS);
+static struct k_spinlock policy_lock;
+
+static void policy_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(policy_work, policy_work_handler);
+
+static const char *mode_str(enum conn_policy_mode mode)
+{
+    return mode == CONN_POLICY_BURST ? "burst" : "idle";
+}
+
+static struct policy_link *policy_link_find(const struct bt_conn *conn)
+{
+    for (int i = 0; i < ARRAY_SIZE(policy_links); i++) {
+        if (policy_links[i].conn == conn) {
+            return &policy_links[i];
+        }
+    }
+    return NULL;
+}
+
+/* Take a reference so the connection can't go away while we use it */
+static struct bt_conn *policy_link_conn(struct policy_link *pl)
+{
+    k_spinlock_key_t key = k_spin_lock(&policy_lock);
+    struct bt_conn *conn = pl->conn ? bt_conn_ref(pl->conn) : NULL;
+
+    k_spin_unlock(&policy_lock, key);
+    return conn;
+}
+
+static void apply_mode(struct policy_link *pl, enum conn_policy_mode mode)
+{
+    struct bt_conn *conn;
+    int err;
+
+    if (pl->mode == mode) {
+        return;
+    }
+
+    conn = policy_link_conn(pl);
+    if (!conn) {
+        return;
+    }
+
+    err = bt_conn_le_param_update(conn, &mode_params[mode]);
+    if (err) {
+        /* Retried on the next evaluation */
+        LOG_DBG("Link %u: %s parameters rejected (err %d)",
+                (uint8_t)(pl - policy_links), mode_str(mode), err);
+    } else {
+        LOG_INF("Link %u: switching to %s parameters",
+                (uint8_t)(pl - policy_links), mode_str(mode));
+        pl->mode = mode;
+    }
+
+    bt_conn_unref(conn);
+}
+
+static void policy_work_handler(struct k_work *work)
+{
+    uint32_t now = k_uptime_get_32();
+    bool active = false;
+
+    for (int i = 0; i < ARRAY_SIZE(policy_links); i++) {
+        struct policy_link *pl = &policy_links[i];
+
+        if (!pl->conn) {
+            continue;
+        }
+
+        active = true;
+
+        bool busy = atomic_test_bit(backlog_links, i) ||
+                    now - (uint32_t)atomic_get(&pl->last_activity) < BLE_CONN_IDLE_AFTER_MS;
+
+        apply_mode(pl, busy ? CONN_POLICY_BURST : CONN_POLICY_IDLE);
+    }
+
+    if (active) {
+        k_work_schedule_for_queue(&workq_housekeeping.queue, &policy_work,
+                                  K_MSEC(BLE_CONN_POLICY_PERIOD_MS));
+    }
+}
+
+static void mtu_exchange_func(struct bt_conn *conn, uint8_t err,
+                              struct bt_gatt_exchange_params *params)
+{
+    struct policy_link *pl = CONTAINER_OF(params, struct policy_link, mtu_params);
+
+    if (err) {
+        LOG_WRN("Link %u: MTU exchange failed (err %u)", (uint8_t)(pl - policy_links), err);
+        return;
+    }
+
+    LOG_INF("Link %u: ATT MTU %u", (uint8_t)(pl - policy_links), bt_gatt_get_mtu(conn));
+}
+
+const struct bt_le_conn_param *conn_policy_initial_param(void)
+{
+    return &mode_params[CONN_POLICY_BURST];
+}
+
+void conn_policy_link_up(uint8_t link, struct bt_conn *conn)
+{
+    struct policy_link *pl;
+    k_spinlock_key_t key;
+    int err;
+
+    if (link >= ARRAY_SIZE(policy_links)) {
+        return;
+    }
+
+    pl = &policy_links[link];
+
+    key = k_spin_lock(&policy_lock);
+    pl->conn = bt_conn_ref(conn);
+    pl->mode = CONN_POLICY_BURST;
+    atomic_set(&pl->last_activity, k_uptime_get_32());
+    atomic_clear_bit(backlog_links, link);
+    k_spin_unlock(&policy_lock, key);
+
+    /* The controller may already be on 2M or max length, in which case
+     * these are no-ops on air.
+     */
+    err = bt_conn_le_phy_update(conn, BT_CONN_LE_PHY_PARAM_2M);
+    if (err) {
+        LOG_WRN("Link %u: PHY update failed (err %d)", link, err);
+    }
+
+    err = bt_conn_le_data_len_update(conn, BT_LE_DATA_LEN_PARAM_MAX);
+    if (err) {
+        LOG_WRN("Link %u: data length update failed (err %d)", link, err);
+    }
+
+    pl->mtu_params.func = mtu_exchange_func;
+    err = bt_gatt_exchange_mtu(conn, &pl->mtu_params);
+    if (err) {
+        LOG_WRN("Link %u: MTU exchange failed (err %d)", link, err);
+    }
+
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &policy_work,
+                              K_MSEC(BLE_CONN_POLICY_PERIOD_MS));
+}
+
+void conn_policy_link_down(uint8_t link)
+{
+    struct bt_conn *conn;
+    k_spinlock_key_t key;
+
+    if (link >= ARRAY_SIZE(policy_links)) {
+        return;
+    }
+
+    key = k_spin_lock(&policy_lock);
+    conn = policy_links[link].conn;
+    policy_links[link].conn = NULL;
+    k_spin_unlock(&policy_lock, key);
+
+    if (conn) {
+        bt_conn_unref(conn);
+    }
+}
+
+void conn_policy_activity(uint8_t link)
+{
+    if (link >= ARRAY_SIZE(policy_links)) {
+        return;
+    }
+
+    struct policy_link *pl = &policy_links[link];
+
+    atomic_set(&pl->last_activity, k_uptime_get_32());
+
+    if (pl->mode != CONN_POLICY_BURST) {
+        /* Don't make a waking link wait for the next evaluation */
+        k_work_reschedule_for_queue(&workq_housekeeping.queue, &policy_work, K_NO_WAIT);
+    }
+}
+
+void conn_policy_set_backlog(uint8_t link, bool backlog)
+{
+    if (link >= ARRAY_SIZE(policy_links)) {
+        return;
+    }
+
+    if (backlog) {
+        if (!atomic_test_and_set_bit(backlog_links, link)) {
+            conn_policy_activity(link);
+        }
+    } else {
+        atomic_clear_bit(backlog_links, link);
+    }
+}
+
+enum conn_policy_mode conn_policy_get_mode(uint8_t link)
+{
+    if (link >= ARRAY_SIZE(policy_links)) {
+        return CONN_POLICY_BURST;
+    }
+    return policy_links[link].mode;
+}
+
+/* Answer peripheral requests with our own profile so a main device can't
+ * pull an idle link back to a short interval, or a busy one to a long one.
+ */
+static bool le_param_req(struct bt_conn *conn, struct bt_le_conn_param *param)
+{
+    struct policy_link *pl = policy_link_find(conn);
+
+    if (pl) {
+        *param = mode_params[pl->mode];
+    }
+    return true;
+}
+
+static void le_param_updated(struct bt_conn *conn, uint16_t interval,
+                             uint16_t latency, uint16_t timeout)
+{
+    struct policy_link *pl = policy_link_find(conn);
+
+    if (pl) {
+        LOG_INF("Link %u: interval %u, latency %u, timeout %u",
+                (uint8_t)(pl - policy_links), interval, latency, timeout);
+    }
+}
+
+static void le_phy_updated(struct bt_conn *conn, struct bt_conn_le_phy_info *param)
+{
+    struct policy_link *pl = policy_link_find(conn);
+
+    if (pl) {
+        LOG_INF("Link %u: PHY TX %u, RX %u", (uint8_t)(pl - policy_links),
+                param->tx_phy, param->rx_phy);
+    }
+}
+
+static void le_data_len_updated(struct bt_conn *conn, struct bt_conn_le_data_len_info *info)
+{
+    struct policy_link *pl = policy_link_find(conn);
+
+    if (pl) {
+        LOG_INF("Link %u: data length TX %u, RX %u", (uint8_t)(pl - policy_links),
+                info->tx_max_len, info->rx_max_len);
+    }
+}
+
+BT_CONN_CB_DEFINE(conn_policy_callbacks) = {
+    .le_param_req = le_param_req,
+    .le_param_updated = le_param_updated,
+    .le_phy_updated = le_phy_updated,
+    .le_data_len_updated = le_data_len_updated,
+};
@@ -0,0 +1,76 @@
+/**
+ * @file conn_policy.h
+ * @brief Connection parameter, PHY and data length policy for main device links
+ */
+
+#ifndef CONN_POLICY_H
+#define CONN_POLICY_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <zephyr/bluetooth/conn.h>
+
+/**
+ * @brief Connection profiles applied by the policy
+ */
+enum conn_policy_mode {
+    CONN_POLICY_BURST,  /**< Short interval, no latency, for traffic */
+    CONN_POLICY_IDLE,   /**< Long interval with peripheral latency */
+};
+
+/**
+ * @brief Get the parameters to create new connections with
+ * 
+ * New links start in the burst profile so discovery and the first
+ * messages go through quickly.
+ * 
+ * @return const struct bt_le_conn_param* Burst connection parameters
+ */
+const struct bt_le_conn_param *conn_policy_initial_param(void);
+
+/**
+ * @brief Start managing a newly connected link
+ * 
+ * Requests the 2M PHY, the maximum data length and an ATT MTU exchange.
+ * 
+ * @param link Link identifier
+ * @param conn Connection of the link
+ */
+void conn_policy_link_up(uint8_t link, struct bt_conn *conn);
+
+/**
+ * @brief Stop managing a link
+ * 
+ * @param link Link identifier
+ */
+void conn_policy_link_down(uint8_t link);
+
+/**
+ * @brief Report traffic on a link
+ * 
+ * Moves an idle link back to the burst profile. Links without traffic
+ * relax to the idle profile after a while.
+ * 
+ * @param link Link identifier
+ */
+void conn_policy_activity(uint8_t link);
+
+/**
+ * @brief Report whether data is waiting to be sent on a link
+ * 
+ * The link is held in the burst profile while a backlog is reported.
+ * 
+ * @param link Link identifier
+ * @param backlog true while data is waiting
+ */
+void conn_policy_set_backlog(uint8_t link, bool backlog);
+
+/**
+ * @brief Get the profile currently requested for a link
+ * 
+ * @param link Link identifier
+ * @return enum conn_policy_mode Requested profile
+ */
+enum conn_policy_mode conn_policy_get_mode(uint8_t link);
+
+#endif /* CONN_POLICY_H */
\ No newline at end of file
@@ -4,8 +4,15 @@
 #include <string.h>
 #include <stdlib.h>
 #include <time.h>
-#include <zephyr/random/rand32.h>
 #include "gateway_service.h"
+#include "ingress_queue.h"
+#include "outbox.h"
+#include "uplink.h"
+#include "ble_central.h"
+#include "rental_store.h"
+#include "workq.h"
+#include "../../common/include/rentscan_expiry.h"
+#include "../../common/include/rentscan_time.h"
 
 LOG_MODULE_REGISTER(gateway_service, LOG_LEVEL_INF);
 
@@ -13,36 +20,12 @@ LOG_MODULE_REGISTER(gateway_service, LOG_LEVEL_INF);
 #define MAX_CONFIG_KEY_LEN 32
 #define MAX_CONFIG_VALUE_LEN 64
 
-/* Backend simulation settings */
-#define BACKEND_SIM_STORAGE_SIZE 16
-#define BACKEND_SIM_CHECK_INTERVAL_MS 10000  /* 10 second interval for connection checks */
-#define MAX_ACTIVE_RENTALS 8
-
-/* Simulated backend connection state */
-static bool backend_connected = false;
+/* Count of messages that could not be logged for the backend */
 static int backend_error_count = 0;
-static struct k_work_delayable backend_sim_check_work;
-
-/* Simulated backend storage */
-typedef struct {
-    rentscan_msg_t messages[BACKEND_SIM_STORAGE_SIZE];
-    uint8_t message_count;
-    uint32_t last_sent_timestamp;
-    uint8_t config_values[MAX_CONFIG_VALUE_LEN];
-    rental_info_t active_rentals[MAX_ACTIVE_RENTALS];
-    uint8_t rental_count;
-    bool connected;
-} backend_sim_t;
-
-static backend_sim_t backend_sim = {
-    .message_count = 0,
-    .last_sent_timestamp = 0,
-    .config_values = {0},
-    .rental_count = 0
-};
-
-/* Forward declarations */
-static void backend_sim_check_handler(struct k_work *work);
+
+/* Expiry schedule, indexed by rental store slot */
+static struct rentscan_expiry_entry rental_expiry[RENTAL_STORE_CAPACITY];
+RENTSCAN_EXPIRY_DEFINE(rental_scheduler, RENTAL_STORE_CAPACITY);
 
 // Simple config storage using settings subsystem
 static int settings_set(const char *name, size_t len, settings_read_cb read_cb, void *cb_arg)
@@ -78,70 +61,41 @@ static bool rental_is_expired(const rental_info_t *rental)
         return false;
     }
     
-    uint32_t current_time = k_uptime_get_32() / 1000;
+    uint32_t current_time = rentscan_time_now();
     return (current_time > rental->start_time + rental->duration);
 }
 
-/* Find rental by item ID */
-static rental_info_t *find_rental_by_item_id(const char *item_id)
+/* Called once when a rental passes its deadline */
+static void rental_expired_handler(struct rentscan_expiry_entry *entry)
 {
-    if (!item_id) {
-        return NULL;
-    }
-    
-    for (int i = 0; i < backend_sim.rental_count; i++) {
-        if (strcmp(backend_sim.active_rentals[i].item_id, item_id) == 0 && 
-            backend_sim.active_rentals[i].active) {
-            return &backend_sim.active_rentals[i];
-        }
+    rental_info_t rental;
+
+    if (rental_store_get(entry - rental_expiry, &rental)) {
+        return;
     }
-    
-    return NULL;
+
+    LOG_WRN("Rental for item %s has expired", rental.item_id);
+
+    /* Tell the backend, through the outbox like every other change */
+    rentscan_msg_t msg = {
+        .cmd = CMD_STATUS_RESP,
+        .status = STATUS_EXPIRED,
+        .tag_id_len = strlen(rental.item_id),
+        .timestamp = rental.start_time,
+        .duration = rental.duration,
+        .payload_len = strlen(rental.user_id)
+    };
+
+    memcpy(msg.tag_id, rental.item_id, msg.tag_id_len);
+    memcpy(msg.payload, rental.user_id, msg.payload_len);
+
+    gateway_service_process_message(&msg);
 }
 
-/* Simulated backend connection check work handler */
-static void backend_sim_check_handler(struct k_work *work)
+/* Stop taking on new main devices while the outbox is nearly full */
+static void outbox_backpressure_handler(bool active)
 {
-    /* Simulate backend connection state changes with some randomness */
-    int random_val = sys_rand32_get() % 10;
-    
-    if (!backend_connected && random_val >= 2) {
-        /* 80% chance to connect if disconnected */
-        backend_connected = true;
-        LOG_INF("Backend connection established");
-    } else if (backend_connected && random_val == 0) {
-        /* 10% chance to disconnect if connected */
-        backend_connected = false;
-        LOG_WRN("Backend connection lost");
-    }
-    
-    /* Periodically process stored messages to simulate backend sync */
-    if (backend_connected && backend_sim.message_count > 0) {
-        LOG_INF("Simulating backend message processing: %u messages in queue", 
-                backend_sim.message_count);
-        
-        /* Clear the queue to simulate successful processing */
-        backend_sim.message_count = 0;
-        backend_sim.last_sent_timestamp = k_uptime_get_32();
-    }
-    
-    /* Check for expired rentals */
-    bool expired_found = false;
-    for (int i = 0; i < backend_sim.rental_count; i++) {
-        if (backend_sim.active_rentals[i].active && 
-            rental_is_expired(&backend_sim.active_rentals[i])) {
-            LOG_WRN("Rental for item %s has expired", 
-                   backend_sim.active_rentals[i].item_id);
-            expired_found = true;
-        }
-    }
-    
-    if (expired_found && backend_connected) {
-        LOG_INF("Simulating notification of expired rentals to backend");
-    }
-    
-    /* Reschedule the work */
-    k_work_schedule(&backend_sim_check_work, K_MSEC(BACKEND_SIM_CHECK_INTERVAL_MS));
+    ble_central_set_backpressure(active);
 }
 
 int gateway_service_init(void)
@@ -162,18 +116,30 @@ int gateway_service_init(void)
         return err;
     }
 
-    /* Initialize backend simulation work */
-    k_work_init_delayable(&backend_sim_check_work, backend_sim_check_handler);
-    
-    /* Start the backend simulation check */
-    k_work_schedule(&backend_sim_check_work, K_MSEC(BACKEND_SIM_CHECK_INTERVAL_MS));
+    /* Mount the outbox after settings_load() restored its ack */
+    err = outbox_init(outbox_backpressure_handler);
+    if (err) {
+        LOG_ERR("Failed to initialize outbox (err %d)", err);
+        return err;
+    }
 
-    /* Use random seed to initialize backend connection state */
-    int random_val = sys_rand32_get() % 10;
-    backend_connected = (random_val >= 3); /* 70% chance to start as connected */
+    rental_store_init();
+
+    /* Rental expiry fires per rental instead of being polled */
+    for (int i = 0; i < RENTAL_STORE_CAPACITY; i++) {
+        rentscan_expiry_entry_init(&rental_expiry[i]);
+    }
+    rentscan_expiry_init(&rental_scheduler, &workq_rental.queue, rental_expired_handler);
+
+    /* Delivers what the outbox holds, including messages from before a reboot */
+    err = uplink_init();
+    if (err) {
+        LOG_ERR("Failed to initialize uplink (err %d)", err);
+        return err;
+    }
 
     LOG_INF("Gateway service initialized (Backend %s)", 
-           backend_connected ? "connected" : "disconnected");
+           uplink_is_up() ? "connected" : "disconnected");
     return 0;
 }
 
@@ -184,56 +150,23 @@ int gateway_service_process_message(const rentscan_msg_t *msg)
     }
 
     LOG_INF("Processing message command %d", msg->cmd);
-    
-    /* Simulate some backend processing */
-    if (!backend_connected) {
+
+    /* Every message goes through the log, the uplink thread batches from it */
+    if (!uplink_is_up()) {
         LOG_WRN("Backend not connected, buffering message");
-        
-        /* If we have space in our simulated buffer */
-        if (backend_sim.message_count < BACKEND_SIM_STORAGE_SIZE) {
-            /* Store the message */
-            memcpy(&backend_sim.messages[backend_sim.message_count], 
-                   msg, sizeof(rentscan_msg_t));
-            backend_sim.message_count++;
-            LOG_INF("Message queued for sending (%d in queue)", backend_sim.message_count);
-            return 0;
-        } else {
-            LOG_ERR("Message queue full, dropping message");
-            backend_error_count++;
-            return -ENOSPC;
-        }
-    } else {
-        /* Simulate successful immediate processing */
-        char cmd_str[32];
-        
-        /* Convert the command to a string for logging */
-        switch (msg->cmd) {
-            case CMD_RENTAL_START:
-                snprintf(cmd_str, sizeof(cmd_str), "rental start");
-                break;
-            case CMD_RENTAL_END:
-                snprintf(cmd_str, sizeof(cmd_str), "rental end");
-                break;
-            case CMD_STATUS_REQ:
-                snprintf(cmd_str, sizeof(cmd_str), "status request");
-                break;
-            case CMD_STATUS_RESP:
-                snprintf(cmd_str, sizeof(cmd_str), "status response");
-                break;
-            case CMD_ERROR:
-                snprintf(cmd_str, sizeof(cmd_str), "error");
-                break;
-            default:
-                snprintf(cmd_str, sizeof(cmd_str), "unknown(%d)", msg->cmd);
-                break;
-        }
-        
-        LOG_INF("Sent %s to backend for tag ID length %d", cmd_str, msg->tag_id_len);
-        
-        /* Update our last sent timestamp */
-        backend_sim.last_sent_timestamp = k_uptime_get_32();
-        return 0;
     }
+
+    int err = outbox_append(msg);
+    if (err) {
+        LOG_ERR("Failed to store message in outbox (err %d)", err);
+        backend_error_count++;
+        return err;
+    }
+
+    LOG_DBG("Message queued for sending (%u in queue)", outbox_unsent());
+
+    uplink_kick();
+    return 0;
 }
 
 int gateway_service_start_rental(const char *item_id, const char *user_id, uint32_t duration)
@@ -242,32 +175,22 @@ int gateway_service_start_rental(const char *item_id, const char *user_id, uint3
         return -EINVAL;
     }
     
-    /* Check if item is already rented */
-    rental_info_t *existing = find_rental_by_item_id(item_id);
-    if (existing) {
+    uint32_t start_time = rentscan_time_now();
+    
+    /* Add the new rental */
+    int slot = rental_store_add(item_id, user_id, start_time, duration);
+    if (slot == -EEXIST) {
         LOG_WRN("Item %s is already rented", item_id);
         return -EBUSY;
     }
-    
-    /* Check if we have space for a new rental */
-    if (backend_sim.rental_count >= MAX_ACTIVE_RENTALS) {
-        LOG_ERR("Maximum active rentals reached");
-        return -ENOSPC;
+    if (slot < 0) {
+        LOG_ERR("Failed to store rental for item %s (err %d)", item_id, slot);
+        return slot;
     }
     
-    /* Add the new rental */
-    rental_info_t *rental = &backend_sim.active_rentals[backend_sim.rental_count];
-    strncpy(rental->item_id, item_id, MAX_TAG_ID_LEN);
-    rental->item_id[MAX_TAG_ID_LEN] = '\0';
-    
-    strncpy(rental->user_id, user_id, sizeof(rental->user_id) - 1);
-    rental->user_id[sizeof(rental->user_id) - 1] = '\0';
-    
-    rental->start_time = k_uptime_get_32() / 1000;  /* Convert to seconds */
-    rental->duration = duration;
-    rental->active = true;
-    
-    backend_sim.rental_count++;
+    /* Same index as the rental, so there is always room */
+    rentscan_expiry_schedule(&rental_scheduler, &rental_expiry[slot],
+                             start_time + duration);
     
     LOG_INF("Rental started for item %s by user %s for %u seconds", 
            item_id, user_id, duration);
@@ -277,7 +200,7 @@ int gateway_service_start_rental(const char *item_id, const char *user_id, uint3
         .cmd = CMD_RENTAL_START,
         .status = STATUS_RENTED,
         .tag_id_len = strlen(item_id),
-        .timestamp = rental->start_time,
+        .timestamp = start_time,
         .duration = duration,
         .payload_len = strlen(user_id)
     };
@@ -297,18 +220,20 @@ int gateway_service_end_rental(const char *item_id)
     }
     
     /* Find the rental */
-    rental_info_t *rental = find_rental_by_item_id(item_id);
-    if (!rental) {
+    rental_info_t rental;
+    int slot = rental_store_find(item_id);
+    if (slot < 0 || rental_store_get(slot, &rental)) {
         LOG_WRN("No active rental found for item %s", item_id);
         return -ENOENT;
     }
     
     /* Calculate actual duration */
-    uint32_t end_time = k_uptime_get_32() / 1000;
-    uint32_t actual_duration = end_time - rental->start_time;
+    uint32_t end_time = rentscan_time_now();
+    uint32_t actual_duration = end_time - rental.start_time;
     
-    /* Update rental status */
-    rental->active = false;
+    /* Release the slot for the next rental */
+    rentscan_expiry_cancel(&rental_scheduler, &rental_expiry[slot]);
+    rental_store_remove(slot);
     
     LOG_INF("Rental ended for item %s (duration: %u seconds)", 
            item_id, actual_duration);
@@ -337,14 +262,14 @@ int gateway_service_get_rental_status(const char *item_id, rentscan_status_t *st
     }
     
     /* Find the rental */
-    rental_info_t *rental = find_rental_by_item_id(item_id);
-    if (!rental) {
+    rental_info_t rental;
+    if (gateway_service_find_rental(item_id, &rental)) {
         *status = STATUS_AVAILABLE;
         return 0;
     }
     
     /* Check if rental has expired */
-    if (rental_is_expired(rental)) {
+    if (rental_is_expired(&rental)) {
         *status = STATUS_EXPIRED;
     } else {
         *status = STATUS_RENTED;
@@ -362,10 +287,8 @@ int gateway_service_get_active_rentals(rental_info_t *rentals, size_t max_count,
     *count = 0;
     
     /* Copy active rentals */
-    for (int i = 0; i < backend_sim.rental_count && *count < max_count; i++) {
-        if (backend_sim.active_rentals[i].active) {
-            memcpy(&rentals[*count], &backend_sim.active_rentals[i], 
-                  sizeof(rental_info_t));
+    for (int i = 0; i < RENTAL_STORE_CAPACITY && *count < max_count; i++) {
+        if (rental_store_get(i, &rentals[*count]) == 0) {
             (*count)++;
         }
     }
@@ -386,7 +309,7 @@ int gateway_service_request_status(const uint8_t *tag_id, size_t tag_id_len)
         .cmd = CMD_STATUS_REQ,
         .status = 0,
         .tag_id_len = tag_id_len,
-        .timestamp = k_uptime_get_32() / 1000,  /* Convert to seconds */
+        .timestamp = rentscan_time_now(),
         .duration = 0,
         .payload_len = 0
     };
@@ -398,20 +321,6 @@ int gateway_service_request_status(const uint8_t *tag_id, size_t tag_id_len)
     return gateway_service_process_message(&status_req);
 }
 
-bool gateway_service_is_connected(void)
-{
-    /* Update backend status with a slight chance of temporary disconnection */
-    if (backend_connected) {
-        /* If connected, there's a small random chance of temporary disconnect */
-        int random_val = sys_rand32_get() % 100;
-        if (random_val < 3) {  /* 3% chance of temporary disconnection */
-            LOG_DBG("Temporary backend connection interruption");
-            return false;
-        }
-    }
-    return backend_connected;
-}
-
 int gateway_service_set_config(const char *config_key, const char *config_value)
 {
     if (!config_key || !config_value) {
@@ -432,12 +341,12 @@ int gateway_service_set_config(const char *config_key, const char *config_value)
         if (strcmp(config_value, "1") == 0 || 
             strcmp(config_value, "true") == 0 || 
             strcmp(config_value, "yes") == 0) {
-            backend_connected = true;
+            uplink_set_enabled(true);
             LOG_INF("Backend connection manually enabled");
         } else if (strcmp(config_value, "0") == 0 || 
                   strcmp(config_value, "false") == 0 || 
                   strcmp(config_value, "no") == 0) {
-            backend_connected = false;
+            uplink_set_enabled(false);
             LOG_INF("Backend connection manually disabled");
         }
     }
@@ -457,25 +366,19 @@ int gateway_service_get_config(const char *config_key, char *config_value, size_
 
     /* Special case for requesting backend status */
     if (strcmp(config_key, "backend_status") == 0) {
-        snprintf(config_value, config_value_len, "%s", backend_connected ? "connected" : "disconnected");
+        snprintf(config_value, config_value_len, "%s", uplink_is_up() ? "connected" : "disconnected");
         return strlen(config_value);
     }
     
     /* Special case for queue stats */
     if (strcmp(config_key, "queue_count") == 0) {
-        snprintf(config_value, config_value_len, "%d", backend_sim.message_count);
+        snprintf(config_value, config_value_len, "%u", outbox_unsent());
         return strlen(config_value);
     }
     
     /* Special case for active rental count */
     if (strcmp(config_key, "rental_count") == 0) {
-        int active_count = 0;
-        for (int i = 0; i < backend_sim.rental_count; i++) {
-            if (backend_sim.active_rentals[i].active) {
-                active_count++;
-            }
-        }
-        snprintf(config_value, config_value_len, "%d", active_count);
+        snprintf(config_value, config_value_len, "%u", (unsigned int)rental_store_count());
         return strlen(config_value);
     }
     
@@ -503,10 +406,42 @@ int gateway_service_get_status(gateway_service_status_t *status)
         return -EINVAL;
     }
     
-    status->backend_connected = backend_connected;
+    status->backend_connected = uplink_is_up();
     status->error_count = backend_error_count;
-    status->queue_size = backend_sim.message_count;
-    status->rental_count = backend_sim.rental_count;
+    status->queue_size = outbox_unsent();
+    status->rental_count = rental_store_count();
+    
+    struct ingress_queue_stats ingress;
+    ingress_queue_get_stats(&ingress);
+    status->ingress_queued = ingress.queued;
+    status->ingress_high_water = ingress.high_water;
+    status->ingress_dropped = ingress.dropped;
+    status->ingress_malformed = ingress.malformed;
+    
+    struct outbox_stats outbox;
+    outbox_get_stats(&outbox);
+    status->outbox_pending = outbox.pending;
+    status->outbox_free_sectors = outbox.free_sectors;
+    status->outbox_dropped = outbox.dropped;
+    status->outbox_backpressure = outbox.backpressure;
+    
+    struct uplink_stats uplink;
+    uplink_get_stats(&uplink);
+    status->uplink_transport = uplink.transport;
+    status->uplink_frames = uplink.frames;
+    status->uplink_messages = uplink.messages;
+    status->uplink_bytes = uplink.bytes;
+    status->uplink_errors = uplink.errors;
+    status->uplink_fill_pct = uplink.fill_pct;
+    status->uplink_ratio_pct = uplink.ratio_pct;
+    status->uplink_msg_rate = uplink.msg_rate;
+    status->uplink_byte_rate = uplink.byte_rate;
+    
+    struct rentscan_expiry_stats expiry;
+    rentscan_expiry_get_stats(&rental_scheduler, &expiry);
+    status->expiry_sweeps = expiry.sweeps;
+    status->expiry_sweep_us_max = expiry.sweep_us_max;
+    status->expiry_late_ms_max = expiry.late_ms_max;
     
     return 0;
 }
@@ -519,33 +454,44 @@ int gateway_service_reset_errors(void)
 
 int gateway_service_connect_backend(void)
 {
-    backend_connected = true;
-    backend_sim.connected = true;
-    
-    /* Process any queued messages immediately */
-    if (backend_sim.message_count > 0) {
-        LOG_INF("Processing %d queued messages", backend_sim.message_count);
-        backend_sim.message_count = 0;
-    }
+    /* Resends everything the backend has not acknowledged yet */
+    uplink_set_enabled(true);
     
-    LOG_INF("Backend connection established (manual)");
+    LOG_INF("Backend uplink enabled (manual)");
     return 0;
 }
 
 int gateway_service_disconnect_backend(void)
 {
-    backend_connected = false;
-    backend_sim.connected = false;
-    LOG_WRN("Backend connection lost (manual)");
+    uplink_set_enabled(false);
+    LOG_WRN("Backend uplink disabled (manual)");
     return 0;
 }
 
 int gateway_service_get_rental(uint32_t index, rental_info_t *rental)
 {
-    if (!rental || index >= backend_sim.rental_count) {
+    if (!rental || index >= RENTAL_STORE_CAPACITY) {
         return -EINVAL;
     }
     
-    memcpy(rental, &backend_sim.active_rentals[index], sizeof(rental_info_t));
-    return 0;
+    return rental_store_get(index, rental);
+}
+
+uint32_t gateway_service_rental_capacity(void)
+{
+    return RENTAL_STORE_CAPACITY;
+}
+
+int gateway_service_find_rental(const char *item_id, rental_info_t *rental)
+{
+    if (!item_id || !rental) {
+        return -EINVAL;
+    }
+
+    int slot = rental_store_find(item_id);
+    if (slot < 0) {
+        return slot;
+    }
+
+    return rental_store_get(slot, rental);
 }
\ No newline at end of file
@@ -12,7 +12,7 @@
 /* Rental information structure */
 typedef struct {
     char item_id[MAX_TAG_ID_LEN + 1];  /* Item ID string */
-    uint32_t start_time;               /* Start time in seconds (system uptime) */
+    uint32_t start_time;               /* Start time in seconds (network time) */
     uint32_t duration;                 /* Duration in seconds */
     char user_id[16];                  /* User ID string */
     bool active;                       /* Whether rental is active */
@@ -24,6 +24,26 @@ typedef struct {
     uint32_t error_count;              /* Count of errors */
     uint32_t queue_size;               /* Size of message queue */
     uint32_t rental_count;             /* Count of active rentals */
+    uint32_t ingress_queued;           /* Received messages waiting for processing */
+    uint32_t ingress_high_water;       /* Most received messages waiting at once */
+    uint32_t ingress_dropped;          /* Received messages dropped, queue full */
+    uint32_t ingress_malformed;        /* Received data that could not be decoded */
+    uint32_t outbox_pending;           /* Logged messages not yet acknowledged */
+    uint32_t outbox_free_sectors;      /* Erased flash sectors left in the outbox */
+    uint32_t outbox_dropped;           /* Messages dropped, outbox full */
+    bool outbox_backpressure;          /* Whether new connections are paused */
+    const char *uplink_transport;      /* Backend transport in use */
+    uint32_t uplink_frames;            /* Frames delivered to the backend */
+    uint32_t uplink_messages;          /* Messages delivered to the backend */
+    uint32_t uplink_bytes;             /* Frame bytes delivered to the backend */
+    uint32_t uplink_errors;            /* Frames that failed and were resent */
+    uint8_t uplink_fill_pct;           /* Average frame fill ratio in percent */
+    uint8_t uplink_ratio_pct;          /* Frame size relative to the raw messages */
+    uint32_t uplink_msg_rate;          /* Messages per second delivered recently */
+    uint32_t uplink_byte_rate;         /* Bytes per second delivered recently */
+    uint32_t expiry_sweeps;            /* Times the rental expiry work ran */
+    uint32_t expiry_sweep_us_max;      /* Longest expiry run */
+    uint32_t expiry_late_ms_max;       /* Longest expiry delay past the deadline */
 } gateway_service_status_t;
 
 /**
@@ -36,7 +56,8 @@ int gateway_service_init(void);
 /**
  * @brief Process a received message
  * 
- * This function will forward the message to the backend
+ * The message is logged in the outbox and delivered to the backend by
+ * the uplink thread, this function never waits for the backend.
  * 
  * @param msg Pointer to RentScan message
  * @return int 0 on success, negative error code otherwise
@@ -88,12 +109,50 @@ int gateway_service_reset_errors(void);
 /**
  * @brief Get rental information by index
  * 
+ * Rentals keep their index for as long as they are active. Indices run up
+ * to gateway_service_rental_capacity(), unused ones return -ENOENT.
+ * 
  * @param index Index of rental
  * @param rental Pointer to store rental information
  * @return int 0 on success, negative error code otherwise
  */
 int gateway_service_get_rental(uint32_t index, rental_info_t *rental);
 
+/**
+ * @brief Get the number of rentals the gateway can track
+ * 
+ * @return uint32_t Number of rental indices
+ */
+uint32_t gateway_service_rental_capacity(void);
+
+/**
+ * @brief Get the active rental of an item
+ * 
+ * @param item_id Item ID string
+ * @param rental Pointer to store rental information
+ * @return int 0 on success, -ENOENT if the item is not rented
+ */
+int gateway_service_find_rental(const char *item_id, rental_info_t *rental);
+
+/**
+ * @brief Set a configuration value
+ * 
+ * @param config_key Configuration key
+ * @param config_value Configuration value
+ * @return int 0 on success, negative error code otherwise
+ */
+int gateway_service_set_config(const char *config_key, const char *config_value);
+
+/**
+ * @brief Get a configuration value
+ * 
+ * @param config_key Configuration key
+ * @param config_value Buffer to store the value
+ * @param config_value_len Size of the buffer
+ * @return int Length of the value on success, negative error code otherwise
+ */
+int gateway_service_get_config(const char *config_key, char *config_value, size_t config_value_len);
+
 /**
  * @brief Connect to backend
  * 
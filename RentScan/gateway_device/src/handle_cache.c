@@ -0,0 +1,239 @@
+/**
+ * @file handle_cache.c
+ * @brief Persistent cache of discovered RentScan GATT handles per peer
+ *
+ * A main device keeps the same attribute table across connections, so the
+ * handles found by one discovery can be reused on every reconnect. Each
+ * entry remembers the peer's Database Hash; the central compares it after
+ * reconnecting and rediscovers only when the table has changed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "handle_cache.h"
+#include "workq.h"
+
+LOG_MODULE_REGISTER(handle_cache, LOG_LEVEL_INF);
+
+#define CACHE_SIZE CONFIG_RENTSCAN_HANDLE_CACHE_SIZE
+#define CACHE_RECORD_VERSION 1
+
+#define SETTINGS_SUBTREE "gw_hc"
+#define SETTINGS_PREFIX SETTINGS_SUBTREE "/"
+
+struct cache_record {
+    uint8_t version;
+    struct handle_cache_entry entry;
+} __packed;
+
+struct cache_slot {
+    struct handle_cache_entry entry;
+    bool valid;
+    uint32_t last_used;
+};
+
+static struct cache_slot slots[CACHE_SIZE];
+static uint32_t use_clock;
+static K_MUTEX_DEFINE(cache_lock);
+
+/* Entries are stored from the Bluetooth RX thread; the flash write is
+ * deferred so discovery callbacks never wait on an erase.
+ */
+static ATOMIC_DEFINE(dirty_slots, CACHE_SIZE);
+static void save_work_handler(struct k_work *work);
+static K_WORK_DEFINE(save_work, save_work_handler);
+
+static struct cache_slot *slot_find(const bt_addr_le_t *addr)
+{
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (slots[i].valid && bt_addr_le_eq(&slots[i].entry.addr, addr)) {
+            return &slots[i];
+        }
+    }
+    return NULL;
+}
+
+static struct cache_slot *slot_victim(void)
+{
+    struct cache_slot *victim = &slots[0];
+
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (!slots[i].valid) {
+            return &slots[i];
+        }
+        if (slots[i].last_used < victim->last_used) {
+            victim = &slots[i];
+        }
+    }
+    return victim;
+}
+
+static void slot_mark_dirty(const struct cache_slot *slot)
+{
+    atomic_set_bit(dirty_slots, slot - slots);
+    k_work_submit_to_queue(&workq_persist.queue, &save_work);
+}
+
+static void save_work_handler(struct k_work *work)
+{
+    char key[SETTINGS_KEY_MAX_LEN];
+
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        struct cache_record rec = { .version = CACHE_RECORD_VERSION };
+        bool valid;
+        int err;
+
+        if (!atomic_test_and_clear_bit(dirty_slots, i)) {
+            continue;
+        }
+
+        k_mutex_lock(&cache_lock, K_FOREVER);
+        valid = slots[i].valid;
+        rec.entry = slots[i].entry;
+        k_mutex_unlock(&cache_lock);
+
+        snprintf(key, sizeof(key), SETTINGS_PREFIX "%d", i);
+
+        if (valid) {
+            err = settings_save_one(key, &rec, sizeof(rec));
+        } else {
+            err = settings_delete(key);
+        }
+
+        if (err) {
+            LOG_ERR("Failed to persist handle cache slot %d (err %d)", i, err);
+        }
+    }
+}
+
+static int cache_settings_set(const char *name, size_t len,
+                              settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+    struct cache_record rec;
+    char *end;
+
+    settings_name_next(name, &next);
+    if (next) {
+        return -ENOENT;
+    }
+
+    unsigned long idx = strtoul(name, &end, 10);
+
+    if (end == name || idx >= CACHE_SIZE) {
+        return -EINVAL;
+    }
+
+    if (len != sizeof(rec) || read_cb(cb_arg, &rec, sizeof(rec)) != sizeof(rec) ||
+        rec.version != CACHE_RECORD_VERSION) {
+        /* Stale layout, discover again on the next connection */
+        atomic_set_bit(dirty_slots, idx);
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    slots[idx].entry = rec.entry;
+    slots[idx].valid = true;
+    slots[idx].last_used = 0;
+    k_mutex_unlock(&cache_lock);
+
+    return 0;
+}
+
+static int cache_settings_commit(void)
+{
+    int count = 0;
+
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        count += slots[i].valid;
+
+        /* Delete the records that failed to restore */
+        if (atomic_test_bit(dirty_slots, i)) {
+            k_work_submit_to_queue(&workq_persist.queue, &save_work);
+        }
+    }
+
+    LOG_INF("Restored handles for %d main devices", count);
+    return 0;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(handle_cache, SETTINGS_SUBTREE, NULL,
+                               cache_settings_set, cache_settings_commit, NULL);
+
+int handle_cache_lookup(const bt_addr_le_t *addr, struct handle_cache_entry *entry)
+{
+    struct cache_slot *slot;
+    int err = -ENOENT;
+
+    if (!addr || !entry) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    slot = slot_find(addr);
+    if (slot) {
+        slot->last_used = ++use_clock;
+        *entry = slot->entry;
+        err = 0;
+    }
+    k_mutex_unlock(&cache_lock);
+
+    return err;
+}
+
+int handle_cache_store(const struct handle_cache_entry *entry)
+{
+    struct cache_slot *slot;
+
+    if (!entry || !entry->tx_handle || !entry->ccc_handle) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+
+    slot = slot_find(&entry->addr);
+    if (!slot) {
+        slot = slot_victim();
+    }
+
+    /* Rewriting an identical entry would only wear the flash */
+    if (!slot->valid || memcmp(&slot->entry, entry, sizeof(*entry)) != 0) {
+        slot->entry = *entry;
+        slot->valid = true;
+        slot_mark_dirty(slot);
+    }
+    slot->last_used = ++use_clock;
+
+    k_mutex_unlock(&cache_lock);
+    return 0;
+}
+
+void handle_cache_invalidate(const bt_addr_le_t *addr)
+{
+    struct cache_slot *slot;
+
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    slot = slot_find(addr);
+    if (slot) {
+        slot->valid = false;
+        slot_mark_dirty(slot);
+    }
+    k_mutex_unlock(&cache_lock);
+}
+
+void handle_cache_clear(void)
+{
+    k_mutex_lock(&cache_lock, K_FOREVER);
+    for (int i = 0; i < CACHE_SIZE; i++) {
+        if (slots[i].valid) {
+            slots[i].valid = false;
+            slot_mark_dirty(&slots[i]);
+        }
+    }
+    k_mutex_unlock(&cache_lock);
+}
@@ -0,0 +1,60 @@
+/**
+ * @file handle_cache.h
+ * @brief Persistent cache of discovered RentScan GATT handles per peer
+ */
+
+#ifndef HANDLE_CACHE_H
+#define HANDLE_CACHE_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <zephyr/bluetooth/addr.h>
+
+/** Size of the peer's GATT Database Hash */
+#define HANDLE_CACHE_HASH_LEN 16
+
+/**
+ * @brief Handles of the RentScan service on one main device
+ */
+struct handle_cache_entry {
+    bt_addr_le_t addr;                      /**< Peer identity address */
+    uint16_t rx_handle;                     /**< RX characteristic value handle */
+    uint16_t tx_handle;                     /**< TX characteristic value handle */
+    uint16_t ccc_handle;                    /**< TX CCC descriptor handle */
+    uint8_t db_hash[HANDLE_CACHE_HASH_LEN]; /**< Database Hash the handles belong to */
+    bool has_hash;                          /**< Whether the peer exposed a Database Hash */
+};
+
+/**
+ * @brief Look up the cached handles of a peer
+ * 
+ * @param addr Peer address
+ * @param entry Pointer to store the cached handles
+ * @return int 0 on success, -ENOENT if the peer is not cached
+ */
+int handle_cache_lookup(const bt_addr_le_t *addr, struct handle_cache_entry *entry);
+
+/**
+ * @brief Store the handles of a peer
+ * 
+ * Replaces the least recently used entry when the cache is full. The
+ * entry is written to flash from the system workqueue.
+ * 
+ * @param entry Handles to store
+ * @return int 0 on success, negative error code otherwise
+ */
+int handle_cache_store(const struct handle_cache_entry *entry);
+
+/**
+ * @brief Drop the cached handles of a peer
+ * 
+ * @param addr Peer address
+ */
+void handle_cache_invalidate(const bt_addr_le_t *addr);
+
+/**
+ * @brief Drop every cached entry
+ */
+void handle_cache_clear(void);
+
+#endif /* HANDLE_CACHE_H */
\ No newline at end of file
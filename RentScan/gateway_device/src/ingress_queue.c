@@ -0,0 +1,145 @@
+/**
+ * @file ingress_queue.c
+ * @brief Queue of messages received from main devices, drained by a dedicated thread
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "ingress_queue.h"
+#include "latency_stats.h"
+#include "metrics.h"
+
+LOG_MODULE_REGISTER(ingress_queue, LOG_LEVEL_INF);
+
+/* One encoded message as received, decoded only when it is processed */
+struct ingress_record {
+    uint32_t rx_cycles;
+    uint8_t link;
+    uint8_t len;
+    uint8_t data[RENTSCAN_WIRE_MSG_MAX_LEN];
+};
+
+BUILD_ASSERT(RENTSCAN_WIRE_MSG_MAX_LEN <= UINT8_MAX, "Record length must fit in a byte");
+
+K_MSGQ_DEFINE(ingress_msgq, sizeof(struct ingress_record),
+              CONFIG_RENTSCAN_INGRESS_QUEUE_DEPTH, 1);
+
+K_THREAD_STACK_DEFINE(ingress_stack, CONFIG_RENTSCAN_INGRESS_THREAD_STACK_SIZE);
+static struct k_thread ingress_thread;
+
+static ingress_handler_t msg_handler;
+
+static void process_record(const struct ingress_record *rec)
+{
+    rentscan_msg_t msg;
+    int err = rentscan_msg_decode(&msg, rec->data, rec->len);
+
+    if (err < 0) {
+        /* rentscan_msg_frame_len() only checked the header */
+        LOG_WRN("Dropping undecodable message from link %u (err %d)", rec->link, err);
+        metrics_inc(METRIC_MSG_MALFORMED);
+        return;
+    }
+
+    uint32_t now = k_cycle_get_32();
+
+    latency_stats_record(LATENCY_RX_TO_PROCESS, rec->rx_cycles, now);
+    latency_stats_track(msg.corr_id, rec->rx_cycles, now, msg.latency_us);
+
+    msg_handler(rec->link, &msg);
+}
+
+static void ingress_thread_fn(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    struct ingress_record rec;
+
+    for (;;) {
+        /* Sleep until something arrives, then take what is queued in one go */
+        k_msgq_get(&ingress_msgq, &rec, K_FOREVER);
+        process_record(&rec);
+
+        for (int i = 1; i < CONFIG_RENTSCAN_INGRESS_BATCH_SIZE; i++) {
+            if (k_msgq_get(&ingress_msgq, &rec, K_NO_WAIT)) {
+                break;
+            }
+            process_record(&rec);
+        }
+    }
+}
+
+int ingress_queue_init(ingress_handler_t handler)
+{
+    if (!handler) {
+        return -EINVAL;
+    }
+
+    msg_handler = handler;
+
+    k_thread_create(&ingress_thread, ingress_stack,
+                    K_THREAD_STACK_SIZEOF(ingress_stack),
+                    ingress_thread_fn, NULL, NULL, NULL,
+                    CONFIG_RENTSCAN_INGRESS_THREAD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&ingress_thread, "ingress");
+
+    LOG_INF("Ingress queue initialized (depth %d)", CONFIG_RENTSCAN_INGRESS_QUEUE_DEPTH);
+    return 0;
+}
+
+int ingress_queue_put(uint8_t link, const uint8_t *data, uint16_t len)
+{
+    uint32_t rx_cycles = k_cycle_get_32();
+    int result = 0;
+
+    if (!data) {
+        return -EINVAL;
+    }
+
+    while (len > 0) {
+        int frame_len = rentscan_msg_frame_len(data, len);
+
+        if (frame_len < 0 || frame_len > RENTSCAN_WIRE_MSG_MAX_LEN) {
+            LOG_WRN("Dropping malformed data from link %u (%u bytes left)", link, len);
+            metrics_inc(METRIC_MSG_MALFORMED);
+            return -EBADMSG;
+        }
+
+        struct ingress_record rec = {
+            .rx_cycles = rx_cycles,
+            .link = link,
+            .len = frame_len,
+        };
+
+        memcpy(rec.data, data, frame_len);
+        metrics_inc(METRIC_MSG_RX);
+
+        if (k_msgq_put(&ingress_msgq, &rec, K_NO_WAIT)) {
+            metrics_inc(METRIC_INGRESS_DROPPED);
+            result = -ENOMEM;
+        } else {
+            metrics_peak(METRIC_INGRESS_HIGH_WATER, k_msgq_num_used_get(&ingress_msgq));
+        }
+
+        data += frame_len;
+        len -= frame_len;
+    }
+
+    if (result) {
+        LOG_WRN("Ingress queue full, dropped messages from link %u (%ld total)",
+                link, (long)metrics_get(METRIC_INGRESS_DROPPED));
+    }
+
+    return result;
+}
+
+void ingress_queue_get_stats(struct ingress_queue_stats *stats)
+{
+    stats->queued = k_msgq_num_used_get(&ingress_msgq);
+    stats->high_water = metrics_get(METRIC_INGRESS_HIGH_WATER);
+    stats->dropped = metrics_get(METRIC_INGRESS_DROPPED);
+    stats->malformed = metrics_get(METRIC_MSG_MALFORMED);
+}
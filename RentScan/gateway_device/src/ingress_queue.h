@@ -0,0 +1,59 @@
+/**
+ * @file ingress_queue.h
+ * @brief Queue of messages received from main devices, drained by a dedicated thread
+ */
+
+#ifndef INGRESS_QUEUE_H
+#define INGRESS_QUEUE_H
+
+#include <zephyr/types.h>
+#include "../../common/include/rentscan_protocol.h"
+
+/**
+ * @brief Handler for a queued message, called from the ingress thread
+ *
+ * @param link Link the message arrived on
+ * @param msg Decoded message
+ */
+typedef void (*ingress_handler_t)(uint8_t link, const rentscan_msg_t *msg);
+
+/**
+ * @brief Ingress queue statistics
+ */
+struct ingress_queue_stats {
+    uint32_t queued;      /**< Messages currently waiting */
+    uint32_t high_water;  /**< Largest number of messages waiting at once */
+    uint32_t dropped;     /**< Messages dropped because the queue was full */
+    uint32_t malformed;   /**< Notifications with undecodable data */
+};
+
+/**
+ * @brief Initialize the queue and start the ingress thread
+ *
+ * @param handler Handler for each decoded message
+ * @return int 0 on success, negative error code otherwise
+ */
+int ingress_queue_init(ingress_handler_t handler);
+
+/**
+ * @brief Queue the encoded messages of one notification
+ *
+ * @p data may hold several messages back to back. Each one is queued in
+ * encoded form and decoded by the ingress thread.
+ *
+ * @param link Link the data arrived on
+ * @param data Encoded message data
+ * @param len Length of @p data
+ * @return int 0 on success, -ENOMEM if messages were dropped, -EBADMSG if
+ *             the data could not be split into messages
+ */
+int ingress_queue_put(uint8_t link, const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Get ingress queue statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void ingress_queue_get_stats(struct ingress_queue_stats *stats);
+
+#endif /* INGRESS_QUEUE_H */
\ No newline at end of file
@@ -0,0 +1,194 @@
+/**
+ * @file latency_stats.c
+ * @brief Tap latency histograms of the gateway
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "latency_stats.h"
+#include "ble_central.h"
+
+LOG_MODULE_REGISTER(latency_stats, LOG_LEVEL_INF);
+
+#define MAX_TRACKED CONFIG_RENTSCAN_LATENCY_TRACKED
+
+struct tracked_tap {
+    uint32_t corr_id;
+    uint32_t rx_cycles;
+    uint32_t process_cycles;
+    uint32_t main_us;
+};
+
+static const char *const stage_names[] = {
+    [LATENCY_RX_TO_PROCESS] = "rx->process",
+    [LATENCY_PROCESS_TO_UPLINK] = "process->uplink",
+    [LATENCY_UPLINK_TO_ACK] = "uplink->ack",
+    [LATENCY_RX_TO_ACK] = "rx->ack",
+    [LATENCY_END_TO_END] = "tap->ack",
+};
+
+BUILD_ASSERT(ARRAY_SIZE(stage_names) == LATENCY_STAGE_COUNT, "Every stage needs a name");
+
+static struct rentscan_latency_hist hists[LATENCY_STAGE_COUNT];
+static struct k_spinlock hist_lock;
+
+/* Taps in flight, replaced round robin */
+static struct tracked_tap tracked[MAX_TRACKED];
+static size_t tracked_next;
+static struct k_spinlock tracked_lock;
+
+/* Remote query in progress */
+static K_MUTEX_DEFINE(query_lock);
+static K_SEM_DEFINE(query_sem, 0, 1);
+static struct rentscan_latency_hist *query_hists;
+static uint8_t query_link;
+static struct k_spinlock query_state_lock;
+
+static uint32_t cycles_to_us(uint32_t start, uint32_t end)
+{
+    return k_cyc_to_us_floor32(end - start);
+}
+
+static void record_us(enum latency_stage stage, uint32_t us)
+{
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+    rentscan_latency_record(&hists[stage], us);
+    k_spin_unlock(&hist_lock, key);
+}
+
+const char *latency_stats_stage_name(enum latency_stage stage)
+{
+    return stage < LATENCY_STAGE_COUNT ? stage_names[stage] : "unknown";
+}
+
+void latency_stats_record(enum latency_stage stage, uint32_t start, uint32_t end)
+{
+    if (stage >= LATENCY_STAGE_COUNT) {
+        return;
+    }
+    record_us(stage, cycles_to_us(start, end));
+}
+
+void latency_stats_track(uint32_t corr_id, uint32_t rx_cycles, uint32_t process_cycles,
+                         uint32_t main_us)
+{
+    if (!corr_id) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&tracked_lock);
+
+    tracked[tracked_next] = (struct tracked_tap) {
+        .corr_id = corr_id,
+        .rx_cycles = rx_cycles,
+        .process_cycles = process_cycles,
+        .main_us = main_us,
+    };
+    tracked_next = (tracked_next + 1) % MAX_TRACKED;
+
+    k_spin_unlock(&tracked_lock, key);
+}
+
+void latency_stats_delivered(const uint32_t *corr_ids, size_t count, uint32_t sent_cycles)
+{
+    uint32_t now = k_cycle_get_32();
+
+    for (size_t i = 0; i < count; i++) {
+        struct tracked_tap tap = { 0 };
+
+        k_spinlock_key_t key = k_spin_lock(&tracked_lock);
+        for (int j = 0; j < MAX_TRACKED; j++) {
+            if (tracked[j].corr_id == corr_ids[i]) {
+                tap = tracked[j];
+                tracked[j].corr_id = 0;
+                break;
+            }
+        }
+        k_spin_unlock(&tracked_lock, key);
+
+        /* Replayed after a reboot, or pushed out by newer taps */
+        if (!tap.corr_id) {
+            continue;
+        }
+
+        uint32_t rx_us = cycles_to_us(tap.rx_cycles, now);
+
+        record_us(LATENCY_PROCESS_TO_UPLINK, cycles_to_us(tap.process_cycles, sent_cycles));
+        record_us(LATENCY_RX_TO_ACK, rx_us);
+        record_us(LATENCY_END_TO_END, tap.main_us + rx_us);
+    }
+}
+
+int latency_stats_get(enum latency_stage stage, struct rentscan_latency_hist *hist)
+{
+    if (stage >= LATENCY_STAGE_COUNT || !hist) {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+    *hist = hists[stage];
+    k_spin_unlock(&hist_lock, key);
+    return 0;
+}
+
+int latency_stats_query(uint8_t link, struct rentscan_latency_hist *hists_out, k_timeout_t timeout)
+{
+    rentscan_msg_t req = {
+        .cmd = CMD_STATS_REQ,
+    };
+    k_spinlock_key_t key;
+    int err;
+
+    if (!hists_out || link >= BLE_CENTRAL_MAX_LINKS) {
+        return -EINVAL;
+    }
+
+    if (k_mutex_lock(&query_lock, K_NO_WAIT)) {
+        return -EBUSY;
+    }
+
+    memset(hists_out, 0, RENTSCAN_LATENCY_MAIN_STAGES * sizeof(*hists_out));
+    k_sem_reset(&query_sem);
+
+    key = k_spin_lock(&query_state_lock);
+    query_hists = hists_out;
+    query_link = link;
+    k_spin_unlock(&query_state_lock, key);
+
+    err = ble_central_send_message(link, &req);
+    if (!err && k_sem_take(&query_sem, timeout)) {
+        err = -EAGAIN;
+    }
+
+    key = k_spin_lock(&query_state_lock);
+    query_hists = NULL;
+    k_spin_unlock(&query_state_lock, key);
+
+    k_mutex_unlock(&query_lock);
+    return err;
+}
+
+void latency_stats_process(uint8_t link, const rentscan_msg_t *msg)
+{
+    uint8_t stage = msg->status & ~RENTSCAN_LATENCY_LAST;
+    struct rentscan_latency_hist hist;
+
+    if (stage >= RENTSCAN_LATENCY_MAIN_STAGES ||
+        rentscan_latency_decode(&hist, msg->payload, msg->payload_len)) {
+        LOG_WRN("Malformed latency statistics from link %u", link);
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&query_state_lock);
+
+    if (query_hists && query_link == link) {
+        query_hists[stage] = hist;
+        if (msg->status & RENTSCAN_LATENCY_LAST) {
+            k_sem_give(&query_sem);
+        }
+    }
+
+    k_spin_unlock(&query_state_lock, key);
+}
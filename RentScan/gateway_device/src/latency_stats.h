@@ -0,0 +1,102 @@
+/**
+ * @file latency_stats.h
+ * @brief Tap latency histograms of the gateway
+ *
+ * Taps are followed by their correlation ID from the notification that
+ * delivered them until the uplink frame carrying them is acknowledged.
+ * The end to end figure adds the time the main device reported spending
+ * on the tap; the BLE connection interval in between is not included.
+ */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <zephyr/types.h>
+#include <zephyr/kernel.h>
+#include "../../common/include/rentscan_latency.h"
+
+/** Stages measured on the gateway */
+enum latency_stage {
+    LATENCY_RX_TO_PROCESS,      /**< Notification until the ingress thread takes it */
+    LATENCY_PROCESS_TO_UPLINK,  /**< Ingress processing until the frame is sent */
+    LATENCY_UPLINK_TO_ACK,      /**< Frame sent until the transport completes it */
+    LATENCY_RX_TO_ACK,          /**< Notification until the backend has the tap */
+    LATENCY_END_TO_END,         /**< NFC read until the backend has the tap */
+    LATENCY_STAGE_COUNT,
+};
+
+/**
+ * @brief Get the name of a stage
+ *
+ * @param stage Stage
+ * @return const char* Name for display
+ */
+const char *latency_stats_stage_name(enum latency_stage stage);
+
+/**
+ * @brief Record the latency of one stage
+ *
+ * Safe to call from any thread.
+ *
+ * @param stage Stage measured
+ * @param start k_cycle_get_32() when the stage started
+ * @param end k_cycle_get_32() when the stage ended
+ */
+void latency_stats_record(enum latency_stage stage, uint32_t start, uint32_t end);
+
+/**
+ * @brief Start following a tap through the gateway
+ *
+ * The oldest tap is forgotten when too many are in flight.
+ *
+ * @param corr_id Correlation ID of the tap
+ * @param rx_cycles k_cycle_get_32() when the notification arrived
+ * @param process_cycles k_cycle_get_32() when the ingress thread took it
+ * @param main_us Time the main device spent on the tap
+ */
+void latency_stats_track(uint32_t corr_id, uint32_t rx_cycles, uint32_t process_cycles,
+                         uint32_t main_us);
+
+/**
+ * @brief Finish following the taps of an acknowledged uplink frame
+ *
+ * @param corr_ids Correlation IDs of the taps in the frame
+ * @param count Number of IDs
+ * @param sent_cycles k_cycle_get_32() when the frame was handed to the transport
+ */
+void latency_stats_delivered(const uint32_t *corr_ids, size_t count, uint32_t sent_cycles);
+
+/**
+ * @brief Get a histogram of the gateway
+ *
+ * @param stage Stage
+ * @param hist Pointer to store the histogram
+ * @return int 0 on success, -EINVAL for an unknown stage
+ */
+int latency_stats_get(enum latency_stage stage, struct rentscan_latency_hist *hist);
+
+/**
+ * @brief Fetch the histograms of a main device
+ *
+ * Sends CMD_STATS_REQ and waits for the last CMD_STATS_RESP. Only one
+ * query runs at a time.
+ *
+ * @param link Link of the main device
+ * @param hists Array of RENTSCAN_LATENCY_MAIN_STAGES histograms to fill
+ * @param timeout Time to wait for the answer
+ * @return int 0 on success, -EBUSY if another query is running,
+ *             -EAGAIN on timeout, negative error code otherwise
+ */
+int latency_stats_query(uint8_t link, struct rentscan_latency_hist *hists, k_timeout_t timeout);
+
+/**
+ * @brief Handle a CMD_STATS_RESP from a main device
+ *
+ * Called from the ingress thread.
+ *
+ * @param link Link the message arrived on
+ * @param msg Received message
+ */
+void latency_stats_process(uint8_t link, const rentscan_msg_t *msg);
+
+#endif /* LATENCY_STATS_H */
\ No newline at end of file
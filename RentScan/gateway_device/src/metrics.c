@@ -0,0 +1,161 @@
+/**
+ * @file metrics.c
+ * @brief Runtime counters of the gateway
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "metrics.h"
+#include "ble_central.h"
+#include "gateway_service.h"
+#include "workq.h"
+#include "../../common/include/rentscan_latency.h"
+#include "../../common/include/rentscan_time.h"
+
+LOG_MODULE_REGISTER(metrics, LOG_LEVEL_INF);
+
+const struct rentscan_metric_desc metrics_desc[METRIC_COUNT] = {
+    GATEWAY_METRICS(RENTSCAN_METRIC_DESC)
+};
+
+atomic_t metrics_values[METRIC_COUNT];
+
+/* Remote query in progress */
+static K_MUTEX_DEFINE(query_lock);
+static K_SEM_DEFINE(query_sem, 0, 1);
+static uint32_t *query_values;
+static uint8_t query_link;
+static struct k_spinlock query_state_lock;
+
+#if CONFIG_RENTSCAN_METRICS_PUSH_INTERVAL > 0
+static void push_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(push_work, push_work_handler);
+
+/* Log the metrics for the backend, they travel like any other message */
+static void push_work_handler(struct k_work *work)
+{
+    uint32_t values[METRIC_COUNT];
+    size_t next = 0;
+
+    metrics_snapshot(values);
+
+    do {
+        rentscan_msg_t msg = {
+            .cmd = CMD_STATS_RESP,
+            .status = RENTSCAN_STATS_METRICS,
+            .timestamp = rentscan_time_now(),
+        };
+
+        int len = rentscan_metrics_encode(values, ARRAY_SIZE(values), &next,
+                                          msg.payload, sizeof(msg.payload));
+        if (len < 0) {
+            break;
+        }
+        msg.payload_len = len;
+
+        if (next >= ARRAY_SIZE(values)) {
+            msg.status |= RENTSCAN_LATENCY_LAST;
+        }
+
+        if (gateway_service_process_message(&msg)) {
+            LOG_WRN("Failed to log metrics for the backend");
+            break;
+        }
+    } while (next < ARRAY_SIZE(values));
+
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &push_work,
+                              K_SECONDS(CONFIG_RENTSCAN_METRICS_PUSH_INTERVAL));
+}
+#endif
+
+void metrics_init(void)
+{
+#if CONFIG_RENTSCAN_METRICS_PUSH_INTERVAL > 0
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &push_work,
+                              K_SECONDS(CONFIG_RENTSCAN_METRICS_PUSH_INTERVAL));
+    LOG_INF("Pushing metrics every %d s", CONFIG_RENTSCAN_METRICS_PUSH_INTERVAL);
+#endif
+}
+
+void metrics_snapshot(uint32_t *values)
+{
+    gateway_service_status_t status;
+
+    /* Kept by their own modules, copied in so the dump is complete */
+    gateway_service_get_status(&status);
+    atomic_set(&metrics_values[METRIC_INGRESS_QUEUED], status.ingress_queued);
+    atomic_set(&metrics_values[METRIC_BLE_LINKS], ble_central_link_count());
+    atomic_set(&metrics_values[METRIC_OUTBOX_PENDING], status.outbox_pending);
+    atomic_set(&metrics_values[METRIC_OUTBOX_FREE_SECTORS], status.outbox_free_sectors);
+    atomic_set(&metrics_values[METRIC_UPLINK_FRAMES], status.uplink_frames);
+    atomic_set(&metrics_values[METRIC_UPLINK_MESSAGES], status.uplink_messages);
+    atomic_set(&metrics_values[METRIC_UPLINK_BYTES], status.uplink_bytes);
+    atomic_set(&metrics_values[METRIC_UPLINK_ERRORS], status.uplink_errors);
+    atomic_set(&metrics_values[METRIC_RENTALS], status.rental_count);
+    atomic_set(&metrics_values[METRIC_EXPIRY_SWEEPS], status.expiry_sweeps);
+    atomic_set(&metrics_values[METRIC_EXPIRY_SWEEP_US_MAX], status.expiry_sweep_us_max);
+    atomic_set(&metrics_values[METRIC_EXPIRY_LATE_MS_MAX], status.expiry_late_ms_max);
+
+    for (int i = 0; i < METRIC_COUNT; i++) {
+        values[i] = atomic_get(&metrics_values[i]);
+    }
+}
+
+int metrics_query(uint8_t link, uint32_t *values, k_timeout_t timeout)
+{
+    rentscan_msg_t req = {
+        .cmd = CMD_STATS_REQ,
+        .status = RENTSCAN_STATS_METRICS,
+    };
+    k_spinlock_key_t key;
+    int err;
+
+    if (!values || link >= BLE_CENTRAL_MAX_LINKS) {
+        return -EINVAL;
+    }
+
+    if (k_mutex_lock(&query_lock, K_NO_WAIT)) {
+        return -EBUSY;
+    }
+
+    memset(values, 0, RENTSCAN_MAIN_METRIC_COUNT * sizeof(*values));
+    k_sem_reset(&query_sem);
+
+    key = k_spin_lock(&query_state_lock);
+    query_values = values;
+    query_link = link;
+    k_spin_unlock(&query_state_lock, key);
+
+    err = ble_central_send_message(link, &req);
+    if (!err && k_sem_take(&query_sem, timeout)) {
+        err = -EAGAIN;
+    }
+
+    key = k_spin_lock(&query_state_lock);
+    query_values = NULL;
+    k_spin_unlock(&query_state_lock, key);
+
+    k_mutex_unlock(&query_lock);
+    return err;
+}
+
+void metrics_process(uint8_t link, const rentscan_msg_t *msg)
+{
+    int err = 0;
+    k_spinlock_key_t key = k_spin_lock(&query_state_lock);
+
+    if (query_values && query_link == link) {
+        err = rentscan_metrics_decode(query_values, RENTSCAN_MAIN_METRIC_COUNT,
+                                      msg->payload, msg->payload_len);
+        if (!err && (msg->status & RENTSCAN_LATENCY_LAST)) {
+            k_sem_give(&query_sem);
+        }
+    }
+
+    k_spin_unlock(&query_state_lock, key);
+
+    if (err) {
+        LOG_WRN("Malformed metrics from link %u", link);
+    }
+}
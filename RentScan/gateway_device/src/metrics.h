@@ -0,0 +1,161 @@
+/**
+ * @file metrics.h
+ * @brief Runtime counters of the gateway
+ *
+ * Hot path figures are updated in place with single atomic operations.
+ * Figures other modules already keep are copied in when the metrics are
+ * read. When CONFIG_RENTSCAN_METRICS_PUSH_INTERVAL is set the metrics are
+ * also logged for the backend as CMD_STATS_RESP messages carrying
+ * RENTSCAN_STATS_METRICS, encoded as in rentscan_metrics.h with the IDs
+ * below.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <zephyr/types.h>
+#include <zephyr/kernel.h>
+#include "../../common/include/rentscan_protocol.h"
+#include "../../common/include/rentscan_metrics.h"
+
+/**
+ * @brief Metrics of the gateway
+ *
+ * New metrics go at the end, the position is the ID on the uplink.
+ */
+#define GATEWAY_METRICS(X)                                                           \
+    X(MSG_RX, msg_rx, COUNTER)                         /* From main devices */       \
+    X(MSG_MALFORMED, msg_malformed, COUNTER)           /* Undecodable */             \
+    X(MSG_FAILED, msg_failed, COUNTER)                 /* Not logged */              \
+    X(INGRESS_DROPPED, ingress_dropped, COUNTER)       /* Ingress queue full */      \
+    X(INGRESS_QUEUED, ingress_queued, GAUGE)                                         \
+    X(INGRESS_HIGH_WATER, ingress_high_water, PEAK)                                  \
+    X(NOTIFY_FAILED, notify_failed, COUNTER)           /* Reply not sent */          \
+    X(BLE_TX, ble_tx, COUNTER)                         /* Writes to main devices */  \
+    X(BLE_TX_NO_BUF, ble_tx_no_buf, COUNTER)           /* Out of TX buffers */       \
+    X(BLE_TX_FAILED, ble_tx_failed, COUNTER)           /* Other write errors */      \
+    X(BLE_LINKS, ble_links, GAUGE)                                                   \
+    X(BLE_CONNECTS, ble_connects, COUNTER)                                           \
+    X(BLE_CONNECT_FAILED, ble_connect_failed, COUNTER)                               \
+    X(BLE_DISCONNECTS, ble_disconnects, COUNTER)                                     \
+    X(BLE_DISC_TIMEOUT, ble_disc_timeout, COUNTER)     /* Supervision timeout */     \
+    X(BLE_DISC_REMOTE, ble_disc_remote, COUNTER)       /* Main device closed it */   \
+    X(BLE_DISC_LOCAL, ble_disc_local, COUNTER)         /* We closed it */            \
+    X(BLE_DISC_OTHER, ble_disc_other, COUNTER)                                       \
+    X(OUTBOX_APPENDED, outbox_appended, COUNTER)                                     \
+    X(OUTBOX_DROPPED, outbox_dropped, COUNTER)         /* Outbox full */             \
+    X(OUTBOX_PENDING, outbox_pending, GAUGE)           /* Not yet acknowledged */    \
+    X(OUTBOX_FREE_SECTORS, outbox_free_sectors, GAUGE)                               \
+    X(FLASH_WRITES, flash_writes, COUNTER)             /* Outbox entries and acks */ \
+    X(FLASH_ERRORS, flash_errors, COUNTER)                                           \
+    X(UPLINK_FRAMES, uplink_frames, COUNTER)                                         \
+    X(UPLINK_MESSAGES, uplink_messages, COUNTER)                                     \
+    X(UPLINK_BYTES, uplink_bytes, COUNTER)                                           \
+    X(UPLINK_ERRORS, uplink_errors, COUNTER)           /* Frames resent */           \
+    X(RENTALS, rentals, GAUGE)                                                       \
+    X(RENTAL_UPDATE_FAILED, rental_update_failed, COUNTER) /* Tap not applied */     \
+    X(EXPIRY_SWEEPS, expiry_sweeps, COUNTER)                                         \
+    X(EXPIRY_SWEEP_US_MAX, expiry_sweep_us_max, PEAK)                                \
+    X(EXPIRY_LATE_MS_MAX, expiry_late_ms_max, PEAK)                                  \
+    X(DEDUP_HITS, dedup_hits, COUNTER)                 /* Repeated scans ignored */  \
+    X(DEDUP_MISSES, dedup_misses, COUNTER)                                           \
+    X(TIME_REQS, time_reqs, COUNTER)                   /* Clock requests answered */
+
+#define GATEWAY_METRIC_ID(id, name, kind) METRIC_##id,
+
+/** Metric IDs of the gateway */
+enum gateway_metric {
+    GATEWAY_METRICS(GATEWAY_METRIC_ID)
+    METRIC_COUNT,
+};
+
+#undef GATEWAY_METRIC_ID
+
+/** Descriptors of the gateway metrics, indexed by ID */
+extern const struct rentscan_metric_desc metrics_desc[METRIC_COUNT];
+
+/** Metric storage, use the helpers below */
+extern atomic_t metrics_values[METRIC_COUNT];
+
+/**
+ * @brief Count one event
+ *
+ * @param id Metric to update
+ */
+static inline void metrics_inc(enum gateway_metric id)
+{
+    rentscan_metric_inc(&metrics_values[id]);
+}
+
+/**
+ * @brief Count several events
+ *
+ * @param id Metric to update
+ * @param val Number of events
+ */
+static inline void metrics_add(enum gateway_metric id, uint32_t val)
+{
+    rentscan_metric_add(&metrics_values[id], val);
+}
+
+/**
+ * @brief Record a value for a peak metric
+ *
+ * @param id Metric to update
+ * @param val Value seen
+ */
+static inline void metrics_peak(enum gateway_metric id, uint32_t val)
+{
+    rentscan_metric_peak(&metrics_values[id], val);
+}
+
+/**
+ * @brief Get the current value of one metric
+ *
+ * @param id Metric to read
+ * @return uint32_t Value, not sampled
+ */
+static inline uint32_t metrics_get(enum gateway_metric id)
+{
+    return atomic_get(&metrics_values[id]);
+}
+
+/**
+ * @brief Start pushing the metrics to the backend, if configured
+ */
+void metrics_init(void);
+
+/**
+ * @brief Read every metric
+ *
+ * Gauges and figures kept by other modules are sampled first.
+ *
+ * @param values Array of METRIC_COUNT values to fill
+ */
+void metrics_snapshot(uint32_t *values);
+
+/**
+ * @brief Fetch the metrics of a main device
+ *
+ * Sends CMD_STATS_REQ with RENTSCAN_STATS_METRICS and waits for the last
+ * CMD_STATS_RESP. Only one query runs at a time.
+ *
+ * @param link Link of the main device
+ * @param values Array of RENTSCAN_MAIN_METRIC_COUNT values to fill
+ * @param timeout Time to wait for the answer
+ * @return int 0 on success, -EBUSY if another query is running,
+ *             -EAGAIN on timeout, negative error code otherwise
+ */
+int metrics_query(uint8_t link, uint32_t *values, k_timeout_t timeout);
+
+/**
+ * @brief Handle a metrics CMD_STATS_RESP from a main device
+ *
+ * Called from the ingress thread.
+ *
+ * @param link Link the message arrived on
+ * @param msg Received message
+ */
+void metrics_process(uint8_t link, const rentscan_msg_t *msg);
+
+#endif /* METRICS_H */
\ No newline at end of file
@@ -0,0 +1,368 @@
+/**
+ * @file outbox.c
+ * @brief Flash-backed store-and-forward log of messages bound for the backend
+ *
+ * Messages are appended to a flash circular buffer on the outbox partition
+ * as [seq][encoded message]. The acknowledged sequence number is kept in
+ * settings; sectors holding only acknowledged messages are erased so the
+ * log never loses data that the backend has not confirmed.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/fs/fcb.h>
+#include <zephyr/storage/flash_map.h>
+#include <zephyr/settings/settings.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include "outbox.h"
+#include "metrics.h"
+
+LOG_MODULE_REGISTER(outbox, LOG_LEVEL_INF);
+
+#define OUTBOX_PARTITION_ID FIXED_PARTITION_ID(outbox_partition)
+#define OUTBOX_MAGIC 0x52534f42 /* "RSOB" */
+#define OUTBOX_VERSION 1
+
+#define OUTBOX_SETTINGS_SUBTREE "outbox"
+#define OUTBOX_ACK_KEY OUTBOX_SETTINGS_SUBTREE "/ack"
+
+#define RECORD_SEQ_LEN sizeof(uint32_t)
+#define RECORD_MAX_LEN (RECORD_SEQ_LEN + RENTSCAN_WIRE_MSG_MAX_LEN)
+
+static struct flash_sector sectors[CONFIG_RENTSCAN_OUTBOX_MAX_SECTORS];
+/* Highest sequence number stored in each sector, 0 if the sector is empty */
+static uint32_t sector_last_seq[CONFIG_RENTSCAN_OUTBOX_MAX_SECTORS];
+static struct fcb fcb;
+
+static K_MUTEX_DEFINE(outbox_lock);
+static uint32_t next_seq = 1;
+static uint32_t acked_seq;
+static uint32_t sent_seq;
+/* Position of the last sent entry, fe_sector is NULL to rescan from the start */
+static struct fcb_entry sent_loc;
+static bool backpressure;
+static outbox_backpressure_cb_t backpressure_callback;
+
+static inline int sector_idx(const struct flash_sector *sector)
+{
+    return sector - sectors;
+}
+
+static int read_record(const struct fcb_entry *loc, uint8_t *buf, size_t *len)
+{
+    if (loc->fe_data_len < RECORD_SEQ_LEN + RENTSCAN_WIRE_MSG_MIN_LEN ||
+        loc->fe_data_len > RECORD_MAX_LEN) {
+        return -EBADMSG;
+    }
+
+    *len = loc->fe_data_len;
+    return flash_area_read(fcb.fap, FCB_ENTRY_FA_DATA_OFF(*loc), buf, *len);
+}
+
+static void update_backpressure_locked(void)
+{
+    int free_cnt = fcb_free_sector_cnt(&fcb);
+    bool active = backpressure;
+
+    /* Hysteresis keeps the BLE side from flapping around the threshold */
+    if (!backpressure && free_cnt <= CONFIG_RENTSCAN_OUTBOX_BACKPRESSURE_SECTORS) {
+        active = true;
+    } else if (backpressure && free_cnt > CONFIG_RENTSCAN_OUTBOX_BACKPRESSURE_SECTORS + 1) {
+        active = false;
+    }
+
+    if (active != backpressure) {
+        backpressure = active;
+        LOG_WRN("Outbox backpressure %s (%d free sectors)", active ? "on" : "off", free_cnt);
+        if (backpressure_callback) {
+            backpressure_callback(active);
+        }
+    }
+}
+
+/* Erase sectors whose messages are all acknowledged. The active sector is
+ * left alone, it is still being appended to.
+ */
+static void truncate_locked(void)
+{
+    while (fcb.f_oldest != fcb.f_active.fe_sector) {
+        int idx = sector_idx(fcb.f_oldest);
+
+        if (sector_last_seq[idx] > acked_seq) {
+            break;
+        }
+
+        if (sent_loc.fe_sector == fcb.f_oldest) {
+            sent_loc.fe_sector = NULL;
+        }
+
+        int err = fcb_rotate(&fcb);
+        if (err) {
+            LOG_ERR("Failed to reclaim outbox sector (err %d)", err);
+            break;
+        }
+        sector_last_seq[idx] = 0;
+    }
+}
+
+static int recover_walk_cb(struct fcb_entry_ctx *loc_ctx, void *arg)
+{
+    uint32_t seq;
+
+    ARG_UNUSED(arg);
+
+    if (loc_ctx->loc.fe_data_len < RECORD_SEQ_LEN ||
+        flash_area_read(loc_ctx->fap, FCB_ENTRY_FA_DATA_OFF(loc_ctx->loc),
+                        &seq, sizeof(seq))) {
+        return 0;
+    }
+
+    seq = sys_le32_to_cpu(seq);
+    sector_last_seq[sector_idx(loc_ctx->loc.fe_sector)] = seq;
+    if (seq >= next_seq) {
+        next_seq = seq + 1;
+    }
+
+    return 0;
+}
+
+static int outbox_settings_set(const char *name, size_t len,
+                               settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+
+    if (settings_name_steq(name, "ack", &next) && !next) {
+        if (len != sizeof(acked_seq)) {
+            return -EINVAL;
+        }
+        return read_cb(cb_arg, &acked_seq, sizeof(acked_seq)) < 0 ? -EINVAL : 0;
+    }
+
+    return -ENOENT;
+}
+
+SETTINGS_STATIC_HANDLER_DEFINE(outbox, OUTBOX_SETTINGS_SUBTREE, NULL,
+                               outbox_settings_set, NULL, NULL);
+
+int outbox_init(outbox_backpressure_cb_t backpressure_cb)
+{
+    uint32_t sector_cnt = ARRAY_SIZE(sectors);
+    int err;
+
+    backpressure_callback = backpressure_cb;
+
+    err = flash_area_get_sectors(OUTBOX_PARTITION_ID, &sector_cnt, sectors);
+    if (err) {
+        LOG_ERR("Failed to get outbox sectors (err %d)", err);
+        return err;
+    }
+
+    fcb.f_magic = OUTBOX_MAGIC;
+    fcb.f_version = OUTBOX_VERSION;
+    fcb.f_sector_cnt = sector_cnt;
+    fcb.f_scratch_cnt = 0;
+    fcb.f_sectors = sectors;
+
+    err = fcb_init(OUTBOX_PARTITION_ID, &fcb);
+    if (err) {
+        LOG_WRN("Outbox log unreadable, clearing (err %d)", err);
+        err = fcb_clear(&fcb);
+        if (err) {
+            LOG_ERR("Failed to clear outbox (err %d)", err);
+            return err;
+        }
+    }
+
+    /* acked_seq was restored by settings_load() before we got here */
+    k_mutex_lock(&outbox_lock, K_FOREVER);
+
+    err = fcb_walk(&fcb, NULL, recover_walk_cb, NULL);
+    if (err) {
+        LOG_ERR("Failed to scan outbox (err %d)", err);
+    }
+
+    if (acked_seq >= next_seq) {
+        /* Log was cleared after the ack was saved */
+        next_seq = acked_seq + 1;
+    }
+    sent_seq = acked_seq;
+    sent_loc.fe_sector = NULL;
+
+    truncate_locked();
+    update_backpressure_locked();
+
+    LOG_INF("Outbox ready: %u pending, next seq %u, %d free of %u sectors",
+            next_seq - 1 - acked_seq, next_seq, fcb_free_sector_cnt(&fcb), sector_cnt);
+
+    k_mutex_unlock(&outbox_lock);
+    return 0;
+}
+
+int outbox_append(const rentscan_msg_t *msg)
+{
+    uint8_t buf[RECORD_MAX_LEN];
+    struct fcb_entry loc;
+    int len;
+    int err;
+
+    if (!msg) {
+        return -EINVAL;
+    }
+
+    len = rentscan_msg_encode(msg, &buf[RECORD_SEQ_LEN], sizeof(buf) - RECORD_SEQ_LEN);
+    if (len < 0) {
+        return len;
+    }
+    len += RECORD_SEQ_LEN;
+
+    k_mutex_lock(&outbox_lock, K_FOREVER);
+
+    sys_put_le32(next_seq, buf);
+
+    err = fcb_append(&fcb, len, &loc);
+    if (err == -ENOSPC) {
+        /* Reclaim what the backend has confirmed and try once more */
+        truncate_locked();
+        err = fcb_append(&fcb, len, &loc);
+    }
+    if (err) {
+        metrics_inc(METRIC_OUTBOX_DROPPED);
+        LOG_ERR("Outbox full, message dropped (%u total)", metrics_get(METRIC_OUTBOX_DROPPED));
+        goto out;
+    }
+
+    err = flash_area_write(fcb.fap, FCB_ENTRY_FA_DATA_OFF(loc), buf, len);
+    if (!err) {
+        err = fcb_append_finish(&fcb, &loc);
+    }
+    metrics_inc(METRIC_FLASH_WRITES);
+    if (err) {
+        metrics_inc(METRIC_FLASH_ERRORS);
+        LOG_ERR("Failed to write outbox entry (err %d)", err);
+        goto out;
+    }
+    metrics_inc(METRIC_OUTBOX_APPENDED);
+
+    sector_last_seq[sector_idx(loc.fe_sector)] = next_seq;
+    next_seq++;
+
+out:
+    update_backpressure_locked();
+    k_mutex_unlock(&outbox_lock);
+    return err;
+}
+
+int outbox_replay(outbox_send_cb_t send, uint32_t max)
+{
+    uint8_t buf[RECORD_MAX_LEN];
+    struct fcb_entry loc;
+    uint32_t count = 0;
+
+    if (!send) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&outbox_lock, K_FOREVER);
+
+    loc = sent_loc;
+
+    while (count < max && sent_seq + 1 < next_seq && fcb_getnext(&fcb, &loc) == 0) {
+        rentscan_msg_t msg;
+        size_t len;
+        int err = read_record(&loc, buf, &len);
+
+        if (err) {
+            LOG_WRN("Skipping unreadable outbox entry (err %d)", err);
+            continue;
+        }
+
+        uint32_t seq = sys_get_le32(buf);
+
+        /* Entries before the cursor when rescanning from the oldest sector */
+        if (seq <= sent_seq) {
+            continue;
+        }
+
+        err = rentscan_msg_decode(&msg, &buf[RECORD_SEQ_LEN], len - RECORD_SEQ_LEN);
+        if (err < 0) {
+            LOG_WRN("Skipping undecodable outbox entry %u (err %d)", seq, err);
+        } else if (send(seq, &msg)) {
+            break;
+        } else {
+            count++;
+        }
+
+        sent_seq = seq;
+        sent_loc = loc;
+    }
+
+    k_mutex_unlock(&outbox_lock);
+    return count;
+}
+
+int outbox_ack(uint32_t seq)
+{
+    int err = 0;
+
+    k_mutex_lock(&outbox_lock, K_FOREVER);
+
+    if (seq >= next_seq) {
+        err = -EINVAL;
+        goto out;
+    }
+
+    if (seq <= acked_seq) {
+        goto out;
+    }
+
+    acked_seq = seq;
+    if (sent_seq < acked_seq) {
+        sent_seq = acked_seq;
+        sent_loc.fe_sector = NULL;
+    }
+
+    err = settings_save_one(OUTBOX_ACK_KEY, &acked_seq, sizeof(acked_seq));
+    metrics_inc(METRIC_FLASH_WRITES);
+    if (err) {
+        metrics_inc(METRIC_FLASH_ERRORS);
+        LOG_ERR("Failed to persist outbox ack (err %d)", err);
+    }
+
+    truncate_locked();
+    update_backpressure_locked();
+
+out:
+    k_mutex_unlock(&outbox_lock);
+    return err;
+}
+
+void outbox_rewind(void)
+{
+    k_mutex_lock(&outbox_lock, K_FOREVER);
+    sent_seq = acked_seq;
+    sent_loc.fe_sector = NULL;
+    k_mutex_unlock(&outbox_lock);
+}
+
+uint32_t outbox_unsent(void)
+{
+    k_mutex_lock(&outbox_lock, K_FOREVER);
+    uint32_t unsent = next_seq - 1 - sent_seq;
+    k_mutex_unlock(&outbox_lock);
+
+    return unsent;
+}
+
+void outbox_get_stats(struct outbox_stats *stats)
+{
+    k_mutex_lock(&outbox_lock, K_FOREVER);
+    stats->next_seq = next_seq;
+    stats->acked_seq = acked_seq;
+    stats->sent_seq = sent_seq;
+    stats->pending = next_seq - 1 - acked_seq;
+    stats->free_sectors = fcb_free_sector_cnt(&fcb);
+    stats->dropped = metrics_get(METRIC_OUTBOX_DROPPED);
+    stats->backpressure = backpressure;
+    k_mutex_unlock(&outbox_lock);
+}
@@ -0,0 +1,103 @@
+/**
+ * @file outbox.h
+ * @brief Flash-backed store-and-forward log of messages bound for the backend
+ */
+
+#ifndef OUTBOX_H
+#define OUTBOX_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include "../../common/include/rentscan_protocol.h"
+
+/**
+ * @brief Callback for delivering a logged message
+ * 
+ * @param seq Sequence number of the message
+ * @param msg Decoded message
+ * @return int 0 if the message was handed to the backend, negative error
+ *             code to stop the replay
+ */
+typedef int (*outbox_send_cb_t)(uint32_t seq, const rentscan_msg_t *msg);
+
+/**
+ * @brief Callback for backpressure changes
+ * 
+ * @param active true when the log is nearly full, false once it has drained
+ */
+typedef void (*outbox_backpressure_cb_t)(bool active);
+
+/**
+ * @brief Outbox statistics
+ */
+struct outbox_stats {
+    uint32_t next_seq;      /**< Sequence number of the next appended message */
+    uint32_t acked_seq;     /**< Last sequence number acknowledged by the backend */
+    uint32_t sent_seq;      /**< Last sequence number handed to the backend */
+    uint32_t pending;       /**< Messages not yet acknowledged */
+    uint32_t free_sectors;  /**< Erased flash sectors left in the log */
+    uint32_t dropped;       /**< Messages rejected because the log was full */
+    bool backpressure;      /**< Whether backpressure is active */
+};
+
+/**
+ * @brief Mount the log and recover its state
+ * 
+ * @param backpressure_cb Called when the log crosses its fill thresholds
+ * @return int 0 on success, negative error code otherwise
+ */
+int outbox_init(outbox_backpressure_cb_t backpressure_cb);
+
+/**
+ * @brief Append a message to the log
+ * 
+ * @param msg Message to store
+ * @return int 0 on success, -ENOSPC if the log is full,
+ *             negative error code otherwise
+ */
+int outbox_append(const rentscan_msg_t *msg);
+
+/**
+ * @brief Hand logged messages to the backend in sequence order
+ * 
+ * Resumes after the last message sent. Stops at the first message the
+ * callback refuses.
+ * 
+ * @param send Delivery callback
+ * @param max Maximum number of messages to send in this call
+ * @return int Number of messages sent, negative error code on failure
+ */
+int outbox_replay(outbox_send_cb_t send, uint32_t max);
+
+/**
+ * @brief Acknowledge every message up to and including @p seq
+ * 
+ * Flash sectors holding only acknowledged messages are reclaimed.
+ * 
+ * @param seq Sequence number acknowledged by the backend
+ * @return int 0 on success, negative error code otherwise
+ */
+int outbox_ack(uint32_t seq);
+
+/**
+ * @brief Resend every unacknowledged message on the next replay
+ * 
+ * Called when the backend connection is re-established.
+ */
+void outbox_rewind(void);
+
+/**
+ * @brief Get the number of messages waiting to be sent
+ * 
+ * @return uint32_t Messages appended but not yet handed to the backend
+ */
+uint32_t outbox_unsent(void);
+
+/**
+ * @brief Get outbox statistics
+ * 
+ * @param stats Pointer to store the statistics
+ */
+void outbox_get_stats(struct outbox_stats *stats);
+
+#endif /* OUTBOX_H */
\ No newline at end of file
@@ -0,0 +1,125 @@
+/**
+ * @file rental_dump.c
+ * @brief Compact snapshot of the gateway's rental table
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/crc.h>
+#include <string.h>
+#include "rental_dump.h"
+#include "gateway_service.h"
+#include "../../common/include/rentscan_protocol.h"
+
+/* status, item and user with their lengths, start time, duration */
+#define RECORD_MAX_LEN (1 + 1 + MAX_TAG_ID_LEN + 1 + sizeof(((rental_info_t *)0)->user_id) + 5 + 5)
+
+BUILD_ASSERT(RECORD_MAX_LEN <= RENTAL_DUMP_CHUNK_LEN, "A chunk must hold at least one record");
+
+/* A chunk, or one record encoded before it is added to a chunk */
+struct dump_chunk {
+    uint8_t buf[RENTAL_DUMP_CHUNK_LEN];
+    size_t pos;
+};
+
+static void put_u8(struct dump_chunk *chunk, uint8_t val)
+{
+    chunk->buf[chunk->pos++] = val;
+}
+
+static void put_varint(struct dump_chunk *chunk, uint32_t val)
+{
+    do {
+        uint8_t byte = val & 0x7F;
+
+        val >>= 7;
+        put_u8(chunk, val ? (byte | 0x80) : byte);
+    } while (val);
+}
+
+static void put_string(struct dump_chunk *chunk, const char *str)
+{
+    size_t len = strlen(str);
+
+    put_u8(chunk, len);
+    memcpy(&chunk->buf[chunk->pos], str, len);
+    chunk->pos += len;
+}
+
+static int flush(struct dump_chunk *chunk, rental_dump_chunk_cb_t chunk_cb, void *user_data,
+                 struct rental_dump_summary *summary)
+{
+    if (chunk->pos == 0) {
+        return 0;
+    }
+
+    summary->bytes += chunk->pos;
+    summary->crc32 = crc32_ieee_update(summary->crc32, chunk->buf, chunk->pos);
+
+    int err = chunk_cb(chunk->buf, chunk->pos, user_data);
+
+    chunk->pos = 0;
+    return err;
+}
+
+int rental_dump(const struct rental_dump_filter *filter, uint32_t now,
+                rental_dump_chunk_cb_t chunk_cb, void *user_data,
+                struct rental_dump_summary *summary)
+{
+    static const struct rental_dump_filter all;
+    struct rental_dump_summary totals = { 0 };
+    struct dump_chunk chunk = { .pos = 0 };
+    int err = 0;
+
+    if (!chunk_cb) {
+        return -EINVAL;
+    }
+    if (!filter) {
+        filter = &all;
+    }
+
+    for (uint32_t i = 0; i < gateway_service_rental_capacity() && !err; i++) {
+        rental_info_t rental;
+
+        if (gateway_service_get_rental(i, &rental)) {
+            continue;
+        }
+        totals.scanned++;
+
+        /* Serial number comparison, as the expiry scheduler does */
+        bool expired = (int32_t)(now - (rental.start_time + rental.duration)) >= 0;
+
+        if ((filter->active && expired) || (filter->expired && !expired) ||
+            (filter->user_id && strcmp(filter->user_id, rental.user_id) != 0)) {
+            continue;
+        }
+
+        struct dump_chunk record = { .pos = 0 };
+
+        put_u8(&record, expired ? STATUS_EXPIRED : STATUS_RENTED);
+        put_string(&record, rental.item_id);
+        put_string(&record, rental.user_id);
+        put_varint(&record, rental.start_time);
+        put_varint(&record, rental.duration);
+
+        /* Whole records only, so every chunk decodes on its own */
+        if (chunk.pos + record.pos > sizeof(chunk.buf)) {
+            err = flush(&chunk, chunk_cb, user_data, &totals);
+            if (err) {
+                break;
+            }
+        }
+
+        memcpy(&chunk.buf[chunk.pos], record.buf, record.pos);
+        chunk.pos += record.pos;
+        totals.records++;
+    }
+
+    if (!err) {
+        err = flush(&chunk, chunk_cb, user_data, &totals);
+    }
+
+    if (summary) {
+        *summary = totals;
+    }
+    return err;
+}
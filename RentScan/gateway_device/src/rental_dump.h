@@ -0,0 +1,77 @@
+/**
+ * @file rental_dump.h
+ * @brief Compact snapshot of the gateway's rental table
+ *
+ * A snapshot is a sequence of chunks of up to RENTAL_DUMP_CHUNK_LEN bytes.
+ * Chunks only hold whole records, so each one decodes on its own:
+ *
+ *   [status][item length][item ID][user length][user ID]
+ *   [start time (varint)][duration (varint)]
+ *
+ * The status is STATUS_RENTED or STATUS_EXPIRED at the time of the
+ * snapshot and the start time is in network seconds, see rentscan_time.h.
+ * Varints are unsigned LEB128 as on the BLE link. The shell prints every
+ * chunk as one base64 line between a header and a trailer with the record
+ * count and the CRC-32 (IEEE) of all chunk bytes, which
+ * common/scripts/rentscan_dump.py turns back into a table.
+ */
+
+#ifndef RENTAL_DUMP_H
+#define RENTAL_DUMP_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Version of the record layout, printed in the header */
+#define RENTAL_DUMP_VERSION 1
+
+/** Largest chunk, a 64 character base64 line */
+#define RENTAL_DUMP_CHUNK_LEN 48
+
+/**
+ * @brief Records to include, applied on the gateway
+ */
+struct rental_dump_filter {
+    bool active;          /**< Only rentals still running */
+    bool expired;         /**< Only rentals past their deadline */
+    const char *user_id;  /**< Only rentals of this user, NULL for any */
+};
+
+/**
+ * @brief Totals of a snapshot, for the trailer
+ */
+struct rental_dump_summary {
+    uint32_t scanned;   /**< Rentals looked at */
+    uint32_t records;   /**< Rentals that passed the filter */
+    uint32_t bytes;     /**< Bytes in all chunks */
+    uint32_t crc32;     /**< CRC-32 (IEEE) of all chunks */
+};
+
+/**
+ * @brief Callback for one chunk of a snapshot
+ *
+ * @param chunk Chunk data, only valid during the call
+ * @param len Length of @p chunk
+ * @param user_data User data passed to rental_dump()
+ * @return int 0 to go on, negative error code to stop the snapshot
+ */
+typedef int (*rental_dump_chunk_cb_t)(const uint8_t *chunk, size_t len, void *user_data);
+
+/**
+ * @brief Walk the rental table and hand out the matching records in chunks
+ *
+ * Rentals started or ended during the walk may or may not be included.
+ *
+ * @param filter Records to include, NULL for all
+ * @param now Network time in seconds that decides what has expired
+ * @param chunk_cb Callback for each chunk
+ * @param user_data User data for @p chunk_cb
+ * @param summary Pointer to store the totals, can be NULL
+ * @return int 0 on success, negative error code of @p chunk_cb otherwise
+ */
+int rental_dump(const struct rental_dump_filter *filter, uint32_t now,
+                rental_dump_chunk_cb_t chunk_cb, void *user_data,
+                struct rental_dump_summary *summary);
+
+#endif /* RENTAL_DUMP_H */
\ No newline at end of file
@@ -0,0 +1,263 @@
+/**
+ * @file rental_store.c
+ * @brief Indexed table of the rentals the gateway tracks
+ *
+ * Rentals live in a fixed array of slots. Free slots are chained into a
+ * free list and an open addressing hash index over the item IDs finds a
+ * rental without scanning, the same layout the main device uses for its
+ * rental table. Item and user IDs are kept in the string pool.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "rental_store.h"
+#include "string_pool.h"
+
+LOG_MODULE_REGISTER(rental_store, LOG_LEVEL_INF);
+
+/* Each bucket holds a slot number plus one so that zero marks an empty bucket */
+#define INDEX_SIZE (1U << CONFIG_RENTSCAN_GATEWAY_RENTAL_INDEX_BITS)
+#define INDEX_MASK (INDEX_SIZE - 1)
+#define SLOT_NONE 0
+
+#define USER_ID_MAX_LEN (sizeof(((rental_info_t *)0)->user_id) - 1)
+
+BUILD_ASSERT(INDEX_SIZE >= 2 * RENTAL_STORE_CAPACITY,
+             "Rental index must have at least twice as many buckets as slots");
+BUILD_ASSERT(RENTAL_STORE_CAPACITY < UINT16_MAX, "Rental slot numbers are 16 bit");
+
+struct rental_record {
+    uint32_t start_time;
+    uint32_t duration;
+    uint32_t hash;
+    string_ref_t item;        /* STRING_REF_NONE while the slot is free */
+    string_ref_t user;
+    uint16_t next_free;
+};
+
+static struct rental_record records[RENTAL_STORE_CAPACITY];
+static uint16_t rental_index[INDEX_SIZE];
+static uint16_t free_head;
+static size_t rental_count;
+static K_MUTEX_DEFINE(store_lock);
+
+static uint32_t item_hash(const char *item_id, size_t len)
+{
+    /* 32-bit FNV-1a */
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)item_id[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static inline struct rental_record *slot_record(uint16_t slot)
+{
+    return &records[slot - 1];
+}
+
+static uint32_t index_probe(uint32_t hash, const char *item_id, size_t len)
+{
+    uint32_t pos = hash & INDEX_MASK;
+
+    while (rental_index[pos] != SLOT_NONE) {
+        const struct rental_record *rec = slot_record(rental_index[pos]);
+
+        if (rec->hash == hash && string_pool_equals(rec->item, item_id, len)) {
+            break;
+        }
+        pos = (pos + 1) & INDEX_MASK;
+    }
+
+    return pos;
+}
+
+static void index_remove(uint32_t hole)
+{
+    uint32_t pos = hole;
+
+    for (;;) {
+        pos = (pos + 1) & INDEX_MASK;
+        if (rental_index[pos] == SLOT_NONE) {
+            break;
+        }
+
+        uint32_t home = slot_record(rental_index[pos])->hash & INDEX_MASK;
+
+        if (((pos - home) & INDEX_MASK) >= ((pos - hole) & INDEX_MASK)) {
+            rental_index[hole] = rental_index[pos];
+            hole = pos;
+        }
+    }
+
+    rental_index[hole] = SLOT_NONE;
+}
+
+void rental_store_init(void)
+{
+    k_mutex_lock(&store_lock, K_FOREVER);
+
+    memset(rental_index, 0, sizeof(rental_index));
+    for (int i = 0; i < RENTAL_STORE_CAPACITY; i++) {
+        string_pool_release(records[i].item);
+        string_pool_release(records[i].user);
+        memset(&records[i], 0, sizeof(records[i]));
+        records[i].next_free = (i + 1 < RENTAL_STORE_CAPACITY) ? i + 2 : SLOT_NONE;
+    }
+    free_head = 1;
+    rental_count = 0;
+
+    k_mutex_unlock(&store_lock);
+
+    LOG_INF("Rental store ready for %d rentals", RENTAL_STORE_CAPACITY);
+}
+
+static int add_locked(const char *item_id, size_t item_len, const char *user_id,
+                      size_t user_len, uint32_t start_time, uint32_t duration)
+{
+    uint32_t hash = item_hash(item_id, item_len);
+    uint32_t pos = index_probe(hash, item_id, item_len);
+    string_ref_t item = STRING_REF_NONE;
+    string_ref_t user = STRING_REF_NONE;
+
+    if (rental_index[pos] != SLOT_NONE) {
+        return -EEXIST;
+    }
+
+    if (free_head == SLOT_NONE) {
+        return -ENOSPC;
+    }
+
+    if (string_pool_intern(item_id, item_len, &item) ||
+        (user_len && string_pool_intern(user_id, user_len, &user))) {
+        LOG_WRN("String pool full");
+        string_pool_release(item);
+        return -ENOSPC;
+    }
+
+    uint16_t slot = free_head;
+    struct rental_record *rec = slot_record(slot);
+
+    free_head = rec->next_free;
+
+    rec->start_time = start_time;
+    rec->duration = duration;
+    rec->hash = hash;
+    rec->item = item;
+    rec->user = user;
+    rec->next_free = SLOT_NONE;
+
+    rental_index[pos] = slot;
+    rental_count++;
+    return slot - 1;
+}
+
+int rental_store_add(const char *item_id, const char *user_id,
+                     uint32_t start_time, uint32_t duration)
+{
+    if (!item_id || !user_id) {
+        return -EINVAL;
+    }
+
+    size_t item_len = strlen(item_id);
+    size_t user_len = MIN(strlen(user_id), USER_ID_MAX_LEN);
+
+    if (item_len == 0 || item_len > MAX_TAG_ID_LEN) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&store_lock, K_FOREVER);
+    int ret = add_locked(item_id, item_len, user_id, user_len, start_time, duration);
+    k_mutex_unlock(&store_lock);
+
+    return ret;
+}
+
+int rental_store_find(const char *item_id)
+{
+    if (!item_id) {
+        return -EINVAL;
+    }
+
+    size_t len = strlen(item_id);
+    int slot = -ENOENT;
+
+    k_mutex_lock(&store_lock, K_FOREVER);
+
+    uint32_t pos = index_probe(item_hash(item_id, len), item_id, len);
+
+    if (rental_index[pos] != SLOT_NONE) {
+        slot = rental_index[pos] - 1;
+    }
+
+    k_mutex_unlock(&store_lock);
+    return slot;
+}
+
+int rental_store_get(int slot, rental_info_t *rental)
+{
+    if (slot < 0 || slot >= RENTAL_STORE_CAPACITY || !rental) {
+        return -EINVAL;
+    }
+
+    int err = -ENOENT;
+
+    k_mutex_lock(&store_lock, K_FOREVER);
+
+    const struct rental_record *rec = &records[slot];
+
+    if (rec->item != STRING_REF_NONE) {
+        memset(rental, 0, sizeof(*rental));
+        string_pool_get(rec->item, rental->item_id, sizeof(rental->item_id));
+        string_pool_get(rec->user, rental->user_id, sizeof(rental->user_id));
+        rental->start_time = rec->start_time;
+        rental->duration = rec->duration;
+        rental->active = true;
+        err = 0;
+    }
+
+    k_mutex_unlock(&store_lock);
+    return err;
+}
+
+int rental_store_remove(int slot)
+{
+    if (slot < 0 || slot >= RENTAL_STORE_CAPACITY) {
+        return -EINVAL;
+    }
+
+    int err = -ENOENT;
+
+    k_mutex_lock(&store_lock, K_FOREVER);
+
+    struct rental_record *rec = &records[slot];
+
+    if (rec->item != STRING_REF_NONE) {
+        char item_id[MAX_TAG_ID_LEN + 1];
+        size_t len = string_pool_get(rec->item, item_id, sizeof(item_id));
+
+        index_remove(index_probe(rec->hash, item_id, len));
+
+        string_pool_release(rec->item);
+        string_pool_release(rec->user);
+        rec->item = STRING_REF_NONE;
+        rec->user = STRING_REF_NONE;
+
+        rec->next_free = free_head;
+        free_head = slot + 1;
+        rental_count--;
+        err = 0;
+    }
+
+    k_mutex_unlock(&store_lock);
+    return err;
+}
+
+size_t rental_store_count(void)
+{
+    return rental_count;
+}
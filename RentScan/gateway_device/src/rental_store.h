@@ -0,0 +1,70 @@
+/**
+ * @file rental_store.h
+ * @brief Indexed table of the rentals the gateway tracks
+ */
+
+#ifndef RENTAL_STORE_H
+#define RENTAL_STORE_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include "gateway_service.h"
+
+/** Number of rental slots */
+#define RENTAL_STORE_CAPACITY CONFIG_RENTSCAN_GATEWAY_MAX_RENTALS
+
+/**
+ * @brief Initialize an empty rental table
+ */
+void rental_store_init(void);
+
+/**
+ * @brief Add a rental
+ * 
+ * The item and user IDs are interned, a user renting many items is only
+ * stored once.
+ * 
+ * @param item_id Item ID string
+ * @param user_id User ID string, truncated to fit rental_info_t
+ * @param start_time Start time in seconds
+ * @param duration Duration in seconds
+ * @return int Slot of the rental on success, -EEXIST if the item is already
+ *             rented, -ENOSPC if the table or the string pool is full,
+ *             negative error code otherwise
+ */
+int rental_store_add(const char *item_id, const char *user_id,
+                     uint32_t start_time, uint32_t duration);
+
+/**
+ * @brief Find the rental of an item
+ * 
+ * @param item_id Item ID string
+ * @return int Slot of the rental on success, -ENOENT if the item is not rented
+ */
+int rental_store_find(const char *item_id);
+
+/**
+ * @brief Get the rental in a slot
+ * 
+ * @param slot Slot number
+ * @param rental Pointer to store the rental information
+ * @return int 0 on success, -ENOENT if the slot is free
+ */
+int rental_store_get(int slot, rental_info_t *rental);
+
+/**
+ * @brief Remove the rental in a slot and free the slot
+ * 
+ * @param slot Slot number
+ * @return int 0 on success, -ENOENT if the slot is free
+ */
+int rental_store_remove(int slot);
+
+/**
+ * @brief Get the number of stored rentals
+ * 
+ * @return size_t Number of slots in use
+ */
+size_t rental_store_count(void);
+
+#endif /* RENTAL_STORE_H */
\ No newline at end of file
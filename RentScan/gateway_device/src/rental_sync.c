@@ -0,0 +1,297 @@
+/**
+ * @file rental_sync.c
+ * @brief Delta sync of the gateway's rentals with the main device tables
+ *
+ * The gateway remembers, per main device address, the epoch and generation
+ * of the last sync it completed. Whenever a link comes up it asks for the
+ * changes since then and compares every listed item with its own rentals,
+ * so a start or end that was lost while the link was down gets resent.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <stdio.h>
+#include <string.h>
+#include "rental_sync.h"
+#include "workq.h"
+#include "ble_central.h"
+#include "gateway_service.h"
+#include "../../common/include/rentscan_sync.h"
+#include "../../common/include/rentscan_time.h"
+
+LOG_MODULE_REGISTER(rental_sync, LOG_LEVEL_INF);
+
+#define MAX_PEERS CONFIG_RENTSCAN_SYNC_PEERS
+
+/* Retry delay for requests that found no TX buffer */
+#define REQUEST_RETRY_MS 100
+
+struct sync_peer {
+    bt_addr_le_t addr;
+    bool valid;
+    uint32_t epoch;
+    uint32_t generation;
+    uint32_t last_used;
+};
+
+/* Progress of the listing being received on a link */
+struct sync_session {
+    uint32_t next_seq;    /* corr_id expected on the next message */
+    uint16_t entries;
+    uint16_t corrections;
+    bool failed;
+};
+
+static struct sync_peer peers[MAX_PEERS];
+static uint32_t use_clock;
+static K_MUTEX_DEFINE(peer_lock);
+
+/* Only touched by the ingress thread */
+static struct sync_session sessions[BLE_CENTRAL_MAX_LINKS];
+static struct rental_sync_stats sync_stats;
+
+static ATOMIC_DEFINE(pending_links, BLE_CENTRAL_MAX_LINKS);
+static ATOMIC_DEFINE(full_links, BLE_CENTRAL_MAX_LINKS);
+
+/* Links whose session the ingress thread drops before the next message */
+static ATOMIC_DEFINE(reset_links, BLE_CENTRAL_MAX_LINKS);
+static void request_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(request_work, request_work_handler);
+
+static struct sync_peer *peer_find(const bt_addr_le_t *addr)
+{
+    for (int i = 0; i < MAX_PEERS; i++) {
+        if (peers[i].valid && bt_addr_le_eq(&peers[i].addr, addr)) {
+            return &peers[i];
+        }
+    }
+    return NULL;
+}
+
+static struct sync_peer *peer_get(const bt_addr_le_t *addr)
+{
+    struct sync_peer *peer = peer_find(addr);
+
+    if (peer) {
+        return peer;
+    }
+
+    /* Free slot, or the device synced least recently */
+    peer = &peers[0];
+    for (int i = 0; i < MAX_PEERS; i++) {
+        if (!peers[i].valid) {
+            peer = &peers[i];
+            break;
+        }
+        if (peers[i].last_used < peer->last_used) {
+            peer = &peers[i];
+        }
+    }
+
+    memset(peer, 0, sizeof(*peer));
+    bt_addr_le_copy(&peer->addr, addr);
+    peer->valid = true;
+    return peer;
+}
+
+static void request_work_handler(struct k_work *work)
+{
+    bool retry = false;
+
+    for (uint8_t link = 0; link < BLE_CENTRAL_MAX_LINKS; link++) {
+        struct ble_central_link_info info;
+        rentscan_msg_t req = {
+            .cmd = CMD_SYNC_REQ,
+        };
+        bool full;
+        int err;
+
+        if (!atomic_test_and_clear_bit(pending_links, link)) {
+            continue;
+        }
+
+        full = atomic_test_and_clear_bit(full_links, link);
+
+        if (ble_central_get_link_info(link, &info)) {
+            continue;
+        }
+
+        /* Epoch 0 makes the main device send its whole table */
+        k_mutex_lock(&peer_lock, K_FOREVER);
+        struct sync_peer *peer = peer_find(&info.addr);
+        if (peer && !full) {
+            req.epoch = peer->epoch;
+            req.generation = peer->generation;
+        }
+        k_mutex_unlock(&peer_lock);
+
+        err = ble_central_send_message(link, &req);
+        if (err == -ENOMEM) {
+            atomic_set_bit(pending_links, link);
+            if (full) {
+                atomic_set_bit(full_links, link);
+            }
+            retry = true;
+        } else if (err) {
+            LOG_WRN("Link %u: sync request failed (err %d)", link, err);
+        } else {
+            LOG_DBG("Link %u: sync requested from generation %u", link, req.generation);
+        }
+    }
+
+    if (retry) {
+        k_work_schedule_for_queue(&workq_rental.queue, &request_work,
+                                  K_MSEC(REQUEST_RETRY_MS));
+    }
+}
+
+int rental_sync_request(uint8_t link, bool full)
+{
+    if (link >= BLE_CENTRAL_MAX_LINKS) {
+        return -EINVAL;
+    }
+
+    if (full) {
+        atomic_set_bit(full_links, link);
+    }
+    atomic_set_bit(reset_links, link);
+    atomic_set_bit(pending_links, link);
+    k_work_reschedule_for_queue(&workq_rental.queue, &request_work, K_NO_WAIT);
+    return 0;
+}
+
+void rental_sync_link_down(uint8_t link)
+{
+    if (link >= BLE_CENTRAL_MAX_LINKS) {
+        return;
+    }
+
+    atomic_clear_bit(pending_links, link);
+    atomic_clear_bit(full_links, link);
+    atomic_set_bit(reset_links, link);
+}
+
+/* Send the command that brings one item on the main device in line */
+static void reconcile(uint8_t link, const struct rentscan_sync_entry *item,
+                      struct sync_session *session)
+{
+    char item_id[MAX_TAG_ID_LEN + 1];
+    rental_info_t rental;
+    rentscan_msg_t fix = {
+        .tag_id_len = item->tag_id_len,
+        .timestamp = rentscan_time_now(),
+    };
+    int err;
+
+    snprintf(item_id, sizeof(item_id), "%.*s", item->tag_id_len, item->tag_id);
+    memcpy(fix.tag_id, item->tag_id, item->tag_id_len);
+
+    bool rented = gateway_service_find_rental(item_id, &rental) == 0;
+
+    if (item->status != STATUS_AVAILABLE && !rented) {
+        /* The end of the rental never reached the main device */
+        fix.cmd = CMD_RENTAL_END;
+        fix.status = STATUS_AVAILABLE;
+    } else if (item->status == STATUS_AVAILABLE && rented) {
+        fix.cmd = CMD_RENTAL_START;
+        fix.status = STATUS_RENTED;
+        fix.timestamp = rental.start_time;
+        fix.duration = rental.duration;
+    } else {
+        return;
+    }
+
+    LOG_INF("Link %u: item %s out of sync, resending rental %s", link, item_id,
+            fix.cmd == CMD_RENTAL_END ? "end" : "start");
+
+    err = ble_central_send_message(link, &fix);
+    if (err) {
+        LOG_WRN("Link %u: correction failed (err %d)", link, err);
+        session->failed = true;
+        return;
+    }
+
+    session->corrections++;
+}
+
+int rental_sync_process(uint8_t link, const rentscan_msg_t *msg)
+{
+    if (link >= BLE_CENTRAL_MAX_LINKS || !msg || msg->cmd != CMD_SYNC_DELTA) {
+        return -EINVAL;
+    }
+
+    struct sync_session *session = &sessions[link];
+    size_t pos = 0;
+
+    if (atomic_test_and_clear_bit(reset_links, link)) {
+        memset(session, 0, sizeof(*session));
+    }
+
+    /* Every listing starts at 1, a listing that started over included */
+    if (msg->corr_id == 1) {
+        if (session->next_seq) {
+            LOG_WRN("Link %u: sync restarted after %u items", link, session->entries);
+        }
+        memset(session, 0, sizeof(*session));
+    } else if (msg->corr_id != session->next_seq) {
+        if (!session->failed) {
+            LOG_WRN("Link %u: sync message %u missing", link, session->next_seq);
+            sync_stats.gaps++;
+        }
+        session->failed = true;
+    }
+    session->next_seq = msg->corr_id + 1;
+
+    while (pos < msg->payload_len) {
+        struct rentscan_sync_entry item;
+        int len = rentscan_sync_entry_decode(&item, &msg->payload[pos],
+                                             msg->payload_len - pos);
+        if (len < 0) {
+            LOG_WRN("Link %u: malformed sync entry (err %d)", link, len);
+            session->failed = true;
+            break;
+        }
+
+        pos += len;
+        session->entries++;
+        reconcile(link, &item, session);
+    }
+
+    if (!(msg->status & RENTSCAN_SYNC_LAST)) {
+        return 0;
+    }
+
+    bool full = msg->status & RENTSCAN_SYNC_FULL;
+    bool failed = session->failed;
+    struct ble_central_link_info info;
+
+    /* Keep the old generation after a failure so the next sync lists
+     * the same items again.
+     */
+    if (!failed && ble_central_get_link_info(link, &info) == 0) {
+        k_mutex_lock(&peer_lock, K_FOREVER);
+        struct sync_peer *peer = peer_get(&info.addr);
+        peer->epoch = msg->epoch;
+        peer->generation = msg->generation;
+        peer->last_used = ++use_clock;
+        k_mutex_unlock(&peer_lock);
+    }
+
+    LOG_INF("Link %u: %s sync of %u items, %u corrected%s", link,
+            full ? "full" : "delta", session->entries, session->corrections,
+            failed ? ", incomplete" : "");
+
+    sync_stats.syncs++;
+    sync_stats.full_syncs += full;
+    sync_stats.entries += session->entries;
+    sync_stats.corrections += session->corrections;
+    memset(session, 0, sizeof(*session));
+
+    return failed ? -EIO : 0;
+}
+
+void rental_sync_get_stats(struct rental_sync_stats *stats)
+{
+    *stats = sync_stats;
+}
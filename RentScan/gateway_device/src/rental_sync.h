@@ -0,0 +1,67 @@
+/**
+ * @file rental_sync.h
+ * @brief Delta sync of the gateway's rentals with the main device tables
+ */
+
+#ifndef RENTAL_SYNC_H
+#define RENTAL_SYNC_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include "../../common/include/rentscan_protocol.h"
+
+/**
+ * @brief Sync statistics
+ */
+struct rental_sync_stats {
+    uint32_t syncs;         /**< Syncs completed */
+    uint32_t full_syncs;    /**< Syncs answered with the whole table */
+    uint32_t entries;       /**< Delta entries received */
+    uint32_t corrections;   /**< Commands sent to bring a main device in line */
+    uint32_t gaps;          /**< Listings with a message missing */
+};
+
+/**
+ * @brief Ask a main device for the rental changes since the last sync
+ * 
+ * The request is sent from the rental work queue, so this can be called
+ * from the Bluetooth RX thread.
+ * 
+ * @param link Link of the main device
+ * @param full true to ask for the whole table instead of a delta
+ * @return int 0 on success, negative error code otherwise
+ */
+int rental_sync_request(uint8_t link, bool full);
+
+/**
+ * @brief Forget the listing being received on a link that went down
+ * 
+ * A sync still pending for the link is dropped too. Can be called from
+ * the Bluetooth RX thread.
+ * 
+ * @param link Link that went down
+ */
+void rental_sync_link_down(uint8_t link);
+
+/**
+ * @brief Apply a CMD_SYNC_DELTA message from a main device
+ * 
+ * The gateway's rentals are authoritative. Every listed item whose state
+ * differs from them is corrected with a CMD_RENTAL_START or
+ * CMD_RENTAL_END to the main device. A listing with a message missing is
+ * not completed, so the next sync lists the same items again.
+ * 
+ * @param link Link the message arrived on
+ * @param msg Decoded message
+ * @return int 0 on success, negative error code otherwise
+ */
+int rental_sync_process(uint8_t link, const rentscan_msg_t *msg);
+
+/**
+ * @brief Get sync statistics
+ * 
+ * @param stats Pointer to store the statistics
+ */
+void rental_sync_get_stats(struct rental_sync_stats *stats);
+
+#endif /* RENTAL_SYNC_H */
\ No newline at end of file
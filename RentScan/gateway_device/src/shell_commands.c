@@ -1,62 +1,62 @@
-#include <shell/shell.h>
-#include <sys/byteorder.h>
-#include <bluetooth/gatt.h>
-#include <bluetooth/bluetooth.h>
-#include <bluetooth/uuid.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/base64.h>
+#include <stdlib.h>
+#include <string.h>
 #include "gateway_service.h"
 #include "ble_central.h"
-#include <logging/log.h>
+#include "beacon_observer.h"
+#include "rental_sync.h"
+#include "rental_dump.h"
+#include "latency_stats.h"
+#include "metrics.h"
+#include "../../common/include/rentscan_workq.h"
+#include "../../common/include/rentscan_time.h"
 
 LOG_MODULE_REGISTER(shell_commands, LOG_LEVEL_INF);
 
-// Add external declaration for direct access to the subscription parameters
-extern struct bt_gatt_subscribe_params subscribe_params;
-extern struct bt_conn *current_conn;
-extern uint16_t nus_tx_handle;
-extern uint16_t nus_rx_handle;
-
-static uint8_t notify_handler_manual(struct bt_conn *conn,
-                          struct bt_gatt_subscribe_params *params,
-                          const void *data, uint16_t length)
+static int parse_link(const struct shell *shell, const char *arg, uint8_t *link)
 {
-    LOG_INF("Manual subscribe notification received!");
-    return BT_GATT_ITER_CONTINUE;
+    char *end;
+    unsigned long val = strtoul(arg, &end, 10);
+
+    if (*end != '\0' || val >= BLE_CENTRAL_MAX_LINKS) {
+        shell_error(shell, "Invalid link %s (0-%d)", arg, BLE_CENTRAL_MAX_LINKS - 1);
+        return -EINVAL;
+    }
+
+    *link = (uint8_t)val;
+    return 0;
 }
 
 static int cmd_manual_subscribe(const struct shell *shell, size_t argc, char **argv)
 {
     int err;
+    uint8_t link;
 
-    if (argc < 3) {
-        shell_error(shell, "Usage: rentscan manual_sub <tx_handle> <ccc_handle>");
+    if (argc < 4) {
+        shell_error(shell, "Usage: rentscan manual_sub <link> <tx_handle> <ccc_handle>");
         return -EINVAL;
     }
 
-    if (!current_conn) {
-        shell_error(shell, "Not connected to any device");
-        return -ENOTCONN;
+    err = parse_link(shell, argv[1], &link);
+    if (err) {
+        return err;
     }
 
-    uint16_t tx_handle = (uint16_t)strtol(argv[1], NULL, 10);
-    uint16_t ccc_handle = (uint16_t)strtol(argv[2], NULL, 10);
-
-    shell_print(shell, "Attempting manual subscription with TX handle %u and CCC handle %u", 
-                tx_handle, ccc_handle);
+    uint16_t tx_handle = (uint16_t)strtol(argv[2], NULL, 10);
+    uint16_t ccc_handle = (uint16_t)strtol(argv[3], NULL, 10);
 
-    // Store the TX handle for future use
-    nus_tx_handle = tx_handle;
+    shell_print(shell, "Attempting manual subscription on link %u with TX handle %u and CCC handle %u", 
+                link, tx_handle, ccc_handle);
 
-    // Set up a temporary subscribe parameters structure
-    static struct bt_gatt_subscribe_params temp_params = {
-        .notify = notify_handler_manual,
-        .value = BT_GATT_CCC_NOTIFY,
-    };
-    
-    temp_params.value_handle = tx_handle;
-    temp_params.ccc_handle = ccc_handle;
-
-    err = bt_gatt_subscribe(current_conn, &temp_params);
-    if (err && err != -EALREADY) {
+    err = ble_central_manual_subscribe(link, tx_handle, ccc_handle);
+    if (err == -ENOTCONN) {
+        shell_error(shell, "Link %u is not connected", link);
+        return err;
+    } else if (err) {
         shell_error(shell, "Subscribe failed (err %d)", err);
         return err;
     }
@@ -67,19 +67,39 @@ static int cmd_manual_subscribe(const struct shell *shell, size_t argc, char **a
 
 static int cmd_show_handles(const struct shell *shell, size_t argc, char **argv)
 {
-    if (!current_conn) {
+    if (!ble_central_is_connected()) {
         shell_error(shell, "Not connected to any device");
         return -ENOTCONN;
     }
 
-    shell_print(shell, "Current RX handle: %u", nus_rx_handle);
-    shell_print(shell, "Current TX handle: %u", nus_tx_handle);
-    shell_print(shell, "Current CCC handle (if known): %u", subscribe_params.ccc_handle);
+    for (uint8_t link = 0; link < BLE_CENTRAL_MAX_LINKS; link++) {
+        struct ble_central_link_info info;
+        char addr[BT_ADDR_LE_STR_LEN];
+
+        if (ble_central_get_link_info(link, &info)) {
+            continue;
+        }
+
+        bt_addr_le_to_str(&info.addr, addr, sizeof(addr));
+        shell_print(shell, "Link %u (%s):", link, addr);
+        shell_print(shell, "  RX handle: %u", info.rx_handle);
+        shell_print(shell, "  TX handle: %u", info.tx_handle);
+        shell_print(shell, "  CCC handle (if known): %u", info.ccc_handle);
+        shell_print(shell, "  Subscribed: %s", info.subscribed ? "yes" : "no");
+        shell_print(shell, "  From cache: %s", info.cached ? "yes" : "no");
+    }
 
     return 0;
 }
 
 /* BLE central commands */
+static int cmd_forget_handles(const struct shell *shell, size_t argc, char **argv)
+{
+    ble_central_forget_handles();
+    shell_print(shell, "Cached GATT handles cleared");
+    return 0;
+}
+
 static int cmd_scan_start(const struct shell *shell, size_t argc, char **argv)
 {
     int err = ble_central_start_scan();
@@ -106,7 +126,13 @@ static int cmd_scan_stop(const struct shell *shell, size_t argc, char **argv)
 
 static int cmd_disconnect(const struct shell *shell, size_t argc, char **argv)
 {
-    int err = ble_central_disconnect();
+    uint8_t link = BLE_CENTRAL_LINK_ALL;
+
+    if (argc > 1 && parse_link(shell, argv[1], &link)) {
+        return -EINVAL;
+    }
+
+    int err = ble_central_disconnect(link);
     if (err) {
         shell_error(shell, "Failed to disconnect (err %d)", err);
         return err;
@@ -116,6 +142,170 @@ static int cmd_disconnect(const struct shell *shell, size_t argc, char **argv)
     return 0;
 }
 
+static int cmd_sync(const struct shell *shell, size_t argc, char **argv)
+{
+    uint8_t link;
+
+    if (argc < 2) {
+        shell_error(shell, "Usage: rentscan sync <link> [full]");
+        return -EINVAL;
+    }
+
+    if (parse_link(shell, argv[1], &link)) {
+        return -EINVAL;
+    }
+
+    bool full = argc > 2 && strcmp(argv[2], "full") == 0;
+    int err = rental_sync_request(link, full);
+    if (err) {
+        shell_error(shell, "Failed to request sync (err %d)", err);
+        return err;
+    }
+
+    shell_print(shell, "%s sync requested on link %u", full ? "Full" : "Delta", link);
+    return 0;
+}
+
+/* Time a main device gets to answer a statistics query */
+#define STATS_QUERY_TIMEOUT_MS 2000
+
+static void print_latency(const struct shell *shell, const char *name,
+                          const struct rentscan_latency_hist *hist)
+{
+    if (!hist->count) {
+        shell_print(shell, "  %-16s no samples", name);
+        return;
+    }
+
+    shell_print(shell, "  %-16s n=%u mean=%uus p50<%uus p90<%uus p99<%uus max=%uus",
+                name, hist->count, rentscan_latency_mean(hist),
+                rentscan_latency_percentile(hist, 50), rentscan_latency_percentile(hist, 90),
+                rentscan_latency_percentile(hist, 99), hist->max_us);
+
+    for (int i = 0; i < RENTSCAN_LATENCY_BUCKETS; i++) {
+        if (!hist->buckets[i]) {
+            continue;
+        }
+        if (i == RENTSCAN_LATENCY_BUCKETS - 1) {
+            shell_print(shell, "    >=%8uus: %u", rentscan_latency_bucket_limit(i - 1),
+                        hist->buckets[i]);
+        } else {
+            shell_print(shell, "    <%9uus: %u", rentscan_latency_bucket_limit(i),
+                        hist->buckets[i]);
+        }
+    }
+}
+
+static int cmd_stats_latency(const struct shell *shell, size_t argc, char **argv)
+{
+    struct rentscan_latency_hist hist;
+    uint8_t link;
+
+    if (argc < 2) {
+        shell_print(shell, "Gateway latency:");
+        for (int i = 0; i < LATENCY_STAGE_COUNT; i++) {
+            latency_stats_get(i, &hist);
+            print_latency(shell, latency_stats_stage_name(i), &hist);
+        }
+        return 0;
+    }
+
+    if (parse_link(shell, argv[1], &link)) {
+        return -EINVAL;
+    }
+
+    static const char *const main_stages[] = {
+        [RENTSCAN_LATENCY_TAP_TO_WORK] = "tap->work",
+        [RENTSCAN_LATENCY_WORK_TO_SEND] = "work->send",
+        [RENTSCAN_LATENCY_TAP_TO_SEND] = "tap->send",
+    };
+    static struct rentscan_latency_hist remote[RENTSCAN_LATENCY_MAIN_STAGES];
+
+    int err = latency_stats_query(link, remote, K_MSEC(STATS_QUERY_TIMEOUT_MS));
+    if (err) {
+        shell_error(shell, "Failed to query main device %u (err %d)", link, err);
+        return err;
+    }
+
+    shell_print(shell, "Main device %u latency:", link);
+    for (int i = 0; i < RENTSCAN_LATENCY_MAIN_STAGES; i++) {
+        print_latency(shell, main_stages[i], &remote[i]);
+    }
+    return 0;
+}
+
+#if defined(CONFIG_THREAD_MONITOR)
+static void print_stack(const struct k_thread *thread, void *user_data)
+{
+    const struct shell *shell = user_data;
+    const char *name = k_thread_name_get((k_tid_t)thread);
+    size_t size;
+    size_t used;
+
+    if (rentscan_thread_stack_usage((struct k_thread *)thread, &size, &used)) {
+        return;
+    }
+
+    shell_print(shell, "  %-20s %5u / %5u bytes (%u%%)", name ? name : "?",
+                (unsigned int)used, (unsigned int)size,
+                size ? (unsigned int)(used * 100 / size) : 0);
+}
+#endif
+
+static int cmd_stats_stacks(const struct shell *shell, size_t argc, char **argv)
+{
+#if defined(CONFIG_THREAD_MONITOR)
+    shell_print(shell, "Stack high water marks:");
+    /* Unlocked, printing to the shell may block */
+    k_thread_foreach_unlocked(print_stack, (void *)shell);
+    return 0;
+#else
+    shell_error(shell, "Needs CONFIG_THREAD_MONITOR");
+    return -ENOTSUP;
+#endif
+}
+
+/* One "<name> <kind> <value>" line per metric, for scripts on the other end */
+static void print_metrics(const struct shell *shell, const char *prefix,
+                          const struct rentscan_metric_desc *desc,
+                          const uint32_t *values, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        shell_print(shell, "%s.%s %s %u", prefix, desc[i].name,
+                    rentscan_metric_kind_name(desc[i].kind), values[i]);
+    }
+}
+
+static int cmd_metrics(const struct shell *shell, size_t argc, char **argv)
+{
+    uint8_t link;
+
+    if (argc < 2) {
+        static uint32_t values[METRIC_COUNT];
+
+        metrics_snapshot(values);
+        shell_print(shell, "# source=gw uptime_ms=%u", k_uptime_get_32());
+        print_metrics(shell, "gw", metrics_desc, values, METRIC_COUNT);
+        return 0;
+    }
+
+    if (parse_link(shell, argv[1], &link)) {
+        return -EINVAL;
+    }
+
+    static uint32_t remote[RENTSCAN_MAIN_METRIC_COUNT];
+
+    int err = metrics_query(link, remote, K_MSEC(STATS_QUERY_TIMEOUT_MS));
+    if (err) {
+        shell_error(shell, "Failed to query main device %u (err %d)", link, err);
+        return err;
+    }
+
+    shell_print(shell, "# source=main link=%u uptime_ms=%u", link, k_uptime_get_32());
+    print_metrics(shell, "main", rentscan_main_metrics, remote, RENTSCAN_MAIN_METRIC_COUNT);
+    return 0;
+}
+
 static int cmd_reset(const struct shell *shell, size_t argc, char **argv)
 {
     int err = ble_central_reset();
@@ -130,26 +320,39 @@ static int cmd_reset(const struct shell *shell, size_t argc, char **argv)
 
 static int cmd_bt_status(const struct shell *shell, size_t argc, char **argv)
 {
-    int8_t rssi;
-    int8_t tx_power;
-    uint16_t conn_interval;
+    struct ble_central_conn_stats stats;
     int err;
     
-    bool connected = ble_central_is_connected();
-    
     shell_print(shell, "BLE Central Status:");
-    shell_print(shell, "  Connected: %s", connected ? "yes" : "no");
+    shell_print(shell, "  Connected: %u/%d devices", ble_central_link_count(),
+                BLE_CENTRAL_MAX_LINKS);
     
-    if (connected) {
-        err = ble_central_get_conn_stats(&rssi, &tx_power, &conn_interval);
+    for (uint8_t link = 0; link < BLE_CENTRAL_MAX_LINKS; link++) {
+        struct ble_central_link_info info;
+        char addr[BT_ADDR_LE_STR_LEN];
+
+        if (ble_central_get_link_info(link, &info)) {
+            continue;
+        }
+
+        bt_addr_le_to_str(&info.addr, addr, sizeof(addr));
+        shell_print(shell, "  Link %u: %s", link, addr);
+
+        err = ble_central_get_conn_stats(link, &stats);
         if (err) {
-            shell_error(shell, "Failed to get connection stats (err %d)", err);
+            shell_error(shell, "    Failed to get connection stats (err %d)", err);
         } else {
-            shell_print(shell, "  RSSI: %d dBm", rssi);
-            shell_print(shell, "  TX Power: %d dBm", tx_power);
-            shell_print(shell, "  Conn Interval: %u.%u ms", 
-                      conn_interval * 5 / 4,
-                      (conn_interval * 5) % 4 * 25);
+            shell_print(shell, "    RSSI: %d dBm", stats.rssi);
+            shell_print(shell, "    TX Power: %d dBm", stats.tx_power);
+            shell_print(shell, "    Conn Interval: %u.%02u ms (%s)", 
+                      stats.interval * 5 / 4,
+                      (stats.interval * 5) % 4 * 25,
+                      stats.burst ? "burst" : "idle");
+            shell_print(shell, "    Latency: %u, Timeout: %u ms",
+                      stats.latency, stats.timeout * 10);
+            shell_print(shell, "    PHY: TX %u, RX %u", stats.tx_phy, stats.rx_phy);
+            shell_print(shell, "    Data Length: TX %u, RX %u, MTU %u",
+                      stats.tx_data_len, stats.rx_data_len, stats.mtu);
         }
     }
     
@@ -182,7 +385,62 @@ static int cmd_gw_status(const struct shell *shell, size_t argc, char **argv)
     shell_print(shell, "  Error Count: %u", status.error_count);
     shell_print(shell, "  Message Queue: %u", status.queue_size);
     shell_print(shell, "  Active Rentals: %u", status.rental_count);
+    shell_print(shell, "  Ingress Queue: %u (high water %u)",
+                status.ingress_queued, status.ingress_high_water);
+    shell_print(shell, "  Ingress Dropped: %u", status.ingress_dropped);
+    shell_print(shell, "  Ingress Malformed: %u", status.ingress_malformed);
+    shell_print(shell, "  Outbox Pending: %u (%u free sectors)",
+                status.outbox_pending, status.outbox_free_sectors);
+    shell_print(shell, "  Outbox Dropped: %u", status.outbox_dropped);
+    shell_print(shell, "  Backpressure: %s", status.outbox_backpressure ? "on" : "off");
+    shell_print(shell, "  Uplink (%s): %u frames, %u messages, %u errors",
+                status.uplink_transport, status.uplink_frames,
+                status.uplink_messages, status.uplink_errors);
+    shell_print(shell, "  Uplink Fill: %u%% (%u%% of raw size)",
+                status.uplink_fill_pct, status.uplink_ratio_pct);
+    shell_print(shell, "  Uplink Throughput: %u msg/s, %u B/s",
+                status.uplink_msg_rate, status.uplink_byte_rate);
+    
+    struct rental_sync_stats sync;
+    rental_sync_get_stats(&sync);
+    shell_print(shell, "  Syncs: %u (%u full), %u items, %u corrected, %u with gaps",
+                sync.syncs, sync.full_syncs, sync.entries, sync.corrections, sync.gaps);
+    
+    return 0;
+}
+
+static int cmd_config_set(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc != 3) {
+        shell_error(shell, "Usage: rentscan config set <key> <value>");
+        return -EINVAL;
+    }
+    
+    int err = gateway_service_set_config(argv[1], argv[2]);
+    if (err) {
+        shell_error(shell, "Failed to set config (err %d)", err);
+        return err;
+    }
+    
+    shell_print(shell, "Config set: %s=%s", argv[1], argv[2]);
+    return 0;
+}
+
+static int cmd_config_get(const struct shell *shell, size_t argc, char **argv)
+{
+    if (argc != 2) {
+        shell_error(shell, "Usage: rentscan config get <key>");
+        return -EINVAL;
+    }
+    
+    char value[64] = {0};
+    int err = gateway_service_get_config(argv[1], value, sizeof(value));
+    if (err < 0) {
+        shell_error(shell, "Failed to get config (err %d)", err);
+        return err;
+    }
     
+    shell_print(shell, "Config: %s=%s", argv[1], value);
     return 0;
 }
 
@@ -241,11 +499,13 @@ static int cmd_rental_list(const struct shell *shell, size_t argc, char **argv)
     
     shell_print(shell, "Active Rentals (%u):", status.rental_count);
     
-    for (int i = 0; i < status.rental_count; i++) {
+    for (uint32_t i = 0; i < gateway_service_rental_capacity(); i++) {
         rental_info_t rental;
-        gateway_service_get_rental(i, &rental);
+        if (gateway_service_get_rental(i, &rental)) {
+            continue;
+        }
         
-        uint32_t now = k_uptime_get_32() / 1000;
+        uint32_t now = rentscan_time_now();
         uint32_t elapsed = now - rental.start_time;
         uint32_t remaining = rental.duration > elapsed ? rental.duration - elapsed : 0;
         
@@ -259,6 +519,61 @@ static int cmd_rental_list(const struct shell *shell, size_t argc, char **argv)
     return 0;
 }
 
+static int dump_chunk_print(const uint8_t *chunk, size_t len, void *user_data)
+{
+    const struct shell *shell = user_data;
+    /* Room for the encoding of a full chunk and its terminator */
+    uint8_t line[4 * DIV_ROUND_UP(RENTAL_DUMP_CHUNK_LEN, 3) + 1];
+    size_t olen;
+
+    int err = base64_encode(line, sizeof(line), &olen, chunk, len);
+    if (err) {
+        return err;
+    }
+
+    shell_print(shell, "%s", line);
+    return 0;
+}
+
+static int cmd_rental_dump(const struct shell *shell, size_t argc, char **argv)
+{
+    struct rental_dump_filter filter = { 0 };
+    struct rental_dump_summary summary;
+
+    for (size_t i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "active") == 0) {
+            filter.active = true;
+        } else if (strcmp(argv[i], "expired") == 0) {
+            filter.expired = true;
+        } else if (strcmp(argv[i], "user") == 0 && i + 1 < argc) {
+            filter.user_id = argv[++i];
+        } else {
+            shell_error(shell, "Usage: rentscan rental dump [active|expired] [user <user_id>]");
+            return -EINVAL;
+        }
+    }
+
+    if (filter.active && filter.expired) {
+        shell_error(shell, "active and expired exclude each other");
+        return -EINVAL;
+    }
+
+    /* One timestamp for the header and the status of every record */
+    uint32_t now = rentscan_time_now();
+
+    shell_print(shell, "# rentscan rental dump v%u now=%u", RENTAL_DUMP_VERSION, now);
+
+    int err = rental_dump(&filter, now, dump_chunk_print, (void *)shell, &summary);
+    if (err) {
+        shell_error(shell, "Dump aborted (err %d)", err);
+        return err;
+    }
+
+    shell_print(shell, "# end records=%u scanned=%u bytes=%u crc32=%08x",
+                summary.records, summary.scanned, summary.bytes, summary.crc32);
+    return 0;
+}
+
 static int cmd_whitelist_add(const struct shell *shell, size_t argc, char **argv)
 {
     if (argc < 2) {
@@ -289,6 +604,62 @@ static int cmd_whitelist_clear(const struct shell *shell, size_t argc, char **ar
     return 0;
 }
 
+#if defined(CONFIG_RENTSCAN_BEACON_OBSERVER)
+static int cmd_beacon_list(const struct shell *shell, size_t argc, char **argv)
+{
+    int count = 0;
+
+    for (size_t i = 0; i < beacon_observer_capacity(); i++) {
+        struct beacon_observer_info info;
+        char addr[BT_ADDR_LE_STR_LEN];
+
+        if (beacon_observer_get(i, &info)) {
+            continue;
+        }
+
+        bt_addr_le_to_str(&info.addr, addr, sizeof(addr));
+        shell_print(shell, "%s: %u out, seq %u, pages %u/%u, RSSI %d, %u ms ago",
+                    addr, info.total, info.seq, info.pages_seen, info.page_count,
+                    info.rssi, info.age_ms);
+        count++;
+    }
+
+    if (count == 0) {
+        shell_print(shell, "No status beacons heard");
+    }
+    return 0;
+}
+
+static int cmd_beacon_lookup(const struct shell *shell, size_t argc, char **argv)
+{
+    rentscan_status_t status;
+    bt_addr_le_t addr;
+    char addr_str[BT_ADDR_LE_STR_LEN];
+
+    if (argc < 2) {
+        shell_error(shell, "Usage: rentscan beacon lookup <item_id>");
+        return -EINVAL;
+    }
+
+    int err = beacon_observer_lookup(argv[1], &status, &addr);
+    if (err == -ENOENT) {
+        shell_print(shell, "Item %s is available", argv[1]);
+        return 0;
+    } else if (err == -EAGAIN) {
+        shell_print(shell, "Item %s not seen, beacons still incomplete", argv[1]);
+        return 0;
+    } else if (err) {
+        shell_error(shell, "Lookup failed (err %d)", err);
+        return err;
+    }
+
+    bt_addr_le_to_str(&addr, addr_str, sizeof(addr_str));
+    shell_print(shell, "Item %s is %s (reported by %s)", argv[1],
+                status == STATUS_EXPIRED ? "expired" : "rented", addr_str);
+    return 0;
+}
+#endif
+
 static int cmd_status(const struct shell *shell, size_t argc, char **argv)
 {
     cmd_bt_status(shell, argc, argv);
@@ -303,6 +674,8 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_rental,
     SHELL_CMD(start, NULL, "Start a rental", cmd_rental_start),
     SHELL_CMD(end, NULL, "End a rental", cmd_rental_end),
     SHELL_CMD(list, NULL, "List active rentals", cmd_rental_list),
+    SHELL_CMD(dump, NULL, "Dump rentals as base64 records [active|expired] [user <user_id>]",
+              cmd_rental_dump),
     SHELL_SUBCMD_SET_END
 );
 
@@ -320,6 +693,13 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_backend,
     SHELL_SUBCMD_SET_END
 );
 
+/* Config subcommands */
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_config,
+    SHELL_CMD(set, NULL, "Set configuration", cmd_config_set),
+    SHELL_CMD(get, NULL, "Get configuration", cmd_config_get),
+    SHELL_SUBCMD_SET_END
+);
+
 /* Whitelist subcommands */
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_whitelist,
     SHELL_CMD(add, NULL, "Add device to whitelist", cmd_whitelist_add),
@@ -327,18 +707,40 @@ SHELL_STATIC_SUBCMD_SET_CREATE(sub_whitelist,
     SHELL_SUBCMD_SET_END
 );
 
+/* Statistics subcommands */
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_stats,
+    SHELL_CMD(latency, NULL, "Show tap latency histograms [link]", cmd_stats_latency),
+    SHELL_CMD(stacks, NULL, "Show stack usage of every thread", cmd_stats_stacks),
+    SHELL_SUBCMD_SET_END
+);
+
 /* Main command set */
+#if defined(CONFIG_RENTSCAN_BEACON_OBSERVER)
+SHELL_STATIC_SUBCMD_SET_CREATE(sub_beacon,
+    SHELL_CMD(list, NULL, "List main devices heard through status beacons", cmd_beacon_list),
+    SHELL_CMD(lookup, NULL, "Look up an item in the status beacons <item_id>", cmd_beacon_lookup),
+    SHELL_SUBCMD_SET_END
+);
+#endif
+
 SHELL_STATIC_SUBCMD_SET_CREATE(sub_rentscan,
     SHELL_CMD(whitelist, &sub_whitelist, "Manage whitelist", NULL),
     SHELL_CMD(scan, &sub_scan, "Control scanning", NULL),
-    SHELL_CMD(disconnect, NULL, "Disconnect from device", cmd_disconnect),
+    SHELL_CMD(disconnect, NULL, "Disconnect from device [link]", cmd_disconnect),
     SHELL_CMD(reset, NULL, "Reset BLE stack", cmd_reset),
+    SHELL_CMD(sync, NULL, "Sync rentals with a main device <link> [full]", cmd_sync),
+    SHELL_CMD(config, &sub_config, "Manage configuration", NULL),
     SHELL_CMD(status, NULL, "Show status", cmd_status),
+    SHELL_CMD(stats, &sub_stats, "Show statistics", NULL),
+    SHELL_CMD(metrics, NULL, "Dump runtime counters [link]", cmd_metrics),
     SHELL_CMD(backend, &sub_backend, "Control backend connection", NULL),
     SHELL_CMD(reset_errors, NULL, "Reset error count", cmd_reset_errors),
     SHELL_CMD(rental, &sub_rental, "Manage rentals", NULL),
-    SHELL_CMD(manual_sub, NULL, "Manual subscribe with handles", cmd_manual_subscribe),
+    SHELL_CMD(manual_sub, NULL, "Manual subscribe <link> <tx_handle> <ccc_handle>", cmd_manual_subscribe),
     SHELL_CMD(show_handles, NULL, "Show current GATT handles", cmd_show_handles),
+    SHELL_CMD(forget_handles, NULL, "Clear cached GATT handles", cmd_forget_handles),
+    SHELL_COND_CMD(CONFIG_RENTSCAN_BEACON_OBSERVER, beacon, &sub_beacon,
+                   "Read rental states from status beacons", NULL),
     SHELL_SUBCMD_SET_END
 );
 
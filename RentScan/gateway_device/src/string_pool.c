@@ -0,0 +1,239 @@
+/**
+ * @file string_pool.c
+ * @brief Reference counted pool of interned strings
+ *
+ * The arena is split into small chunks tracked by a bitmap. A string takes
+ * a run of chunks holding a short header and its characters, and the
+ * reference is the number of its first chunk plus one. An open addressing
+ * index over the string contents finds the copy that is already stored.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/util.h>
+#include <string.h>
+#include "string_pool.h"
+
+#define CHUNK_SIZE 4
+#define CHUNK_COUNT (CONFIG_RENTSCAN_STRING_POOL_SIZE / CHUNK_SIZE)
+
+#define INDEX_SIZE (1U << CONFIG_RENTSCAN_STRING_INDEX_BITS)
+#define INDEX_MASK (INDEX_SIZE - 1)
+
+/* Strings beyond this load factor are refused to keep probe runs short */
+#define MAX_STRINGS (INDEX_SIZE * 3 / 4)
+
+BUILD_ASSERT(CHUNK_COUNT < UINT16_MAX, "String references are 16 bit");
+
+struct string_hdr {
+    uint16_t refs;
+    uint8_t len;
+    char data[];
+} __packed;
+
+static uint8_t arena[CHUNK_COUNT * CHUNK_SIZE] __aligned(4);
+static uint32_t chunk_map[DIV_ROUND_UP(CHUNK_COUNT, 32)];
+static string_ref_t string_index[INDEX_SIZE];
+static uint32_t string_count;
+static uint32_t used_chunks;
+static uint32_t alloc_hint;
+
+static uint32_t string_hash(const char *str, size_t len)
+{
+    /* 32-bit FNV-1a */
+    uint32_t hash = 2166136261U;
+
+    for (size_t i = 0; i < len; i++) {
+        hash ^= (uint8_t)str[i];
+        hash *= 16777619U;
+    }
+
+    return hash;
+}
+
+static inline struct string_hdr *string_get(string_ref_t ref)
+{
+    return (struct string_hdr *)&arena[(ref - 1) * CHUNK_SIZE];
+}
+
+static inline uint32_t string_chunks(size_t len)
+{
+    return DIV_ROUND_UP(sizeof(struct string_hdr) + len, CHUNK_SIZE);
+}
+
+static inline bool chunk_used(uint32_t chunk)
+{
+    return chunk_map[chunk / 32] & BIT(chunk % 32);
+}
+
+static void chunks_mark(uint32_t first, uint32_t count, bool used)
+{
+    for (uint32_t i = first; i < first + count; i++) {
+        if (used) {
+            chunk_map[i / 32] |= BIT(i % 32);
+        } else {
+            chunk_map[i / 32] &= ~BIT(i % 32);
+        }
+    }
+}
+
+/* Next fit, so freshly freed chunks at the start are not searched first */
+static int chunks_alloc(uint32_t count)
+{
+    uint32_t run = 0;
+
+    for (uint32_t n = 0; n < CHUNK_COUNT; n++) {
+        uint32_t chunk = (alloc_hint + n) % CHUNK_COUNT;
+
+        if (chunk == 0) {
+            /* Runs don't wrap around the end of the arena */
+            run = 0;
+        }
+
+        if (chunk_used(chunk)) {
+            run = 0;
+            continue;
+        }
+
+        if (++run == count) {
+            uint32_t first = chunk + 1 - count;
+
+            chunks_mark(first, count, true);
+            used_chunks += count;
+            alloc_hint = (first + count) % CHUNK_COUNT;
+            return first;
+        }
+    }
+
+    return -ENOMEM;
+}
+
+static uint32_t index_probe(uint32_t hash, const char *str, size_t len)
+{
+    uint32_t pos = hash & INDEX_MASK;
+
+    while (string_index[pos] != STRING_REF_NONE) {
+        const struct string_hdr *hdr = string_get(string_index[pos]);
+
+        if (hdr->len == len && memcmp(hdr->data, str, len) == 0) {
+            break;
+        }
+        pos = (pos + 1) & INDEX_MASK;
+    }
+
+    return pos;
+}
+
+/* Backward shift deletion, the same scheme the main device rental index uses */
+static void index_remove(uint32_t hole)
+{
+    uint32_t pos = hole;
+
+    for (;;) {
+        pos = (pos + 1) & INDEX_MASK;
+        if (string_index[pos] == STRING_REF_NONE) {
+            break;
+        }
+
+        const struct string_hdr *hdr = string_get(string_index[pos]);
+        uint32_t home = string_hash(hdr->data, hdr->len) & INDEX_MASK;
+
+        if (((pos - home) & INDEX_MASK) >= ((pos - hole) & INDEX_MASK)) {
+            string_index[hole] = string_index[pos];
+            hole = pos;
+        }
+    }
+
+    string_index[hole] = STRING_REF_NONE;
+}
+
+int string_pool_intern(const char *str, size_t len, string_ref_t *ref)
+{
+    if (!str || !ref || len == 0 || len > STRING_POOL_MAX_LEN) {
+        return -EINVAL;
+    }
+
+    uint32_t pos = index_probe(string_hash(str, len), str, len);
+
+    if (string_index[pos] != STRING_REF_NONE) {
+        struct string_hdr *hdr = string_get(string_index[pos]);
+
+        if (hdr->refs == UINT16_MAX) {
+            return -ENOMEM;
+        }
+        hdr->refs++;
+        *ref = string_index[pos];
+        return 0;
+    }
+
+    if (string_count >= MAX_STRINGS) {
+        return -ENOMEM;
+    }
+
+    int first = chunks_alloc(string_chunks(len));
+    if (first < 0) {
+        return first;
+    }
+
+    struct string_hdr *hdr = (struct string_hdr *)&arena[first * CHUNK_SIZE];
+
+    hdr->refs = 1;
+    hdr->len = len;
+    memcpy(hdr->data, str, len);
+
+    string_index[pos] = first + 1;
+    string_count++;
+    *ref = first + 1;
+    return 0;
+}
+
+void string_pool_release(string_ref_t ref)
+{
+    if (ref == STRING_REF_NONE) {
+        return;
+    }
+
+    struct string_hdr *hdr = string_get(ref);
+
+    if (--hdr->refs > 0) {
+        return;
+    }
+
+    uint32_t count = string_chunks(hdr->len);
+
+    index_remove(index_probe(string_hash(hdr->data, hdr->len), hdr->data, hdr->len));
+    chunks_mark(ref - 1, count, false);
+    used_chunks -= count;
+    string_count--;
+}
+
+size_t string_pool_get(string_ref_t ref, char *buf, size_t buf_len)
+{
+    if (ref == STRING_REF_NONE || !buf || buf_len == 0) {
+        return 0;
+    }
+
+    const struct string_hdr *hdr = string_get(ref);
+    size_t len = MIN(hdr->len, buf_len - 1);
+
+    memcpy(buf, hdr->data, len);
+    buf[len] = '\0';
+    return len;
+}
+
+bool string_pool_equals(string_ref_t ref, const char *str, size_t len)
+{
+    if (ref == STRING_REF_NONE) {
+        return false;
+    }
+
+    const struct string_hdr *hdr = string_get(ref);
+
+    return hdr->len == len && memcmp(hdr->data, str, len) == 0;
+}
+
+void string_pool_get_stats(struct string_pool_stats *stats)
+{
+    stats->strings = string_count;
+    stats->used_bytes = used_chunks * CHUNK_SIZE;
+    stats->size_bytes = sizeof(arena);
+}
@@ -0,0 +1,80 @@
+/**
+ * @file string_pool.h
+ * @brief Reference counted pool of interned strings
+ *
+ * Every distinct string is stored once in a fixed arena and shared by all
+ * its users through a 16-bit reference. The pool does no locking of its
+ * own; callers serialize access.
+ */
+
+#ifndef STRING_POOL_H
+#define STRING_POOL_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/** Reference to an interned string */
+typedef uint16_t string_ref_t;
+
+/** Reference that names no string */
+#define STRING_REF_NONE 0
+
+/** Longest string the pool stores */
+#define STRING_POOL_MAX_LEN UINT8_MAX
+
+/**
+ * @brief String pool usage
+ */
+struct string_pool_stats {
+    uint32_t strings;      /**< Distinct strings stored */
+    uint32_t used_bytes;   /**< Arena bytes in use, including headers */
+    uint32_t size_bytes;   /**< Arena size */
+};
+
+/**
+ * @brief Intern a string, taking a reference to it
+ *
+ * @param str String, does not need to be NUL terminated
+ * @param len Length of the string
+ * @param ref Pointer to store the reference in
+ * @return int 0 on success, -ENOMEM if the pool is full, negative error
+ *             code otherwise
+ */
+int string_pool_intern(const char *str, size_t len, string_ref_t *ref);
+
+/**
+ * @brief Drop a reference, freeing the string with its last one
+ *
+ * @param ref Reference returned by string_pool_intern(), STRING_REF_NONE is ignored
+ */
+void string_pool_release(string_ref_t ref);
+
+/**
+ * @brief Copy an interned string out as a NUL terminated string
+ *
+ * @param ref Reference returned by string_pool_intern()
+ * @param buf Output buffer
+ * @param buf_len Size of the output buffer, the string is truncated to fit
+ * @return size_t Number of characters copied, excluding the terminator
+ */
+size_t string_pool_get(string_ref_t ref, char *buf, size_t buf_len);
+
+/**
+ * @brief Compare an interned string with a string
+ *
+ * @param ref Reference returned by string_pool_intern()
+ * @param str String to compare with
+ * @param len Length of @p str
+ * @return true if they are equal
+ */
+bool string_pool_equals(string_ref_t ref, const char *str, size_t len);
+
+/**
+ * @brief Get string pool usage
+ *
+ * @param stats Pointer to store the usage
+ */
+void string_pool_get_stats(struct string_pool_stats *stats);
+
+#endif /* STRING_POOL_H */
\ No newline at end of file
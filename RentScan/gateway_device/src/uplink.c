@@ -0,0 +1,449 @@
+/**
+ * @file uplink.c
+ * @brief Batched delivery of outbox messages to the backend
+ *
+ * The uplink thread is the only reader of the outbox. Producers append to
+ * the log and kick the thread, so BLE ingress never waits on the backend.
+ * A frame is filled from the log until it is full or the batch window
+ * closes, sent, and acknowledged in the outbox once the transport reports
+ * completion. At most one frame is in flight.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/byteorder.h>
+#include <string.h>
+#include "uplink.h"
+#include "outbox.h"
+#include "latency_stats.h"
+#include "../../common/include/rentscan_protocol.h"
+
+LOG_MODULE_REGISTER(uplink, LOG_LEVEL_INF);
+
+#define FRAME_SIZE CONFIG_RENTSCAN_UPLINK_FRAME_SIZE
+
+/* cmd, flags, status, tag header and tag, timestamp, duration, correlation, payload */
+#define FRAME_MSG_MAX_LEN (3 + 2 + MAX_TAG_ID_LEN + 5 + 5 + 10 + 2 + MAX_MSG_PAYLOAD)
+
+BUILD_ASSERT(FRAME_SIZE >= UPLINK_FRAME_HDR_LEN + FRAME_MSG_MAX_LEN,
+             "Uplink frame must hold at least one message");
+
+#if defined(CONFIG_RENTSCAN_UPLINK_UART)
+#define TRANSPORT uplink_uart_transport
+#else
+#define TRANSPORT uplink_sim_transport
+#endif
+
+struct frame_builder {
+    uint8_t buf[FRAME_SIZE];
+    size_t pos;
+    uint8_t count;
+    bool full;
+    uint32_t first_seq;
+    uint32_t last_seq;
+    uint32_t prev_timestamp;
+    uint8_t prev_tag[MAX_TAG_ID_LEN];
+    uint8_t prev_tag_len;
+    size_t prev_payload_pos;
+    uint8_t prev_payload_len;
+    size_t raw_len;
+    /* Taps in the frame whose latency is being measured */
+    uint32_t corr_ids[CONFIG_RENTSCAN_LATENCY_TRACKED];
+    size_t corr_count;
+};
+
+/* Only touched by the uplink thread, and by outbox_replay() on its behalf */
+static struct frame_builder frame;
+
+K_THREAD_STACK_DEFINE(uplink_stack, CONFIG_RENTSCAN_UPLINK_THREAD_STACK_SIZE);
+static struct k_thread uplink_thread;
+
+static K_SEM_DEFINE(kick_sem, 0, 1);
+static K_SEM_DEFINE(done_sem, 0, 1);
+static atomic_t done_err;
+static atomic_t enabled = ATOMIC_INIT(1);
+
+static struct k_spinlock stats_lock;
+static struct uplink_stats totals;
+static uint32_t raw_total;
+static int64_t window_start;
+static uint32_t window_msgs;
+static uint32_t window_bytes;
+
+static void put_u8(uint8_t val)
+{
+    frame.buf[frame.pos++] = val;
+}
+
+static void put_varint(uint32_t val)
+{
+    do {
+        uint8_t byte = val & 0x7F;
+
+        val >>= 7;
+        put_u8(val ? (byte | 0x80) : byte);
+    } while (val);
+}
+
+static void put_bytes(const uint8_t *data, size_t len)
+{
+    memcpy(&frame.buf[frame.pos], data, len);
+    frame.pos += len;
+}
+
+static size_t varint_len(uint32_t val)
+{
+    size_t len = 1;
+
+    while (val >>= 7) {
+        len++;
+    }
+    return len;
+}
+
+static uint32_t zigzag(int32_t val)
+{
+    return ((uint32_t)val << 1) ^ (uint32_t)(val >> 31);
+}
+
+static void frame_reset(void)
+{
+    frame.pos = 0;
+    frame.count = 0;
+    frame.full = false;
+    frame.raw_len = 0;
+    frame.corr_count = 0;
+}
+
+/* outbox_replay() callback, refusing a message ends the frame */
+static int frame_add(uint32_t seq, const rentscan_msg_t *msg)
+{
+    uint8_t raw[RENTSCAN_WIRE_MSG_MAX_LEN];
+    uint8_t shared = 0;
+    uint8_t flags = 0;
+    size_t need;
+
+    if (frame.count == UINT8_MAX || (frame.count && seq != frame.last_seq + 1)) {
+        frame.full = true;
+        return -ENOSPC;
+    }
+
+    if (!frame.count) {
+        frame.first_seq = seq;
+        frame.prev_timestamp = msg->timestamp;
+        frame.prev_tag_len = 0;
+        frame.prev_payload_len = 0;
+    }
+
+    while (shared < msg->tag_id_len && shared < frame.prev_tag_len &&
+           msg->tag_id[shared] == frame.prev_tag[shared]) {
+        shared++;
+    }
+
+    uint32_t delta = zigzag((int32_t)(msg->timestamp - frame.prev_timestamp));
+    bool same_payload = msg->payload_len && msg->payload_len == frame.prev_payload_len &&
+                        memcmp(msg->payload, &frame.buf[frame.prev_payload_pos],
+                               msg->payload_len) == 0;
+
+    if (msg->duration) {
+        flags |= UPLINK_MSG_DURATION;
+    }
+    if (msg->corr_id) {
+        flags |= UPLINK_MSG_CORR;
+    }
+    if (same_payload) {
+        flags |= UPLINK_MSG_PAYLOAD_SAME;
+    } else if (msg->payload_len) {
+        flags |= UPLINK_MSG_PAYLOAD;
+    }
+
+    need = 5 + (msg->tag_id_len - shared) + varint_len(delta);
+    if (flags & UPLINK_MSG_DURATION) {
+        need += varint_len(msg->duration);
+    }
+    if (flags & UPLINK_MSG_CORR) {
+        need += varint_len(msg->corr_id) + varint_len(msg->latency_us);
+    }
+    if (flags & UPLINK_MSG_PAYLOAD) {
+        need += varint_len(msg->payload_len) + msg->payload_len;
+    }
+    if (!frame.count) {
+        need += UPLINK_FRAME_HDR_LEN;
+    }
+
+    if (frame.pos + need > sizeof(frame.buf)) {
+        frame.full = true;
+        return -ENOSPC;
+    }
+
+    if (!frame.count) {
+        put_u8(UPLINK_FRAME_VERSION);
+        put_u8(0);  /* Count, filled in before sending */
+        sys_put_le32(seq, &frame.buf[frame.pos]);
+        frame.pos += 4;
+        sys_put_le32(msg->timestamp, &frame.buf[frame.pos]);
+        frame.pos += 4;
+    }
+
+    put_u8(msg->cmd);
+    put_u8(flags);
+    put_u8(msg->status);
+    put_u8(shared);
+    put_u8(msg->tag_id_len - shared);
+    put_bytes(&msg->tag_id[shared], msg->tag_id_len - shared);
+    put_varint(delta);
+
+    if (flags & UPLINK_MSG_DURATION) {
+        put_varint(msg->duration);
+    }
+    if (flags & UPLINK_MSG_CORR) {
+        put_varint(msg->corr_id);
+        put_varint(msg->latency_us);
+        if (frame.corr_count < ARRAY_SIZE(frame.corr_ids)) {
+            frame.corr_ids[frame.corr_count++] = msg->corr_id;
+        }
+    }
+    if (flags & UPLINK_MSG_PAYLOAD) {
+        put_varint(msg->payload_len);
+        frame.prev_payload_pos = frame.pos;
+        frame.prev_payload_len = msg->payload_len;
+        put_bytes(msg->payload, msg->payload_len);
+    }
+
+    memcpy(frame.prev_tag, msg->tag_id, msg->tag_id_len);
+    frame.prev_tag_len = msg->tag_id_len;
+    frame.prev_timestamp = msg->timestamp;
+    frame.last_seq = seq;
+    frame.count++;
+
+    /* What the message would have cost in its own wire encoding */
+    int raw_len = rentscan_msg_encode(msg, raw, sizeof(raw));
+    if (raw_len > 0) {
+        frame.raw_len += raw_len;
+    }
+
+    return 0;
+}
+
+static bool link_up(void)
+{
+    return atomic_get(&enabled) && TRANSPORT.ready();
+}
+
+/* Fill the frame from the outbox, waiting up to the batch window for more */
+static void frame_fill(void)
+{
+    int64_t deadline = k_uptime_get() + CONFIG_RENTSCAN_UPLINK_BATCH_MS;
+
+    frame_reset();
+
+    for (;;) {
+        int sent = outbox_replay(frame_add, CONFIG_RENTSCAN_OUTBOX_REPLAY_BATCH);
+
+        if (sent < 0) {
+            LOG_ERR("Outbox replay failed (err %d)", sent);
+            return;
+        }
+
+        if (frame.full || !link_up()) {
+            return;
+        }
+
+        if (sent == CONFIG_RENTSCAN_OUTBOX_REPLAY_BATCH) {
+            continue;
+        }
+
+        int64_t remaining = deadline - k_uptime_get();
+
+        if (remaining <= 0 || k_sem_take(&kick_sem, K_MSEC(remaining))) {
+            return;
+        }
+    }
+}
+
+static void stats_update(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    int64_t now = k_uptime_get();
+
+    totals.frames++;
+    totals.messages += frame.count;
+    totals.bytes += frame.pos;
+    raw_total += frame.raw_len;
+
+    window_msgs += frame.count;
+    window_bytes += frame.pos;
+
+    if (now - window_start >= CONFIG_RENTSCAN_UPLINK_RATE_WINDOW_MS) {
+        uint32_t elapsed = now - window_start;
+
+        totals.msg_rate = (uint64_t)window_msgs * MSEC_PER_SEC / elapsed;
+        totals.byte_rate = (uint64_t)window_bytes * MSEC_PER_SEC / elapsed;
+        window_start = now;
+        window_msgs = 0;
+        window_bytes = 0;
+    }
+
+    k_spin_unlock(&stats_lock, key);
+}
+
+static void frame_send(void)
+{
+    int err;
+
+    frame.buf[1] = frame.count;
+
+    uint32_t sent_cycles = k_cycle_get_32();
+
+    k_sem_reset(&done_sem);
+    err = TRANSPORT.send(frame.buf, frame.pos);
+    if (!err) {
+        if (k_sem_take(&done_sem, K_MSEC(CONFIG_RENTSCAN_UPLINK_TX_TIMEOUT_MS))) {
+            err = -ETIMEDOUT;
+        } else {
+            err = atomic_get(&done_err);
+        }
+    }
+
+    if (err) {
+        LOG_WRN("Frame %u-%u not delivered (err %d)", frame.first_seq, frame.last_seq, err);
+        k_spinlock_key_t key = k_spin_lock(&stats_lock);
+        totals.errors++;
+        k_spin_unlock(&stats_lock, key);
+
+        /* Everything after the last ack goes out again */
+        outbox_rewind();
+        k_sleep(K_MSEC(CONFIG_RENTSCAN_UPLINK_RETRY_MS));
+        return;
+    }
+
+    LOG_DBG("Frame %u-%u delivered (%u messages, %u bytes)", frame.first_seq,
+            frame.last_seq, frame.count, frame.pos);
+
+    err = outbox_ack(frame.last_seq);
+    if (err) {
+        LOG_ERR("Failed to acknowledge outbox up to %u (err %d)", frame.last_seq, err);
+    }
+
+    stats_update();
+
+    latency_stats_record(LATENCY_UPLINK_TO_ACK, sent_cycles, k_cycle_get_32());
+    latency_stats_delivered(frame.corr_ids, frame.corr_count, sent_cycles);
+}
+
+static void uplink_thread_fn(void *p1, void *p2, void *p3)
+{
+    ARG_UNUSED(p1);
+    ARG_UNUSED(p2);
+    ARG_UNUSED(p3);
+
+    bool was_up = false;
+
+    for (;;) {
+        bool up = link_up();
+
+        if (up && !was_up) {
+            LOG_INF("Backend reachable over %s", TRANSPORT.name);
+            /* Resend everything the backend has not acknowledged yet */
+            outbox_rewind();
+        } else if (!up && was_up) {
+            LOG_WRN("Backend unreachable, keeping messages in the outbox");
+        }
+        was_up = up;
+
+        if (!up || outbox_unsent() == 0) {
+            k_sem_take(&kick_sem, K_FOREVER);
+            continue;
+        }
+
+        frame_fill();
+        if (frame.count && link_up()) {
+            frame_send();
+        } else if (frame.count) {
+            /* Lost the link while batching, the next frame starts over */
+            outbox_rewind();
+        }
+    }
+}
+
+int uplink_init(void)
+{
+    int err = TRANSPORT.init();
+
+    if (err) {
+        LOG_ERR("Failed to initialize %s transport (err %d)", TRANSPORT.name, err);
+        return err;
+    }
+
+    window_start = k_uptime_get();
+
+    k_thread_create(&uplink_thread, uplink_stack,
+                    K_THREAD_STACK_SIZEOF(uplink_stack),
+                    uplink_thread_fn, NULL, NULL, NULL,
+                    CONFIG_RENTSCAN_UPLINK_THREAD_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&uplink_thread, "uplink");
+
+    LOG_INF("Uplink initialized (%s, %d byte frames)", TRANSPORT.name, FRAME_SIZE);
+    return 0;
+}
+
+void uplink_kick(void)
+{
+    k_sem_give(&kick_sem);
+}
+
+void uplink_set_enabled(bool enable)
+{
+    atomic_set(&enabled, enable);
+
+    if (enable && TRANSPORT.connect) {
+        int err = TRANSPORT.connect();
+
+        if (err) {
+            LOG_WRN("Failed to connect %s transport (err %d)", TRANSPORT.name, err);
+        }
+    }
+
+    uplink_kick();
+}
+
+bool uplink_is_up(void)
+{
+    return link_up();
+}
+
+void uplink_get_stats(struct uplink_stats *stats)
+{
+    if (!stats) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+    *stats = totals;
+    stats->fill_pct = totals.frames ?
+        (uint64_t)totals.bytes * 100 / ((uint64_t)totals.frames * FRAME_SIZE) : 0;
+    stats->ratio_pct = raw_total ?
+        MIN((uint64_t)totals.bytes * 100 / raw_total, UINT8_MAX) : 0;
+
+    /* No frame closed the last window, the link has gone quiet */
+    if (k_uptime_get() - window_start >= 2 * CONFIG_RENTSCAN_UPLINK_RATE_WINDOW_MS) {
+        stats->msg_rate = 0;
+        stats->byte_rate = 0;
+    }
+    k_spin_unlock(&stats_lock, key);
+
+    stats->transport = TRANSPORT.name;
+    stats->up = link_up();
+}
+
+void uplink_transport_done(int err)
+{
+    atomic_set(&done_err, err);
+    k_sem_give(&done_sem);
+}
+
+void uplink_transport_changed(void)
+{
+    uplink_kick();
+}
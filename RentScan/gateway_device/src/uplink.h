@@ -0,0 +1,142 @@
+/**
+ * @file uplink.h
+ * @brief Batched delivery of outbox messages to the backend
+ *
+ * A dedicated thread packs the messages waiting in the outbox into frames
+ * and hands each frame to the configured transport. The outbox is only
+ * acknowledged once the transport reports the frame as delivered, so a
+ * failed or lost frame is sent again from the log.
+ *
+ * Frame layout, all integers little endian:
+ *
+ *   [version][count][first seq (4)][base timestamp (4)][message]...
+ *
+ * Messages carry consecutive outbox sequence numbers starting at the one
+ * in the header. Each message is encoded as:
+ *
+ *   [cmd][flags][status][tag shared][tag suffix length][suffix]
+ *   [timestamp delta][duration][correlation ID][latency][payload length]
+ *   [payload]
+ *
+ * The tag ID only stores the bytes that differ from the previous tag in
+ * the frame. The timestamp delta is a zigzag varint relative to the
+ * previous message, the first one is relative to the base timestamp.
+ * Duration, payload and the correlation ID of a tap with the time the main
+ * device spent on it are only present when their flag is set, all as
+ * varints. A payload equal to the previous one is sent as a flag alone.
+ */
+
+#ifndef UPLINK_H
+#define UPLINK_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <zephyr/sys/util.h>
+
+/** Version byte of the frame layout */
+#define UPLINK_FRAME_VERSION 2
+
+/** Size of the frame header */
+#define UPLINK_FRAME_HDR_LEN 10
+
+/** Message flags, in the second byte of each message */
+#define UPLINK_MSG_DURATION     BIT(0)  /**< Duration follows */
+#define UPLINK_MSG_PAYLOAD      BIT(1)  /**< Payload length and payload follow */
+#define UPLINK_MSG_PAYLOAD_SAME BIT(2)  /**< Payload equals the previous message's */
+#define UPLINK_MSG_CORR         BIT(3)  /**< Correlation ID and latency follow */
+
+/**
+ * @brief Backend transport
+ *
+ * A transport moves frames to the backend. send() may return before the
+ * frame is on its way, but must not use @p frame once it returns; the
+ * outcome is reported through uplink_transport_done().
+ */
+struct uplink_transport {
+    const char *name;                                    /**< Name shown in the status */
+    int (*init)(void);                                   /**< Called once from uplink_init() */
+    int (*connect)(void);                                /**< Re-establish the link, can be NULL */
+    bool (*ready)(void);                                 /**< Whether frames can be sent */
+    int (*send)(const uint8_t *frame, size_t len);       /**< Start sending one frame */
+};
+
+/** Simulated backend that accepts every frame after a short delay */
+extern const struct uplink_transport uplink_sim_transport;
+
+/** SLIP framed UART or USB CDC ACM link to a host */
+extern const struct uplink_transport uplink_uart_transport;
+
+/**
+ * @brief Uplink statistics
+ */
+struct uplink_stats {
+    const char *transport;  /**< Name of the transport in use */
+    bool up;                /**< Whether the backend is reachable */
+    uint32_t frames;        /**< Frames delivered */
+    uint32_t messages;      /**< Messages delivered */
+    uint32_t bytes;         /**< Frame bytes delivered */
+    uint32_t errors;        /**< Frames that failed and were resent */
+    uint8_t fill_pct;       /**< Average frame size relative to the frame buffer */
+    uint8_t ratio_pct;      /**< Frame bytes relative to the messages' wire encoding */
+    uint32_t msg_rate;      /**< Messages per second over the last rate window */
+    uint32_t byte_rate;     /**< Bytes per second over the last rate window */
+};
+
+/**
+ * @brief Initialize the transport and start the uplink thread
+ *
+ * Must be called after outbox_init().
+ *
+ * @return int 0 on success, negative error code otherwise
+ */
+int uplink_init(void);
+
+/**
+ * @brief Tell the uplink thread that messages were added to the outbox
+ *
+ * Never blocks, safe to call from any thread.
+ */
+void uplink_kick(void);
+
+/**
+ * @brief Enable or disable delivery to the backend
+ *
+ * Enabling also asks the transport to reconnect. Everything the backend
+ * has not acknowledged is resent once the link is up.
+ *
+ * @param enable true to deliver messages, false to keep them in the outbox
+ */
+void uplink_set_enabled(bool enable);
+
+/**
+ * @brief Check if messages can currently be delivered
+ *
+ * @return true if the uplink is enabled and the transport is ready
+ */
+bool uplink_is_up(void);
+
+/**
+ * @brief Get uplink statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void uplink_get_stats(struct uplink_stats *stats);
+
+/**
+ * @brief Report the outcome of the frame passed to send()
+ *
+ * Called by transports, also from interrupt context.
+ *
+ * @param err 0 if the frame was delivered, negative error code otherwise
+ */
+void uplink_transport_done(int err);
+
+/**
+ * @brief Report a change of the transport's ready state
+ *
+ * Called by transports, also from interrupt context.
+ */
+void uplink_transport_changed(void);
+
+#endif /* UPLINK_H */
\ No newline at end of file
@@ -0,0 +1,103 @@
+/**
+ * @file uplink_sim.c
+ * @brief Simulated backend transport
+ *
+ * Stands in for a real backend during demos: the connection comes and goes
+ * at random, and every frame sent while it is up is accepted after a
+ * short round trip.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/random/rand32.h>
+#include <zephyr/sys/atomic.h>
+#include "uplink.h"
+#include "workq.h"
+
+LOG_MODULE_REGISTER(uplink_sim, LOG_LEVEL_INF);
+
+/* 10 second interval for connection checks */
+#define SIM_CHECK_INTERVAL_MS 10000
+
+/* Time the simulated backend takes to accept a frame */
+#define SIM_ROUND_TRIP_MS 20
+
+static atomic_t sim_connected;
+
+static void sim_check_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sim_check_work, sim_check_handler);
+
+static void sim_done_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sim_done_work, sim_done_handler);
+
+/* Simulate backend connection state changes with some randomness */
+static void sim_check_handler(struct k_work *work)
+{
+    int random_val = sys_rand32_get() % 10;
+
+    if (!atomic_get(&sim_connected) && random_val >= 2) {
+        /* 80% chance to connect if disconnected */
+        atomic_set(&sim_connected, 1);
+        LOG_INF("Backend connection established");
+        uplink_transport_changed();
+    } else if (atomic_get(&sim_connected) && random_val == 0) {
+        /* 10% chance to disconnect if connected */
+        atomic_set(&sim_connected, 0);
+        LOG_WRN("Backend connection lost");
+        uplink_transport_changed();
+    }
+
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &sim_check_work,
+                              K_MSEC(SIM_CHECK_INTERVAL_MS));
+}
+
+/* A frame in flight when the connection drops is lost */
+static void sim_done_handler(struct k_work *work)
+{
+    uplink_transport_done(atomic_get(&sim_connected) ? 0 : -ENOTCONN);
+}
+
+static int sim_init(void)
+{
+    /* 70% chance to start as connected */
+    atomic_set(&sim_connected, sys_rand32_get() % 10 >= 3);
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &sim_check_work,
+                              K_MSEC(SIM_CHECK_INTERVAL_MS));
+
+    LOG_INF("Simulated backend %s", atomic_get(&sim_connected) ? "connected" : "disconnected");
+    return 0;
+}
+
+static int sim_connect(void)
+{
+    if (!atomic_set(&sim_connected, 1)) {
+        LOG_INF("Backend connection established (manual)");
+    }
+    return 0;
+}
+
+static bool sim_ready(void)
+{
+    return atomic_get(&sim_connected);
+}
+
+static int sim_send(const uint8_t *frame, size_t len)
+{
+    if (!atomic_get(&sim_connected)) {
+        return -ENOTCONN;
+    }
+
+    LOG_INF("Sent %u message frame to backend (%u bytes)", frame[1], (unsigned int)len);
+
+    /* Stands in for a transport interrupt, so not queued behind housekeeping */
+    k_work_schedule(&sim_done_work, K_MSEC(SIM_ROUND_TRIP_MS));
+    return 0;
+}
+
+const struct uplink_transport uplink_sim_transport = {
+    .name = "simulated",
+    .init = sim_init,
+    .connect = sim_connect,
+    .ready = sim_ready,
+    .send = sim_send,
+};
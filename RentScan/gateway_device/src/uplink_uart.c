@@ -0,0 +1,162 @@
+/**
+ * @file uplink_uart.c
+ * @brief Backend transport over a UART or USB CDC ACM port
+ *
+ * Each frame is followed by its CRC-16/CCITT (crc16_ccitt() with seed
+ * 0xFFFF, little endian) and sent SLIP encoded, so the host can find
+ * frame boundaries in the byte stream and drop corrupted frames. The port
+ * is the one chosen as rentscan,uplink-uart in the devicetree.
+ *
+ * A frame counts as delivered once the last byte is handed to the driver;
+ * there is no acknowledgement from the host.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/crc.h>
+#include "uplink.h"
+#include "workq.h"
+
+LOG_MODULE_REGISTER(uplink_uart, LOG_LEVEL_INF);
+
+#define UPLINK_UART_NODE DT_CHOSEN(rentscan_uplink_uart)
+
+BUILD_ASSERT(DT_NODE_HAS_STATUS(UPLINK_UART_NODE, okay),
+             "The UART uplink needs an enabled rentscan,uplink-uart chosen node");
+
+#define SLIP_END     0xC0
+#define SLIP_ESC     0xDB
+#define SLIP_ESC_END 0xDC
+#define SLIP_ESC_ESC 0xDD
+
+/* How often the host side of a CDC ACM port is checked */
+#define DTR_POLL_MS 1000
+
+static const struct device *const uart_dev = DEVICE_DT_GET(UPLINK_UART_NODE);
+
+/* Worst case every byte is escaped, plus a delimiter on both ends */
+static uint8_t tx_buf[2 * (CONFIG_RENTSCAN_UPLINK_FRAME_SIZE + 2) + 2];
+static size_t tx_len;
+static size_t tx_pos;
+static atomic_t tx_busy;
+static atomic_t host_ready = ATOMIC_INIT(1);
+
+static size_t slip_put(size_t pos, uint8_t byte)
+{
+    if (byte == SLIP_END) {
+        tx_buf[pos++] = SLIP_ESC;
+        tx_buf[pos++] = SLIP_ESC_END;
+    } else if (byte == SLIP_ESC) {
+        tx_buf[pos++] = SLIP_ESC;
+        tx_buf[pos++] = SLIP_ESC_ESC;
+    } else {
+        tx_buf[pos++] = byte;
+    }
+    return pos;
+}
+
+static void uart_isr(const struct device *dev, void *user_data)
+{
+    ARG_UNUSED(user_data);
+
+    if (!uart_irq_update(dev) || !uart_irq_tx_ready(dev)) {
+        return;
+    }
+
+    if (tx_pos < tx_len) {
+        tx_pos += uart_fifo_fill(dev, &tx_buf[tx_pos], tx_len - tx_pos);
+        return;
+    }
+
+    uart_irq_tx_disable(dev);
+    atomic_clear(&tx_busy);
+    uplink_transport_done(0);
+}
+
+#if defined(CONFIG_UART_LINE_CTRL)
+/* A CDC ACM port is only worth writing to while a host has it open */
+static void dtr_poll_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(dtr_poll_work, dtr_poll_handler);
+
+static void dtr_poll_handler(struct k_work *work)
+{
+    uint32_t dtr = 1;
+
+    /* Ports without line control are always considered open */
+    if (uart_line_ctrl_get(uart_dev, UART_LINE_CTRL_DTR, &dtr) == 0 &&
+        atomic_set(&host_ready, dtr != 0) != (dtr != 0)) {
+        LOG_INF("Host %s the uplink port", dtr ? "opened" : "closed");
+        uplink_transport_changed();
+    }
+
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &dtr_poll_work, K_MSEC(DTR_POLL_MS));
+}
+#endif
+
+static int uart_uplink_init(void)
+{
+    int err;
+
+    if (!device_is_ready(uart_dev)) {
+        LOG_ERR("Uplink UART %s not ready", uart_dev->name);
+        return -ENODEV;
+    }
+
+    err = uart_irq_callback_user_data_set(uart_dev, uart_isr, NULL);
+    if (err) {
+        return err;
+    }
+
+#if defined(CONFIG_UART_LINE_CTRL)
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &dtr_poll_work, K_NO_WAIT);
+#endif
+
+    LOG_INF("Uplink on %s", uart_dev->name);
+    return 0;
+}
+
+static bool uart_uplink_ready(void)
+{
+    return atomic_get(&host_ready);
+}
+
+static int uart_uplink_send(const uint8_t *frame, size_t len)
+{
+    uint16_t crc;
+    size_t pos = 0;
+
+    if (len > CONFIG_RENTSCAN_UPLINK_FRAME_SIZE) {
+        return -EMSGSIZE;
+    }
+
+    if (atomic_set(&tx_busy, 1)) {
+        return -EBUSY;
+    }
+
+    crc = crc16_ccitt(0xFFFF, frame, len);
+
+    /* The leading delimiter ends any garbage the host saw before */
+    tx_buf[pos++] = SLIP_END;
+    for (size_t i = 0; i < len; i++) {
+        pos = slip_put(pos, frame[i]);
+    }
+    pos = slip_put(pos, crc & 0xFF);
+    pos = slip_put(pos, crc >> 8);
+    tx_buf[pos++] = SLIP_END;
+
+    tx_len = pos;
+    tx_pos = 0;
+    uart_irq_tx_enable(uart_dev);
+    return 0;
+}
+
+const struct uplink_transport uplink_uart_transport = {
+    .name = "uart",
+    .init = uart_uplink_init,
+    .connect = NULL,
+    .ready = uart_uplink_ready,
+    .send = uart_uplink_send,
+};
@@ -0,0 +1,29 @@
+/**
+ * @file workq.c
+ * @brief Work queues of the gateway
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "workq.h"
+
+LOG_MODULE_REGISTER(workq, LOG_LEVEL_INF);
+
+RENTSCAN_WORKQ_DEFINE(workq_rental, "rental_wq",
+                      CONFIG_RENTSCAN_RENTAL_WORKQ_STACK_SIZE,
+                      CONFIG_RENTSCAN_RENTAL_WORKQ_PRIORITY);
+RENTSCAN_WORKQ_DEFINE(workq_persist, "persist_wq",
+                      CONFIG_RENTSCAN_PERSIST_WORKQ_STACK_SIZE,
+                      CONFIG_RENTSCAN_PERSIST_WORKQ_PRIORITY);
+RENTSCAN_WORKQ_DEFINE(workq_housekeeping, "housekeeping_wq",
+                      CONFIG_RENTSCAN_HOUSEKEEPING_WORKQ_STACK_SIZE,
+                      CONFIG_RENTSCAN_HOUSEKEEPING_WORKQ_PRIORITY);
+
+void workq_init(void)
+{
+    rentscan_workq_start(&workq_rental);
+    rentscan_workq_start(&workq_persist);
+    rentscan_workq_start(&workq_housekeeping);
+
+    LOG_INF("Work queues started");
+}
@@ -0,0 +1,32 @@
+/**
+ * @file workq.h
+ * @brief Work queues of the gateway
+ *
+ * Messages from the main devices have their own ingress thread and the
+ * backend its uplink thread. Everything else the gateway schedules runs
+ * on the queues below rather than the system work queue, which is left
+ * to the Bluetooth host and the kernel.
+ */
+
+#ifndef WORKQ_H
+#define WORKQ_H
+
+#include "../../common/include/rentscan_workq.h"
+
+/** Rental logic: expiry and sync requests */
+extern struct rentscan_workq workq_rental;
+
+/** Flash writes of the handle cache */
+extern struct rentscan_workq workq_persist;
+
+/** Health checks, connection policy, metrics and uplink polling */
+extern struct rentscan_workq workq_housekeeping;
+
+/**
+ * @brief Start every work queue
+ *
+ * Must run before any other module is initialized.
+ */
+void workq_init(void);
+
+#endif /* WORKQ_H */
\ No newline at end of file
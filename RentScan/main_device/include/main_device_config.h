@@ -7,7 +7,6 @@
 #define MAIN_DEVICE_CONFIG_H
 
 /** NFC configuration */
-#define NFC_POLL_PERIOD_MS 500        /**< NFC polling period in milliseconds */
 #define NFC_READ_RETRY_LIMIT 3        /**< Number of NFC read retries */
 #define NFC_WRITE_RETRY_LIMIT 3       /**< Number of NFC write retries */
 
@@ -16,9 +15,9 @@
 #define BLE_ADV_FAST_INT_MAX 0x0040   /**< Fast advertising interval maximum (40 ms) */
 #define BLE_ADV_SLOW_INT_MIN 0x0640   /**< Slow advertising interval minimum (1 second) */
 #define BLE_ADV_SLOW_INT_MAX 0x0780   /**< Slow advertising interval maximum (1.2 seconds) */
+#define BLE_TX_FLUSH_DELAY_MS 10      /**< Max time a message waits in the TX batch before it is sent */
 
 /** Rental configuration */
 #define DEFAULT_RENTAL_DURATION 3600  /**< Default rental duration in seconds (1 hour) */
-#define RENTAL_EXPIRY_CHECK_PERIOD 60 /**< How often to check for rental expiry (seconds) */
 
 #endif /* MAIN_DEVICE_CONFIG_H */
\ No newline at end of file
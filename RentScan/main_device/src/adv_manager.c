@@ -0,0 +1,207 @@
+/**
+ * @file adv_manager.c
+ * @brief Advertising state machine and energy model of the main device
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/conn.h>
+#include <zephyr/logging/log.h>
+#include "adv_manager.h"
+#include "ble_service.h"
+#include "workq.h"
+#include "../include/main_device_config.h"
+
+LOG_MODULE_REGISTER(adv_manager, LOG_LEVEL_INF);
+
+/* Retry delay when advertising can't start, e.g. before the stack has
+ * freed the connection that just ended
+ */
+#define ADV_RETRY_MS 100
+
+/* Every advertising event is delayed by a random 0-10 ms advDelay */
+#define ADV_DELAY_MEAN_US 5000
+
+/* Interval units of 0.625 ms */
+#define ADV_INTERVAL_UNIT_US 625
+
+enum {
+    ADV_FLAG_REQ_FAST,      /* Fast window asked for */
+    ADV_FLAG_CONNECTED,     /* Gateway connected, don't advertise */
+};
+
+static const char *const mode_names[ADV_MODE_COUNT] = {
+    [ADV_MODE_OFF] = "off",
+    [ADV_MODE_FAST] = "fast",
+    [ADV_MODE_SLOW] = "slow",
+    [ADV_MODE_CONNECTED] = "connected",
+};
+
+static struct k_work_delayable adv_work;
+static atomic_t adv_flags;
+
+/* Mode and time accounting, updated from the work queue and the stack */
+static struct k_spinlock mode_lock;
+static enum adv_mode mode;
+static int64_t mode_since_ms;
+static uint64_t mode_time_ms[ADV_MODE_COUNT];
+static uint32_t fast_windows;
+
+static void switch_mode_locked(enum adv_mode new_mode)
+{
+    int64_t now = k_uptime_get();
+
+    mode_time_ms[mode] += now - mode_since_ms;
+    mode_since_ms = now;
+
+    if (new_mode == ADV_MODE_FAST) {
+        fast_windows++;
+    }
+    if (new_mode != mode) {
+        LOG_DBG("Advertising %s -> %s", mode_names[mode], mode_names[new_mode]);
+        mode = new_mode;
+    }
+}
+
+/* Start advertising at one interval, unless the gateway connected meanwhile */
+static int apply_mode(bool fast)
+{
+    int err = ble_service_start_advertising(fast);
+    k_spinlock_key_t key = k_spin_lock(&mode_lock);
+
+    if (!atomic_test_bit(&adv_flags, ADV_FLAG_CONNECTED)) {
+        switch_mode_locked(err ? ADV_MODE_OFF : fast ? ADV_MODE_FAST : ADV_MODE_SLOW);
+    }
+    k_spin_unlock(&mode_lock, key);
+
+    return err;
+}
+
+static void request_fast(void)
+{
+    atomic_set_bit(&adv_flags, ADV_FLAG_REQ_FAST);
+    k_work_reschedule_for_queue(&workq_housekeeping.queue, &adv_work, K_NO_WAIT);
+}
+
+/* Runs for a fast window request, and once the window is over */
+static void adv_work_handler(struct k_work *work)
+{
+    if (atomic_test_bit(&adv_flags, ADV_FLAG_CONNECTED)) {
+        return;
+    }
+
+    bool fast = atomic_test_and_clear_bit(&adv_flags, ADV_FLAG_REQ_FAST);
+    int err = apply_mode(fast);
+
+    if (err) {
+        LOG_WRN("Cannot start %s advertising (err %d), retrying", fast ? "fast" : "slow", err);
+        if (fast) {
+            atomic_set_bit(&adv_flags, ADV_FLAG_REQ_FAST);
+        }
+        k_work_reschedule_for_queue(&workq_housekeeping.queue, &adv_work, K_MSEC(ADV_RETRY_MS));
+        return;
+    }
+
+    if (fast) {
+        k_work_reschedule_for_queue(&workq_housekeeping.queue, &adv_work,
+                                    K_MSEC(CONFIG_RENTSCAN_ADV_FAST_WINDOW_MS));
+    }
+}
+
+static void connected(struct bt_conn *conn, uint8_t err)
+{
+    if (err) {
+        return;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&mode_lock);
+
+    /* The stack ended the advertising, see ble_service_start_advertising() */
+    atomic_set_bit(&adv_flags, ADV_FLAG_CONNECTED);
+    switch_mode_locked(ADV_MODE_CONNECTED);
+    k_spin_unlock(&mode_lock, key);
+
+    k_work_cancel_delayable(&adv_work);
+}
+
+static void disconnected(struct bt_conn *conn, uint8_t reason)
+{
+    k_spinlock_key_t key = k_spin_lock(&mode_lock);
+
+    atomic_clear_bit(&adv_flags, ADV_FLAG_CONNECTED);
+    switch_mode_locked(ADV_MODE_OFF);
+    k_spin_unlock(&mode_lock, key);
+
+    /* The gateway most likely scans for us right away */
+    request_fast();
+}
+
+BT_CONN_CB_DEFINE(adv_conn_callbacks) = {
+    .connected = connected,
+    .disconnected = disconnected,
+};
+
+/* Mean time between advertising events for an interval range */
+static uint32_t event_period_us(uint16_t interval_min, uint16_t interval_max)
+{
+    return (interval_min + interval_max) * ADV_INTERVAL_UNIT_US / 2 + ADV_DELAY_MEAN_US;
+}
+
+void adv_manager_init(void)
+{
+    k_work_init_delayable(&adv_work, adv_work_handler);
+    mode_since_ms = k_uptime_get();
+}
+
+int adv_manager_start(void)
+{
+    int err = apply_mode(true);
+    if (err) {
+        return err;
+    }
+
+    k_work_reschedule_for_queue(&workq_housekeeping.queue, &adv_work,
+                                K_MSEC(CONFIG_RENTSCAN_ADV_FAST_WINDOW_MS));
+    LOG_INF("Advertising fast for %u ms, then slow", CONFIG_RENTSCAN_ADV_FAST_WINDOW_MS);
+    return 0;
+}
+
+void adv_manager_field_detected(void)
+{
+    if (!atomic_test_bit(&adv_flags, ADV_FLAG_CONNECTED)) {
+        request_fast();
+    }
+}
+
+void adv_manager_get_stats(struct adv_manager_stats *stats)
+{
+    const uint32_t fast_us = event_period_us(BLE_ADV_FAST_INT_MIN, BLE_ADV_FAST_INT_MAX);
+    const uint32_t slow_us = event_period_us(BLE_ADV_SLOW_INT_MIN, BLE_ADV_SLOW_INT_MAX);
+    k_spinlock_key_t key = k_spin_lock(&mode_lock);
+
+    stats->mode = mode;
+    stats->fast_windows = fast_windows;
+    for (int i = 0; i < ADV_MODE_COUNT; i++) {
+        stats->time_ms[i] = mode_time_ms[i];
+    }
+    stats->time_ms[mode] += k_uptime_get() - mode_since_ms;
+    k_spin_unlock(&mode_lock, key);
+
+    uint64_t fast_ms = stats->time_ms[ADV_MODE_FAST];
+    uint64_t slow_ms = stats->time_ms[ADV_MODE_SLOW];
+    uint64_t total_ms = 0;
+
+    for (int i = 0; i < ADV_MODE_COUNT; i++) {
+        total_ms += stats->time_ms[i];
+    }
+
+    /* nC per ms is uA, so charge * 1000 / ms is the average current in nA */
+    uint64_t events = fast_ms * USEC_PER_MSEC / fast_us + slow_ms * USEC_PER_MSEC / slow_us;
+    uint64_t always_fast = (fast_ms + slow_ms) * USEC_PER_MSEC / fast_us;
+    uint64_t charge_nc = events * CONFIG_RENTSCAN_ADV_EVENT_CHARGE_NC;
+
+    stats->events = events;
+    stats->charge_uc = charge_nc / 1000;
+    stats->avg_current_na = total_ms ? charge_nc * 1000 / total_ms : 0;
+    stats->always_fast_na = total_ms ?
+                            always_fast * CONFIG_RENTSCAN_ADV_EVENT_CHARGE_NC * 1000 / total_ms : 0;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file adv_manager.h
+ * @brief Advertising state machine and energy model of the main device
+ *
+ * Advertising runs at the fast interval for CONFIG_RENTSCAN_ADV_FAST_WINDOW_MS
+ * after boot, after the gateway disconnects and whenever an NFC reader
+ * field shows up, then decays to the slow interval. While the gateway is
+ * connected nothing is advertised.
+ *
+ * Time spent in each mode is kept, and an estimate of the charge the
+ * advertising took is derived from it with CONFIG_RENTSCAN_ADV_EVENT_CHARGE_NC
+ * per advertising event. Connection events are not part of the model.
+ */
+
+#ifndef ADV_MANAGER_H
+#define ADV_MANAGER_H
+
+#include <zephyr/types.h>
+
+/** Advertising modes */
+enum adv_mode {
+    ADV_MODE_OFF,           /**< Not started, or every start attempt failed */
+    ADV_MODE_FAST,          /**< Fast interval, reconnects are quick */
+    ADV_MODE_SLOW,          /**< Slow interval, idle kiosk */
+    ADV_MODE_CONNECTED,     /**< Gateway connected, not advertising */
+    ADV_MODE_COUNT,
+};
+
+/**
+ * @brief Advertising statistics since boot
+ */
+struct adv_manager_stats {
+    enum adv_mode mode;                 /**< Current mode */
+    uint64_t time_ms[ADV_MODE_COUNT];   /**< Time spent in each mode */
+    uint32_t fast_windows;              /**< Times the fast window was (re)started */
+    uint32_t events;                    /**< Estimated advertising events */
+    uint32_t charge_uc;                 /**< Estimated advertising charge */
+    uint32_t avg_current_na;            /**< Estimated average advertising current */
+    uint32_t always_fast_na;            /**< Same, if advertising had always been fast */
+};
+
+/**
+ * @brief Initialize the advertising manager
+ */
+void adv_manager_init(void);
+
+/**
+ * @brief Start advertising with a fast window
+ *
+ * Must be called after Bluetooth has been enabled.
+ *
+ * @return int 0 on success, negative error code otherwise
+ */
+int adv_manager_start(void);
+
+/**
+ * @brief Restart the fast window after an NFC reader field showed up
+ *
+ * Safe to call from an interrupt.
+ */
+void adv_manager_field_detected(void);
+
+/**
+ * @brief Get the advertising statistics
+ *
+ * @param stats Pointer to store the statistics
+ */
+void adv_manager_get_stats(struct adv_manager_stats *stats);
+
+#endif /* ADV_MANAGER_H */
\ No newline at end of file
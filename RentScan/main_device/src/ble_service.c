@@ -2,19 +2,87 @@
 #include <zephyr/bluetooth/bluetooth.h>
 #include <zephyr/bluetooth/uuid.h>
 #include <zephyr/bluetooth/gatt.h>
+#include <zephyr/bluetooth/hci.h>
+#include <zephyr/bluetooth/l2cap.h>
 #include <zephyr/logging/log.h>
+#include <string.h>
 #include "ble_service.h"
+#include "metrics.h"
+#include "time_sync.h"
+#include "workq.h"
+#include "../include/main_device_config.h"
 #include "../../common/include/rentscan_protocol.h"
 
 LOG_MODULE_REGISTER(ble_service, LOG_LEVEL_INF);
 
+/* Largest notification payload we can ever send (ATT MTU minus opcode and handle) */
+#define TX_BATCH_MAX_LEN (CONFIG_BT_L2CAP_TX_MTU - 3)
+
+/* Largest write we can ever receive */
+#define RX_WRITE_MAX_LEN (BT_L2CAP_RX_MTU - 3)
+
 static ble_data_received_cb_t data_callback;
 static struct bt_conn *current_conn;
 static bool is_advertising = false;
+static bool adv_fast;
+
+/* Coalescing buffer for outgoing messages. Encoded messages are appended
+ * back to back and sent as a single notification once the next message
+ * would not fit in the negotiated MTU or the flush deadline expires.
+ */
+static uint8_t tx_buffer[TX_BATCH_MAX_LEN];
+static uint16_t tx_buffer_len;
+static uint8_t tx_batch_count;
+static bool tx_batch_indicate;
+static K_MUTEX_DEFINE(tx_lock);
+static struct k_work_delayable tx_flush_work;
+
+/* Closed batches waiting for a TX credit. A batch leaves the queue once
+ * the stack has taken it; a credit comes back when the stack reports the
+ * notification sent or the gateway confirms the indication, so the
+ * controller's buffers never run dry under a burst.
+ */
+struct tx_slot {
+    uint16_t len;
+    uint8_t count;      /* Messages in the batch */
+    bool indicate;      /* Holds a rental state change */
+    uint8_t data[TX_BATCH_MAX_LEN];
+};
+
+static struct tx_slot tx_queue[CONFIG_RENTSCAN_BLE_TX_QUEUE_DEPTH];
+static uint8_t tx_queue_head;
+static uint8_t tx_queue_count;
+static struct k_work_delayable tx_drain_work;
+
+/* Updated from the stack's callbacks without tx_lock. Completions of an
+ * earlier connection are told apart by the generation and ignored.
+ */
+static atomic_t tx_in_flight;
+static atomic_t tx_conn_gen;
+
+/* The gateway confirms one indication at a time */
+static struct bt_gatt_indicate_params indicate_params;
+static uint8_t indicate_data[TX_BATCH_MAX_LEN];
+static atomic_t indicate_busy;
+static uint32_t indicate_gen;
+static bool indications_enabled;
+
+static struct bt_gatt_exchange_params mtu_exchange_params;
+
+/* Given whenever a batch leaves the TX queue, wakes a sender waiting for a slot */
+static K_SEM_DEFINE(tx_room, 0, 1);
+
+/* Writes of the gateway, handed to the data callback on the rental work
+ * queue so the Bluetooth RX thread never waits for the rental table or
+ * for TX room
+ */
+struct rx_write {
+    uint16_t len;
+    uint8_t data[RX_WRITE_MAX_LEN];
+};
 
-/* Buffer for outgoing data */
-static uint8_t tx_buffer[sizeof(rentscan_msg_t)];
-static uint8_t tx_buffer_len;
+K_MSGQ_DEFINE(rx_msgq, sizeof(struct rx_write), CONFIG_RENTSCAN_BLE_RX_QUEUE_DEPTH, 4);
+static struct k_work rx_work;
 
 /* Function declarations */
 static void tx_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value);
@@ -24,7 +92,6 @@ static ssize_t on_receive(struct bt_conn *conn,
                          uint16_t len,
                          uint16_t offset,
                          uint8_t flags);
-static void send_response(void);
 
 /* Advertising data */
 static const struct bt_data ad[] = {
@@ -41,12 +108,26 @@ BT_GATT_SERVICE_DEFINE(rentscan_svc,
                         BT_GATT_PERM_WRITE,
                         NULL, on_receive, NULL),
     BT_GATT_CHARACTERISTIC(BT_UUID_RENTSCAN_TX,
-                        BT_GATT_CHRC_NOTIFY,
+                        BT_GATT_CHRC_NOTIFY | BT_GATT_CHRC_INDICATE,
                         BT_GATT_PERM_NONE,
                         NULL, NULL, NULL),
     BT_GATT_CCC(tx_ccc_changed, BT_GATT_PERM_READ | BT_GATT_PERM_WRITE),
 );
 
+/* TX characteristic declaration, the stack notifies on the value that follows it */
+#define TX_CHRC_ATTR (&rentscan_svc.attrs[3])
+
+static void mtu_exchange_cb(struct bt_conn *conn, uint8_t err,
+                            struct bt_gatt_exchange_params *params)
+{
+    if (err) {
+        LOG_WRN("MTU exchange failed (err %u)", err);
+        return;
+    }
+
+    LOG_INF("MTU exchanged, batches up to %u bytes", bt_gatt_get_mtu(conn) - 3);
+}
+
 static void connected(struct bt_conn *conn, uint8_t err)
 {
     if (err) {
@@ -56,12 +137,71 @@ static void connected(struct bt_conn *conn, uint8_t err)
 
     current_conn = bt_conn_ref(conn);
     LOG_INF("Connected");
+    time_sync_link_up();
+
+    /* Advertising started by the advertising manager ends with the connection */
+    if (IS_ENABLED(CONFIG_RENTSCAN_ADV_MANAGER)) {
+        is_advertising = false;
+    }
+
+    /* A larger MTU lets more events share one notification */
+    mtu_exchange_params.func = mtu_exchange_cb;
+    err = bt_gatt_exchange_mtu(conn, &mtu_exchange_params);
+    if (err) {
+        LOG_WRN("MTU exchange request failed (err %d)", err);
+    }
 }
 
 static void disconnected(struct bt_conn *conn, uint8_t reason)
 {
     LOG_INF("Disconnected (reason %u)", reason);
 
+    metrics_inc(RENTSCAN_MAIN_METRIC_BLE_DISCONNECTS);
+    switch (reason) {
+    case BT_HCI_ERR_CONN_TIMEOUT:
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_DISC_TIMEOUT);
+        break;
+    case BT_HCI_ERR_REMOTE_USER_TERM_CONN:
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_DISC_REMOTE);
+        break;
+    case BT_HCI_ERR_LOCALHOST_TERM_CONN:
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_DISC_LOCAL);
+        break;
+    default:
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_DISC_OTHER);
+        break;
+    }
+
+    k_work_cancel_delayable(&tx_flush_work);
+    k_work_cancel_delayable(&tx_drain_work);
+    k_mutex_lock(&tx_lock, K_FOREVER);
+
+    /* The gateway asks for a delta sync on reconnect, which brings back
+     * any rental state change that was still queued here.
+     */
+    uint32_t unsent = tx_batch_count;
+
+    for (uint8_t i = 0; i < tx_queue_count; i++) {
+        unsent += tx_queue[(tx_queue_head + i) % ARRAY_SIZE(tx_queue)].count;
+    }
+    if (unsent) {
+        LOG_WRN("Dropping %u unsent messages", unsent);
+        metrics_add(RENTSCAN_MAIN_METRIC_BLE_TX_LOST, unsent);
+    }
+    tx_buffer_len = 0;
+    tx_batch_count = 0;
+    tx_batch_indicate = false;
+    tx_queue_head = 0;
+    tx_queue_count = 0;
+
+    atomic_inc(&tx_conn_gen);
+    atomic_clear(&tx_in_flight);
+    atomic_clear(&indicate_busy);
+    k_mutex_unlock(&tx_lock);
+
+    /* A sender waiting for room gets -ENOTCONN right away */
+    k_sem_give(&tx_room);
+
     if (current_conn) {
         bt_conn_unref(current_conn);
         current_conn = NULL;
@@ -75,16 +215,210 @@ BT_CONN_CB_DEFINE(conn_callbacks) = {
 
 static void tx_ccc_changed(const struct bt_gatt_attr *attr, uint16_t value)
 {
-    bool notifications_enabled = (value == BT_GATT_CCC_NOTIFY);
-    LOG_INF("Notifications %s", notifications_enabled ? "enabled" : "disabled");
+    bool notifications_enabled = (value & BT_GATT_CCC_NOTIFY);
+
+    indications_enabled = (value & BT_GATT_CCC_INDICATE);
+    LOG_INF("Notifications %s, indications %s",
+            notifications_enabled ? "enabled" : "disabled",
+            indications_enabled ? "enabled" : "disabled");
 }
 
-static void send_response(void)
+/* Give back the credit of a notification or indication and send what waits */
+static void tx_complete(uint32_t gen)
 {
-    if (tx_buffer_len > 0) {
-        bt_gatt_notify(NULL, &rentscan_svc.attrs[2], tx_buffer, tx_buffer_len);
-        tx_buffer_len = 0;
+    if (gen != (uint32_t)atomic_get(&tx_conn_gen)) {
+        return;
     }
+
+    atomic_dec(&tx_in_flight);
+    k_work_reschedule_for_queue(&workq_tag.queue, &tx_drain_work, K_NO_WAIT);
+}
+
+static void notify_complete_cb(struct bt_conn *conn, void *user_data)
+{
+    tx_complete(POINTER_TO_UINT(user_data));
+}
+
+static void indicate_cb(struct bt_conn *conn, struct bt_gatt_indicate_params *params,
+                        uint8_t err)
+{
+    if (err) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_TX_FAILED);
+        LOG_WRN("Indication not confirmed (err %u)", err);
+    } else {
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_INDICATIONS);
+    }
+
+    if (indicate_gen == (uint32_t)atomic_get(&tx_conn_gen)) {
+        atomic_clear(&indicate_busy);
+    }
+    tx_complete(indicate_gen);
+}
+
+/* Hand one batch to the stack, taking a credit */
+static int tx_send_slot(const struct tx_slot *slot)
+{
+    uint32_t gen = atomic_get(&tx_conn_gen);
+    int err;
+
+    if (slot->indicate && indications_enabled) {
+        if (!atomic_cas(&indicate_busy, 0, 1)) {
+            return -EBUSY;
+        }
+
+        memcpy(indicate_data, slot->data, slot->len);
+        indicate_params = (struct bt_gatt_indicate_params) {
+            .attr = TX_CHRC_ATTR,
+            .func = indicate_cb,
+            .data = indicate_data,
+            .len = slot->len,
+        };
+        indicate_gen = gen;
+
+        atomic_inc(&tx_in_flight);
+        err = bt_gatt_indicate(current_conn, &indicate_params);
+        if (err) {
+            atomic_dec(&tx_in_flight);
+            atomic_clear(&indicate_busy);
+        }
+        return err;
+    }
+
+    struct bt_gatt_notify_params params = {
+        .attr = TX_CHRC_ATTR,
+        .data = slot->data,
+        .len = slot->len,
+        .func = notify_complete_cb,
+        .user_data = UINT_TO_POINTER(gen),
+    };
+
+    /* Taken first, the completion can run before bt_gatt_notify_cb() returns */
+    atomic_inc(&tx_in_flight);
+    err = bt_gatt_notify_cb(current_conn, &params);
+    if (err) {
+        atomic_dec(&tx_in_flight);
+    }
+    return err;
+}
+
+/* Send queued batches while credits last. Must be called with tx_lock held. */
+static void tx_drain_locked(void)
+{
+    while (tx_queue_count > 0 && current_conn) {
+        struct tx_slot *slot = &tx_queue[tx_queue_head];
+
+        if (atomic_get(&tx_in_flight) >= CONFIG_RENTSCAN_BLE_TX_CREDITS) {
+            /* The next completion resumes */
+            return;
+        }
+
+        int err = tx_send_slot(slot);
+
+        if (err == -EBUSY) {
+            /* Behind an unconfirmed indication, the confirmation resumes */
+            return;
+        }
+
+        if (err == -ENOMEM) {
+            /* Buffers taken by other traffic, try again shortly */
+            metrics_inc(RENTSCAN_MAIN_METRIC_BLE_TX_RETRIES);
+            k_work_reschedule_for_queue(&workq_tag.queue, &tx_drain_work,
+                                        K_MSEC(CONFIG_RENTSCAN_BLE_TX_RETRY_MS));
+            return;
+        }
+
+        if (err) {
+            metrics_inc(RENTSCAN_MAIN_METRIC_BLE_TX_FAILED);
+            metrics_add(RENTSCAN_MAIN_METRIC_BLE_TX_LOST, slot->count);
+            LOG_ERR("Failed to send batch of %u messages (err %d)", slot->count, err);
+        } else {
+            metrics_inc(RENTSCAN_MAIN_METRIC_BLE_BATCHES);
+            LOG_DBG("Sent batch of %u messages, %u bytes%s", slot->count, slot->len,
+                    slot->indicate && indications_enabled ? " as indication" : "");
+        }
+
+        tx_queue_head = (tx_queue_head + 1) % ARRAY_SIZE(tx_queue);
+        tx_queue_count--;
+        k_sem_give(&tx_room);
+    }
+}
+
+/* Queue one closed batch. Must be called with tx_lock held. */
+static int tx_enqueue_locked(const uint8_t *data, uint16_t len, uint8_t count, bool indicate)
+{
+    if (!current_conn) {
+        return -ENOTCONN;
+    }
+
+    if (tx_queue_count == ARRAY_SIZE(tx_queue)) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_TX_QUEUE_FULL);
+        return -ENOBUFS;
+    }
+
+    struct tx_slot *slot = &tx_queue[(tx_queue_head + tx_queue_count) % ARRAY_SIZE(tx_queue)];
+
+    memcpy(slot->data, data, len);
+    slot->len = len;
+    slot->count = count;
+    slot->indicate = indicate;
+    tx_queue_count++;
+    metrics_peak(RENTSCAN_MAIN_METRIC_BLE_TX_QUEUE_PEAK, tx_queue_count);
+
+    tx_drain_locked();
+    return 0;
+}
+
+/* Close the pending batch and queue it. Must be called with tx_lock held.
+ * With the queue full the batch stays open and -ENOBUFS is returned.
+ */
+static int tx_flush_locked(void)
+{
+    if (tx_buffer_len == 0) {
+        return 0;
+    }
+
+    int err = tx_enqueue_locked(tx_buffer, tx_buffer_len, tx_batch_count, tx_batch_indicate);
+    if (err) {
+        return err;
+    }
+
+    tx_buffer_len = 0;
+    tx_batch_count = 0;
+    tx_batch_indicate = false;
+    return 0;
+}
+
+static void tx_flush_work_handler(struct k_work *work)
+{
+    k_mutex_lock(&tx_lock, K_FOREVER);
+    if (tx_flush_locked() == -ENOBUFS) {
+        k_work_schedule_for_queue(&workq_tag.queue, &tx_flush_work,
+                                  K_MSEC(CONFIG_RENTSCAN_BLE_TX_RETRY_MS));
+    }
+    k_mutex_unlock(&tx_lock);
+}
+
+static void tx_drain_work_handler(struct k_work *work)
+{
+    k_mutex_lock(&tx_lock, K_FOREVER);
+    tx_drain_locked();
+    k_mutex_unlock(&tx_lock);
+}
+
+/* Rental state changes are confirmed by the gateway, see
+ * CONFIG_RENTSCAN_BLE_INDICATE_STATUS
+ */
+static bool is_state_change(const rentscan_msg_t *msg)
+{
+    return IS_ENABLED(CONFIG_RENTSCAN_BLE_INDICATE_STATUS) && msg->cmd == CMD_STATUS_RESP;
+}
+
+/* Usable notification payload on the current connection */
+static uint16_t tx_batch_limit(void)
+{
+    uint16_t limit = bt_gatt_get_mtu(current_conn) - 3;
+
+    return MIN(limit, sizeof(tx_buffer));
 }
 
 static ssize_t on_receive(struct bt_conn *conn,
@@ -94,20 +428,50 @@ static ssize_t on_receive(struct bt_conn *conn,
                          uint16_t offset,
                          uint8_t flags)
 {
+    struct rx_write write = {
+        .len = len,
+    };
+
     LOG_INF("Received data, len %u", len);
     
-    if (data_callback) {
-        data_callback(buf, len);
+    if (offset != 0 || len > sizeof(write.data)) {
+        return BT_GATT_ERR(BT_ATT_ERR_INVALID_ATTRIBUTE_LEN);
+    }
+    
+    memcpy(write.data, buf, len);
+    if (k_msgq_put(&rx_msgq, &write, K_NO_WAIT)) {
+        /* Answered as an error to a write request, the gateway's next
+         * delta sync restores anything lost with a write command
+         */
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_RX_DROPPED);
+        LOG_WRN("Command queue full, write dropped");
+        return BT_GATT_ERR(BT_ATT_ERR_INSUFFICIENT_RESOURCES);
     }
     
+    k_work_submit_to_queue(&workq_rental.queue, &rx_work);
     return len;
 }
 
+static void rx_work_handler(struct k_work *work)
+{
+    /* Only this work item takes writes off the queue */
+    static struct rx_write write;
+
+    while (k_msgq_get(&rx_msgq, &write, K_NO_WAIT) == 0) {
+        if (data_callback) {
+            data_callback(write.data, write.len);
+        }
+    }
+}
+
 int ble_service_init(ble_data_received_cb_t data_received_cb)
 {
     int err;
 
     data_callback = data_received_cb;
+    k_work_init_delayable(&tx_flush_work, tx_flush_work_handler);
+    k_work_init_delayable(&tx_drain_work, tx_drain_work_handler);
+    k_work_init(&rx_work, rx_work_handler);
 
     err = bt_enable(NULL);
     if (err) {
@@ -124,31 +488,40 @@ int ble_service_init(ble_data_received_cb_t data_received_cb)
 
 int ble_service_start_advertising(bool fast)
 {
-    if (is_advertising) {
+    if (is_advertising && fast == adv_fast) {
         return 0;
     }
 
+    /* The name is already in ad[]. The advertising manager restarts
+     * advertising after a disconnect itself, without it the stack resumes it.
+     */
+    uint32_t options = BT_LE_ADV_OPT_CONNECTABLE |
+                       (IS_ENABLED(CONFIG_RENTSCAN_ADV_MANAGER) ? BT_LE_ADV_OPT_ONE_TIME : 0);
+    struct bt_le_adv_param adv_param = {
+        .id = BT_ID_DEFAULT,
+        .sid = 0,
+        .secondary_max_skip = 0,
+        .options = options,
+        .interval_min = fast ? BLE_ADV_FAST_INT_MIN : BLE_ADV_SLOW_INT_MIN,
+        .interval_max = fast ? BLE_ADV_FAST_INT_MAX : BLE_ADV_SLOW_INT_MAX,
+        .peer = NULL,
+    };
     int err;
-    
-    if (fast) {
-        // Use standard connectable advertising
-        err = bt_le_adv_start(BT_LE_ADV_CONN, ad, ARRAY_SIZE(ad), NULL, 0);
-    } else {
-        // Create custom slow advertising parameters
-        static const struct bt_le_adv_param slow_adv_param = {
-            .id = BT_ID_DEFAULT,
-            .sid = 0,
-            .secondary_max_skip = 0,
-            .options = BT_LE_ADV_OPT_CONNECTABLE | BT_LE_ADV_OPT_USE_NAME,
-            .interval_min = BT_GAP_ADV_SLOW_INT_MIN,
-            .interval_max = BT_GAP_ADV_SLOW_INT_MAX,
-            .peer = NULL,
-        };
-        err = bt_le_adv_start(&slow_adv_param, ad, ARRAY_SIZE(ad), NULL, 0);
+
+    if (is_advertising) {
+        err = bt_le_adv_stop();
+        if (err) {
+            LOG_ERR("Cannot stop advertising (err %d)", err);
+            return err;
+        }
+        is_advertising = false;
     }
 
+    err = bt_le_adv_start(&adv_param, ad, ARRAY_SIZE(ad), NULL, 0);
+
     if (!err) {
         is_advertising = true;
+        adv_fast = fast;
         LOG_INF("Advertising started (%s mode)", fast ? "fast" : "slow");
     } else {
         LOG_ERR("Advertising failed to start (err %d)", err);
@@ -172,27 +545,139 @@ int ble_service_stop_advertising(void)
 
 int ble_service_send_data(const uint8_t *data, uint16_t len)
 {
+    if (!data || len == 0) {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&tx_lock, K_FOREVER);
+
+    int err = current_conn ? 0 : -ENOTCONN;
+
+    if (!err && len > tx_batch_limit()) {
+        err = -EMSGSIZE;
+    }
+    if (!err) {
+        err = tx_enqueue_locked(data, len, 1, false);
+    }
+
+    k_mutex_unlock(&tx_lock);
+    return err;
+}
+
+/* Append a message to the current batch, -ENOBUFS if the TX queue is full */
+static int tx_add_message(const rentscan_msg_t *msg)
+{
+    if (!msg) {
+        return -EINVAL;
+    }
+
     if (!current_conn) {
         return -ENOTCONN;
     }
 
-    struct bt_gatt_notify_params params = {0};
-    params.uuid = NULL;
-    params.attr = &rentscan_svc.attrs[3];  // TX characteristic
-    params.data = data;
-    params.len = len;
-    params.func = NULL;
+    uint8_t buf[RENTSCAN_WIRE_MSG_MAX_LEN];
+    int len = rentscan_msg_encode(msg, buf, sizeof(buf));
+    if (len < 0) {
+        LOG_ERR("Failed to encode message (err %d)", len);
+        return len;
+    }
+
+    int err = 0;
+
+    k_mutex_lock(&tx_lock, K_FOREVER);
+
+    uint16_t limit = tx_batch_limit();
+
+    if (len > limit) {
+        /* Doesn't fit a notification even on its own */
+        k_mutex_unlock(&tx_lock);
+        return -EMSGSIZE;
+    }
+
+    if (tx_buffer_len + len > limit) {
+        err = tx_flush_locked();
+        if (err) {
+            /* Every queue slot is taken, refuse rather than drop it later */
+            k_mutex_unlock(&tx_lock);
+            return err;
+        }
+    }
+
+    memcpy(&tx_buffer[tx_buffer_len], buf, len);
+    tx_buffer_len += len;
+    tx_batch_count++;
+    tx_batch_indicate |= is_state_change(msg);
+    metrics_inc(RENTSCAN_MAIN_METRIC_MSG_TX);
+
+    if (tx_buffer_len + RENTSCAN_WIRE_MSG_MIN_LEN > limit) {
+        /* Nothing else will fit, don't wait for the deadline. With the
+         * queue full the batch is retried, the message is already taken.
+         */
+        k_work_cancel_delayable(&tx_flush_work);
+        if (tx_flush_locked() == -ENOBUFS) {
+            k_work_schedule_for_queue(&workq_tag.queue, &tx_flush_work,
+                                      K_MSEC(CONFIG_RENTSCAN_BLE_TX_RETRY_MS));
+        }
+    } else if (tx_batch_count == 1) {
+        /* First message of a new batch arms the flush deadline */
+        k_work_schedule_for_queue(&workq_tag.queue, &tx_flush_work,
+                                  K_MSEC(BLE_TX_FLUSH_DELAY_MS));
+    }
 
-    return bt_gatt_notify_cb(current_conn, &params);
+    k_mutex_unlock(&tx_lock);
+    return err;
 }
 
 int ble_service_send_message(const rentscan_msg_t *msg)
 {
-    if (!msg) {
-        return -EINVAL;
+    int err = tx_add_message(msg);
+
+    if (err == -ENOBUFS) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_TX_REFUSED);
+    }
+    return err;
+}
+
+int ble_service_send_message_wait(const rentscan_msg_t *msg)
+{
+    int64_t deadline = k_uptime_get() + CONFIG_RENTSCAN_BLE_TX_WAIT_MS;
+    int err;
+
+    while ((err = tx_add_message(msg)) == -ENOBUFS) {
+        int64_t left = deadline - k_uptime_get();
+
+        if (left <= 0) {
+            break;
+        }
+
+        /* The drain work may be queued behind the caller, so drain here too */
+        k_sem_take(&tx_room, K_MSEC(MIN(left, CONFIG_RENTSCAN_BLE_TX_RETRY_MS)));
+        k_mutex_lock(&tx_lock, K_FOREVER);
+        tx_drain_locked();
+        k_mutex_unlock(&tx_lock);
+    }
+
+    if (err == -ENOBUFS) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_BLE_TX_REFUSED);
+        LOG_WRN("TX queue still full after %u ms, message refused",
+                CONFIG_RENTSCAN_BLE_TX_WAIT_MS);
     }
+    return err;
+}
 
-    return ble_service_send_data((const uint8_t *)msg, sizeof(rentscan_msg_t));
+int ble_service_flush(void)
+{
+    int err;
+
+    k_work_cancel_delayable(&tx_flush_work);
+    k_mutex_lock(&tx_lock, K_FOREVER);
+    err = tx_flush_locked();
+    if (err == -ENOBUFS) {
+        k_work_schedule_for_queue(&workq_tag.queue, &tx_flush_work,
+                                  K_MSEC(CONFIG_RENTSCAN_BLE_TX_RETRY_MS));
+    }
+    k_mutex_unlock(&tx_lock);
+    return err;
 }
 
 bool ble_service_is_connected(void)
@@ -14,6 +14,9 @@
 /**
  * @brief Callback for received BLE data
  * 
+ * Called from the rental work queue, one write of the gateway at a time
+ * and in the order they arrived.
+ * 
  * @param data Pointer to data buffer
  * @param len Length of data
  */
@@ -30,6 +33,10 @@ int ble_service_init(ble_data_received_cb_t data_received_cb);
 /**
  * @brief Start BLE advertising
  * 
+ * Advertising already running at the other interval is restarted with
+ * this one. The intervals are BLE_ADV_FAST_* and BLE_ADV_SLOW_* of
+ * main_device_config.h.
+ * 
  * @param fast Use fast advertising interval if true, slow if false
  * @return int 0 on success, negative error code otherwise
  */
@@ -45,20 +52,56 @@ int ble_service_stop_advertising(void);
 /**
  * @brief Send data over BLE
  * 
+ * The data is sent as one notification of its own, queued behind the
+ * batches already waiting for a TX credit.
+ * 
  * @param data Pointer to data buffer
  * @param len Length of data
- * @return int 0 on success, negative error code otherwise
+ * @return int 0 on success, -ENOBUFS if the TX queue is full, negative
+ *             error code otherwise
  */
 int ble_service_send_data(const uint8_t *data, uint16_t len);
 
 /**
  * @brief Send a RentScan message over BLE
  * 
+ * The message is encoded and appended to the current TX batch. The batch is
+ * closed when it is full or BLE_TX_FLUSH_DELAY_MS after its first message
+ * was queued, whichever comes first, and then waits in the TX queue until
+ * one of CONFIG_RENTSCAN_BLE_TX_CREDITS is free. A batch the stack has no
+ * buffer for is retried, so nothing is lost while the link is up. Batches
+ * holding a rental state change are sent as indications, see
+ * CONFIG_RENTSCAN_BLE_INDICATE_STATUS.
+ * 
+ * Messages refused with -ENOBUFS are counted in the ble_tx_refused metric.
+ * 
  * @param msg Pointer to RentScan message
- * @return int 0 on success, negative error code otherwise
+ * @return int 0 on success, -ENOBUFS if the TX queue is full, negative
+ *             error code otherwise
  */
 int ble_service_send_message(const rentscan_msg_t *msg);
 
+/**
+ * @brief Send a RentScan message over BLE, waiting for room in the TX queue
+ * 
+ * As ble_service_send_message(), but while the TX queue is full the call
+ * waits up to CONFIG_RENTSCAN_BLE_TX_WAIT_MS for a batch to leave it.
+ * Must not be called from the Bluetooth RX thread, whose progress frees
+ * the credits.
+ * 
+ * @param msg Pointer to RentScan message
+ * @return int 0 on success, -ENOBUFS if the TX queue stayed full, negative
+ *             error code otherwise
+ */
+int ble_service_send_message_wait(const rentscan_msg_t *msg);
+
+/**
+ * @brief Send any batched messages immediately
+ * 
+ * @return int 0 on success, negative error code otherwise
+ */
+int ble_service_flush(void);
+
 /**
  * @brief Get BLE connection status
  * 
@@ -0,0 +1,88 @@
+/**
+ * @file latency_stats.c
+ * @brief Tap latency histograms of the main device
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/random/rand32.h>
+#include <zephyr/sys/atomic.h>
+#include <string.h>
+#include "latency_stats.h"
+#include "ble_service.h"
+
+LOG_MODULE_REGISTER(latency_stats, LOG_LEVEL_INF);
+
+BUILD_ASSERT(RENTSCAN_LATENCY_ENCODED_MAX_LEN <= MAX_MSG_PAYLOAD,
+             "A histogram must fit in one message");
+
+static struct rentscan_latency_hist hists[RENTSCAN_LATENCY_MAIN_STAGES];
+static struct k_spinlock hist_lock;
+static atomic_t corr_seq;
+
+void latency_stats_init(void)
+{
+    atomic_set(&corr_seq, sys_rand32_get());
+}
+
+uint32_t latency_stats_next_corr_id(void)
+{
+    uint32_t id;
+
+    do {
+        id = atomic_inc(&corr_seq) + 1;
+    } while (id == 0);
+
+    return id;
+}
+
+uint32_t latency_stats_us(uint32_t start, uint32_t end)
+{
+    return k_cyc_to_us_floor32(end - start);
+}
+
+void latency_stats_record(enum rentscan_latency_main_stage stage, uint32_t start, uint32_t end)
+{
+    if (stage >= RENTSCAN_LATENCY_MAIN_STAGES) {
+        return;
+    }
+
+    uint32_t us = latency_stats_us(start, end);
+    k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+    rentscan_latency_record(&hists[stage], us);
+    k_spin_unlock(&hist_lock, key);
+}
+
+int latency_stats_report(void)
+{
+    for (int i = 0; i < RENTSCAN_LATENCY_MAIN_STAGES; i++) {
+        struct rentscan_latency_hist hist;
+        rentscan_msg_t msg = {
+            .cmd = CMD_STATS_RESP,
+            .status = i,
+        };
+
+        k_spinlock_key_t key = k_spin_lock(&hist_lock);
+        hist = hists[i];
+        k_spin_unlock(&hist_lock, key);
+
+        if (i == RENTSCAN_LATENCY_MAIN_STAGES - 1) {
+            msg.status |= RENTSCAN_LATENCY_LAST;
+        }
+
+        int len = rentscan_latency_encode(&hist, msg.payload, sizeof(msg.payload));
+        if (len < 0) {
+            return len;
+        }
+        msg.payload_len = len;
+
+        int err = ble_service_send_message_wait(&msg);
+        if (err) {
+            LOG_WRN("Failed to send latency statistics (err %d)", err);
+            return err;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,54 @@
+/**
+ * @file latency_stats.h
+ * @brief Tap latency histograms of the main device
+ */
+
+#ifndef LATENCY_STATS_H
+#define LATENCY_STATS_H
+
+#include <zephyr/types.h>
+#include "../../common/include/rentscan_latency.h"
+
+/**
+ * @brief Seed the correlation IDs
+ *
+ * IDs start at a random value so taps on different main devices are
+ * unlikely to share one.
+ */
+void latency_stats_init(void);
+
+/**
+ * @brief Get the correlation ID for a new tap
+ *
+ * @return uint32_t Correlation ID, never 0
+ */
+uint32_t latency_stats_next_corr_id(void);
+
+/**
+ * @brief Convert a cycle counter interval to microseconds
+ *
+ * @param start k_cycle_get_32() at the start of the interval
+ * @param end k_cycle_get_32() at the end of the interval
+ * @return uint32_t Interval in microseconds
+ */
+uint32_t latency_stats_us(uint32_t start, uint32_t end);
+
+/**
+ * @brief Record the latency of one stage
+ *
+ * Safe to call from any thread.
+ *
+ * @param stage Stage measured
+ * @param start k_cycle_get_32() when the stage started
+ * @param end k_cycle_get_32() when the stage ended
+ */
+void latency_stats_record(enum rentscan_latency_main_stage stage, uint32_t start, uint32_t end);
+
+/**
+ * @brief Send every histogram to the gateway, one CMD_STATS_RESP per stage
+ *
+ * @return int 0 on success, negative error code otherwise
+ */
+int latency_stats_report(void);
+
+#endif /* LATENCY_STATS_H */
\ No newline at end of file
@@ -13,58 +13,69 @@
 #include "nfc_handler.h"
 #include "ble_service.h"
 #include "rental_manager.h"
+#include "status_beacon.h"
+#include "adv_manager.h"
+#include "scan_ring.h"
+#include "workq.h"
+#include "latency_stats.h"
+#include "metrics.h"
+#include "time_sync.h"
 #include "../../common/include/rentscan_protocol.h"
+#include "../../common/include/rentscan_dedup.h"
 
 LOG_MODULE_REGISTER(main, LOG_LEVEL_INF);
 
 /* Define work queue items for various tasks */
-static struct k_work_delayable expiry_check_work;
 static struct k_work nfc_process_work;
 
-/* Buffer for NFC tag data */
-static uint8_t tag_data_buf[MAX_MSG_PAYLOAD];
-static size_t tag_data_len;
-static uint8_t tag_id_buf[MAX_TAG_ID_LEN];
-static size_t tag_id_len;
-
-/* Indicate if a tag is being processed */
-static bool tag_processing = false;
+/* Tags processed recently, only used from the tag work queue */
+RENTSCAN_DEDUP_DEFINE(scan_dedup, CONFIG_RENTSCAN_SCAN_DEDUP_SLOTS, CONFIG_RENTSCAN_SCAN_DEDUP_MS);
 
 /**
  * @brief Handler for NFC tag detection events
+ * 
+ * Called by the NFC front-end for every tag read, which starts the latency
+ * measurement of the tap.
  */
-static void tag_detected_handler(const uint8_t *tag_id, size_t id_len,
-                               const uint8_t *tag_data, size_t data_len)
+static void tag_detected_handler(const uint8_t *id, size_t id_len,
+                               const uint8_t *data, size_t data_len)
 {
-    if (tag_processing) {
-        LOG_WRN("Already processing a tag, ignoring new tag");
-        return;
-    }
+    /* The NFC handler keeps these valid until its payload is rewritten */
+    struct scan_event evt = {
+        .tag_id = id,
+        .tag_id_len = MIN(id_len, MAX_TAG_ID_LEN),
+        .tag_data = data,
+        .tag_data_len = data ? MIN(data_len, UINT16_MAX) : 0,
+        .timestamp_ms = k_uptime_get_32(),
+        .cycles = k_cycle_get_32(),
+    };
     
-    /* Copy the tag data to our buffer */
-    if (id_len > MAX_TAG_ID_LEN) {
-        id_len = MAX_TAG_ID_LEN;
+    metrics_inc(RENTSCAN_MAIN_METRIC_TAPS);
+    if (!scan_ring_put(&evt)) {
+        LOG_WRN("Scan queue full, tag dropped (%u total)", scan_ring_overflow_count());
+        return;
     }
-    memcpy(tag_id_buf, tag_id, id_len);
-    tag_id_len = id_len;
+    metrics_peak(RENTSCAN_MAIN_METRIC_SCAN_HIGH_WATER, scan_ring_count());
     
-    if (tag_data && data_len > 0) {
-        if (data_len > MAX_MSG_PAYLOAD) {
-            data_len = MAX_MSG_PAYLOAD;
-        }
-        memcpy(tag_data_buf, tag_data, data_len);
-        tag_data_len = data_len;
-    } else {
-        tag_data_len = 0;
+    /* Process queued tags in the work queue */
+    k_work_submit_to_queue(&workq_tag.queue, &nfc_process_work);
+}
+
+/**
+ * @brief Handler for NFC reader field events
+ * 
+ * A field shows up just before a tap, so advertising turns fast in time
+ * for a gateway that lost the link to reconnect.
+ */
+static void field_changed_handler(bool present)
+{
+    if (present) {
+        adv_manager_field_detected();
     }
-    
-    /* Process the tag in the work queue */
-    tag_processing = true;
-    k_work_submit(&nfc_process_work);
 }
 
 /**
- * @brief Handler for BLE data reception
+ * @brief Handler for BLE data reception, runs on the rental work queue
  */
 static void ble_data_received_handler(const uint8_t *data, uint16_t len)
 {
@@ -78,24 +89,44 @@ static void ble_data_received_handler(const uint8_t *data, uint16_t len)
 /**
  * @brief Handler for rental status changes
  */
-static void rental_status_changed_handler(const rentscan_msg_t *msg)
+static int rental_status_changed_handler(const rentscan_msg_t *msg)
 {
-    /* Send the status update via BLE */
-    int err = ble_service_send_message(msg);
+    /* Send the status update via BLE, with a time request if one is due.
+     * Runs on a work queue, so it can wait for room in the TX queue.
+     */
+    time_sync_piggyback();
+    int err = ble_service_send_message_wait(msg);
     if (err) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_NOTIFY_FAILED);
         LOG_ERR("Failed to send status update: %d", err);
     }
-    
-    /* If we're currently processing a tag, we're done now */
-    tag_processing = false;
+
+    /* Let passive observers see the change right away */
+    if (IS_ENABLED(CONFIG_RENTSCAN_STATUS_BEACON)) {
+        status_beacon_refresh();
+    }
+    return err;
 }
 
 /**
- * @brief NFC tag processing work handler
+ * @brief Process a single queued scan
  */
-static void nfc_process_work_handler(struct k_work *work)
+static void process_scan(const struct scan_event *evt, uint32_t work_cycles)
 {
-    LOG_INF("Processing NFC tag with ID: %.*s", tag_id_len, tag_id_buf);
+    latency_stats_record(RENTSCAN_LATENCY_TAP_TO_WORK, evt->cycles, work_cycles);
+    metrics_peak(RENTSCAN_MAIN_METRIC_WORK_LATE_US_MAX, latency_stats_us(evt->cycles, work_cycles));
+
+    /* A tag held at the reader is read over and over, toggle it only once */
+    if (CONFIG_RENTSCAN_SCAN_DEDUP_MS > 0) {
+        if (rentscan_dedup_check(&scan_dedup, evt->tag_id, evt->tag_id_len)) {
+            metrics_inc(RENTSCAN_MAIN_METRIC_DEDUP_HITS);
+            LOG_DBG("Tag %.*s seen again, ignored", evt->tag_id_len, evt->tag_id);
+            return;
+        }
+        metrics_inc(RENTSCAN_MAIN_METRIC_DEDUP_MISSES);
+    }
+
+    LOG_INF("Processing NFC tag with ID: %.*s", evt->tag_id_len, evt->tag_id);
     
     // Create a message to send to the gateway
     rentscan_msg_t msg;
@@ -103,47 +134,58 @@ static void nfc_process_work_handler(struct k_work *work)
     
     // Set message fields
     msg.cmd = CMD_STATUS_REQ; // Request status to check if item is rented
-    msg.tag_id_len = tag_id_len;
-    memcpy(msg.tag_id, tag_id_buf, tag_id_len);
-    msg.timestamp = k_uptime_get_32() / 1000; // Convert to seconds
+    msg.tag_id_len = evt->tag_id_len;
+    memcpy(msg.tag_id, evt->tag_id, evt->tag_id_len);
+    msg.timestamp = rentscan_time_from_uptime(evt->timestamp_ms);
+    msg.corr_id = latency_stats_next_corr_id();
     
     // Only send if we have a BLE connection
     if (ble_service_is_connected()) {
-        int err = ble_service_send_message(&msg);
+        uint32_t send_cycles = k_cycle_get_32();
+
+        // The gateway adds this to its own share of the tap's latency
+        msg.latency_us = latency_stats_us(evt->cycles, send_cycles);
+        latency_stats_record(RENTSCAN_LATENCY_WORK_TO_SEND, work_cycles, send_cycles);
+        latency_stats_record(RENTSCAN_LATENCY_TAP_TO_SEND, evt->cycles, send_cycles);
+
+        time_sync_piggyback();
+        int err = ble_service_send_message_wait(&msg);
         if (err) {
+            metrics_inc(RENTSCAN_MAIN_METRIC_SEND_FAILED);
             LOG_ERR("Failed to send tag data via BLE: %d", err);
         } else {
             LOG_INF("Tag data sent to gateway");
         }
     } else {
+        metrics_inc(RENTSCAN_MAIN_METRIC_SEND_FAILED);
         LOG_WRN("BLE not connected, can't send tag data");
     }
     
     // Process the tag locally
-    int err = rental_manager_process_tag(tag_id_buf, tag_id_len,
-                                       tag_data_buf, tag_data_len);
+    int err = rental_manager_process_tag(evt->tag_id, evt->tag_id_len,
+                                       evt->tag_data, evt->tag_data_len);
     if (err) {
         LOG_ERR("Failed to process tag: %d", err);
     }
-    
-    // Clear the processing flag
-    tag_processing = false;
 }
 
 /**
- * @brief Rental expiry check work handler
+ * @brief NFC tag processing work handler
+ * 
+ * Drains the scan ring in batches so a burst of taps is handled in one run.
  */
-static void expiry_check_work_handler(struct k_work *work)
+static void nfc_process_work_handler(struct k_work *work)
 {
-    /* Check for expired rentals */
-    int expired = rental_manager_check_expirations();
-    if (expired > 0) {
-        LOG_INF("Found %d expired rentals", expired);
-    }
+    struct scan_event batch[CONFIG_RENTSCAN_SCAN_BATCH_SIZE];
+    size_t count;
     
-    /* Reschedule the work */
-    k_work_schedule_for_queue(&k_sys_work_q, &expiry_check_work,
-                            K_SECONDS(RENTAL_EXPIRY_CHECK_PERIOD));
+    while ((count = scan_ring_get_batch(batch, ARRAY_SIZE(batch))) > 0) {
+        uint32_t work_cycles = k_cycle_get_32();
+
+        for (size_t i = 0; i < count; i++) {
+            process_scan(&batch[i], work_cycles);
+        }
+    }
 }
 
 int main(void)
@@ -152,9 +194,12 @@ int main(void)
     
     LOG_INF("RentScan main device starting");
     
+    /* Everything below schedules work on the dedicated queues */
+    workq_init();
+    
     /* Initialize work queue items */
     k_work_init(&nfc_process_work, nfc_process_work_handler);
-    k_work_init_delayable(&expiry_check_work, expiry_check_work_handler);
+    latency_stats_init();
     
     /* Initialize the rental manager */
     err = rental_manager_init(rental_status_changed_handler);
@@ -184,10 +229,20 @@ int main(void)
         LOG_ERR("Failed to initialize NFC handler: %d", err);
         return err;
     }
+
+    /* Advertising decays from fast to slow, reader fields make it fast again */
+    if (IS_ENABLED(CONFIG_RENTSCAN_ADV_MANAGER)) {
+        adv_manager_init();
+        nfc_handler_set_field_callback(field_changed_handler);
+    }
     
     /* Start BLE advertising with retry on error */
     for (int retry = 0; retry < 5; retry++) {
-        err = ble_service_start_advertising(true);
+        if (IS_ENABLED(CONFIG_RENTSCAN_ADV_MANAGER)) {
+            err = adv_manager_start();
+        } else {
+            err = ble_service_start_advertising(true);
+        }
         if (err == 0) {
             break;  // Success
         }
@@ -213,18 +268,22 @@ int main(void)
         LOG_ERR("Failed to start advertising: %d", err);
         /* Continue anyway */
     }
+
+#if defined(CONFIG_RENTSCAN_STATUS_BEACON)
+    err = status_beacon_init();
+    if (err) {
+        LOG_ERR("Failed to start status beacon: %d", err);
+        /* Continue anyway, connected gateways still get updates */
+    }
+#endif
     
-    /* Start NFC polling */
+    /* Start NFC tag emulation, from here on taps arrive as events */
     err = nfc_handler_start_polling();
     if (err) {
-        LOG_ERR("Failed to start NFC polling: %d", err);
+        LOG_ERR("Failed to start NFC tag emulation: %d", err);
         /* Continue anyway */
     }
     
-    /* Schedule rental expiry check */
-    k_work_schedule_for_queue(&k_sys_work_q, &expiry_check_work, 
-                            K_SECONDS(RENTAL_EXPIRY_CHECK_PERIOD));
-    
     LOG_INF("RentScan main device initialized");
     
     /* Application is now running - Zephyr will handle the threads */
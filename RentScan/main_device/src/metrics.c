@@ -0,0 +1,102 @@
+/**
+ * @file metrics.c
+ * @brief Runtime counters of the main device
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include "metrics.h"
+#include "../../common/include/rentscan_latency.h"
+#include "adv_manager.h"
+#include "ble_service.h"
+#include "rental_manager.h"
+#include "scan_ring.h"
+#include "workq.h"
+
+LOG_MODULE_REGISTER(metrics, LOG_LEVEL_INF);
+
+atomic_t metrics_values[RENTSCAN_MAIN_METRIC_COUNT];
+
+static void sample_stack(enum rentscan_main_metric metric, struct k_thread *thread)
+{
+    size_t size;
+    size_t used;
+
+    if (!rentscan_thread_stack_usage(thread, &size, &used)) {
+        atomic_set(&metrics_values[metric], used);
+    }
+}
+
+void metrics_snapshot(uint32_t *values)
+{
+    struct rental_manager_stats rentals;
+
+    /* Kept by their own modules, copied in so the report is complete */
+    rental_manager_get_stats(&rentals);
+    atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_TAPS_DROPPED], scan_ring_overflow_count());
+    atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_RENTALS], rentals.rentals);
+    atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_EXPIRY_SWEEPS], rentals.expiry.sweeps);
+    atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_EXPIRY_SWEEP_US_MAX],
+               rentals.expiry.sweep_us_max);
+    atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_EXPIRY_LATE_MS_MAX],
+               rentals.expiry.late_ms_max);
+    sample_stack(RENTSCAN_MAIN_METRIC_STACK_TAG_WQ, &workq_tag.queue.thread);
+    sample_stack(RENTSCAN_MAIN_METRIC_STACK_RENTAL_WQ, &workq_rental.queue.thread);
+    sample_stack(RENTSCAN_MAIN_METRIC_STACK_PERSIST_WQ, &workq_persist.queue.thread);
+    sample_stack(RENTSCAN_MAIN_METRIC_STACK_HOUSEKEEPING_WQ, &workq_housekeeping.queue.thread);
+    sample_stack(RENTSCAN_MAIN_METRIC_STACK_SYSTEM_WQ, &k_sys_work_q.thread);
+
+    if (IS_ENABLED(CONFIG_RENTSCAN_ADV_MANAGER)) {
+        struct adv_manager_stats adv;
+
+        adv_manager_get_stats(&adv);
+        atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_ADV_FAST_S],
+                   adv.time_ms[ADV_MODE_FAST] / MSEC_PER_SEC);
+        atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_ADV_SLOW_S],
+                   adv.time_ms[ADV_MODE_SLOW] / MSEC_PER_SEC);
+        atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_ADV_CONNECTED_S],
+                   adv.time_ms[ADV_MODE_CONNECTED] / MSEC_PER_SEC);
+        atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_ADV_FAST_WINDOWS], adv.fast_windows);
+        atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_ADV_CHARGE_UC], adv.charge_uc);
+        atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_ADV_AVG_NA], adv.avg_current_na);
+        atomic_set(&metrics_values[RENTSCAN_MAIN_METRIC_ADV_ALWAYS_FAST_NA], adv.always_fast_na);
+    }
+
+    for (int i = 0; i < RENTSCAN_MAIN_METRIC_COUNT; i++) {
+        values[i] = atomic_get(&metrics_values[i]);
+    }
+}
+
+int metrics_report(void)
+{
+    uint32_t values[RENTSCAN_MAIN_METRIC_COUNT];
+    size_t next = 0;
+
+    metrics_snapshot(values);
+
+    do {
+        rentscan_msg_t msg = {
+            .cmd = CMD_STATS_RESP,
+            .status = RENTSCAN_STATS_METRICS,
+        };
+
+        int len = rentscan_metrics_encode(values, ARRAY_SIZE(values), &next,
+                                          msg.payload, sizeof(msg.payload));
+        if (len < 0) {
+            return len;
+        }
+        msg.payload_len = len;
+
+        if (next >= ARRAY_SIZE(values)) {
+            msg.status |= RENTSCAN_LATENCY_LAST;
+        }
+
+        int err = ble_service_send_message_wait(&msg);
+        if (err) {
+            LOG_WRN("Failed to send metrics (err %d)", err);
+            return err;
+        }
+    } while (next < ARRAY_SIZE(values));
+
+    return 0;
+}
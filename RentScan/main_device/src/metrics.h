@@ -0,0 +1,66 @@
+/**
+ * @file metrics.h
+ * @brief Runtime counters of the main device
+ *
+ * The metrics themselves are listed in rentscan_metrics.h so the gateway
+ * can name them. Updates are single atomic operations.
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <zephyr/types.h>
+#include "../../common/include/rentscan_metrics.h"
+
+/** Metric storage, use the helpers below */
+extern atomic_t metrics_values[RENTSCAN_MAIN_METRIC_COUNT];
+
+/**
+ * @brief Count one event
+ *
+ * @param id Metric to update
+ */
+static inline void metrics_inc(enum rentscan_main_metric id)
+{
+    rentscan_metric_inc(&metrics_values[id]);
+}
+
+/**
+ * @brief Count several events
+ *
+ * @param id Metric to update
+ * @param val Number of events
+ */
+static inline void metrics_add(enum rentscan_main_metric id, uint32_t val)
+{
+    rentscan_metric_add(&metrics_values[id], val);
+}
+
+/**
+ * @brief Record a value for a peak metric
+ *
+ * @param id Metric to update
+ * @param val Value seen
+ */
+static inline void metrics_peak(enum rentscan_main_metric id, uint32_t val)
+{
+    rentscan_metric_peak(&metrics_values[id], val);
+}
+
+/**
+ * @brief Read every metric
+ *
+ * Gauges and figures kept by other modules are sampled first.
+ *
+ * @param values Array of RENTSCAN_MAIN_METRIC_COUNT values to fill
+ */
+void metrics_snapshot(uint32_t *values);
+
+/**
+ * @brief Send the metrics to the gateway in CMD_STATS_RESP messages
+ *
+ * @return int 0 on success, negative error code otherwise
+ */
+int metrics_report(void);
+
+#endif /* METRICS_H */
\ No newline at end of file
@@ -3,72 +3,163 @@
 #include <zephyr/device.h>
 #include <nrfx_nfct.h>
 #include <nfc_t2t_lib.h>
-#include <nfc/t2t/parser.h>
 #include <nfc/ndef/msg.h>
 #include <nfc/ndef/text_rec.h>
+#include <string.h>
 #include "nfc_handler.h"
+#include "nfc_item.h"
+#include "metrics.h"
+#include "../../common/include/rentscan_protocol.h"
 
 LOG_MODULE_REGISTER(nfc_handler, LOG_LEVEL_INF);
 
-#define NFC_TAG_DATA_MAX_LEN 1024
-#define NFC_POLL_INTERVAL K_MSEC(100)
+#define NFC_TAG_DATA_MAX_LEN CONFIG_RENTSCAN_NFC_TAG_DATA_MAX_LEN
 
 static nfc_tag_callback_t tag_callback;
-static bool is_polling = false;
-static struct k_work_delayable poll_work;
+static nfc_field_callback_t field_callback;
+static bool is_emulating = false;
+
+/* Encoded NDEF message served by the tag. Parsed item fields point into it. */
 static uint8_t tag_data_buf[NFC_TAG_DATA_MAX_LEN];
 
-/* NDEF message buffer */
-static uint8_t ndef_msg_buf[NFC_TAG_DATA_MAX_LEN];
-static uint32_t len;
+/* Item fields of the current payload, updated whenever the payload changes */
+static struct nfc_item item;
+static struct k_spinlock item_lock;
 
 /* Default NDEF message */
 static const uint8_t en_code[] = {'e', 'n'};
 static const uint8_t en_payload[] = "ItemID: 001";
 
-/* NFC callback from T2T lib */
+/**
+ * @brief Parse the item fields of the NDEF message served by the tag
+ */
+static int parse_item_ndef(const uint8_t *ndef, uint32_t ndef_len)
+{
+    struct nfc_item parsed;
+    int err;
+
+    err = nfc_item_parse_ndef(ndef, ndef_len, &parsed);
+    if (err == -ENOENT) {
+        LOG_ERR("No item text record in NDEF message");
+    }
+    if (err) {
+        return err;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&item_lock);
+
+    item = parsed;
+    k_spin_unlock(&item_lock, key);
+
+    LOG_INF("Tag payload ItemID: %.*s (%u extra bytes)", parsed.id_len, parsed.id,
+            parsed.extra_len);
+    return 0;
+}
+
+/**
+ * @brief Encode a single text record message into tag_data_buf and serve it
+ */
+static int set_item_payload(const uint8_t *text, size_t text_len)
+{
+    uint32_t len = sizeof(tag_data_buf);
+    int err;
+
+    NFC_NDEF_MSG_DEF(ndef_msg, 1);
+    NFC_NDEF_TEXT_RECORD_DESC_DEF(text_rec,
+                                 UTF_8,
+                                 en_code,
+                                 sizeof(en_code),
+                                 text,
+                                 text_len);
+
+    err = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(ndef_msg),
+                                 &NFC_NDEF_TEXT_RECORD_DESC(text_rec));
+    if (err) {
+        LOG_ERR("Cannot add NDEF record (err %d)", err);
+        return err;
+    }
+
+    /* Drop the cached fields first, they point into the buffer being rewritten */
+    k_spinlock_key_t key = k_spin_lock(&item_lock);
+
+    item.id_len = 0;
+    k_spin_unlock(&item_lock, key);
+
+    err = nfc_ndef_msg_encode(&NFC_NDEF_MSG(ndef_msg),
+                             tag_data_buf,
+                             &len);
+    if (err) {
+        LOG_ERR("Cannot encode NDEF message (err %d)", err);
+        return err;
+    }
+
+    err = parse_item_ndef(tag_data_buf, len);
+    if (err) {
+        return err;
+    }
+
+    err = nfc_t2t_payload_set(tag_data_buf, len);
+    if (err) {
+        LOG_ERR("Cannot set payload (err %d)", err);
+        return err;
+    }
+
+    return 0;
+}
+
+/* NFC callback from T2T lib, the only entry point of the handler.
+ * Between taps the NFCT peripheral sits in field sense and nothing runs.
+ */
 static void nfc_callback(void *context,
                         nfc_t2t_event_t event,
                         const uint8_t *data,
                         size_t data_length)
 {
-    int err;
-    char item_id[16] = "001"; // Default item ID
+    k_spinlock_key_t key;
     
     switch (event) {
     case NFC_T2T_EVENT_FIELD_ON:
         LOG_INF("NFC field detected");
+        metrics_inc(RENTSCAN_MAIN_METRIC_NFC_FIELDS);
+        if (field_callback) {
+            field_callback(true);
+        }
         break;
 
     case NFC_T2T_EVENT_FIELD_OFF:
         LOG_INF("NFC field lost");
+        if (field_callback) {
+            field_callback(false);
+        }
         break;
 
-    case NFC_T2T_EVENT_DATA_READ:
-        LOG_INF("NFC data read: ItemID: %s", item_id);
+    case NFC_T2T_EVENT_DATA_READ: {
+        // Item fields were parsed when the payload was set, just hand them on
+        key = k_spin_lock(&item_lock);
+        const uint8_t *id = item.id;
+        size_t id_len = item.id_len;
+        const uint8_t *extra = item.extra;
+        size_t extra_len = item.extra_len;
+        k_spin_unlock(&item_lock, key);
+
+        if (id_len == 0) {
+            LOG_WRN("NFC data read without a valid item payload");
+            break;
+        }
+
+        LOG_INF("NFC data read: ItemID: %.*s", id_len, id);
         
-        // Call the registered callback with the item ID
         if (tag_callback) {
-            // Extract item ID from hardcoded value for demonstration
-            // In a real implementation, this would parse the NDEF record
-            uint8_t id_len = strlen(item_id);
-            tag_callback((const uint8_t *)item_id, id_len, NULL, 0);
+            tag_callback(id, id_len, extra, extra_len);
         }
         break;
+    }
 
     default:
         break;
     }
 }
 
-static void poll_work_handler(struct k_work *work)
-{
-    if (is_polling) {
-        // Reschedule polling work
-        k_work_schedule(&poll_work, NFC_POLL_INTERVAL);
-    }
-}
-
 int nfc_handler_init(nfc_tag_callback_t tag_detected_cb)
 {
     int err;
@@ -78,48 +169,19 @@ int nfc_handler_init(nfc_tag_callback_t tag_detected_cb)
     // Initialize NFC Type 2 Tag library
     nfc_t2t_setup(nfc_callback, NULL);
 
-    // Initialize default NDEF message
-    NFC_NDEF_MSG_DEF(welcome_msg, 1);
-    NFC_NDEF_TEXT_RECORD_DESC_DEF(welcome_text,
-                                 UTF_8,
-                                 en_code,
-                                 sizeof(en_code),
-                                 en_payload,
-                                 sizeof(en_payload));
-
-    err = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(welcome_msg),
-                                 &NFC_NDEF_TEXT_RECORD_DESC(welcome_text));
+    // Serve the default item payload (without the string terminator)
+    err = set_item_payload(en_payload, sizeof(en_payload) - 1);
     if (err) {
-        LOG_ERR("Cannot add NDEF record (err %d)", err);
-        return err;
-    }
-
-    len = sizeof(ndef_msg_buf);
-    err = nfc_ndef_msg_encode(&NFC_NDEF_MSG(welcome_msg),
-                             ndef_msg_buf,
-                             &len);
-    if (err) {
-        LOG_ERR("Cannot encode NDEF message (err %d)", err);
         return err;
     }
 
-    // Set encoded message as the NFC payload
-    err = nfc_t2t_payload_set(ndef_msg_buf, len);
-    if (err) {
-        LOG_ERR("Cannot set payload (err %d)", err);
-        return err;
-    }
-
-    // Initialize polling work
-    k_work_init_delayable(&poll_work, poll_work_handler);
-
     LOG_INF("NFC handler initialized");
     return 0;
 }
 
 int nfc_handler_start_polling(void)
 {
-    if (is_polling) {
+    if (is_emulating) {
         return 0;
     }
 
@@ -129,61 +191,36 @@ int nfc_handler_start_polling(void)
         return err;
     }
 
-    is_polling = true;
-    k_work_schedule(&poll_work, K_NO_WAIT);
-    LOG_INF("NFC polling started");
+    is_emulating = true;
+    LOG_INF("NFC tag emulation started");
     return 0;
 }
 
 int nfc_handler_stop_polling(void)
 {
-    if (!is_polling) {
+    if (!is_emulating) {
         return 0;
     }
 
     nfc_t2t_emulation_stop();
-    is_polling = false;
-    k_work_cancel_delayable(&poll_work);
-    LOG_INF("NFC polling stopped");
+    is_emulating = false;
+    LOG_INF("NFC tag emulation stopped");
     return 0;
 }
 
+void nfc_handler_set_field_callback(nfc_field_callback_t field_cb)
+{
+    field_callback = field_cb;
+}
+
 int nfc_handler_write_tag(const uint8_t *data, size_t data_len)
 {
     if (!data || data_len == 0 || data_len > NFC_TAG_DATA_MAX_LEN) {
         return -EINVAL;
     }
 
-    int err;
-
-    // Create NDEF message with text record
-    NFC_NDEF_MSG_DEF(ndef_msg, 1);
-    NFC_NDEF_TEXT_RECORD_DESC_DEF(text_rec,
-                                 UTF_8,
-                                 en_code,
-                                 sizeof(en_code),
-                                 data,
-                                 data_len);
-
-    err = nfc_ndef_msg_record_add(&NFC_NDEF_MSG(ndef_msg),
-                                 &NFC_NDEF_TEXT_RECORD_DESC(text_rec));
+    int err = set_item_payload(data, data_len);
     if (err) {
-        LOG_ERR("Cannot add NDEF record (err %d)", err);
-        return err;
-    }
-
-    len = sizeof(ndef_msg_buf);
-    err = nfc_ndef_msg_encode(&NFC_NDEF_MSG(ndef_msg),
-                             ndef_msg_buf,
-                             &len);
-    if (err) {
-        LOG_ERR("Cannot encode message (err %d)", err);
-        return err;
-    }
-
-    err = nfc_t2t_payload_set(ndef_msg_buf, len);
-    if (err) {
-        LOG_ERR("Cannot set payload (err %d)", err);
         return err;
     }
 
@@ -193,5 +230,5 @@ int nfc_handler_write_tag(const uint8_t *data, size_t data_len)
 
 bool nfc_handler_is_active(void)
 {
-    return is_polling;
+    return is_emulating;
 }
\ No newline at end of file
@@ -1,6 +1,12 @@
 /**
  * @file nfc_handler.h
  * @brief NFC tag reading and writing functionality
+ *
+ * Implemented by one of two front-ends, chosen in Kconfig: Type 2 tag
+ * emulation on the NFCT peripheral (nfc_handler.c), where the customer's
+ * reader reads the item record served by the kiosk, or the ST25R3911B
+ * reader (nfc_reader.c), which reads the item tags themselves and can
+ * take a stack of them at once.
  */
 
 #ifndef NFC_HANDLER_H
@@ -13,6 +19,19 @@
 /**
  * @brief Callback for NFC tag detection/reading
  * 
+ * The item ID and extra data come from the NDEF text record
+ * ("ItemID: <id>[;<extra>]").
+ * 
+ * With tag emulation it is called from the NFC interrupt, and the pointers
+ * refer to the handler's static payload buffer. They stay valid until the
+ * next nfc_handler_write_tag() call.
+ * 
+ * With the reader it is called from the reader thread, once per tag, and a
+ * tag without an item record is reported by its UID in hex. The pointers
+ * refer to a slot that is reused only after the scan ring and a batch of
+ * the tag work item have been filled since; the reader does not report a
+ * tag while the scan ring is full.
+ * 
  * @param tag_id Pointer to tag ID buffer
  * @param tag_id_len Length of tag ID
  * @param tag_data Pointer to tag data buffer (can be NULL if no data)
@@ -21,6 +40,19 @@
 typedef void (*nfc_tag_callback_t)(const uint8_t *tag_id, size_t tag_id_len,
                                    const uint8_t *tag_data, size_t tag_data_len);
 
+/**
+ * @brief Callback for a reader field appearing or going away
+ * 
+ * Must not block. With tag emulation it is called from the NFC interrupt
+ * when a reader field comes up, a moment before the tag is read, which is
+ * the earliest sign of a customer at the kiosk. With the reader it is
+ * called when the first new tag of a session is read and when the session
+ * is over.
+ * 
+ * @param present true when a reader field or tags were detected, false when they are gone
+ */
+typedef void (*nfc_field_callback_t)(bool present);
+
 /**
  * @brief Initialize the NFC subsystem
  * 
@@ -30,32 +62,49 @@ typedef void (*nfc_tag_callback_t)(const uint8_t *tag_id, size_t tag_id_len,
 int nfc_handler_init(nfc_tag_callback_t tag_detected_cb);
 
 /**
- * @brief Start NFC polling for tags
+ * @brief Start NFC tag emulation, or reading tags
+ * 
+ * Tag emulation is driven by the events of the NFC T2T library. Until a
+ * reader field shows up the NFCT peripheral only senses the field and
+ * wakes nothing, so an idle device stays at sleep current. The reader
+ * turns its field on every CONFIG_RENTSCAN_NFC_READER_POLL_MS to look for
+ * tags.
  * 
  * @return int 0 on success, negative error code otherwise
  */
 int nfc_handler_start_polling(void);
 
 /**
- * @brief Stop NFC polling
+ * @brief Stop NFC tag emulation, or reading tags
  * 
  * @return int 0 on success, negative error code otherwise
  */
 int nfc_handler_stop_polling(void);
 
+/**
+ * @brief Set the callback for reader field events
+ * 
+ * @param field_cb Callback function, NULL to stop the field events
+ */
+void nfc_handler_set_field_callback(nfc_field_callback_t field_cb);
+
 /**
  * @brief Write data to an NFC tag
  * 
+ * @p data becomes the text of the tag's NDEF text record and must follow
+ * the item format, so the ID can be parsed from it. Only tag emulation
+ * serves a payload.
+ * 
  * @param data Pointer to data buffer
  * @param data_len Length of data
- * @return int 0 on success, negative error code otherwise
+ * @return int 0 on success, -ENOTSUP with the reader, negative error code otherwise
  */
 int nfc_handler_write_tag(const uint8_t *data, size_t data_len);
 
 /**
  * @brief Get the current NFC subsystem status
  * 
- * @return true if NFC is active and polling
+ * @return true if NFC tag emulation or reading is running
  * @return false if NFC is inactive
  */
 bool nfc_handler_is_active(void);
@@ -0,0 +1,119 @@
+/**
+ * @file nfc_item.c
+ * @brief Item record of the NDEF message on a rental tag
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <nfc/ndef/msg.h>
+#include <nfc/ndef/msg_parser.h>
+#include <string.h>
+#include "nfc_item.h"
+#include "../../common/include/rentscan_protocol.h"
+
+LOG_MODULE_REGISTER(nfc_item, LOG_LEVEL_INF);
+
+/* Item tags carry a single text record, allow one spare for vendor records */
+#define NDEF_MAX_RECORDS 2
+
+/* Text record layout: status byte, language code, then the text itself */
+#define TEXT_REC_STATUS_UTF16 BIT(7)
+#define TEXT_REC_LANG_LEN_MASK 0x3F
+
+#define ITEM_ID_PREFIX "ItemID:"
+#define ITEM_EXTRA_SEPARATOR ';'
+
+/* Descriptor storage for the NDEF parser, no heap involved */
+NFC_NDEF_MSG_PARSER_BUF_DEF(ndef_parser_buf, NDEF_MAX_RECORDS);
+
+/**
+ * @brief Split the text of an item record into item ID and extra payload
+ *
+ * Accepts "ItemID: <id>[;<extra>]" or a bare "<id>[;<extra>]".
+ */
+static int parse_item_text(const uint8_t *text, size_t text_len, struct nfc_item *item)
+{
+    const size_t prefix_len = sizeof(ITEM_ID_PREFIX) - 1;
+
+    if (text_len >= prefix_len && memcmp(text, ITEM_ID_PREFIX, prefix_len) == 0) {
+        text += prefix_len;
+        text_len -= prefix_len;
+    }
+
+    while (text_len > 0 && *text == ' ') {
+        text++;
+        text_len--;
+    }
+
+    const uint8_t *sep = memchr(text, ITEM_EXTRA_SEPARATOR, text_len);
+    size_t len = sep ? (size_t)(sep - text) : text_len;
+
+    /* Tolerate trailing padding written by some encoders */
+    while (len > 0 && (text[len - 1] == ' ' || text[len - 1] == '\0')) {
+        len--;
+    }
+
+    if (len == 0 || len > MAX_TAG_ID_LEN) {
+        return -EMSGSIZE;
+    }
+
+    item->id = text;
+    item->id_len = len;
+
+    if (sep) {
+        item->extra = sep + 1;
+        item->extra_len = (text + text_len) - item->extra;
+    } else {
+        item->extra = NULL;
+        item->extra_len = 0;
+    }
+
+    return 0;
+}
+
+int nfc_item_parse_ndef(const uint8_t *ndef, uint32_t ndef_len, struct nfc_item *item)
+{
+    uint32_t desc_len = sizeof(ndef_parser_buf);
+    int err;
+
+    /* The parser only builds descriptors in ndef_parser_buf, record
+     * payloads keep pointing into the message.
+     */
+    err = nfc_ndef_msg_parse(ndef_parser_buf, &desc_len, ndef, &ndef_len);
+    if (err) {
+        LOG_ERR("Cannot parse NDEF message (err %d)", err);
+        return err;
+    }
+
+    const struct nfc_ndef_msg_desc *msg = (const struct nfc_ndef_msg_desc *)ndef_parser_buf;
+
+    for (uint32_t i = 0; i < msg->record_count; i++) {
+        const struct nfc_ndef_record_desc *rec = msg->record[i];
+        const struct nfc_ndef_bin_payload_desc *payload = rec->payload_descriptor;
+
+        if (rec->tnf != TNF_WELL_KNOWN || rec->type_length != 1 ||
+            rec->type[0] != 'T' || !payload || payload->payload_length < 1) {
+            continue;
+        }
+
+        uint8_t status = payload->payload[0];
+        size_t lang_len = status & TEXT_REC_LANG_LEN_MASK;
+
+        if (status & TEXT_REC_STATUS_UTF16) {
+            LOG_WRN("UTF-16 text record not supported");
+            continue;
+        }
+        if (1 + lang_len > payload->payload_length) {
+            return -EBADMSG;
+        }
+
+        err = parse_item_text(payload->payload + 1 + lang_len,
+                              payload->payload_length - 1 - lang_len, item);
+        if (err) {
+            LOG_ERR("Invalid item ID in text record (err %d)", err);
+        }
+        return err;
+    }
+
+    return -ENOENT;
+}
@@ -0,0 +1,40 @@
+/**
+ * @file nfc_item.h
+ * @brief Item record of the NDEF message on a rental tag
+ *
+ * Item tags carry one NDEF text record holding "ItemID: <id>[;<extra>]"
+ * or a bare "<id>[;<extra>]". Shared by the tag emulation and the reader
+ * front-end of the NFC handler.
+ */
+
+#ifndef NFC_ITEM_H
+#define NFC_ITEM_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+
+/**
+ * @brief Item fields of a tag, pointing into the parsed NDEF message
+ */
+struct nfc_item {
+    const uint8_t *id;      /**< Item ID */
+    size_t id_len;          /**< Length of the item ID */
+    const uint8_t *extra;   /**< Extra data after the separator, NULL if none */
+    size_t extra_len;       /**< Length of the extra data */
+};
+
+/**
+ * @brief Locate the item record in an encoded NDEF message
+ *
+ * Zero-copy, the fields point into @p ndef. Not reentrant, the parser
+ * descriptors live in a static buffer.
+ *
+ * @param ndef Encoded NDEF message
+ * @param ndef_len Length of @p ndef
+ * @param item Pointer to store the item fields
+ * @return int 0 on success, -ENOENT if there is no item text record,
+ *             negative error code otherwise
+ */
+int nfc_item_parse_ndef(const uint8_t *ndef, uint32_t ndef_len, struct nfc_item *item);
+
+#endif /* NFC_ITEM_H */
\ No newline at end of file
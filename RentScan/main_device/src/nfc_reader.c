@@ -0,0 +1,573 @@
+/**
+ * @file nfc_reader.c
+ * @brief ST25R3911B reader front-end of the NFC handler
+ *
+ * Reads a stack of item tags in one session. Every tag answering a
+ * SENS_REQ goes through anticollision, its UID and NDEF TLV are read and
+ * it is put to sleep, so the next SENS_REQ is answered by a tag that has
+ * not been read yet. The session ends when no tag answers. Between
+ * sessions the field is off and comes back every
+ * CONFIG_RENTSCAN_NFC_READER_POLL_MS.
+ *
+ * A READ returns four blocks and reading stops at the end of the NDEF TLV
+ * rather than the end of the data area, which takes two or three READs
+ * for an item record. Each READ is sent from the completion of the one
+ * before, and a tag is in the scan ring before the next one is selected,
+ * so the tag work queue processes one tag while the next is read.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+#include <st25r3911b_nfca.h>
+#include <string.h>
+#include "nfc_handler.h"
+#include "nfc_item.h"
+#include "scan_ring.h"
+#include "metrics.h"
+#include "workq.h"
+#include "../../common/include/rentscan_protocol.h"
+#include "../../common/include/rentscan_dedup.h"
+
+LOG_MODULE_REGISTER(nfc_reader, LOG_LEVEL_INF);
+
+/* Type 2 Tag READ: one command returns four 4 byte blocks */
+#define T2T_READ_CMD 0x30
+#define T2T_READ_CMD_LEN 2
+#define T2T_BLOCK_SIZE 4
+#define T2T_READ_LEN (4 * T2T_BLOCK_SIZE)
+#define T2T_FIRST_DATA_BLOCK 4
+
+/* Capability container in block 3, the data area size is in units of 8 bytes */
+#define T2T_CC_OFFSET (3 * T2T_BLOCK_SIZE)
+#define T2T_CC_MAGIC 0xE1
+#define T2T_CC_SIZE_UNIT 8
+
+#define TLV_NULL 0x00
+#define TLV_NDEF_MESSAGE 0x03
+#define TLV_TERMINATOR 0xFE
+#define TLV_LEN_3_BYTES 0xFF
+
+/* Frame delay time, as in the tag_reader sample */
+#define NFCA_BD 128
+#define BITS_IN_BYTE 8
+#define NFCA_LAST_BIT_MASK 0x80
+#define NFCA_FDT_ALIGN_84 84
+#define NFCA_FDT_ALIGN_20 20
+
+#define NFCA_UID_MAX_LEN 10
+
+/* Wait for room in the scan ring before selecting the next tag */
+#define READER_BACKOFF_MS 5
+
+/* Failed anticollisions in a row before the session is given up */
+#define READER_MAX_RETRIES 3
+
+/* Extra item data kept per reported tag */
+#define READER_EXTRA_MAX_LEN 32
+
+/* The ring holds at most its depth and the tag work item one batch, and
+ * no tag is reported while the ring is full, so slots are not reused
+ * while an event still points at them.
+ */
+#define READER_ID_SLOTS (CONFIG_RENTSCAN_SCAN_RING_DEPTH + CONFIG_RENTSCAN_SCAN_BATCH_SIZE + 1)
+
+enum reader_state {
+    READER_OFF,
+    READER_IDLE,            /* Field off between sessions */
+    READER_DETECT,          /* SENS_REQ sent */
+    READER_SELECT,          /* Anticollision running */
+    READER_HEADER,          /* Reading blocks 0-3 */
+    READER_DATA,            /* Reading the data area */
+    READER_SLEEP,           /* SLP_REQ sent */
+};
+
+struct id_slot {
+    uint8_t id[MAX_TAG_ID_LEN];
+    uint8_t extra[READER_EXTRA_MAX_LEN];
+};
+
+static nfc_tag_callback_t tag_callback;
+static nfc_field_callback_t field_callback;
+static bool is_active;
+static enum reader_state state;
+
+static struct k_poll_event events[ST25R3911B_NFCA_EVENT_CNT];
+static uint8_t tx_data[T2T_READ_CMD_LEN];
+static uint8_t rx_data[2 * T2T_READ_LEN];
+
+static struct st25r3911b_nfca_buf tx_buf = {
+    .data = tx_data,
+    .len = sizeof(tx_data),
+};
+
+static const struct st25r3911b_nfca_buf rx_buf = {
+    .data = rx_data,
+    .len = sizeof(rx_data),
+};
+
+/* Tag being read */
+static struct {
+    uint8_t uid[NFCA_UID_MAX_LEN];
+    uint8_t uid_len;
+    uint16_t data_len;      /* Size of the data area, capped to the buffer */
+    uint16_t read_len;      /* Bytes of the data area read so far */
+    uint8_t data[CONFIG_RENTSCAN_NFC_READER_NDEF_MAX_LEN];
+} tag;
+
+static struct id_slot id_slots[READER_ID_SLOTS];
+static uint8_t next_slot;
+
+/* UIDs reported recently, a hit refreshes the window */
+RENTSCAN_DEDUP_DEFINE(recent_uids, CONFIG_RENTSCAN_NFC_READER_DEDUP_SLOTS,
+                      CONFIG_RENTSCAN_NFC_READER_DEDUP_MS);
+
+static int64_t session_start_ms;
+static uint32_t session_tags;
+static uint8_t select_failures;
+
+static struct k_work_delayable poll_work;
+
+K_THREAD_STACK_DEFINE(reader_stack, CONFIG_RENTSCAN_NFC_READER_STACK_SIZE);
+static struct k_thread reader_thread;
+
+static uint32_t fdt_calculate(const uint8_t *data, size_t len)
+{
+    uint8_t fdt_align = (data[len - 1] & NFCA_LAST_BIT_MASK) ?
+                        NFCA_FDT_ALIGN_84 : NFCA_FDT_ALIGN_20;
+
+    return len * NFCA_BD * BITS_IN_BYTE + fdt_align;
+}
+
+static int read_blocks(uint8_t block)
+{
+    tx_data[0] = T2T_READ_CMD;
+    tx_data[1] = block;
+    tx_buf.len = T2T_READ_CMD_LEN;
+
+    return st25r3911b_nfca_transfer_with_crc(&tx_buf, &rx_buf,
+                                             fdt_calculate(tx_data, T2T_READ_CMD_LEN));
+}
+
+static void session_end(void)
+{
+    if (session_tags) {
+        uint32_t elapsed = k_uptime_get() - session_start_ms;
+
+        LOG_INF("Read %u tags in %u ms", session_tags, elapsed);
+        metrics_peak(RENTSCAN_MAIN_METRIC_READER_SESSION_MS_MAX, elapsed);
+        if (field_callback) {
+            field_callback(false);
+        }
+    }
+    session_tags = 0;
+
+    if (!is_active) {
+        return;
+    }
+
+    state = READER_IDLE;
+    st25r3911b_nfca_field_off();
+    k_work_reschedule_for_queue(&workq_housekeeping.queue, &poll_work,
+                                K_MSEC(CONFIG_RENTSCAN_NFC_READER_POLL_MS));
+}
+
+static void detect_next(void)
+{
+    if (!is_active) {
+        return;
+    }
+
+    /* The next tag waits in the field until the ring has room for it */
+    if (scan_ring_count() >= CONFIG_RENTSCAN_SCAN_RING_DEPTH) {
+        k_work_reschedule_for_queue(&workq_housekeeping.queue, &poll_work,
+                                    K_MSEC(READER_BACKOFF_MS));
+        return;
+    }
+
+    state = READER_DETECT;
+
+    int err = st25r3911b_nfca_tag_detect(ST25R3911B_NFCA_DETECT_CMD_SENS_REQ);
+    if (err) {
+        LOG_ERR("Tag detect failed (err %d)", err);
+        session_end();
+    }
+}
+
+static void sleep_tag(void)
+{
+    state = READER_SLEEP;
+
+    int err = st25r3911b_nfca_tag_sleep();
+    if (err) {
+        LOG_WRN("Tag sleep failed (err %d)", err);
+        detect_next();
+    }
+}
+
+static void read_failed(int err)
+{
+    LOG_WRN("Tag read failed (err %d)", err);
+    metrics_inc(RENTSCAN_MAIN_METRIC_READER_ERRORS);
+    sleep_tag();
+}
+
+/* Find the NDEF message TLV in the part of the data area read so far */
+static int ndef_tlv_find(const uint8_t *data, size_t len, size_t *offset, size_t *ndef_len)
+{
+    size_t pos = 0;
+
+    while (pos < len) {
+        uint8_t type = data[pos];
+
+        if (type == TLV_NULL) {
+            pos++;
+            continue;
+        }
+        if (type == TLV_TERMINATOR) {
+            return -ENOENT;
+        }
+        if (pos + 2 > len) {
+            return -EAGAIN;
+        }
+
+        size_t hdr_len = 2;
+        size_t value_len = data[pos + 1];
+
+        if (value_len == TLV_LEN_3_BYTES) {
+            if (pos + 4 > len) {
+                return -EAGAIN;
+            }
+            hdr_len = 4;
+            value_len = sys_get_be16(&data[pos + 2]);
+        }
+
+        if (type == TLV_NDEF_MESSAGE) {
+            if (pos + hdr_len + value_len > len) {
+                return -EAGAIN;
+            }
+            *offset = pos + hdr_len;
+            *ndef_len = value_len;
+            return 0;
+        }
+
+        pos += hdr_len + value_len;
+    }
+
+    return -EAGAIN;
+}
+
+/* Hand the tag to the application, by its item ID or else by its UID */
+static void report_tag(const uint8_t *ndef, size_t ndef_len)
+{
+    struct id_slot *slot = &id_slots[next_slot];
+    struct nfc_item item;
+    size_t id_len;
+    size_t extra_len = 0;
+
+    next_slot = (next_slot + 1) % ARRAY_SIZE(id_slots);
+
+    if (ndef && nfc_item_parse_ndef(ndef, ndef_len, &item) == 0) {
+        id_len = item.id_len;
+        memcpy(slot->id, item.id, id_len);
+        if (item.extra) {
+            extra_len = MIN(item.extra_len, sizeof(slot->extra));
+            memcpy(slot->extra, item.extra, extra_len);
+        }
+    } else {
+        char hex[2 * NFCA_UID_MAX_LEN + 1];
+        uint8_t uid_len = MIN(tag.uid_len, MAX_TAG_ID_LEN / 2);
+
+        id_len = bin2hex(&tag.uid[tag.uid_len - uid_len], uid_len, hex, sizeof(hex));
+        memcpy(slot->id, hex, id_len);
+        LOG_WRN("Tag without item record, using its UID %s", hex);
+    }
+
+    rentscan_dedup_add(&recent_uids, tag.uid, tag.uid_len);
+    metrics_inc(RENTSCAN_MAIN_METRIC_READER_TAGS);
+
+    if (session_tags++ == 0) {
+        session_start_ms = k_uptime_get();
+        if (field_callback) {
+            field_callback(true);
+        }
+    }
+
+    LOG_DBG("Tag %.*s read", id_len, slot->id);
+    if (tag_callback) {
+        tag_callback(slot->id, id_len, extra_len ? slot->extra : NULL, extra_len);
+    }
+}
+
+static void on_header_read(const uint8_t *data, size_t len)
+{
+    const uint8_t *cc = &data[T2T_CC_OFFSET];
+
+    if (len < T2T_READ_LEN || cc[0] != T2T_CC_MAGIC) {
+        /* Not formatted for NDEF, the UID still identifies it */
+        report_tag(NULL, 0);
+        sleep_tag();
+        return;
+    }
+
+    tag.data_len = MIN(cc[2] * T2T_CC_SIZE_UNIT, sizeof(tag.data));
+    tag.read_len = 0;
+    state = READER_DATA;
+
+    int err = read_blocks(T2T_FIRST_DATA_BLOCK);
+    if (err) {
+        read_failed(err);
+    }
+}
+
+static void on_data_read(const uint8_t *data, size_t len)
+{
+    size_t offset;
+    size_t ndef_len;
+
+    len = MIN(len, (size_t)(tag.data_len - tag.read_len));
+    memcpy(&tag.data[tag.read_len], data, len);
+    tag.read_len += len;
+
+    int err = ndef_tlv_find(tag.data, tag.read_len, &offset, &ndef_len);
+
+    if (err == -EAGAIN && tag.read_len < tag.data_len) {
+        err = read_blocks(T2T_FIRST_DATA_BLOCK + tag.read_len / T2T_BLOCK_SIZE);
+        if (err) {
+            read_failed(err);
+        }
+        return;
+    }
+
+    if (err) {
+        LOG_WRN("No complete NDEF message in %u bytes", tag.read_len);
+    }
+    report_tag(err ? NULL : &tag.data[offset], err ? 0 : ndef_len);
+    sleep_tag();
+}
+
+static void nfca_field_on(void)
+{
+    select_failures = 0;
+    detect_next();
+}
+
+static void nfca_field_off(void)
+{
+}
+
+static void nfca_tag_detected(const struct st25r3911b_nfca_sens_resp *sens_resp)
+{
+    state = READER_SELECT;
+
+    int err = st25r3911b_nfca_anticollision_start();
+    if (err) {
+        LOG_ERR("Anticollision start failed (err %d)", err);
+        session_end();
+    }
+}
+
+static void nfca_anticollision_completed(const struct st25r3911b_nfca_tag_info *tag_info,
+                                         int err)
+{
+    if (err) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_READER_ERRORS);
+        if (++select_failures > READER_MAX_RETRIES) {
+            LOG_WRN("Anticollision keeps failing (err %d)", err);
+            session_end();
+        } else {
+            detect_next();
+        }
+        return;
+    }
+    select_failures = 0;
+
+    tag.uid_len = MIN(tag_info->nfcid1_len, sizeof(tag.uid));
+    memcpy(tag.uid, tag_info->nfcid1, tag.uid_len);
+
+    /* Still in the field since it was reported, no need to read it again */
+    if (rentscan_dedup_seen(&recent_uids, tag.uid, tag.uid_len)) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_READER_DUPLICATES);
+        sleep_tag();
+        return;
+    }
+
+    if (tag_info->type != ST25R3911B_NFCA_TAG_TYPE_T2T) {
+        report_tag(NULL, 0);
+        sleep_tag();
+        return;
+    }
+
+    state = READER_HEADER;
+    err = read_blocks(0);
+    if (err) {
+        read_failed(err);
+    }
+}
+
+static void nfca_rx_timeout(bool tag_sleep)
+{
+    switch (state) {
+    case READER_DETECT:
+        /* Every tag in the field has been read */
+        session_end();
+        break;
+
+    case READER_SLEEP:
+        /* The tag didn't answer the SLP_REQ, it is asleep */
+        detect_next();
+        break;
+
+    case READER_HEADER:
+    case READER_DATA:
+        read_failed(-ETIMEDOUT);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void nfca_transfer_completed(const uint8_t *data, size_t len, int err)
+{
+    if (err) {
+        read_failed(err);
+        return;
+    }
+
+    switch (state) {
+    case READER_HEADER:
+        on_header_read(data, len);
+        break;
+
+    case READER_DATA:
+        on_data_read(data, len);
+        break;
+
+    default:
+        break;
+    }
+}
+
+static void nfca_tag_sleep(void)
+{
+    /* The rx_timeout that follows moves on to the next tag */
+}
+
+static const struct st25r3911b_nfca_cb nfca_cb = {
+    .field_on = nfca_field_on,
+    .field_off = nfca_field_off,
+    .tag_detected = nfca_tag_detected,
+    .anticollision_completed = nfca_anticollision_completed,
+    .rx_timeout = nfca_rx_timeout,
+    .transfer_completed = nfca_transfer_completed,
+    .tag_sleep = nfca_tag_sleep,
+};
+
+/* Runs between sessions and while waiting for room in the scan ring */
+static void poll_work_handler(struct k_work *work)
+{
+    if (!is_active) {
+        return;
+    }
+
+    if (state == READER_IDLE) {
+        int err = st25r3911b_nfca_field_on();
+        if (err) {
+            LOG_ERR("Field on failed (err %d)", err);
+            k_work_reschedule_for_queue(&workq_housekeeping.queue, &poll_work,
+                                        K_MSEC(CONFIG_RENTSCAN_NFC_READER_POLL_MS));
+        }
+    } else {
+        detect_next();
+    }
+}
+
+static void reader_thread_fn(void *p1, void *p2, void *p3)
+{
+    while (true) {
+        k_poll(events, ARRAY_SIZE(events), K_FOREVER);
+
+        int err = st25r3911b_nfca_process();
+        if (err) {
+            LOG_ERR("NFC-A processing failed (err %d)", err);
+        }
+    }
+}
+
+int nfc_handler_init(nfc_tag_callback_t tag_detected_cb)
+{
+    int err;
+
+    tag_callback = tag_detected_cb;
+    k_work_init_delayable(&poll_work, poll_work_handler);
+
+    err = st25r3911b_nfca_init(events, ARRAY_SIZE(events), &nfca_cb);
+    if (err) {
+        LOG_ERR("Cannot initialize the NFC-A reader (err %d)", err);
+        return err;
+    }
+
+    k_thread_create(&reader_thread, reader_stack, K_THREAD_STACK_SIZEOF(reader_stack),
+                    reader_thread_fn, NULL, NULL, NULL,
+                    CONFIG_RENTSCAN_NFC_READER_PRIORITY, 0, K_NO_WAIT);
+    k_thread_name_set(&reader_thread, "nfc_reader");
+
+    LOG_INF("NFC reader initialized");
+    return 0;
+}
+
+int nfc_handler_start_polling(void)
+{
+    if (is_active) {
+        return 0;
+    }
+
+    is_active = true;
+    state = READER_IDLE;
+
+    int err = st25r3911b_nfca_field_on();
+    if (err) {
+        LOG_ERR("Cannot turn the reader field on (err %d)", err);
+        is_active = false;
+        state = READER_OFF;
+        return err;
+    }
+
+    LOG_INF("NFC reader started");
+    return 0;
+}
+
+int nfc_handler_stop_polling(void)
+{
+    if (!is_active) {
+        return 0;
+    }
+
+    is_active = false;
+    k_work_cancel_delayable(&poll_work);
+    state = READER_OFF;
+    st25r3911b_nfca_field_off();
+    LOG_INF("NFC reader stopped");
+    return 0;
+}
+
+void nfc_handler_set_field_callback(nfc_field_callback_t field_cb)
+{
+    field_callback = field_cb;
+}
+
+int nfc_handler_write_tag(const uint8_t *data, size_t data_len)
+{
+    ARG_UNUSED(data);
+    ARG_UNUSED(data_len);
+
+    /* Item tags are written by the back office, not by the kiosk */
+    return -ENOTSUP;
+}
+
+bool nfc_handler_is_active(void)
+{
+    return is_active;
+}
@@ -1,88 +1,587 @@
 #include <zephyr/kernel.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/settings/settings.h>
+#include <zephyr/sys/atomic.h>
+#include <zephyr/random/rand32.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include "rental_manager.h"
+#include "latency_stats.h"
+#include "metrics.h"
+#include "time_sync.h"
+#include "workq.h"
+#include "../../common/include/rentscan_expiry.h"
+#include "../../common/include/rentscan_beacon.h"
+#include "../../common/include/rentscan_sync.h"
 
 LOG_MODULE_REGISTER(rental_manager, LOG_LEVEL_INF);
 
-#define MAX_ACTIVE_RENTALS 10
-#define RENTAL_CHECK_INTERVAL K_SECONDS(60)
-#define SETTINGS_PREFIX "rental/"
+#define MAX_ACTIVE_RENTALS CONFIG_RENTSCAN_MAX_RENTALS
+#define SETTINGS_SUBTREE "rental"
+#define SETTINGS_PREFIX SETTINGS_SUBTREE "/"
+#define SETTINGS_KEY_MAX_LEN (sizeof(SETTINGS_PREFIX) + 5)
+
+/* Format of the per-slot record stored under "rental/<slot>" */
+#define RENTAL_RECORD_VERSION 1
+
+/* Open addressing index over tag IDs. Each bucket holds a slot number plus
+ * one so that zero marks an empty bucket.
+ */
+#define RENTAL_INDEX_SIZE (1U << CONFIG_RENTSCAN_RENTAL_INDEX_BITS)
+#define RENTAL_INDEX_MASK (RENTAL_INDEX_SIZE - 1)
+#define SLOT_NONE 0
+
+BUILD_ASSERT(RENTAL_INDEX_SIZE >= 2 * MAX_ACTIVE_RENTALS,
+             "Rental index must have at least twice as many buckets as slots");
+BUILD_ASSERT(MAX_ACTIVE_RENTALS < UINT16_MAX, "Rental slot numbers are 16 bit");
 
 struct rental_entry {
     uint8_t tag_id[MAX_TAG_ID_LEN];
     uint8_t tag_id_len;
+    bool in_use;
     rentscan_status_t status;
     uint32_t start_time;
     uint32_t duration;
+    uint32_t hash;
+    uint32_t sync_gen;        /* Generation of the last change */
+    bool notify_pending;      /* Status refused for lack of TX room */
+    uint16_t next_free;
+    struct rentscan_expiry_entry expiry;
 };
 
 static struct rental_entry rentals[MAX_ACTIVE_RENTALS];
-static uint8_t num_rentals;
+static uint16_t rental_index[RENTAL_INDEX_SIZE];
+static uint16_t free_head;
+static uint16_t num_rentals;
 static rental_status_cb_t status_callback;
-static struct k_work_delayable check_work;
 
-static void send_status_update(const struct rental_entry *entry)
+/* Guards the table, its index, the free list and the tombstones. Entry
+ * points run on the BT RX thread and on the tag, rental, persist and
+ * housekeeping queues, which preempt each other. Messages are built with
+ * it held and sent without it, as sending may wait for TX room.
+ */
+static K_MUTEX_DEFINE(rental_lock);
+
+/* Bumped whenever the rental table changes */
+static atomic_t generation;
+
+/* Identifies the generations of this boot to the gateway */
+static uint32_t sync_epoch;
+
+/* Tags of recently released slots, so deltas can report the returns */
+struct rental_tombstone {
+    uint8_t tag_id[MAX_TAG_ID_LEN];
+    uint8_t tag_id_len;
+    uint32_t gen;
+};
+
+static struct rental_tombstone tombstones[CONFIG_RENTSCAN_SYNC_TOMBSTONES];
+static uint16_t tombstone_next;
+
+/* A delta from before this generation could miss returns */
+static uint32_t tombstone_floor;
+
+/* Items of a listing: the tombstones, then the slots */
+#define SYNC_POS_END (ARRAY_SIZE(tombstones) + MAX_ACTIVE_RENTALS)
+
+/* Time before a listing that ran out of TX room is sent again */
+#define SYNC_RETRY_MS 1000
+
+/* Progress of a sync listing */
+struct sync_listing {
+    bool full;
+    uint32_t since;
+    uint32_t pos;      /* Next tombstone or slot to look at */
+    uint32_t count;    /* Items listed so far */
+};
+
+/* Request of the listing to send again, only used on the rental work queue */
+static uint32_t sync_retry_epoch;
+static uint32_t sync_retry_generation;
+static void sync_retry_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(sync_retry_work, sync_retry_work_handler);
+
+/* Time before status updates refused for lack of TX room are sent again */
+#define NOTIFY_RETRY_MS 500
+
+static void notify_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(notify_work, notify_work_handler);
+
+RENTSCAN_EXPIRY_DEFINE(rental_expiry, MAX_ACTIVE_RENTALS);
+
+#if defined(CONFIG_RENTSCAN_RENTAL_PERSIST)
+struct rental_record {
+    uint8_t version;
+    uint8_t tag_id_len;
+    uint8_t status;
+    uint8_t tag_id[MAX_TAG_ID_LEN];
+    uint32_t start_time;
+    uint32_t duration;
+} __packed;
+
+/* Slots changed since the last flush. A flush writes in-use slots and
+ * deletes released ones, so only the final state of a burst hits flash.
+ */
+static ATOMIC_DEFINE(dirty_slots, MAX_ACTIVE_RENTALS);
+static struct k_work_delayable flush_work;
+static int64_t last_flush_time;
+#endif
+
+#if defined(CONFIG_RENTSCAN_RENTAL_PERSIST)
+static void mark_dirty(const struct rental_entry *entry)
 {
-    if (!status_callback) {
-        return;
+    atomic_set_bit(dirty_slots, entry - rentals);
+
+    /* Coalesce changes for a while, but never flush more often than the
+     * minimum interval. An already pending flush picks this change up.
+     */
+    int64_t now = k_uptime_get();
+    int64_t flush_at = MAX(now + CONFIG_RENTSCAN_RENTAL_FLUSH_DELAY_MS,
+                           last_flush_time + CONFIG_RENTSCAN_RENTAL_FLUSH_MIN_INTERVAL_MS);
+
+    k_work_schedule_for_queue(&workq_persist.queue, &flush_work, K_MSEC(flush_at - now));
+}
+
+static void flush_work_handler(struct k_work *work)
+{
+    char key[SETTINGS_KEY_MAX_LEN];
+    int written = 0;
+    int deleted = 0;
+    int err;
+
+    last_flush_time = k_uptime_get();
+
+    for (int i = 0; i < MAX_ACTIVE_RENTALS; i++) {
+        if (!atomic_test_and_clear_bit(dirty_slots, i)) {
+            continue;
+        }
+
+        /* Copied under the lock, flash is written without it. A change
+         * after the copy marks the slot dirty again.
+         */
+        const struct rental_entry *entry = &rentals[i];
+        struct rental_record rec = { .version = RENTAL_RECORD_VERSION };
+        bool in_use;
+
+        k_mutex_lock(&rental_lock, K_FOREVER);
+        in_use = entry->in_use;
+        if (in_use) {
+            rec.tag_id_len = entry->tag_id_len;
+            rec.status = entry->status;
+            rec.start_time = entry->start_time;
+            rec.duration = entry->duration;
+            memcpy(rec.tag_id, entry->tag_id, entry->tag_id_len);
+        }
+        k_mutex_unlock(&rental_lock);
+
+        snprintf(key, sizeof(key), SETTINGS_PREFIX "%d", i);
+
+        if (!in_use) {
+            err = settings_delete(key);
+            deleted++;
+        } else {
+            err = settings_save_one(key, &rec, sizeof(rec));
+            written++;
+        }
+
+        metrics_inc(RENTSCAN_MAIN_METRIC_FLASH_WRITES);
+        if (err) {
+            metrics_inc(RENTSCAN_MAIN_METRIC_FLASH_ERRORS);
+            LOG_ERR("Failed to persist rental slot %d (err %d)", i, err);
+            // Retry with the next flush
+            atomic_set_bit(dirty_slots, i);
+            k_work_schedule_for_queue(&workq_persist.queue, &flush_work,
+                                      K_MSEC(CONFIG_RENTSCAN_RENTAL_FLUSH_MIN_INTERVAL_MS));
+        }
     }
 
-    rentscan_msg_t msg = {
+    LOG_DBG("Rental table flushed (%d written, %d deleted)", written, deleted);
+}
+#else
+static inline void mark_dirty(const struct rental_entry *entry)
+{
+    ARG_UNUSED(entry);
+}
+#endif /* CONFIG_RENTSCAN_RENTAL_PERSIST */
+
+/* Same hash the status beacon identifies tags by */
+static inline uint32_t tag_hash(const uint8_t *tag_id, size_t tag_id_len)
+{
+    return rentscan_beacon_tag_hash(tag_id, tag_id_len);
+}
+
+static inline struct rental_entry *slot_entry(uint16_t slot)
+{
+    return &rentals[slot - 1];
+}
+
+/* Record a change for the status beacon and for delta syncs */
+static void touch(struct rental_entry *entry)
+{
+    entry->sync_gen = atomic_inc(&generation) + 1;
+}
+
+static void tombstone_add(const struct rental_entry *entry)
+{
+    struct rental_tombstone *t = &tombstones[tombstone_next];
+
+    if (t->tag_id_len) {
+        // The oldest return is forgotten, deltas from before it are incomplete
+        tombstone_floor = t->gen;
+    }
+
+    memcpy(t->tag_id, entry->tag_id, entry->tag_id_len);
+    t->tag_id_len = entry->tag_id_len;
+    t->gen = atomic_inc(&generation) + 1;
+    tombstone_next = (tombstone_next + 1) % ARRAY_SIZE(tombstones);
+}
+
+/**
+ * @brief Find the index bucket holding a tag, or the empty bucket ending its probe
+ */
+static uint32_t index_probe(uint32_t hash, const uint8_t *tag_id, size_t tag_id_len)
+{
+    uint32_t pos = hash & RENTAL_INDEX_MASK;
+
+    while (rental_index[pos] != SLOT_NONE) {
+        const struct rental_entry *entry = slot_entry(rental_index[pos]);
+
+        if (entry->hash == hash && entry->tag_id_len == tag_id_len &&
+            memcmp(entry->tag_id, tag_id, tag_id_len) == 0) {
+            break;
+        }
+        pos = (pos + 1) & RENTAL_INDEX_MASK;
+    }
+
+    return pos;
+}
+
+/**
+ * @brief Remove a bucket from the index without leaving tombstones
+ *
+ * Later entries of the probe run are shifted back into the hole whenever
+ * that keeps them reachable from their home bucket.
+ */
+static void index_remove(uint32_t hole)
+{
+    uint32_t pos = hole;
+
+    for (;;) {
+        pos = (pos + 1) & RENTAL_INDEX_MASK;
+        if (rental_index[pos] == SLOT_NONE) {
+            break;
+        }
+
+        uint32_t home = slot_entry(rental_index[pos])->hash & RENTAL_INDEX_MASK;
+
+        if (((pos - home) & RENTAL_INDEX_MASK) >= ((pos - hole) & RENTAL_INDEX_MASK)) {
+            rental_index[hole] = rental_index[pos];
+            hole = pos;
+        }
+    }
+
+    rental_index[hole] = SLOT_NONE;
+}
+
+static struct rental_entry *find_rental(const uint8_t *tag_id, size_t tag_id_len)
+{
+    uint32_t pos = index_probe(tag_hash(tag_id, tag_id_len), tag_id, tag_id_len);
+
+    if (rental_index[pos] == SLOT_NONE) {
+        return NULL;
+    }
+    return slot_entry(rental_index[pos]);
+}
+
+static struct rental_entry *add_rental(const uint8_t *tag_id, size_t tag_id_len)
+{
+    if (free_head == SLOT_NONE) {
+        return NULL;
+    }
+
+    uint32_t hash = tag_hash(tag_id, tag_id_len);
+    uint32_t pos = index_probe(hash, tag_id, tag_id_len);
+    uint16_t slot = free_head;
+    struct rental_entry *entry = slot_entry(slot);
+
+    free_head = entry->next_free;
+
+    memset(entry, 0, sizeof(*entry));
+    rentscan_expiry_entry_init(&entry->expiry);
+    memcpy(entry->tag_id, tag_id, tag_id_len);
+    entry->tag_id_len = tag_id_len;
+    entry->hash = hash;
+    entry->in_use = true;
+    entry->status = STATUS_AVAILABLE;
+
+    rental_index[pos] = slot;
+    num_rentals++;
+
+    touch(entry);
+    mark_dirty(entry);
+    return entry;
+}
+
+static void remove_rental(struct rental_entry *entry)
+{
+    uint16_t slot = (entry - rentals) + 1;
+
+    rentscan_expiry_cancel(&rental_expiry, &entry->expiry);
+    index_remove(index_probe(entry->hash, entry->tag_id, entry->tag_id_len));
+
+    entry->in_use = false;
+    entry->next_free = free_head;
+    free_head = slot;
+    num_rentals--;
+
+    tombstone_add(entry);
+    mark_dirty(entry);
+}
+
+/* Build the status update of an entry. Must be called with rental_lock held. */
+static void status_msg(rentscan_msg_t *msg, const struct rental_entry *entry)
+{
+    *msg = (rentscan_msg_t) {
         .cmd = CMD_STATUS_RESP,
         .status = entry->status,
         .timestamp = entry->start_time,
         .duration = entry->duration,
         .tag_id_len = entry->tag_id_len
     };
-    memcpy(msg.tag_id, entry->tag_id, entry->tag_id_len);
+    memcpy(msg->tag_id, entry->tag_id, entry->tag_id_len);
+}
+
+/* Have the item of a refused update sent again with the state it has then */
+static void notify_later(const rentscan_msg_t *msg)
+{
+    k_mutex_lock(&rental_lock, K_FOREVER);
+    struct rental_entry *entry = find_rental(msg->tag_id, msg->tag_id_len);
 
-    status_callback(&msg);
+    // A returned item is gone from the table, the gateway ended it itself
+    if (entry) {
+        entry->notify_pending = true;
+    }
+    k_mutex_unlock(&rental_lock);
+
+    k_work_schedule_for_queue(&workq_rental.queue, &notify_work, K_MSEC(NOTIFY_RETRY_MS));
 }
 
-static struct rental_entry *find_rental(const uint8_t *tag_id, size_t tag_id_len)
+/**
+ * @brief Send a status update built under rental_lock
+ *
+ * Must be called without rental_lock held. Updates refused for lack of TX
+ * room are sent again from the rental work queue; one lost while the link
+ * is down is set right by the delta sync when it comes back.
+ */
+static void send_status_update(const rentscan_msg_t *msg)
+{
+    if (!status_callback) {
+        return;
+    }
+
+    // While a resend is due the TX queue is still full, don't wait for it again
+    if (!k_work_delayable_is_pending(&notify_work) && status_callback(msg) != -ENOBUFS) {
+        return;
+    }
+
+    notify_later(msg);
+}
+
+static void notify_work_handler(struct k_work *work)
 {
-    for (int i = 0; i < num_rentals; i++) {
-        if (rentals[i].tag_id_len == tag_id_len &&
-            memcmp(rentals[i].tag_id, tag_id, tag_id_len) == 0) {
-            return &rentals[i];
+    for (int i = 0; i < MAX_ACTIVE_RENTALS; i++) {
+        struct rental_entry *entry = &rentals[i];
+        rentscan_msg_t msg;
+        bool pending;
+
+        k_mutex_lock(&rental_lock, K_FOREVER);
+        pending = entry->in_use && entry->notify_pending;
+        if (pending) {
+            entry->notify_pending = false;
+            status_msg(&msg, entry);
         }
+        k_mutex_unlock(&rental_lock);
+
+        if (pending && status_callback && status_callback(&msg) == -ENOBUFS) {
+            notify_later(&msg);
+            return;
+        }
+    }
+}
+
+static void rental_expired_handler(struct rentscan_expiry_entry *expiry)
+{
+    struct rental_entry *entry = CONTAINER_OF(expiry, struct rental_entry, expiry);
+    rentscan_msg_t update;
+    bool expired;
+
+    k_mutex_lock(&rental_lock, K_FOREVER);
+    expired = entry->in_use && entry->status == STATUS_RENTED;
+    if (expired) {
+        entry->status = STATUS_EXPIRED;
+        LOG_INF("Rental expired");
+        touch(entry);
+        mark_dirty(entry);
+        status_msg(&update, entry);
     }
-    return NULL;
+    k_mutex_unlock(&rental_lock);
+
+    if (expired) {
+        send_status_update(&update);
+    }
+}
+
+/* Deadlines are in network time, so rentals wait for the first time sync
+ * before they are scheduled
+ */
+static void schedule_expiry(struct rental_entry *entry)
+{
+    if (!rentscan_time_is_synced()) {
+        return;
+    }
+
+    // One slot per rental, so the scheduler can never be full here
+    rentscan_expiry_schedule(&rental_expiry, &entry->expiry,
+                             entry->start_time + entry->duration);
 }
 
-static void check_work_handler(struct k_work *work)
+/* Schedule the rentals held back so far and move the rest to the new offset */
+static void time_changed(void)
 {
-    uint32_t now = k_uptime_get_32() / 1000;
-    int expired = 0;
+    for (int i = 0; i < MAX_ACTIVE_RENTALS; i++) {
+        struct rental_entry *entry = &rentals[i];
 
-    for (int i = 0; i < num_rentals; i++) {
-        if (rentals[i].status == STATUS_RENTED) {
-            uint32_t end_time = rentals[i].start_time + rentals[i].duration;
-            if (now >= end_time) {
-                rentals[i].status = STATUS_EXPIRED;
-                send_status_update(&rentals[i]);
-                expired++;
+        if (entry->in_use && entry->status == STATUS_RENTED &&
+            !rentscan_expiry_is_scheduled(&entry->expiry)) {
+            schedule_expiry(entry);
+        }
+    }
+
+    rentscan_expiry_resync(&rental_expiry);
+}
+
+#if defined(CONFIG_RENTSCAN_RENTAL_PERSIST)
+/* Restore one slot. All records arrive in a single settings_load() pass and
+ * the index is rebuilt once in rental_settings_commit().
+ */
+static int rental_settings_set(const char *name, size_t len,
+                               settings_read_cb read_cb, void *cb_arg)
+{
+    const char *next;
+    struct rental_record rec;
+    char *end;
+
+    settings_name_next(name, &next);
+    if (next) {
+        return -ENOENT;
+    }
+
+    unsigned long slot = strtoul(name, &end, 10);
+
+    if (end == name || slot >= MAX_ACTIVE_RENTALS) {
+        // Capacity shrank or the key is foreign, forget the record
+        return -EINVAL;
+    }
+
+    if (len != sizeof(rec) || read_cb(cb_arg, &rec, sizeof(rec)) != sizeof(rec) ||
+        rec.version != RENTAL_RECORD_VERSION ||
+        rec.tag_id_len == 0 || rec.tag_id_len > MAX_TAG_ID_LEN) {
+        atomic_set_bit(dirty_slots, slot);
+        return -EINVAL;
+    }
+
+    struct rental_entry *entry = &rentals[slot];
+
+    k_mutex_lock(&rental_lock, K_FOREVER);
+    memset(entry, 0, sizeof(*entry));
+    rentscan_expiry_entry_init(&entry->expiry);
+    memcpy(entry->tag_id, rec.tag_id, rec.tag_id_len);
+    entry->tag_id_len = rec.tag_id_len;
+    entry->status = rec.status;
+    entry->start_time = rec.start_time;
+    entry->duration = rec.duration;
+    entry->in_use = true;
+    k_mutex_unlock(&rental_lock);
+
+    return 0;
+}
+
+static int rental_settings_commit(void)
+{
+    k_mutex_lock(&rental_lock, K_FOREVER);
+    memset(rental_index, 0, sizeof(rental_index));
+    free_head = SLOT_NONE;
+    num_rentals = 0;
+
+    // Walk backwards so the free list hands out low slots first
+    for (int i = MAX_ACTIVE_RENTALS - 1; i >= 0; i--) {
+        struct rental_entry *entry = &rentals[i];
+
+        if (entry->in_use) {
+            entry->hash = tag_hash(entry->tag_id, entry->tag_id_len);
+
+            uint32_t pos = index_probe(entry->hash, entry->tag_id, entry->tag_id_len);
+
+            if (rental_index[pos] == SLOT_NONE) {
+                rental_index[pos] = i + 1;
+                num_rentals++;
+
+                if (entry->status == STATUS_RENTED) {
+                    schedule_expiry(entry);
+                }
+                continue;
             }
+
+            // Duplicate tag, keep the first copy and drop this one from flash
+            entry->in_use = false;
+            atomic_set_bit(dirty_slots, i);
         }
+
+        entry->next_free = free_head;
+        free_head = i + 1;
     }
 
-    if (expired > 0) {
-        LOG_INF("%d rentals expired", expired);
+    atomic_inc(&generation);
+    LOG_INF("Restored %u rentals", num_rentals);
+    k_mutex_unlock(&rental_lock);
+
+    // Clean up records that were rejected while loading
+    for (int i = 0; i < MAX_ACTIVE_RENTALS; i++) {
+        if (atomic_test_bit(dirty_slots, i)) {
+            k_work_schedule_for_queue(&workq_persist.queue, &flush_work,
+                                      K_MSEC(CONFIG_RENTSCAN_RENTAL_FLUSH_DELAY_MS));
+            break;
+        }
     }
 
-    // Schedule next check
-    k_work_schedule(&check_work, RENTAL_CHECK_INTERVAL);
+    return 0;
 }
 
+SETTINGS_STATIC_HANDLER_DEFINE(rental, SETTINGS_SUBTREE, NULL,
+                               rental_settings_set, rental_settings_commit, NULL);
+#endif /* CONFIG_RENTSCAN_RENTAL_PERSIST */
+
 int rental_manager_init(rental_status_cb_t status_changed_cb)
 {
     status_callback = status_changed_cb;
     num_rentals = 0;
 
-    // Initialize periodic check work
-    k_work_init_delayable(&check_work, check_work_handler);
-    k_work_schedule(&check_work, RENTAL_CHECK_INTERVAL);
+    // Chain every slot onto the free list
+    memset(rental_index, 0, sizeof(rental_index));
+    for (int i = 0; i < MAX_ACTIVE_RENTALS; i++) {
+        rentals[i].in_use = false;
+        rentals[i].next_free = (i + 1 < MAX_ACTIVE_RENTALS) ? i + 2 : SLOT_NONE;
+    }
+    free_head = 1;
+
+    rentscan_expiry_init(&rental_expiry, &workq_rental.queue, rental_expired_handler);
+
+    // A gateway that never synced asks for epoch 0
+    sync_epoch = sys_rand32_get() | 1;
+
+#if defined(CONFIG_RENTSCAN_RENTAL_PERSIST)
+    k_work_init_delayable(&flush_work, flush_work_handler);
+#endif
 
     LOG_INF("Rental manager initialized");
     return 0;
@@ -95,30 +594,204 @@ int rental_manager_process_tag(const uint8_t *tag_id, size_t tag_id_len,
         return -EINVAL;
     }
 
+    rentscan_msg_t update;
+    bool added = false;
+    int err = 0;
+
+    k_mutex_lock(&rental_lock, K_FOREVER);
+
     struct rental_entry *entry = find_rental(tag_id, tag_id_len);
     
-    if (!entry && num_rentals < MAX_ACTIVE_RENTALS) {
+    if (!entry) {
         // New tag - add to rentals list
-        entry = &rentals[num_rentals++];
-        memcpy(entry->tag_id, tag_id, tag_id_len);
-        entry->tag_id_len = tag_id_len;
-        entry->status = STATUS_AVAILABLE;
-        entry->start_time = 0;
-        entry->duration = 0;
-        
-        send_status_update(entry);
+        entry = add_rental(tag_id, tag_id_len);
+        if (entry) {
+            status_msg(&update, entry);
+            added = true;
+        } else {
+            LOG_WRN("Rental table full (%d items), tag not tracked",
+                    MAX_ACTIVE_RENTALS);
+            err = -ENOSPC;
+        }
+    }
+
+    k_mutex_unlock(&rental_lock);
+
+    if (added) {
+        send_status_update(&update);
+    }
+    return err;
+}
+
+/**
+ * @brief Find the next item of a listing, starting at its cursor
+ *
+ * Must be called with rental_lock held.
+ */
+static bool sync_peek(struct sync_listing *listing, struct rentscan_sync_entry *item)
+{
+    memset(item, 0, sizeof(*item));
+
+    for (; listing->pos < SYNC_POS_END; listing->pos++) {
+        if (listing->pos < ARRAY_SIZE(tombstones)) {
+            const struct rental_tombstone *t = &tombstones[listing->pos];
+
+            // A tag back in the table is listed with its current state below
+            if (listing->full || !t->tag_id_len || t->gen <= listing->since ||
+                find_rental(t->tag_id, t->tag_id_len)) {
+                continue;
+            }
+
+            memcpy(item->tag_id, t->tag_id, t->tag_id_len);
+            item->tag_id_len = t->tag_id_len;
+            item->status = STATUS_AVAILABLE;
+            return true;
+        }
+
+        const struct rental_entry *entry = &rentals[listing->pos - ARRAY_SIZE(tombstones)];
+
+        if (!entry->in_use || (!listing->full && entry->sync_gen <= listing->since)) {
+            continue;
+        }
+
+        memcpy(item->tag_id, entry->tag_id, entry->tag_id_len);
+        item->tag_id_len = entry->tag_id_len;
+        item->status = entry->status;
+        item->start_time = entry->start_time;
+        item->duration = entry->duration;
+        return true;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Fill the payload of the next message of a listing
+ *
+ * Must be called with rental_lock held.
+ */
+static void sync_fill(struct sync_listing *listing, rentscan_msg_t *msg)
+{
+    struct rentscan_sync_entry item;
+
+    msg->payload_len = 0;
+    while (sync_peek(listing, &item)) {
+        int len = rentscan_sync_entry_encode(&item, &msg->payload[msg->payload_len],
+                                             sizeof(msg->payload) - msg->payload_len);
+
+        if (len == -ENOMEM && msg->payload_len > 0) {
+            // Starts the next message
+            break;
+        }
+        if (len > 0) {
+            msg->payload_len += len;
+            listing->count++;
+        }
+        listing->pos++;
+    }
+
+    if (listing->pos >= SYNC_POS_END) {
+        msg->status |= RENTSCAN_SYNC_LAST;
     }
+}
+
+/**
+ * @brief Answer a sync request from the gateway
+ *
+ * Must be called without rental_lock held. It is taken while a message is
+ * filled and released while the message waits for room in the TX queue,
+ * so taps and expiry are not held up by a long listing.
+ */
+static int send_sync_delta(uint32_t epoch, uint32_t since)
+{
+    struct sync_listing listing = { 0 };
+    int err;
+
+    if (!status_callback) {
+        return -ENOTCONN;
+    }
+
+    k_mutex_lock(&rental_lock, K_FOREVER);
+
+    uint32_t current = atomic_get(&generation);
+
+    listing.full = epoch != sync_epoch || since > current || since < tombstone_floor;
+    listing.since = listing.full ? 0 : since;
+
+    rentscan_msg_t msg = {
+        .cmd = CMD_SYNC_DELTA,
+        .status = listing.full ? RENTSCAN_SYNC_FULL : 0,
+        .epoch = sync_epoch,
+        .generation = current,
+    };
 
+    do {
+        /* A return forgotten while the listing waited would be missed,
+         * the whole table is listed instead
+         */
+        if (!listing.full && tombstone_floor > listing.since) {
+            LOG_INF("Returns forgotten during a delta sync, listing every item");
+            listing = (struct sync_listing) { .full = true };
+            msg.status = RENTSCAN_SYNC_FULL;
+            msg.generation = atomic_get(&generation);
+            msg.corr_id = 0;
+        }
+
+        // Numbered from 1, so the gateway notices a message that went missing
+        msg.corr_id++;
+        sync_fill(&listing, &msg);
+        k_mutex_unlock(&rental_lock);
+
+        err = status_callback(&msg);
+        if (err) {
+            LOG_WRN("Sync aborted after %u items (err %d)", listing.count, err);
+
+            /* The gateway asks again when the link comes back, but not
+             * while it waits for the rest of this listing
+             */
+            if (err != -ENOTCONN) {
+                sync_retry_epoch = epoch;
+                sync_retry_generation = since;
+                k_work_schedule_for_queue(&workq_rental.queue, &sync_retry_work,
+                                          K_MSEC(SYNC_RETRY_MS));
+            }
+            return err;
+        }
+
+        k_mutex_lock(&rental_lock, K_FOREVER);
+    } while (!(msg.status & RENTSCAN_SYNC_LAST));
+
+    k_mutex_unlock(&rental_lock);
+
+    LOG_INF("Sent %s sync of %u items in %u messages at generation %u",
+            listing.full ? "full" : "delta", listing.count, msg.corr_id, msg.generation);
     return 0;
 }
 
-int rental_manager_process_command(const uint8_t *data, uint16_t len)
+static void sync_retry_work_handler(struct k_work *work)
 {
-    if (!data || len < sizeof(rentscan_msg_t)) {
-        return -EINVAL;
+    send_sync_delta(sync_retry_epoch, sync_retry_generation);
+}
+
+/**
+ * @brief Apply one command from the gateway
+ *
+ * Must be called with rental_lock held.
+ *
+ * @param msg Decoded command
+ * @param update Status update to send once the lock is released
+ * @param notify Set to true when @p update was filled in
+ * @return int 0 on success, negative error code otherwise
+ */
+static int process_one_command(const rentscan_msg_t *msg, rentscan_msg_t *update, bool *notify)
+{
+    if (msg->cmd == CMD_TIME_RESP) {
+        if (time_sync_process(msg) == 0) {
+            time_changed();
+        }
+        return 0;
     }
 
-    const rentscan_msg_t *msg = (const rentscan_msg_t *)data;
     struct rental_entry *entry = find_rental(msg->tag_id, msg->tag_id_len);
 
     if (!entry) {
@@ -135,6 +808,9 @@ int rental_manager_process_command(const uint8_t *data, uint16_t len)
         entry->status = STATUS_RENTED;
         entry->start_time = msg->timestamp;
         entry->duration = msg->duration;
+        touch(entry);
+        mark_dirty(entry);
+        schedule_expiry(entry);
         break;
 
     case CMD_RENTAL_END:
@@ -146,34 +822,74 @@ int rental_manager_process_command(const uint8_t *data, uint16_t len)
         entry->status = STATUS_AVAILABLE;
         entry->start_time = 0;
         entry->duration = 0;
-        break;
+
+        // Report the return, then release the slot for the next item
+        status_msg(update, entry);
+        *notify = true;
+        remove_rental(entry);
+        return 0;
 
     default:
         LOG_WRN("Unknown command %d", msg->cmd);
         return -EINVAL;
     }
 
-    send_status_update(entry);
+    status_msg(update, entry);
+    *notify = true;
     return 0;
 }
 
-int rental_manager_check_expirations(void)
+int rental_manager_process_command(const uint8_t *data, uint16_t len)
 {
-    uint32_t now = k_uptime_get_32() / 1000;
-    int expired = 0;
+    if (!data) {
+        return -EINVAL;
+    }
+
+    int result = 0;
+
+    /* A single write may carry several encoded commands back to back */
+    while (len > 0) {
+        rentscan_msg_t msg;
+        int consumed = rentscan_msg_decode(&msg, data, len);
+        if (consumed < 0) {
+            metrics_inc(RENTSCAN_MAIN_METRIC_MSG_MALFORMED);
+            LOG_ERR("Malformed command (err %d)", consumed);
+            return consumed;
+        }
+
+        metrics_inc(RENTSCAN_MAIN_METRIC_MSG_RX);
+
+        int err;
+
+        if (msg.cmd == CMD_SYNC_REQ) {
+            // A new request replaces the listing still to be sent again
+            k_work_cancel_delayable(&sync_retry_work);
+            err = send_sync_delta(msg.epoch, msg.generation);
+        } else if (msg.cmd == CMD_STATS_REQ) {
+            // The reports wait for TX room and don't touch the table
+            err = (msg.status & RENTSCAN_STATS_METRICS) ? metrics_report() :
+                                                          latency_stats_report();
+        } else {
+            rentscan_msg_t update;
+            bool notify = false;
 
-    for (int i = 0; i < num_rentals; i++) {
-        if (rentals[i].status == STATUS_RENTED) {
-            uint32_t end_time = rentals[i].start_time + rentals[i].duration;
-            if (now >= end_time) {
-                rentals[i].status = STATUS_EXPIRED;
-                send_status_update(&rentals[i]);
-                expired++;
+            k_mutex_lock(&rental_lock, K_FOREVER);
+            err = process_one_command(&msg, &update, &notify);
+            k_mutex_unlock(&rental_lock);
+
+            if (notify) {
+                send_status_update(&update);
             }
         }
+        if (err) {
+            result = err;
+        }
+
+        data += consumed;
+        len -= consumed;
     }
 
-    return expired;
+    return result;
 }
 
 int rental_manager_get_status(const uint8_t *tag_id, size_t tag_id_len,
@@ -183,11 +899,59 @@ int rental_manager_get_status(const uint8_t *tag_id, size_t tag_id_len,
         return -EINVAL;
     }
 
+    int err = 0;
+
+    k_mutex_lock(&rental_lock, K_FOREVER);
+
     struct rental_entry *entry = find_rental(tag_id, tag_id_len);
-    if (!entry) {
-        return -ENOENT;
+    if (entry) {
+        *status = entry->status;
+    } else {
+        err = -ENOENT;
     }
 
-    *status = entry->status;
-    return 0;
+    k_mutex_unlock(&rental_lock);
+    return err;
+}
+
+uint32_t rental_manager_generation(void)
+{
+    return atomic_get(&generation);
+}
+
+size_t rental_manager_get_unavailable(struct rental_summary *out, size_t max,
+                                      size_t skip, size_t *total)
+{
+    size_t found = 0;
+    size_t count = 0;
+
+    k_mutex_lock(&rental_lock, K_FOREVER);
+    for (int i = 0; i < MAX_ACTIVE_RENTALS; i++) {
+        const struct rental_entry *entry = &rentals[i];
+
+        if (!entry->in_use || entry->status == STATUS_AVAILABLE) {
+            continue;
+        }
+
+        if (found >= skip && count < max) {
+            out[count].tag_hash = entry->hash;
+            out[count].status = entry->status;
+            count++;
+        }
+        found++;
+    }
+    k_mutex_unlock(&rental_lock);
+
+    if (total) {
+        *total = found;
+    }
+    return count;
+}
+
+void rental_manager_get_stats(struct rental_manager_stats *stats)
+{
+    k_mutex_lock(&rental_lock, K_FOREVER);
+    stats->rentals = num_rentals;
+    k_mutex_unlock(&rental_lock);
+    rentscan_expiry_get_stats(&rental_expiry, &stats->expiry);
 }
\ No newline at end of file
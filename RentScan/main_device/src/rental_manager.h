@@ -9,17 +9,27 @@
 #include <zephyr/types.h>
 #include <stdbool.h>
 #include "../../common/include/rentscan_protocol.h"
+#include "../../common/include/rentscan_expiry.h"
 
 /**
- * @brief Callback for rental status changes
+ * @brief Callback for messages to the gateway
+ * 
+ * Called with every rental status change, and with the CMD_SYNC_DELTA
+ * messages answering a gateway's sync request. The rental table is not
+ * locked during the call, so it may wait for room in the TX queue. A
+ * status update refused with -ENOBUFS is sent again later.
  * 
  * @param msg Pointer to RentScan message containing status information
+ * @return int 0 on success, negative error code if the message was not sent
  */
-typedef void (*rental_status_cb_t)(const rentscan_msg_t *msg);
+typedef int (*rental_status_cb_t)(const rentscan_msg_t *msg);
 
 /**
  * @brief Initialize the rental manager
  * 
+ * Rentals are marked expired when their deadline passes and reported
+ * through @p status_changed_cb; no periodic polling is needed.
+ * 
  * @param status_changed_cb Callback function for rental status changes
  * @return int 0 on success, negative error code otherwise
  */
@@ -28,11 +38,14 @@ int rental_manager_init(rental_status_cb_t status_changed_cb);
 /**
  * @brief Process a tag scan event
  * 
+ * Unknown tags are added to the rental table as available items.
+ * 
  * @param tag_id Pointer to tag ID
  * @param tag_id_len Length of tag ID
  * @param tag_data Pointer to tag data (can be NULL)
  * @param tag_data_len Length of tag data
- * @return int 0 on success, negative error code otherwise
+ * @return int 0 on success, -ENOSPC if the rental table is full,
+ *             negative error code otherwise
  */
 int rental_manager_process_tag(const uint8_t *tag_id, size_t tag_id_len,
                               const uint8_t *tag_data, size_t tag_data_len);
@@ -40,21 +53,14 @@ int rental_manager_process_tag(const uint8_t *tag_id, size_t tag_id_len,
 /**
  * @brief Process a command received from the gateway
  * 
+ * @p data holds one or more encoded messages back to back.
+ * 
  * @param data Pointer to command data
  * @param len Length of command data
  * @return int 0 on success, negative error code otherwise
  */
 int rental_manager_process_command(const uint8_t *data, uint16_t len);
 
-/**
- * @brief Check for rental expirations
- * 
- * This function should be called periodically to check for rental expirations
- * 
- * @return int Number of expired rentals found
- */
-int rental_manager_check_expirations(void);
-
 /**
  * @brief Get current rental status for a tag
  * 
@@ -66,4 +72,49 @@ int rental_manager_check_expirations(void);
 int rental_manager_get_status(const uint8_t *tag_id, size_t tag_id_len,
                              rentscan_status_t *status);
 
+/**
+ * @brief Summary of one item that is not available
+ */
+struct rental_summary {
+    uint32_t tag_hash;          /**< Hash of the tag ID, see rentscan_beacon_tag_hash() */
+    rentscan_status_t status;   /**< Current status */
+};
+
+/**
+ * @brief Get the rental state generation
+ * 
+ * The value changes whenever an item is added, rented, expires or is
+ * returned.
+ * 
+ * @return uint32_t Current generation
+ */
+uint32_t rental_manager_generation(void);
+
+/**
+ * @brief List the items that are not available
+ * 
+ * @param out Array to store the summaries in
+ * @param max Size of @p out
+ * @param skip Number of unavailable items to skip before filling @p out
+ * @param total Pointer to store the total number of unavailable items, can be NULL
+ * @return size_t Number of summaries stored
+ */
+size_t rental_manager_get_unavailable(struct rental_summary *out, size_t max,
+                                      size_t skip, size_t *total);
+
+/**
+ * @brief Load figures of the rental table
+ */
+struct rental_manager_stats {
+    uint16_t rentals;                     /**< Items tracked */
+    struct rentscan_expiry_stats expiry;  /**< Cost of the expiry work */
+};
+
+/**
+ * @brief Get the load figures of the rental table
+ * 
+ * @param stats Pointer to store the figures
+ */
+void rental_manager_get_stats(struct rental_manager_stats *stats);
+
 #endif /* RENTAL_MANAGER_H */ 
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+ * @file scan_ring.c
+ * @brief Single-producer/single-consumer ring of NFC scan events
+ *
+ * The producer only writes head and the consumer only writes tail, so no
+ * lock is needed. Indices run freely and are masked on access, which keeps
+ * one slot from being wasted to tell a full ring from an empty one.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/sys/atomic.h>
+#include "scan_ring.h"
+
+#define SCAN_RING_DEPTH CONFIG_RENTSCAN_SCAN_RING_DEPTH
+#define SCAN_RING_MASK (SCAN_RING_DEPTH - 1)
+
+BUILD_ASSERT(IS_POWER_OF_TWO(SCAN_RING_DEPTH), "Scan ring depth must be a power of two");
+
+static struct scan_event ring[SCAN_RING_DEPTH];
+static atomic_t head;
+static atomic_t tail;
+static atomic_t overflow_count;
+
+bool scan_ring_put(const struct scan_event *evt)
+{
+    uint32_t h = (uint32_t)atomic_get(&head);
+
+    if ((uint32_t)(h - (uint32_t)atomic_get(&tail)) >= SCAN_RING_DEPTH) {
+        atomic_inc(&overflow_count);
+        return false;
+    }
+
+    ring[h & SCAN_RING_MASK] = *evt;
+
+    /* Publish the slot only after it is fully written */
+    atomic_set(&head, (atomic_val_t)(h + 1));
+    return true;
+}
+
+size_t scan_ring_get_batch(struct scan_event *evts, size_t max)
+{
+    uint32_t t = (uint32_t)atomic_get(&tail);
+    uint32_t avail = (uint32_t)atomic_get(&head) - t;
+    size_t n = MIN(avail, max);
+
+    for (size_t i = 0; i < n; i++) {
+        evts[i] = ring[(t + i) & SCAN_RING_MASK];
+    }
+
+    /* Hand the slots back only after they are copied out */
+    atomic_set(&tail, (atomic_val_t)(t + n));
+    return n;
+}
+
+bool scan_ring_is_empty(void)
+{
+    return atomic_get(&head) == atomic_get(&tail);
+}
+
+size_t scan_ring_count(void)
+{
+    return (uint32_t)atomic_get(&head) - (uint32_t)atomic_get(&tail);
+}
+
+uint32_t scan_ring_overflow_count(void)
+{
+    return (uint32_t)atomic_get(&overflow_count);
+}
@@ -0,0 +1,70 @@
+/**
+ * @file scan_ring.h
+ * @brief Lock-free queue of NFC scan events from the NFC ISR to the work queue
+ */
+
+#ifndef SCAN_RING_H
+#define SCAN_RING_H
+
+#include <zephyr/types.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * @brief One NFC scan, as reported by the NFC handler
+ *
+ * The data pointers refer to the NFC handler's payload buffer and are not
+ * copied.
+ */
+struct scan_event {
+    const uint8_t *tag_id;    /**< Tag ID */
+    const uint8_t *tag_data;  /**< Extra tag data, NULL if none */
+    uint16_t tag_data_len;    /**< Length of extra tag data */
+    uint8_t tag_id_len;       /**< Length of tag ID */
+    uint32_t timestamp_ms;    /**< Uptime of the scan in milliseconds */
+    uint32_t cycles;          /**< Cycle counter at the scan, for latency statistics */
+};
+
+/**
+ * @brief Queue a scan event
+ *
+ * Must only be called from a single producer context (the NFC callback).
+ *
+ * @param evt Event to copy into the ring
+ * @return true if queued, false if the ring was full and the event was dropped
+ */
+bool scan_ring_put(const struct scan_event *evt);
+
+/**
+ * @brief Take up to @p max queued events in one go
+ *
+ * Must only be called from a single consumer context.
+ *
+ * @param evts Array to copy the events into
+ * @param max Size of @p evts
+ * @return size_t Number of events copied
+ */
+size_t scan_ring_get_batch(struct scan_event *evts, size_t max);
+
+/**
+ * @brief Check whether the ring holds no events
+ *
+ * @return true if empty
+ */
+bool scan_ring_is_empty(void);
+
+/**
+ * @brief Get the number of events waiting
+ *
+ * @return size_t Events queued and not yet taken
+ */
+size_t scan_ring_count(void);
+
+/**
+ * @brief Get the number of events dropped because the ring was full
+ *
+ * @return uint32_t Overflow count since boot
+ */
+uint32_t scan_ring_overflow_count(void);
+
+#endif /* SCAN_RING_H */
\ No newline at end of file
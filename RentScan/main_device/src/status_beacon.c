@@ -0,0 +1,149 @@
+/**
+ * @file status_beacon.c
+ * @brief Connectionless rental status beacon of the main device
+ *
+ * The items that are not available are published as RentScan service data
+ * in a non-connectable extended advertisement. When they don't fit in one
+ * advertisement the beacon rotates through pages, one page per
+ * CONFIG_RENTSCAN_BEACON_ROTATE_MS. A change of the rental state restarts
+ * the rotation at the first page with a new sequence number.
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/bluetooth/bluetooth.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "status_beacon.h"
+#include "workq.h"
+#include "rental_manager.h"
+#include "../../common/include/rentscan_beacon.h"
+
+LOG_MODULE_REGISTER(status_beacon, LOG_LEVEL_INF);
+
+#define UUID_LEN 16
+
+/* Advertising intervals are in 0.625 ms units */
+#define BEACON_INTERVAL_UNITS (CONFIG_RENTSCAN_BEACON_INTERVAL_MS * 8 / 5)
+
+static struct bt_le_ext_adv *beacon_adv;
+static uint8_t svc_data[UUID_LEN + RENTSCAN_BEACON_MAX_LEN] = {
+    BT_UUID_RENTSCAN_VAL
+};
+static uint32_t published_generation;
+static uint8_t next_page;
+
+static void rotate_work_handler(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(rotate_work, rotate_work_handler);
+
+static int publish_page(void)
+{
+    struct rental_summary items[RENTSCAN_BEACON_MAX_ENTRIES];
+    struct rentscan_beacon beacon;
+    uint32_t generation = rental_manager_generation();
+    size_t total;
+    size_t count;
+
+    if (generation != published_generation) {
+        /* Observers drop their pages when seq changes, start over */
+        published_generation = generation;
+        next_page = 0;
+    }
+
+    count = rental_manager_get_unavailable(items, ARRAY_SIZE(items),
+                                           next_page * RENTSCAN_BEACON_MAX_ENTRIES, &total);
+
+    size_t page_count = DIV_ROUND_UP(total, RENTSCAN_BEACON_MAX_ENTRIES);
+
+    if (page_count == 0) {
+        page_count = 1;
+    } else if (page_count > RENTSCAN_BEACON_MAX_PAGES) {
+        /* Observers can't track more pages; the summary is truncated */
+        page_count = RENTSCAN_BEACON_MAX_PAGES;
+    }
+
+    if (next_page >= page_count) {
+        next_page = 0;
+        count = rental_manager_get_unavailable(items, ARRAY_SIZE(items), 0, &total);
+    }
+
+    beacon.seq = generation;
+    beacon.page = next_page;
+    beacon.page_count = page_count;
+    beacon.total = MIN(total, UINT16_MAX);
+    beacon.entry_count = count;
+    for (size_t i = 0; i < count; i++) {
+        beacon.entries[i].tag_hash = items[i].tag_hash;
+        beacon.entries[i].status = items[i].status;
+    }
+
+    int len = rentscan_beacon_encode(&beacon, &svc_data[UUID_LEN], sizeof(svc_data) - UUID_LEN);
+    if (len < 0) {
+        return len;
+    }
+
+    const struct bt_data ad[] = {
+        BT_DATA(BT_DATA_SVC_DATA128, svc_data, UUID_LEN + len),
+    };
+
+    int err = bt_le_ext_adv_set_data(beacon_adv, ad, ARRAY_SIZE(ad), NULL, 0);
+    if (err) {
+        LOG_WRN("Failed to update beacon (err %d)", err);
+        return err;
+    }
+
+    LOG_DBG("Beacon seq %u page %u/%u, %u entries", beacon.seq, beacon.page + 1,
+            beacon.page_count, beacon.entry_count);
+
+    next_page = (next_page + 1) % page_count;
+    return 0;
+}
+
+static void rotate_work_handler(struct k_work *work)
+{
+    publish_page();
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &rotate_work,
+                              K_MSEC(CONFIG_RENTSCAN_BEACON_ROTATE_MS));
+}
+
+int status_beacon_init(void)
+{
+    /* Sent from the identity address so observers can match the beacon
+     * to the device's connectable advertising.
+     */
+    const struct bt_le_adv_param param = BT_LE_ADV_PARAM_INIT(
+        BT_LE_ADV_OPT_EXT_ADV | BT_LE_ADV_OPT_USE_IDENTITY,
+        BEACON_INTERVAL_UNITS, BEACON_INTERVAL_UNITS + BEACON_INTERVAL_UNITS / 8,
+        NULL);
+    int err;
+
+    err = bt_le_ext_adv_create(&param, NULL, &beacon_adv);
+    if (err) {
+        LOG_ERR("Failed to create beacon advertising set (err %d)", err);
+        return err;
+    }
+
+    published_generation = rental_manager_generation();
+    err = publish_page();
+    if (err) {
+        return err;
+    }
+
+    err = bt_le_ext_adv_start(beacon_adv, BT_LE_EXT_ADV_START_DEFAULT);
+    if (err) {
+        LOG_ERR("Failed to start beacon (err %d)", err);
+        return err;
+    }
+
+    k_work_schedule_for_queue(&workq_housekeeping.queue, &rotate_work,
+                              K_MSEC(CONFIG_RENTSCAN_BEACON_ROTATE_MS));
+
+    LOG_INF("Status beacon started");
+    return 0;
+}
+
+void status_beacon_refresh(void)
+{
+    if (beacon_adv) {
+        k_work_reschedule_for_queue(&workq_housekeeping.queue, &rotate_work, K_NO_WAIT);
+    }
+}
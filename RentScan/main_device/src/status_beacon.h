@@ -0,0 +1,27 @@
+/**
+ * @file status_beacon.h
+ * @brief Connectionless rental status beacon of the main device
+ */
+
+#ifndef STATUS_BEACON_H
+#define STATUS_BEACON_H
+
+#include <zephyr/types.h>
+
+/**
+ * @brief Create the beacon advertising set and start publishing
+ * 
+ * Runs alongside the connectable advertising of the BLE service, so
+ * gateways can read rental states without connecting. Must be called
+ * after Bluetooth has been enabled.
+ * 
+ * @return int 0 on success, negative error code otherwise
+ */
+int status_beacon_init(void);
+
+/**
+ * @brief Publish the current rental states without waiting for the next rotation
+ */
+void status_beacon_refresh(void);
+
+#endif /* STATUS_BEACON_H */
\ No newline at end of file
@@ -0,0 +1,118 @@
+/**
+ * @file time_sync.c
+ * @brief Offset of the main device's clock to the network time of the gateway
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <stdlib.h>
+#include "time_sync.h"
+#include "ble_service.h"
+#include "metrics.h"
+
+LOG_MODULE_REGISTER(time_sync, LOG_LEVEL_INF);
+
+/* Used from the BLE receive path and from every thread that sends */
+static struct k_spinlock lock;
+static bool wanted;          /* Exchange due regardless of the last one */
+static bool pending;         /* Request sent, no usable response yet */
+static uint32_t pending_t1;
+static int64_t last_sync_ms;
+
+static bool due_locked(int64_t now_ms)
+{
+    /* A request that was not answered in time is given up */
+    if (pending && (uint32_t)now_ms - pending_t1 < CONFIG_RENTSCAN_TIME_MAX_RTT_MS) {
+        return false;
+    }
+
+    return wanted || !rentscan_time_is_synced() ||
+           now_ms - last_sync_ms >= (int64_t)CONFIG_RENTSCAN_TIME_RESYNC_S * MSEC_PER_SEC;
+}
+
+void time_sync_link_up(void)
+{
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    wanted = true;
+    pending = false;
+    k_spin_unlock(&lock, key);
+}
+
+void time_sync_piggyback(void)
+{
+    rentscan_msg_t req;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (!due_locked(k_uptime_get())) {
+        k_spin_unlock(&lock, key);
+        return;
+    }
+
+    pending_t1 = rentscan_time_request(&req);
+    pending = true;
+    wanted = false;
+    k_spin_unlock(&lock, key);
+
+    int err = ble_service_send_message(&req);
+
+    if (err) {
+        key = k_spin_lock(&lock);
+        pending = false;
+        wanted = true;
+        k_spin_unlock(&lock, key);
+        LOG_DBG("Time request not sent (err %d)", err);
+    }
+}
+
+int time_sync_process(const rentscan_msg_t *msg)
+{
+    struct rentscan_time_sample sample;
+    int64_t t4_ms = k_uptime_get();
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (!pending) {
+        k_spin_unlock(&lock, key);
+        return -ESTALE;
+    }
+
+    int err = rentscan_time_sample(msg, pending_t1, t4_ms, &sample);
+
+    if (err == -ESTALE) {
+        /* Late answer to a request given up on, keep waiting for ours */
+        k_spin_unlock(&lock, key);
+        return err;
+    }
+
+    pending = false;
+    if (!err && sample.rtt_ms > CONFIG_RENTSCAN_TIME_MAX_RTT_MS) {
+        err = -ETIMEDOUT;
+    }
+    if (err) {
+        wanted = true;
+    } else {
+        last_sync_ms = t4_ms;
+    }
+    k_spin_unlock(&lock, key);
+
+    if (err) {
+        metrics_inc(RENTSCAN_MAIN_METRIC_TIME_SYNC_REJECTS);
+        LOG_WRN("Time sample dropped (err %d)", err);
+        return err;
+    }
+
+    bool first = !rentscan_time_is_synced();
+    int64_t step_ms = sample.offset_ms - rentscan_time_get_offset();
+
+    rentscan_time_set_offset(sample.offset_ms);
+
+    metrics_inc(RENTSCAN_MAIN_METRIC_TIME_SYNCS);
+    metrics_peak(RENTSCAN_MAIN_METRIC_TIME_RTT_MS_MAX, sample.rtt_ms);
+    if (!first) {
+        metrics_peak(RENTSCAN_MAIN_METRIC_TIME_STEP_MS_MAX, MIN(llabs(step_ms), UINT32_MAX));
+    }
+
+    LOG_INF("Network time offset %lld ms (step %lld ms, round trip %u ms)",
+            (long long)sample.offset_ms, first ? 0LL : (long long)step_ms, sample.rtt_ms);
+    return 0;
+}
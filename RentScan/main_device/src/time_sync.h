@@ -0,0 +1,35 @@
+/**
+ * @file time_sync.h
+ * @brief Offset of the main device's clock to the network time of the gateway
+ */
+
+#ifndef TIME_SYNC_H
+#define TIME_SYNC_H
+
+#include <zephyr/types.h>
+#include "../../common/include/rentscan_time.h"
+
+/**
+ * @brief Ask for an exchange on a new connection
+ *
+ * The gateway may have restarted its clock while the link was down.
+ */
+void time_sync_link_up(void);
+
+/**
+ * @brief Send a time request ahead of other traffic if one is due
+ *
+ * Called before a message is handed to the BLE service, so the request
+ * shares its notification.
+ */
+void time_sync_piggyback(void);
+
+/**
+ * @brief Handle a CMD_TIME_RESP from the gateway
+ *
+ * @param msg Received response
+ * @return int 0 if the network time offset changed, negative error code otherwise
+ */
+int time_sync_process(const rentscan_msg_t *msg);
+
+#endif /* TIME_SYNC_H */
\ No newline at end of file
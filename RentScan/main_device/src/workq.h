@@ -0,0 +1,33 @@
+/**
+ * @file workq.h
+ * @brief Work queues of the main device
+ *
+ * Nothing of the main device runs on the system work queue, which is left
+ * to the Bluetooth host and the kernel.
+ */
+
+#ifndef WORKQ_H
+#define WORKQ_H
+
+#include "../../common/include/rentscan_workq.h"
+
+/** Tag processing and BLE notifications, latency critical */
+extern struct rentscan_workq workq_tag;
+
+/** Rental logic: expiry and the commands of the gateway */
+extern struct rentscan_workq workq_rental;
+
+/** Flash writes of the rental table */
+extern struct rentscan_workq workq_persist;
+
+/** NFC polling and the status beacon */
+extern struct rentscan_workq workq_housekeeping;
+
+/**
+ * @brief Start every work queue
+ *
+ * Must run before any other module is initialized.
+ */
+void workq_init(void);
+
+#endif /* WORKQ_H */
\ No newline at end of file
@@ -98,7 +98,7 @@ static uint8_t notify_func(struct bt_conn *conn,
         return BT_GATT_ITER_STOP;
     }
 
-    LOG_INF("Central received notify, %u bytes", length);
+    LOG_DBG("Central received notify, %u bytes", length);
     
     if (data_callback) {
         data_callback(data, length);
@@ -107,6 +107,22 @@ static uint8_t notify_func(struct bt_conn *conn,
     return BT_GATT_ITER_CONTINUE;
 }
 
+/* MTU exchange result, batches of the stress mode need more than 23 bytes */
+static void mtu_exchange_func(struct bt_conn *conn, uint8_t err,
+                              struct bt_gatt_exchange_params *params)
+{
+    if (err) {
+        LOG_WRN("MTU exchange failed (err %u)", err);
+        return;
+    }
+
+    LOG_INF("MTU exchanged, %u bytes", bt_gatt_get_mtu(conn));
+}
+
+static struct bt_gatt_exchange_params mtu_exchange_params = {
+    .func = mtu_exchange_func,
+};
+
 /* Find service and characteristic handlers */
 static uint8_t discover_func(struct bt_conn *conn,
                             const struct bt_gatt_attr *attr,
@@ -240,6 +256,11 @@ static void connected(struct bt_conn *conn, uint8_t err)
     if (is_device_found) {
         LOG_INF("Central connected");
         current_conn = bt_conn_ref(conn);
+
+        err = bt_gatt_exchange_mtu(conn, &mtu_exchange_params);
+        if (err) {
+            LOG_WRN("MTU exchange not started (err %d)", err);
+        }
         
         /* Start service discovery */
         discovery_complete = false;
@@ -319,11 +340,11 @@ int mock_ble_central_send_data(const uint8_t *data, uint16_t len)
         return -ENOTCONN;
     }
 
-    LOG_INF("Central sending write, %d bytes", len);
+    LOG_DBG("Central sending write, %d bytes", len);
     
     err = bt_gatt_write_without_response(current_conn, rx_handle, data, len, false);
     if (err) {
-        LOG_ERR("Write failed (err %d)", err);
+        LOG_DBG("Write failed (err %d)", err);
     }
     
     return err;
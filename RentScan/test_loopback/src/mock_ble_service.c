@@ -98,7 +98,7 @@ static ssize_t on_receive(struct bt_conn *conn,
                          uint16_t offset,
                          uint8_t flags)
 {
-    LOG_INF("Peripheral received data, len %u", len);
+    LOG_DBG("Peripheral received data, len %u", len);
     
     if (data_callback) {
         data_callback(buf, len);
@@ -162,10 +162,15 @@ int mock_ble_service_send_data(const uint8_t *data, uint16_t len)
     params.len = len;
     params.func = NULL;
 
-    LOG_INF("Peripheral sending data, %d bytes", len);
+    LOG_DBG("Peripheral sending data, %d bytes", len);
     return bt_gatt_notify_cb(current_conn, &params);
 }
 
+uint16_t mock_ble_service_get_mtu(void)
+{
+    return current_conn ? bt_gatt_get_mtu(current_conn) : 0;
+}
+
 bool mock_ble_service_is_connected(void)
 {
     return current_conn != NULL;
@@ -0,0 +1,326 @@
+/**
+ * @file stress.c
+ * @brief Loopback stress traffic between two boards running the test
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/logging/log.h>
+#include <string.h>
+#include "stress.h"
+
+LOG_MODULE_REGISTER(stress, LOG_LEVEL_INF);
+
+/* Function declarations for mock implementations */
+int mock_ble_service_send_data(const uint8_t *data, uint16_t len);
+bool mock_ble_service_is_connected(void);
+uint16_t mock_ble_service_get_mtu(void);
+int mock_ble_central_send_data(const uint8_t *data, uint16_t len);
+
+/* Tag ID marking stress traffic, nothing else on the link uses it */
+#define STRESS_TAG_ID "STRESS"
+#define STRESS_TAG_ID_LEN (sizeof(STRESS_TAG_ID) - 1)
+
+/* Largest notification with a 247 byte MTU */
+#define STRESS_PDU_MAX 244
+
+/* Most notifications sent by one run of the work item */
+#define STRESS_BURST_MAX 8
+
+/* Retry delay after running out of buffers or losing the link */
+#define STRESS_RETRY_MS 1
+#define STRESS_IDLE_MS 100
+
+static struct stress_config config;
+static struct stress_stats stats;
+static struct k_spinlock stats_lock;
+static struct k_work_delayable tick_work;
+
+/* Run the traffic belongs to, so late echoes of an earlier run are ignored */
+static uint32_t run_id;
+static int64_t start_ms;
+static uint32_t next_seq;
+static uint32_t expected_seq;
+
+static bool is_stress_msg(const rentscan_msg_t *msg)
+{
+    return msg->cmd == CMD_STATUS_RESP && msg->corr_id != 0 &&
+           msg->tag_id_len == STRESS_TAG_ID_LEN &&
+           memcmp(msg->tag_id, STRESS_TAG_ID, STRESS_TAG_ID_LEN) == 0;
+}
+
+/* Pack one notification of up to config.batch messages and send it */
+static int send_batch(void)
+{
+    uint8_t buf[STRESS_PDU_MAX];
+    uint16_t mtu = mock_ble_service_get_mtu();
+    rentscan_msg_t msg = {
+        .cmd = CMD_STATUS_RESP,
+        .status = STATUS_AVAILABLE,
+        .tag_id_len = STRESS_TAG_ID_LEN,
+        .epoch = run_id,
+        .payload_len = config.payload_len,
+    };
+    size_t len = 0;
+    uint8_t count = 0;
+
+    if (mtu <= 3) {
+        return -ENOTCONN;
+    }
+
+    size_t limit = MIN(mtu - 3, sizeof(buf));
+
+    memcpy(msg.tag_id, STRESS_TAG_ID, STRESS_TAG_ID_LEN);
+
+    while (count < config.batch) {
+        msg.corr_id = next_seq + count;
+        msg.timestamp = k_cycle_get_32();
+        memset(msg.payload, (uint8_t)msg.corr_id, msg.payload_len);
+
+        int enc = rentscan_msg_encode(&msg, &buf[len], limit - len);
+        if (enc == -ENOMEM) {
+            break;
+        }
+        if (enc < 0) {
+            return enc;
+        }
+
+        len += enc;
+        count++;
+    }
+
+    if (count == 0) {
+        return -EMSGSIZE;
+    }
+
+    int err = mock_ble_service_send_data(buf, len);
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    if (err == -ENOMEM) {
+        stats.notify_enomem++;
+    } else if (err) {
+        stats.notify_failed++;
+    } else {
+        next_seq += count;
+        stats.batch = count;
+        stats.notifies++;
+        stats.sent += count;
+        stats.tx_bytes += len;
+    }
+    k_spin_unlock(&stats_lock, key);
+
+    return err;
+}
+
+static void log_summary(void)
+{
+    struct stress_stats s;
+
+    stress_get_stats(&s);
+    LOG_INF("Stress run over after %u ms: %u notifies, %u sent, %u received",
+            s.elapsed_ms, s.notifies, s.sent, s.received);
+    LOG_INF("  lost %u, reordered %u, in flight %u, ENOMEM %u, failed %u",
+            s.lost, s.reordered, s.in_flight, s.notify_enomem, s.notify_failed);
+    LOG_INF("  rtt p50 %u us, p99 %u us, max %u us",
+            rentscan_latency_percentile(&s.rtt, 50),
+            rentscan_latency_percentile(&s.rtt, 99), s.rtt.max_us);
+}
+
+static void tick_work_handler(struct k_work *work)
+{
+    int64_t elapsed = k_uptime_get() - start_ms;
+    int err = 0;
+
+    if (!stats.running) {
+        return;
+    }
+
+    if (config.duration_s && elapsed >= (int64_t)config.duration_s * MSEC_PER_SEC) {
+        stress_stop();
+        log_summary();
+        return;
+    }
+
+    if (!mock_ble_service_is_connected()) {
+        k_work_schedule(&tick_work, K_MSEC(STRESS_IDLE_MS));
+        return;
+    }
+
+    /* Catch up on the notifications due so far, so the rate doesn't drift
+     * and a notification refused for lack of buffers is tried again.
+     */
+    int64_t due = STRESS_BURST_MAX;
+
+    if (config.rate_hz) {
+        due = elapsed * config.rate_hz / MSEC_PER_SEC + 1 - stats.notifies;
+        due = CLAMP(due, 0, STRESS_BURST_MAX);
+    }
+
+    while (due-- > 0) {
+        err = send_batch();
+        if (err) {
+            break;
+        }
+    }
+
+    if (err && err != -ENOMEM && err != -ENOTCONN) {
+        LOG_ERR("Stress run stopped (err %d)", err);
+        stress_stop();
+        return;
+    }
+
+    if (config.rate_hz) {
+        k_work_schedule(&tick_work, K_USEC(USEC_PER_SEC / config.rate_hz));
+    } else {
+        k_work_schedule(&tick_work, err ? K_MSEC(STRESS_RETRY_MS) : K_NO_WAIT);
+    }
+}
+
+void stress_init(void)
+{
+    k_work_init_delayable(&tick_work, tick_work_handler);
+}
+
+int stress_start(const struct stress_config *cfg)
+{
+    struct stress_config defaults = {
+        .rate_hz = CONFIG_RENTSCAN_STRESS_RATE_HZ,
+        .payload_len = CONFIG_RENTSCAN_STRESS_PAYLOAD_LEN,
+        .batch = CONFIG_RENTSCAN_STRESS_BATCH,
+        .duration_s = CONFIG_RENTSCAN_STRESS_DURATION_S,
+    };
+
+    if (!cfg) {
+        cfg = &defaults;
+    }
+
+    if (cfg->payload_len > MAX_MSG_PAYLOAD || cfg->batch == 0) {
+        return -EINVAL;
+    }
+
+    k_work_cancel_delayable(&tick_work);
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    config = *cfg;
+    memset(&stats, 0, sizeof(stats));
+    stats.running = true;
+    run_id++;
+    next_seq = 1;
+    expected_seq = 1;
+    start_ms = k_uptime_get();
+    k_spin_unlock(&stats_lock, key);
+
+    LOG_INF("Stress run: %u Hz, %u byte payload, batch %u, %u s",
+            config.rate_hz, config.payload_len, config.batch, config.duration_s);
+
+    k_work_schedule(&tick_work, K_NO_WAIT);
+    return 0;
+}
+
+void stress_stop(void)
+{
+    k_work_cancel_delayable(&tick_work);
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    if (stats.running) {
+        stats.running = false;
+        stats.elapsed_ms = k_uptime_get() - start_ms;
+    }
+    k_spin_unlock(&stats_lock, key);
+}
+
+bool stress_is_running(void)
+{
+    return stats.running;
+}
+
+bool stress_handle_write(const uint8_t *data, uint16_t len)
+{
+    uint32_t now = k_cycle_get_32();
+    size_t pos = 0;
+
+    while (pos < len) {
+        rentscan_msg_t msg;
+        int consumed = rentscan_msg_decode(&msg, &data[pos], len - pos);
+
+        if (consumed < 0 || !is_stress_msg(&msg)) {
+            break;
+        }
+        pos += consumed;
+        if (msg.epoch != run_id) {
+            continue;
+        }
+
+        uint32_t seq = msg.corr_id;
+        k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+        stats.received++;
+        if (seq >= expected_seq) {
+            /* Anything skipped counts as lost until it turns up late */
+            stats.lost += seq - expected_seq;
+            expected_seq = seq + 1;
+        } else {
+            stats.reordered++;
+            if (stats.lost) {
+                stats.lost--;
+            }
+        }
+        rentscan_latency_record(&stats.rtt, k_cyc_to_us_floor32(now - msg.timestamp));
+        k_spin_unlock(&stats_lock, key);
+    }
+
+    if (pos == 0) {
+        return false;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    stats.rx_bytes += pos;
+    k_spin_unlock(&stats_lock, key);
+    return true;
+}
+
+bool stress_handle_notify(const uint8_t *data, uint16_t len)
+{
+    uint32_t count = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+        rentscan_msg_t msg;
+        int consumed = rentscan_msg_decode(&msg, &data[pos], len - pos);
+
+        if (consumed < 0 || !is_stress_msg(&msg)) {
+            break;
+        }
+        pos += consumed;
+        count++;
+    }
+
+    if (count == 0) {
+        return false;
+    }
+
+    int err = mock_ble_central_send_data(data, len);
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    if (err) {
+        stats.echo_failed++;
+    } else {
+        stats.echoed += count;
+    }
+    k_spin_unlock(&stats_lock, key);
+    return true;
+}
+
+void stress_get_stats(struct stress_stats *out)
+{
+    k_spinlock_key_t key = k_spin_lock(&stats_lock);
+
+    *out = stats;
+    if (stats.running) {
+        out->elapsed_ms = k_uptime_get() - start_ms;
+    }
+    out->in_flight = next_seq - expected_seq;
+    k_spin_unlock(&stats_lock, key);
+}
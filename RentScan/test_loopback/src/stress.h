@@ -0,0 +1,109 @@
+/**
+ * @file stress.h
+ * @brief Loopback stress traffic between two boards running the test
+ *
+ * The peripheral role notifies batches of encoded rentscan_msg_t at a set
+ * rate and the central role of the other board writes every batch back
+ * unchanged. Each message carries a sequence number in corr_id and its
+ * send time in timestamp, so the sender can count lost and reordered
+ * messages and measure the round trip of every one of them.
+ */
+
+#ifndef STRESS_H
+#define STRESS_H
+
+#include <zephyr/types.h>
+#include <stdbool.h>
+#include "../../common/include/rentscan_protocol.h"
+#include "../../common/include/rentscan_latency.h"
+
+/** L2CAP and ATT headers sent with every notification */
+#define STRESS_PDU_OVERHEAD (4 + 3)
+
+/**
+ * @brief Shape of a stress run
+ */
+struct stress_config {
+    uint32_t rate_hz;       /**< Notifications per second, 0 for as fast as buffers allow */
+    uint8_t payload_len;    /**< Payload bytes per message */
+    uint8_t batch;          /**< Messages per notification */
+    uint32_t duration_s;    /**< Length of the run, 0 to run until stopped */
+};
+
+/**
+ * @brief Counters of the current or last stress run
+ */
+struct stress_stats {
+    bool running;           /**< A run is in progress */
+    uint32_t elapsed_ms;    /**< Length of the run so far */
+    uint8_t batch;          /**< Messages per notification at the current MTU */
+    uint32_t notifies;      /**< Notifications sent */
+    uint32_t notify_enomem; /**< Notifications refused for lack of buffers */
+    uint32_t notify_failed; /**< Notifications refused for other reasons */
+    uint32_t sent;          /**< Messages sent */
+    uint32_t received;      /**< Messages written back by the other board */
+    uint32_t lost;          /**< Messages skipped over by a later one */
+    uint32_t reordered;     /**< Messages written back after a later one */
+    uint32_t in_flight;     /**< Messages sent after the last one written back */
+    uint32_t tx_bytes;      /**< Notification payload bytes sent */
+    uint32_t rx_bytes;      /**< Write payload bytes received back */
+    uint32_t echoed;        /**< Messages of the other board written back */
+    uint32_t echo_failed;   /**< Batches of the other board not written back */
+    struct rentscan_latency_hist rtt; /**< Round trip of every received message */
+};
+
+/**
+ * @brief Initialize the stress mode
+ */
+void stress_init(void);
+
+/**
+ * @brief Start a stress run on the peripheral link
+ *
+ * Any run in progress is restarted and the counters are cleared.
+ *
+ * @param config Shape of the run, NULL for the Kconfig defaults
+ * @return int 0 on success, negative error code otherwise
+ */
+int stress_start(const struct stress_config *config);
+
+/**
+ * @brief Stop the stress run in progress
+ */
+void stress_stop(void);
+
+/**
+ * @brief Check whether a stress run is in progress
+ *
+ * @return true if a run is in progress
+ */
+bool stress_is_running(void);
+
+/**
+ * @brief Handle data written by the central of the other board
+ *
+ * @param data Data received
+ * @param len Length of the data
+ * @return true if the data was stress traffic and has been consumed
+ */
+bool stress_handle_write(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Handle a notification from the peripheral of the other board
+ *
+ * Stress traffic is written back unchanged.
+ *
+ * @param data Data received
+ * @param len Length of the data
+ * @return true if the data was stress traffic and has been consumed
+ */
+bool stress_handle_notify(const uint8_t *data, uint16_t len);
+
+/**
+ * @brief Get the counters of the current or last run
+ *
+ * @param stats Pointer to store the counters
+ */
+void stress_get_stats(struct stress_stats *stats);
+
+#endif /* STRESS_H */
\ No newline at end of file
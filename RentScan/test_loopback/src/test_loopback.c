@@ -9,8 +9,10 @@
 #include <zephyr/bluetooth/gatt.h>
 #include <zephyr/logging/log.h>
 #include <zephyr/shell/shell.h>
+#include <stdlib.h>
 
 #include "../../common/include/rentscan_protocol.h"
+#include "stress.h"
 
 LOG_MODULE_REGISTER(test_loopback, LOG_LEVEL_INF);
 
@@ -55,6 +57,12 @@ static struct {
 /* Message handlers */
 static void peripheral_data_received(const uint8_t *data, uint16_t len)
 {
+#if defined(CONFIG_RENTSCAN_STRESS)
+    if (stress_handle_write(data, len)) {
+        return;
+    }
+#endif
+
     LOG_INF("Peripheral received data (%u bytes)", len);
     test_stats.peripheral_msgs_received++;
     
@@ -66,6 +74,12 @@ static void peripheral_data_received(const uint8_t *data, uint16_t len)
 
 static void central_data_received(const uint8_t *data, uint16_t len)
 {
+#if defined(CONFIG_RENTSCAN_STRESS)
+    if (stress_handle_notify(data, len)) {
+        return;
+    }
+#endif
+
     LOG_INF("Central received data (%u bytes)", len);
     test_stats.central_msgs_received++;
     
@@ -80,6 +94,14 @@ static void send_test_message(void)
 {
     uint8_t test_data[8];
     
+#if defined(CONFIG_RENTSCAN_STRESS)
+    /* Keep the link to the stress traffic while a run is in progress */
+    if (stress_is_running()) {
+        k_work_schedule(&test_msg_work, K_SECONDS(10));
+        return;
+    }
+#endif
+
     test_stats.test_sequence++;
     
     /* Alternate between peripheral and central sending messages */
@@ -117,6 +139,14 @@ static void send_test_message(void)
 /* Test message work handler */
 static void test_msg_work_handler(struct k_work *work)
 {
+#if defined(CONFIG_RENTSCAN_STRESS_AUTOSTART)
+    static bool stress_started;
+
+    if (!stress_started && mock_ble_service_is_connected()) {
+        stress_started = stress_start(NULL) == 0;
+    }
+#endif
+
     send_test_message();
 }
 
@@ -319,6 +349,104 @@ static int cmd_reset_ble(const struct shell *sh, size_t argc, char *argv[])
     return 0;
 }
 
+#if defined(CONFIG_RENTSCAN_STRESS)
+static int cmd_stress_start(const struct shell *sh, size_t argc, char *argv[])
+{
+    struct stress_config config = {
+        .rate_hz = CONFIG_RENTSCAN_STRESS_RATE_HZ,
+        .payload_len = CONFIG_RENTSCAN_STRESS_PAYLOAD_LEN,
+        .batch = CONFIG_RENTSCAN_STRESS_BATCH,
+        .duration_s = CONFIG_RENTSCAN_STRESS_DURATION_S,
+    };
+
+    if (argc > 1) {
+        config.rate_hz = strtoul(argv[1], NULL, 10);
+    }
+    if (argc > 2) {
+        config.payload_len = MIN(strtoul(argv[2], NULL, 10), MAX_MSG_PAYLOAD);
+    }
+    if (argc > 3) {
+        config.batch = CLAMP(strtoul(argv[3], NULL, 10), 1, UINT8_MAX);
+    }
+    if (argc > 4) {
+        config.duration_s = strtoul(argv[4], NULL, 10);
+    }
+
+    if (!mock_ble_service_is_connected()) {
+        shell_warn(sh, "Peripheral not connected, the run starts once it is");
+    }
+
+    int err = stress_start(&config);
+    if (err) {
+        shell_error(sh, "Failed to start stress run (err %d)", err);
+        return err;
+    }
+
+    shell_print(sh, "Stress run started: %u Hz, %u byte payload, batch %u, %u s",
+                config.rate_hz, config.payload_len, config.batch, config.duration_s);
+    return 0;
+}
+
+static int cmd_stress_stop(const struct shell *sh, size_t argc, char *argv[])
+{
+    stress_stop();
+    shell_print(sh, "Stress run stopped");
+    return 0;
+}
+
+/* Value per second over the run */
+static uint32_t per_sec(uint32_t value, uint32_t elapsed_ms)
+{
+    return elapsed_ms ? (uint64_t)value * MSEC_PER_SEC / elapsed_ms : 0;
+}
+
+static int cmd_stress_status(const struct shell *sh, size_t argc, char *argv[])
+{
+    struct stress_stats s;
+
+    stress_get_stats(&s);
+
+    uint32_t attempts = s.notifies + s.notify_enomem + s.notify_failed;
+    uint32_t enomem_permille = attempts ? (uint64_t)s.notify_enomem * 1000 / attempts : 0;
+    uint32_t on_air = s.tx_bytes + s.notifies * STRESS_PDU_OVERHEAD;
+
+    shell_print(sh, "Stress run: %s, %u ms", s.running ? "running" : "stopped", s.elapsed_ms);
+    shell_print(sh, "Sent:");
+    shell_print(sh, "  Notifications:      %u (%u/s, batch %u)", s.notifies,
+                per_sec(s.notifies, s.elapsed_ms), s.batch);
+    shell_print(sh, "  Messages:           %u (%u/s)", s.sent, per_sec(s.sent, s.elapsed_ms));
+    shell_print(sh, "  Payload:            %u bytes (%u B/s)", s.tx_bytes,
+                per_sec(s.tx_bytes, s.elapsed_ms));
+    shell_print(sh, "  On air:             %u B/s with L2CAP and ATT headers",
+                per_sec(on_air, s.elapsed_ms));
+    shell_print(sh, "  ENOMEM:             %u (%u.%u%% of attempts)", s.notify_enomem,
+                enomem_permille / 10, enomem_permille % 10);
+    shell_print(sh, "  Other failures:     %u", s.notify_failed);
+    shell_print(sh, "Received back:");
+    shell_print(sh, "  Messages:           %u (%u B/s)", s.received,
+                per_sec(s.rx_bytes, s.elapsed_ms));
+    shell_print(sh, "  Lost:               %u", s.lost);
+    shell_print(sh, "  Reordered:          %u", s.reordered);
+    shell_print(sh, "  In flight:          %u", s.in_flight);
+    shell_print(sh, "  RTT (us):           mean %u, p50 %u, p90 %u, p99 %u, max %u",
+                rentscan_latency_mean(&s.rtt), rentscan_latency_percentile(&s.rtt, 50),
+                rentscan_latency_percentile(&s.rtt, 90),
+                rentscan_latency_percentile(&s.rtt, 99), s.rtt.max_us);
+    shell_print(sh, "Echoed for the other board:");
+    shell_print(sh, "  Messages:           %u", s.echoed);
+    shell_print(sh, "  Failed writes:      %u", s.echo_failed);
+    return 0;
+}
+
+SHELL_STATIC_SUBCMD_SET_CREATE(stress_cmds,
+    SHELL_CMD_ARG(start, NULL, "Start a run [rate_hz] [payload_len] [batch] [duration_s]",
+                  cmd_stress_start, 1, 4),
+    SHELL_CMD(stop, NULL, "Stop the run", cmd_stress_stop),
+    SHELL_CMD(status, NULL, "Show throughput, loss and RTT of the run", cmd_stress_status),
+    SHELL_SUBCMD_SET_END
+);
+#endif
+
 /* Create subcmd set for scan subcommand */
 SHELL_STATIC_SUBCMD_SET_CREATE(scan_cmds,
     SHELL_CMD(start, NULL, "Start scanning for devices", cmd_start_scan),
@@ -338,6 +466,9 @@ SHELL_STATIC_SUBCMD_SET_CREATE(rentscan_test_cmds,
     SHELL_CMD(scan, &scan_cmds, "Scanning commands", NULL),
     SHELL_CMD(adv, &adv_cmds, "Advertising commands", NULL),
     SHELL_CMD(reset, NULL, "Reset Bluetooth stack and restart", cmd_reset_ble),
+#if defined(CONFIG_RENTSCAN_STRESS)
+    SHELL_CMD(stress, &stress_cmds, "Stress traffic commands", NULL),
+#endif
     SHELL_SUBCMD_SET_END
 );
 
@@ -372,6 +503,9 @@ int main(void)
     k_work_init_delayable(&test_msg_work, test_msg_work_handler);
     k_work_init_delayable(&start_scan_work, start_scan_work_handler);
     k_work_init_delayable(&retry_work, retry_work_handler);
+#if defined(CONFIG_RENTSCAN_STRESS)
+    stress_init();
+#endif
     
     /* Initialize retry state */
     retry_state.remaining_adv_attempts = MAX_RETRY_ATTEMPTS;
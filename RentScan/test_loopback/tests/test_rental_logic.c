@@ -1,32 +1,184 @@
-#include <zephyr/ztest.h>
-#include <zephyr/kernel.h>
-#include <rental_logic.h>
-
-/* Stub BLE send function */
-static int ble_send_count;
-void ble_send(const char *msg)
-{
-    ARG_UNUSED(msg);
-    ble_send_count++;
-}
-
-ZTEST_SUITE(rental_logic_tests, NULL, NULL, NULL, NULL, NULL);
-
-ZTEST(rental_logic_tests, test_invalid_scan)
-{
-    ble_send_count = 0;
-    /* Invalid inputs should not trigger BLE send */
-    rental_logic_process_scan(NULL, 0);
-    zassert_equal(ble_send_count, 0, "ble_send should not be called on invalid scan");
-}
-
-ZTEST(rental_logic_tests, test_active_update)
-{
-    ble_send_count = 0;
-    uint8_t id[] = "ITEM123";
-
-    rental_logic_process_scan(id, sizeof(id) - 1);
-    /* First update: rental active, should send one message */
-    rental_logic_update_status();
-    zassert_equal(ble_send_count, 1, "Expected one notification for active rental");
-}
+#include <zephyr/ztest.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/byteorder.h>
+#include <rentscan_protocol.h>
+#include <rentscan_dedup.h>
+#include <rentscan_time.h>
+#include "rental_manager.h"
+#include "latency_stats.h"
+#include "workq.h"
+
+/* Stub BLE send functions, only the reports and time requests use them */
+int ble_service_send_message(const rentscan_msg_t *msg)
+{
+    ARG_UNUSED(msg);
+    return 0;
+}
+
+int ble_service_send_message_wait(const rentscan_msg_t *msg)
+{
+    return ble_service_send_message(msg);
+}
+
+/* Status notifications for the gateway */
+static int status_count;
+static int status_refusals;
+static rentscan_msg_t last_status;
+
+static int status_changed(const rentscan_msg_t *msg)
+{
+    last_status = *msg;
+    status_count++;
+
+    /* As a TX queue that stayed full */
+    if (status_refusals > 0) {
+        status_refusals--;
+        return -ENOBUFS;
+    }
+    return 0;
+}
+
+static void *rental_logic_setup(void)
+{
+    workq_init();
+    latency_stats_init();
+    zassert_ok(rental_manager_init(status_changed), "Rental manager init failed");
+    return NULL;
+}
+
+static void rental_logic_before(void *fixture)
+{
+    ARG_UNUSED(fixture);
+    status_count = 0;
+    status_refusals = 0;
+}
+
+ZTEST_SUITE(rental_logic_tests, NULL, rental_logic_setup, rental_logic_before, NULL, NULL);
+
+ZTEST(rental_logic_tests, test_invalid_scan)
+{
+    /* Invalid inputs should not trigger a notification */
+    zassert_equal(rental_manager_process_tag(NULL, 0, NULL, 0), -EINVAL);
+    zassert_equal(status_count, 0, "No notification expected on invalid scan");
+}
+
+ZTEST(rental_logic_tests, test_active_update)
+{
+    uint8_t id[] = "ITEM123";
+
+    /* First scan: new item, should send one message */
+    zassert_ok(rental_manager_process_tag(id, sizeof(id) - 1, NULL, 0));
+    zassert_equal(status_count, 1, "Expected one notification for a new item");
+    zassert_equal(last_status.tag_id_len, sizeof(id) - 1);
+    zassert_mem_equal(last_status.tag_id, id, sizeof(id) - 1);
+
+    /* Scanning it again changes nothing */
+    zassert_ok(rental_manager_process_tag(id, sizeof(id) - 1, NULL, 0));
+    zassert_equal(status_count, 1, "No notification expected for a known item");
+}
+
+ZTEST(rental_logic_tests, test_rental_start)
+{
+    uint8_t id[] = "ITEM456";
+    rentscan_msg_t start = {
+        .cmd = CMD_RENTAL_START,
+        .status = STATUS_RENTED,
+        .tag_id_len = sizeof(id) - 1,
+        .timestamp = k_uptime_get_32() / 1000,
+        .duration = 300,
+    };
+    uint8_t buf[RENTSCAN_WIRE_MSG_MAX_LEN];
+    rentscan_status_t status;
+
+    memcpy(start.tag_id, id, sizeof(id) - 1);
+    zassert_ok(rental_manager_process_tag(id, sizeof(id) - 1, NULL, 0));
+
+    /* The gateway's answer rents the item out */
+    int len = rentscan_msg_encode(&start, buf, sizeof(buf));
+
+    zassert_true(len > 0, "Encode failed");
+    zassert_ok(rental_manager_process_command(buf, len));
+    zassert_ok(rental_manager_get_status(id, sizeof(id) - 1, &status));
+    zassert_equal(status, STATUS_RENTED, "Item should be rented");
+}
+
+ZTEST(rental_logic_tests, test_status_resend)
+{
+    uint8_t id[] = "ITEM789";
+
+    /* A refused update is sent again from the rental work queue */
+    status_refusals = 1;
+    zassert_ok(rental_manager_process_tag(id, sizeof(id) - 1, NULL, 0));
+    zassert_equal(status_count, 1, "Expected the first attempt");
+
+    k_sleep(K_SECONDS(1));
+    zassert_equal(status_count, 2, "Expected the update to be sent again");
+    zassert_mem_equal(last_status.tag_id, id, sizeof(id) - 1);
+
+    k_sleep(K_SECONDS(1));
+    zassert_equal(status_count, 2, "No further resend expected");
+}
+
+RENTSCAN_DEDUP_DEFINE(window_dedup, 4, 100);
+RENTSCAN_DEDUP_DEFINE(lru_dedup, 2, 1000);
+
+ZTEST_SUITE(dedup_tests, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(dedup_tests, test_window)
+{
+    uint8_t id[] = "ITEM123";
+
+    zassert_false(rentscan_dedup_check(&window_dedup, id, sizeof(id) - 1), "First scan");
+    zassert_true(rentscan_dedup_check(&window_dedup, id, sizeof(id) - 1), "Repeated scan");
+
+    /* Held at the reader: every sighting restarts the window */
+    k_sleep(K_MSEC(60));
+    zassert_true(rentscan_dedup_check(&window_dedup, id, sizeof(id) - 1));
+    k_sleep(K_MSEC(60));
+    zassert_true(rentscan_dedup_check(&window_dedup, id, sizeof(id) - 1));
+
+    /* Taken away for longer than the window */
+    k_sleep(K_MSEC(110));
+    zassert_false(rentscan_dedup_check(&window_dedup, id, sizeof(id) - 1), "Window over");
+}
+
+ZTEST(dedup_tests, test_lru)
+{
+    uint8_t a[] = "ITEMA";
+    uint8_t b[] = "ITEMB";
+    uint8_t c[] = "ITEMC";
+
+    zassert_false(rentscan_dedup_check(&lru_dedup, a, sizeof(a) - 1));
+    k_sleep(K_MSEC(1));
+    zassert_false(rentscan_dedup_check(&lru_dedup, b, sizeof(b) - 1));
+    k_sleep(K_MSEC(1));
+    zassert_true(rentscan_dedup_seen(&lru_dedup, a, sizeof(a) - 1));
+
+    /* B was seen least recently, C takes its place */
+    k_sleep(K_MSEC(1));
+    zassert_false(rentscan_dedup_check(&lru_dedup, c, sizeof(c) - 1));
+    zassert_true(rentscan_dedup_seen(&lru_dedup, a, sizeof(a) - 1));
+    zassert_false(rentscan_dedup_seen(&lru_dedup, b, sizeof(b) - 1), "B evicted");
+    zassert_true(rentscan_dedup_seen(&lru_dedup, c, sizeof(c) - 1));
+}
+
+ZTEST_SUITE(time_tests, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(time_tests, test_offset_estimate)
+{
+    rentscan_msg_t req;
+    rentscan_msg_t resp;
+    struct rentscan_time_sample sample;
+    uint32_t t1 = rentscan_time_request(&req);
+
+    zassert_ok(rentscan_time_respond(&req, &resp));
+
+    /* The gateway's clock is 5 s ahead and the round trip takes 100 ms */
+    sys_put_le64((int64_t)t1 + 5050, &resp.payload[RENTSCAN_TIME_REQ_LEN]);
+    zassert_ok(rentscan_time_sample(&resp, t1, (int64_t)t1 + 100, &sample));
+    zassert_equal(sample.rtt_ms, 100);
+    zassert_equal(sample.offset_ms, 5000);
+
+    /* An answer to an earlier request doesn't count */
+    zassert_equal(rentscan_time_sample(&resp, t1 + 1, (int64_t)t1 + 100, &sample), -ESTALE);
+}